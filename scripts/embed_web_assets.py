@@ -0,0 +1,106 @@
+# EMBED THE WEB UI IN THE FIRMWARE - GZIPPED AT BUILD TIME, WITH A CONTENT HASH AS ITS ETAG
+# Runs before every PlatformIO build (extra_scripts = pre:scripts/embed_web_assets.py) and rewrites
+# src/web_assets.h only when something under web/ changed. Can also be run by hand:
+#   python scripts/embed_web_assets.py
+import gzip
+import hashlib
+import os
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    PROJECT_DIR = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+WEB_DIR = os.path.join(PROJECT_DIR, "web")
+OUTPUT = os.path.join(PROJECT_DIR, "src", "web_assets.h")
+
+# THE PAGE IS REVALIDATED ON EVERY LOAD (A 304 WHEN UNCHANGED). IT REFERS TO THE OTHER ASSETS BY
+# CONTENT HASH ({{name}} PLACEHOLDERS), SO THOSE CAN BE CACHED FOR GOOD
+REVALIDATE = "no-cache"
+IMMUTABLE = "public, max-age=31536000, immutable"
+ASSETS = [
+    # file, URL, content type
+    ("app.css", "/app.css", "text/css"),
+    ("app.js", "/app.js", "application/javascript"),
+    ("index.html", "/", "text/html; charset=utf-8"),
+]
+
+
+def compress(data):
+    return gzip.compress(data, compresslevel=9, mtime=0)  # mtime=0 keeps the output reproducible
+
+
+def etag_of(gz):
+    return '"' + hashlib.sha256(gz).hexdigest()[:16] + '"'
+
+
+def c_array(name, data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    return "static const uint8_t %s[] PROGMEM = {\n%s\n};\n" % (name, "\n".join(lines))
+
+
+def build():
+    arrays, entries, versions = [], [], {}
+    for index, (filename, path, content_type) in enumerate(ASSETS):
+        with open(os.path.join(WEB_DIR, filename), "rb") as f:
+            raw = f.read()
+        for name, version in versions.items():
+            raw = raw.replace(("{{%s}}" % name).encode(), ("%s?v=%s" % (name, version)).encode())
+        gz = compress(raw)
+        etag = etag_of(gz)
+        versions[filename] = etag.strip('"')[:8]
+        symbol = "web_asset_%d" % index
+        arrays.append("// %s: %u bytes, %u gzipped\n%s" % (filename, len(raw), len(gz), c_array(symbol, gz)))
+        cache = REVALIDATE if path == "/" else IMMUTABLE
+        entries.append('    {"%s", "%s", "%s", "%s", %s, sizeof(%s), %u},'
+                       % (path, content_type, cache, etag.replace('"', '\\"'), symbol, symbol, len(raw)))
+
+    return """// GENERATED BY scripts/embed_web_assets.py FROM web/ - DO NOT EDIT
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include <Arduino.h>
+
+// ONE FILE OF THE WEB UI, STORED GZIPPED AND SENT AS-IS WITH Content-Encoding: gzip
+struct WebAsset {
+    const char* path;
+    const char* contentType;
+    const char* cacheControl;
+    const char* etag;           // Strong ETag, quoted: a hash of the gzipped bytes
+    const uint8_t* data;
+    size_t len;
+    size_t rawLen;              // Size before compression, for diagnostics
+};
+
+// TRUE IF A REQUEST'S If-None-Match (NULL WHEN ABSENT) ALREADY NAMES THIS ASSET, SO A BODILESS 304 WILL DO.
+// IT MAY LIST SEVERAL TAGS, AND MATCHING IS WEAK (W/"..." COUNTS) AS RFC 9110 ASKS FOR If-None-Match
+inline bool webAssetNotModified(const WebAsset& asset, const char* ifNoneMatch) {
+    return ifNoneMatch && (strcmp(ifNoneMatch, "*") == 0 || strstr(ifNoneMatch, asset.etag) != nullptr);
+}
+
+%s
+static const WebAsset WEB_ASSETS[] = {
+%s
+};
+
+#endif
+""" % ("\n".join(arrays), "\n".join(entries))
+
+
+def main():
+    header = build()
+    try:
+        with open(OUTPUT) as f:
+            if f.read() == header:
+                return
+    except OSError:
+        pass
+    with open(OUTPUT, "w") as f:
+        f.write(header)
+    print("Embedded web assets into %s" % os.path.relpath(OUTPUT, PROJECT_DIR))
+
+
+main()
@@ -6,20 +6,39 @@
 // DEVICE CONFIGURATION - SET IN PLATFORMIO.INI
 #if defined(HELTEC_V3_BOARD)
     const String MY_DEVICE_ID = "BigNode"; 
-    const String LORA_PACKET_PREFIX = "P:";
+    const uint16_t MY_NODE_ADDRESS = 0x0001;
     const String WIFI_SSID = "BigNode_AP";
     const String WIFI_PASSWORD = "offlinecomms";
     const String BOARD_TYPE_NAME = "BigNode";
+    const bool RELAY_ENABLED = true;   // Rebroadcast other nodes' frames (managed flooding)
+    const uint16_t MY_GROUPS[] = { 0xFF01 }; // Group addresses this node receives (see KNOWN_GROUPS)
 
 #elif defined(XIAO_ESP32S3_BOARD) 
     const String MY_DEVICE_ID = "PhoneNode";
-    const String LORA_PACKET_PREFIX = "P:";
+    const uint16_t MY_NODE_ADDRESS = 0x0002;
     const String WIFI_SSID = "PhoneNode_AP";
     const String WIFI_PASSWORD = "offlinecomms"; 
     const String BOARD_TYPE_NAME = "PhoneNode";
+    const bool RELAY_ENABLED = true;
+    const uint16_t MY_GROUPS[] = { 0xFF01 };
 
 #else
     #error "Board type not defined!"
 #endif
 
+// KNOWN NODES - MAPS SHORT LORA ADDRESSES TO DISPLAY NAMES
+struct KnownNode {
+    uint16_t address;
+    const char* name;
+};
+const KnownNode KNOWN_NODES[] = {
+    { 0x0001, "BigNode" },
+    { 0x0002, "PhoneNode" },
+};
+
+// KNOWN GROUPS - GROUP ADDRESSES (0xFF00..0xFFFE) OFFERED AS RECIPIENTS, MEMBERSHIP IS MY_GROUPS
+const KnownNode KNOWN_GROUPS[] = {
+    { 0xFF01, "Team" },
+};
+
 #endif
\ No newline at end of file
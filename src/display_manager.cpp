@@ -17,13 +17,24 @@ static String storedApPassword_disp;
 static String currentApIp_disp = "0.0.0.0";
 static int wifiClientCount_disp = 0;
 
-static String lastLoRaRx_disp_content = "---";
-static String lastLoRaTx_disp_content = "---";
-static String statusMsg_disp_content = "Booting...";
+// FIXED BUFFERS, CUT TO WHAT FITS ON SCREEN - SET FROM THE LORA PATH WITHOUT TOUCHING THE HEAP
+#define DISPLAY_LORA_TEXT_LEN 18
+#define DISPLAY_STATUS_LEN 20
+static char lastLoRaRx_disp_content[DISPLAY_LORA_TEXT_LEN + 1] = "---";
+static char lastLoRaTx_disp_content[DISPLAY_LORA_TEXT_LEN + 1] = "---";
+static char statusMsg_disp_content[DISPLAY_STATUS_LEN + 1] = "Booting...";
 
 volatile bool displayNeedsUpdate = true;
 
 // HELPER FUNCTIONS (BOARD-SPECIFIC IF NECESSARY)
+static void setStatusText(const char* text) {
+    strlcpy(statusMsg_disp_content, text, sizeof(statusMsg_disp_content));
+}
+
+static void setClientCountStatus(const char* format) {
+    snprintf(statusMsg_disp_content, sizeof(statusMsg_disp_content), format, wifiClientCount_disp);
+}
+
 #if defined(HELTEC_V3_BOARD)
 void powerOnDisplay_internal() {
     pinMode(DISPLAY_VEXT_PIN, OUTPUT);
@@ -45,7 +56,7 @@ void setupDisplay() {
     Wire.begin(DISPLAY_OLED_SDA_PIN, DISPLAY_OLED_SCL_PIN);
     if (!u8g2.begin()) {
         Serial.println(F("  Display Init FAILED!"));
-        statusMsg_disp_content = "Display Fail";
+        setStatusText("Display Fail");
         displayNeedsUpdate = true;
         return;
     }
@@ -60,12 +71,12 @@ void setupDisplay() {
     delay(2000); // Display splash for 2 seconds
 
     currentDisplayState = STATE_AP_DETAILS; // New default state after splash
-    statusMsg_disp_content = "AP Starting..."; 
+    setStatusText("AP Starting..."); 
     displayNeedsUpdate = true;
 }
 
 void updateDisplay() {
-    if (statusMsg_disp_content == "Display Fail" && currentDisplayState != STATE_BOOTING) {
+    if (strcmp(statusMsg_disp_content, "Display Fail") == 0 && currentDisplayState != STATE_BOOTING) {
         if (!displayNeedsUpdate) return; 
         u8g2.clearBuffer();
         u8g2.setFont(u8g2_font_ncenB08_tr);
@@ -103,16 +114,16 @@ void updateDisplay() {
             break;
 
         case STATE_CHAT_VIEW:
-            u8g2.setCursor(0, 28); u8g2.print("TX: " + lastLoRaTx_disp_content.substring(0,18));
-            u8g2.setCursor(0, 42); u8g2.print("RX: " + lastLoRaRx_disp_content.substring(0,18));
+            u8g2.setCursor(0, 28); u8g2.print("TX: "); u8g2.print(lastLoRaTx_disp_content);
+            u8g2.setCursor(0, 42); u8g2.print("RX: "); u8g2.print(lastLoRaRx_disp_content);
             break;
         
         case STATE_RX_ALERT:
-            u8g2.setCursor(0, 35); u8g2.print("RX: " + lastLoRaRx_disp_content.substring(0,18)); 
+            u8g2.setCursor(0, 35); u8g2.print("RX: "); u8g2.print(lastLoRaRx_disp_content); 
             break;
     }
     if (currentDisplayState != STATE_BOOTING) {
-        u8g2.setCursor(0, 58); u8g2.print(statusMsg_disp_content.substring(0,20));
+        u8g2.setCursor(0, 58); u8g2.print(statusMsg_disp_content);
     }
 
     u8g2.sendBuffer();
@@ -125,16 +136,16 @@ void setDisplayState(DisplayState newState) {
         currentDisplayState = newState;
         switch (newState) {
             case STATE_AP_DETAILS:
-                statusMsg_disp_content = "AP Mode Active";
+                setStatusText("AP Mode Active");
                 break;
             case STATE_IP_READY:
-                statusMsg_disp_content = String(wifiClientCount_disp) + " WiFi Client(s)";
+                setClientCountStatus("%d WiFi Client(s)");
                 break;
             case STATE_CHAT_VIEW:
-                statusMsg_disp_content = "Web Client Online";
+                setStatusText("Web Client Online");
                 break;
             case STATE_RX_ALERT:
-                statusMsg_disp_content = "LoRa Msg Received!";
+                setStatusText("LoRa Msg Received!");
                 break;
             default:
                 break;
@@ -147,7 +158,7 @@ void setDisplayAPIP(const String& ipAddress) {
     if (currentApIp_disp != ipAddress) {
         currentApIp_disp = ipAddress;
         if (currentDisplayState == STATE_AP_DETAILS && ipAddress != "0.0.0.0") {
-            statusMsg_disp_content = "AP Ready. Clients: " + String(wifiClientCount_disp);
+            setClientCountStatus("AP Ready. Clients: %d");
         }
         displayNeedsUpdate = true;
     }
@@ -172,9 +183,9 @@ void setDisplayWiFiClientCount(int count) {
     }
     // Update status line if relevant and state hasn't changed to something else
     if (currentDisplayState == STATE_AP_DETAILS) {
-         statusMsg_disp_content = "AP Ready. Clients: " + String(wifiClientCount_disp);
+         setClientCountStatus("AP Ready. Clients: %d");
     } else if (currentDisplayState == STATE_IP_READY) {
-         statusMsg_disp_content = String(wifiClientCount_disp) + " WiFi Client(s)";
+         setClientCountStatus("%d WiFi Client(s)");
     }
     displayNeedsUpdate = true;
 }
@@ -196,32 +207,32 @@ void setDisplayWebSocketStatus(bool connected) {
     displayNeedsUpdate = true; 
 }
 
-void setDisplayStatusLine(const String& status) {
-    if (statusMsg_disp_content != status) {
-        statusMsg_disp_content = status;
+void setDisplayStatusLine(const char* status) {
+    if (strncmp(statusMsg_disp_content, status, DISPLAY_STATUS_LEN) != 0) {
+        setStatusText(status);
         displayNeedsUpdate = true;
     }
 }
 
-void setLastLoRaRx(const String& rx) {
-    if (lastLoRaRx_disp_content != rx) {
-        lastLoRaRx_disp_content = rx;
+void setLastLoRaRx(const char* rx) {
+    if (strncmp(lastLoRaRx_disp_content, rx, DISPLAY_LORA_TEXT_LEN) != 0) {
+        strlcpy(lastLoRaRx_disp_content, rx, sizeof(lastLoRaRx_disp_content));
 
         if (currentDisplayState == STATE_AP_DETAILS || currentDisplayState == STATE_IP_READY) {
             setDisplayState(STATE_RX_ALERT);
         } else {
-            if (currentDisplayState == STATE_RX_ALERT) statusMsg_disp_content = "LoRa Msg Updated!";
-            else if (currentDisplayState == STATE_CHAT_VIEW) statusMsg_disp_content = "New LoRa RX";
+            if (currentDisplayState == STATE_RX_ALERT) setStatusText("LoRa Msg Updated!");
+            else if (currentDisplayState == STATE_CHAT_VIEW) setStatusText("New LoRa RX");
         }
         displayNeedsUpdate = true;
     }
 }
 
-void setLastLoRaTx(const String& tx) {
-    if (lastLoRaTx_disp_content != tx) {
-        lastLoRaTx_disp_content = tx;
+void setLastLoRaTx(const char* tx) {
+    if (strncmp(lastLoRaTx_disp_content, tx, DISPLAY_LORA_TEXT_LEN) != 0) {
+        strlcpy(lastLoRaTx_disp_content, tx, sizeof(lastLoRaTx_disp_content));
         if (currentDisplayState == STATE_CHAT_VIEW) { 
-             statusMsg_disp_content = "LoRa TX Sent";
+             setStatusText("LoRa TX Sent");
         }
         displayNeedsUpdate = true;
     }
@@ -44,8 +44,8 @@ void setDisplayState(DisplayState newState); // To manually change state if need
 void setDisplayAPIP(const String& ipAddress); // To provide the AP IP once known
 void setDisplayWiFiClientCount(int count);   // To inform display manager of WiFi clients
 void setDisplayWebSocketStatus(bool connected); // To inform of WebSocket client connection
-void setDisplayStatusLine(const String& status); // For a general status line at the bottom
-void setLastLoRaRx(const String& rx);            // Update last received LoRa message
-void setLastLoRaTx(const String& tx);            // Update last transmitted LoRa message
+void setDisplayStatusLine(const char* status);   // For a general status line at the bottom
+void setLastLoRaRx(const char* rx);              // Update last received LoRa message
+void setLastLoRaTx(const char* tx);              // Update last transmitted LoRa message
 
 #endif
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "encryption.h"
+#include "mbedtls/ccm.h"
+
+// SHARED NETWORK KEY (16 BYTES)
+static const char ENCRYPTION_KEY[] = "SecureLoraComms1";
+
+// KEY SCHEDULE IS EXPANDED ONCE AND REUSED FOR EVERY FRAME
+static mbedtls_ccm_context ccmContext;
+static bool ccmReady = false;
+
+void setupEncryption()
+{
+  mbedtls_ccm_init(&ccmContext);
+  int ret = mbedtls_ccm_setkey(&ccmContext, MBEDTLS_CIPHER_ID_AES, (const unsigned char *)ENCRYPTION_KEY, 128);
+  if (ret != 0)
+  {
+    Serial.printf("[Crypto] CCM key setup FAILED, code: %d\n", ret);
+    return;
+  }
+  ccmReady = true;
+}
+
+// NONCE = SRC | DST | SEQUENCE | TYPE | ATTEMPT, UNIQUE PER TRANSMISSION: EACH STREAM'S SEQUENCE NEVER
+// REPEATS AND A RETRANSMISSION CARRIES THE NEXT ATTEMPT. AN ACK'S CUMULATIVE ACK DOES REPEAT, SO ACKS
+// USE THEIR SERIAL IN ITS PLACE
+static void buildNonce(uint8_t *nonce, const LoRaFrameHeader &header)
+{
+  uint32_t sequence = (header.type == LORA_FRAME_ACK) ? header.ackSerial : header.messageId;
+  memset(nonce, 0, LORA_CCM_NONCE_LEN);
+  nonce[0] = (uint8_t)header.srcAddress;
+  nonce[1] = (uint8_t)(header.srcAddress >> 8);
+  nonce[2] = (uint8_t)header.dstAddress;
+  nonce[3] = (uint8_t)(header.dstAddress >> 8);
+  nonce[4] = (uint8_t)sequence;
+  nonce[5] = (uint8_t)(sequence >> 8);
+  nonce[6] = (uint8_t)(sequence >> 16);
+  nonce[7] = (uint8_t)(sequence >> 24);
+  nonce[8] = header.type;
+  nonce[9] = header.attempt;
+}
+
+// ENCRYPT IN PLACE AND WRITE LORA_AUTH_TAG_LEN TAG BYTES, AAD IS AUTHENTICATED BUT NOT ENCRYPTED
+// (LEN 0 ONLY TAGS THE AAD, AS FOR ACK FRAMES)
+bool encryptPayload(uint8_t *data, size_t len, const uint8_t *aad, size_t aadLen,
+                    const LoRaFrameHeader &header, uint8_t *tag)
+{
+  if (!ccmReady)
+    return false;
+  uint8_t nonce[LORA_CCM_NONCE_LEN];
+  buildNonce(nonce, header);
+  return mbedtls_ccm_encrypt_and_tag(&ccmContext, len, nonce, sizeof(nonce), aad, aadLen,
+                                     data, data, tag, LORA_AUTH_TAG_LEN) == 0;
+}
+
+// VERIFY AND DECRYPT IN PLACE, FALSE (DATA UNUSABLE) IF THE TAG DOES NOT MATCH
+bool decryptPayload(uint8_t *data, size_t len, const uint8_t *aad, size_t aadLen,
+                    const LoRaFrameHeader &header, const uint8_t *tag)
+{
+  if (!ccmReady)
+    return false;
+  uint8_t nonce[LORA_CCM_NONCE_LEN];
+  buildNonce(nonce, header);
+  return mbedtls_ccm_auth_decrypt(&ccmContext, len, nonce, sizeof(nonce), aad, aadLen,
+                                  data, data, tag, LORA_AUTH_TAG_LEN) == 0;
+}
@@ -0,0 +1,30 @@
+#ifndef LORA_AIRTIME_H
+#define LORA_AIRTIME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// LORA TIME ON AIR (SEMTECH AN1200.13 / SX1262 DATASHEET 6.1.4)
+// Explicit header and payload CRC, as configured by setupLoRaRadio().
+// Low data rate optimisation is assumed whenever a symbol lasts longer than
+// 16 ms, matching RadioLib's automatic setting. codingRate is the
+// denominator of 4/5..4/8, i.e. 5..8.
+inline uint32_t loRaTimeOnAirUs(size_t frameLen, uint8_t spreadingFactor, float bandwidthKhz,
+                                uint8_t codingRate, uint16_t preambleLen) {
+    float symbolUs = (float)(1UL << spreadingFactor) * 1000.0f / bandwidthKhz;
+    int lowDataRate = (symbolUs > 16000.0f) ? 1 : 0;
+
+    int numerator = 8 * (int)frameLen - 4 * spreadingFactor + 28 + 16;
+    int denominator = 4 * (spreadingFactor - 2 * lowDataRate);
+    int payloadBlocks = (numerator > 0) ? (numerator + denominator - 1) / denominator : 0;
+    float symbols = (float)preambleLen + 4.25f + 8.0f + (float)(payloadBlocks * codingRate);
+
+    return (uint32_t)(symbols * symbolUs + 0.5f);
+}
+
+inline uint32_t loRaTimeOnAirMs(size_t frameLen, uint8_t spreadingFactor, float bandwidthKhz,
+                                uint8_t codingRate, uint16_t preambleLen) {
+    return (loRaTimeOnAirUs(frameLen, spreadingFactor, bandwidthKhz, codingRate, preambleLen) + 999) / 1000;
+}
+
+#endif
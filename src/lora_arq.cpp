@@ -0,0 +1,251 @@
+#include "lora_arq.h"
+#include "lora_packet.h"
+
+// STREAM TABLES
+static ArqTxStream txStreams[ARQ_MAX_PEERS];
+static ArqRxStream rxStreams[ARQ_MAX_PEERS];
+
+// SEQUENCE NUMBERS ARE EPOCH << 16 | COUNTER, NEW STREAMS START ABOVE ANY SEQUENCE ISSUED THIS BOOT
+static uint32_t arqSeqHighWater = 0;
+
+void arqSetEpoch(uint16_t epoch)
+{
+  uint32_t epochStart = (uint32_t)epoch << 16;
+  if (arqSeqBefore(arqSeqHighWater, epochStart))
+    arqSeqHighWater = epochStart;
+}
+
+// SERIAL NUMBER COMPARISON, CORRECT ACROSS 32-BIT WRAP
+bool arqSeqBefore(uint32_t a, uint32_t b)
+{
+  return (int32_t)(a - b) < 0;
+}
+
+// EXISTING SENDER STREAM FOR A DESTINATION, OR NULLPTR
+ArqTxStream *arqFindTxStream(uint16_t peer)
+{
+  for (ArqTxStream &tx : txStreams)
+  {
+    if (tx.active && tx.peer == peer)
+      return &tx;
+  }
+  return nullptr;
+}
+
+// SENDER STREAM FOR A DESTINATION, RECYCLING AN IDLE ONE IF NEEDED
+ArqTxStream *arqTxStreamFor(uint16_t peer, unsigned long now)
+{
+  ArqTxStream *tx = arqFindTxStream(peer);
+  if (tx)
+  {
+    tx->lastUsed = now;
+    return tx;
+  }
+
+  // ONLY STREAMS WITH NOTHING IN FLIGHT CAN BE RECYCLED
+  for (ArqTxStream &candidate : txStreams)
+  {
+    if (!candidate.active)
+    {
+      tx = &candidate;
+      break;
+    }
+    if (candidate.base != candidate.nextSeq)
+      continue;
+    if (!tx || arqSeqBefore(candidate.lastUsed, tx->lastUsed))
+      tx = &candidate;
+  }
+  if (!tx)
+    return nullptr;
+
+  // A REBOOTED SENDER STARTS IN A NEWER EPOCH AND A RECYCLED STREAM ABOVE ITS PREDECESSOR,
+  // SO NEITHER IS MISTAKEN FOR DUPLICATES OF EARLIER TRAFFIC
+  if (tx->active && arqSeqBefore(arqSeqHighWater, tx->nextSeq))
+    arqSeqHighWater = tx->nextSeq;
+  tx->peer = peer;
+  tx->active = true;
+  tx->base = tx->nextSeq = arqSeqHighWater;
+  for (int16_t &slot : tx->slotBySeq)
+    slot = -1;
+  tx->lastUsed = now;
+  tx->rttValid = false;
+  tx->srtt = tx->rttvar = 0;
+  tx->rto = ARQ_RTO_INITIAL_MS;
+  tx->backoff = 0;
+  return tx;
+}
+
+// EXISTING RECEIVER STREAM FOR A SENDER'S TRAFFIC TO ONE DESTINATION, OR NULLPTR
+ArqRxStream *arqFindRxStream(uint16_t peer, uint16_t stream)
+{
+  for (ArqRxStream &rx : rxStreams)
+  {
+    if (rx.active && rx.peer == peer && rx.stream == stream)
+      return &rx;
+  }
+  return nullptr;
+}
+
+// RECEIVER STREAM FOR A SENDER'S TRAFFIC TO ONE DESTINATION, RECYCLING THE LEAST RECENTLY HEARD ONE IF NEEDED
+ArqRxStream *arqRxStreamFor(uint16_t peer, uint16_t stream, unsigned long now)
+{
+  ArqRxStream *rx = nullptr;
+  for (ArqRxStream &candidate : rxStreams)
+  {
+    if (candidate.active && candidate.peer == peer && candidate.stream == stream)
+    {
+      candidate.lastUsed = now;
+      return &candidate;
+    }
+    if (!candidate.active)
+    {
+      if (!rx || rx->active)
+        rx = &candidate;
+    }
+    else if (!rx || (rx->active && arqSeqBefore(candidate.lastUsed, rx->lastUsed)))
+    {
+      rx = &candidate;
+    }
+  }
+  rx->peer = peer;
+  rx->stream = stream;
+  rx->active = false; // Synchronised by the first frame in arqAcceptFrame()
+  rx->ackPending = false;
+  rx->lastUsed = now;
+  return rx;
+}
+
+bool arqWindowOpen(const ArqTxStream &tx)
+{
+  return tx.nextSeq - tx.base < ARQ_WINDOW_SIZE;
+}
+
+// SLIDE THE SENDER WINDOW PAST EVERY SETTLED SEQUENCE
+void arqAdvanceBase(ArqTxStream &tx)
+{
+  while (tx.base != tx.nextSeq && tx.slotBySeq[tx.base % ARQ_WINDOW_SIZE] < 0)
+    tx.base++;
+}
+
+// FOLD CONTIGUOUS RECEIVED FRAMES INTO THE CUMULATIVE ACK
+static void absorbContiguous(ArqRxStream &rx)
+{
+  while (rx.bitmap & 1)
+  {
+    rx.bitmap >>= 1;
+    rx.cumAck++;
+  }
+}
+
+// CLASSIFY AN INCOMING SEQUENCE AND RECORD IT IN THE RECEIVE WINDOW
+ArqRxResult arqAcceptFrame(ArqRxStream &rx, uint32_t seq, uint8_t windowOffset)
+{
+  uint32_t senderBase = seq - windowOffset;
+  if (!rx.active)
+  {
+    rx.active = true;
+    rx.cumAck = senderBase - 1;
+    rx.bitmap = 0;
+  }
+  else if (arqSeqBefore(rx.cumAck + 1, senderBase))
+  {
+    // SENDER GAVE UP ON FRAMES WE NEVER SAW (OR STARTED A NEW STREAM) - FOLLOW ITS WINDOW
+    uint32_t lead = senderBase - (rx.cumAck + 1);
+    rx.bitmap = (lead >= 32) ? 0 : (rx.bitmap >> lead);
+    rx.cumAck = senderBase - 1;
+    absorbContiguous(rx);
+  }
+
+  // ANYTHING BEHIND THE WINDOW IS OLD OR REPLAYED: A REBOOTED OR RECYCLED SENDER STREAM ALWAYS RESUMES AHEAD
+  if (!arqSeqBefore(rx.cumAck, seq))
+    return ARQ_RX_DUPLICATE;
+
+  uint32_t offset = seq - (rx.cumAck + 1);
+  if (offset >= 32)
+    return ARQ_RX_OUT_OF_WINDOW;
+  if (rx.bitmap & (1UL << offset))
+    return ARQ_RX_DUPLICATE;
+
+  rx.bitmap |= (1UL << offset);
+  absorbContiguous(rx);
+  return ARQ_RX_NEW;
+}
+
+// A RECEIVE STREAM WHOSE HELD ACK HAS WAITED LONG ENOUGH, OR NULLPTR
+ArqRxStream *arqNextDueAck(unsigned long now)
+{
+  for (ArqRxStream &rx : rxStreams)
+  {
+    if (rx.active && rx.ackPending && (long)(now - rx.ackDueTime) >= 0)
+      return &rx;
+  }
+  return nullptr;
+}
+
+// A HELD ACK THAT CAN RIDE ON A DATA FRAME TO THIS DESTINATION, OR NULLPTR
+ArqRxStream *arqPendingAckFor(uint16_t dstAddress)
+{
+  for (ArqRxStream &rx : rxStreams)
+  {
+    if (rx.active && rx.ackPending && (dstAddress == LORA_BROADCAST_ADDRESS || rx.peer == dstAddress))
+      return &rx;
+  }
+  return nullptr;
+}
+
+// FOLD AN RTT SAMPLE FROM A FRAME SENT EXACTLY ONCE INTO THE ESTIMATE (JACOBSON/KARELS)
+void arqRttSample(ArqTxStream &tx, uint32_t rttMs)
+{
+  if (!tx.rttValid)
+  {
+    tx.srtt = rttMs;
+    tx.rttvar = rttMs / 2;
+    tx.rttValid = true;
+  }
+  else
+  {
+    uint32_t delta = (rttMs > tx.srtt) ? rttMs - tx.srtt : tx.srtt - rttMs;
+    tx.rttvar = (3 * tx.rttvar + delta) / 4;
+    tx.srtt = (7 * tx.srtt + rttMs) / 8;
+  }
+  uint32_t variance = 4 * tx.rttvar;
+  tx.rto = tx.srtt + (variance > ARQ_RTO_MIN_MS ? variance : ARQ_RTO_MIN_MS);
+  if (tx.rto > ARQ_RTO_MAX_MS)
+    tx.rto = ARQ_RTO_MAX_MS;
+  tx.backoff = 0;
+}
+
+// A FRAME TIMED OUT - DOUBLE THE NEXT TIMEOUT UNTIL A CLEAN SAMPLE ARRIVES
+void arqRtoBackoff(ArqTxStream &tx)
+{
+  if (tx.backoff < ARQ_RTO_MAX_BACKOFF)
+    tx.backoff++;
+}
+
+// TIMEOUT FOR THE NEXT (RE)TRANSMISSION: ESTIMATE, AIRTIME FLOOR, BACKOFF AND UP TO 50% JITTER
+uint32_t arqRetransmitTimeout(const ArqTxStream &tx, uint32_t floorMs)
+{
+  uint32_t rto = (tx.rto > floorMs) ? tx.rto : floorMs;
+  rto <<= tx.backoff;
+  if (rto > ARQ_RTO_MAX_MS)
+    rto = ARQ_RTO_MAX_MS;
+  // JITTER KEEPS NODES THAT LOST THE SAME FRAME FROM RETRYING IN LOCKSTEP
+  return rto + esp_random() % (rto / 2 + 1);
+}
+
+// SENDER STREAM BY TABLE INDEX FOR DIAGNOSTICS, NULLPTR IF UNUSED
+const ArqTxStream *arqTxStreamAt(size_t index)
+{
+  if (index >= ARQ_MAX_PEERS || !txStreams[index].active)
+    return nullptr;
+  return &txStreams[index];
+}
+
+// DOES A (CUMULATIVE ACK, BITMAP) PAIR COVER THIS SEQUENCE
+bool arqSeqAcked(uint32_t seq, uint32_t cumAck, uint32_t bitmap)
+{
+  if (!arqSeqBefore(cumAck, seq))
+    return true;
+  uint32_t offset = seq - (cumAck + 1);
+  return offset < 32 && (bitmap & (1UL << offset));
+}
@@ -0,0 +1,71 @@
+#ifndef LORA_ARQ_H
+#define LORA_ARQ_H
+
+#include <Arduino.h>
+
+// SLIDING WINDOW CONFIGURATION
+#define ARQ_WINDOW_SIZE 8           // Frames in flight per destination (1..32, bounded by the SACK bitmap)
+#define ARQ_MAX_PEERS 8             // Streams kept per direction, least recently used is recycled
+#define ARQ_GAP_RETX_GUARD_MS 1000  // Minimum spacing between SACK-triggered retransmits of one frame
+#define ARQ_ACK_HOLD_MS 200         // Delay before a standalone ACK, to coalesce or piggyback it
+
+// RETRANSMISSION TIMEOUT (RFC 6298 STYLE, PER DESTINATION)
+#define ARQ_RTO_INITIAL_MS 5000     // Before the first RTT sample
+#define ARQ_RTO_MIN_MS 300          // Floor on top of the time-on-air bound
+#define ARQ_RTO_MAX_MS 60000
+#define ARQ_RTO_MAX_BACKOFF 5       // Doublings on consecutive losses (x32)
+
+static_assert(ARQ_WINDOW_SIZE >= 1 && ARQ_WINDOW_SIZE <= 32, "ARQ_WINDOW_SIZE must fit the 32-bit SACK bitmap");
+
+// SENDER SIDE - ONE STREAM PER DESTINATION
+struct ArqTxStream {
+    uint16_t peer;              // Destination address (or broadcast)
+    bool active;
+    uint32_t base;              // Oldest unacknowledged sequence number
+    uint32_t nextSeq;           // Sequence number for the next new frame
+    int16_t slotBySeq[ARQ_WINDOW_SIZE]; // Outgoing slot per in-window sequence, -1 once settled
+    unsigned long lastUsed;
+    bool rttValid;              // At least one RTT sample taken
+    uint32_t srtt;              // Smoothed round-trip time (ms)
+    uint32_t rttvar;            // Round-trip time variation (ms)
+    uint32_t rto;               // Retransmission timeout before backoff (ms)
+    uint8_t backoff;            // Consecutive timeouts without a fresh RTT sample
+};
+
+// RECEIVER SIDE - ONE STREAM PER SENDER AND DESTINATION IT ADDRESSED (US, BROADCAST OR A GROUP)
+struct ArqRxStream {
+    uint16_t peer;              // Source address
+    uint16_t stream;            // Destination address the sender used
+    bool active;
+    uint32_t cumAck;            // Every sequence up to and including this one was received
+    uint32_t bitmap;            // Bit i set: sequence cumAck + 1 + i was received
+    bool ackPending;            // Received frames not yet acknowledged
+    unsigned long ackDueTime;   // When the held ACK must go out on its own
+    unsigned long lastUsed;
+};
+
+enum ArqRxResult {
+    ARQ_RX_NEW,                 // First copy, deliver it
+    ARQ_RX_DUPLICATE,           // Already received, only re-ACK
+    ARQ_RX_OUT_OF_WINDOW        // Beyond what the SACK bitmap can describe, drop
+};
+
+// FUNCTION DECLARATIONS
+void arqSetEpoch(uint16_t epoch);
+ArqTxStream* arqFindTxStream(uint16_t peer);
+ArqTxStream* arqTxStreamFor(uint16_t peer, unsigned long now);
+ArqRxStream* arqFindRxStream(uint16_t peer, uint16_t stream);
+ArqRxStream* arqRxStreamFor(uint16_t peer, uint16_t stream, unsigned long now);
+bool arqWindowOpen(const ArqTxStream& tx);
+void arqAdvanceBase(ArqTxStream& tx);
+ArqRxResult arqAcceptFrame(ArqRxStream& rx, uint32_t seq, uint8_t windowOffset);
+ArqRxStream* arqNextDueAck(unsigned long now);
+ArqRxStream* arqPendingAckFor(uint16_t dstAddress);
+void arqRttSample(ArqTxStream& tx, uint32_t rttMs);
+void arqRtoBackoff(ArqTxStream& tx);
+uint32_t arqRetransmitTimeout(const ArqTxStream& tx, uint32_t floorMs);
+const ArqTxStream* arqTxStreamAt(size_t index);
+bool arqSeqAcked(uint32_t seq, uint32_t cumAck, uint32_t bitmap);
+bool arqSeqBefore(uint32_t a, uint32_t b);
+
+#endif
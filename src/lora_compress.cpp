@@ -0,0 +1,135 @@
+#include "lora_compress.h"
+
+// STATIC DICTIONARY OF FRAGMENTS COMMON IN SHORT ENGLISH CHAT
+// Grouped by first character and longest first within a group, so a
+// greedy encoder only scans the entries sharing the next input byte.
+// Codes are assigned in this order from LORA_COMPRESS_CODE_BASE; the
+// table is part of the wire format, so never reorder or edit it
+// without bumping LORA_PROTOCOL_VERSION.
+static const char *const dictionary[] = {
+    " the", " and", " to ", " you", " is ", " in ", " of ", " at ", " on ", " for", " are", " ok",
+    " we", " I ", " it", " be", " me", " my", " no", " so", " do", " go", " wi", " th", " a ",
+    " s", " c", " w", " m", " b", " p", " f", " h", " d", " t", " o", " i", " l", " n", " r", " e",
+    " g", "! ", ", ", ". ", "? ", "OK", "and", "all", "ave", "an", "at", "al", "ar", "as", "be",
+    "co", "ce", "ch", "d ", "de", "ent", "ere", "e ", "er", "en", "es", "ed", "ea", "for", "ght",
+    "here", "her", "hat", "his", "he", "ha", "hi", "ing", "ion", "ith", "ill", "in", "is", "it",
+    "io", "ic", "le", "li", "ll", "me", "ma", "now", "n ", "nd", "nt", "ng", "ne", "ould", "out",
+    "ome", "o ", "on", "or", "of", "ou", "om", "r ", "re", "ri", "ro", "ra", "s ", "st", "se",
+    "si", "the", "tha", "ter", "t ", "th", "ti", "te", "to", "ver", "ve", "y "
+};
+
+#define DICTIONARY_SIZE (sizeof(dictionary) / sizeof(dictionary[0]))
+static_assert(DICTIONARY_SIZE == LORA_COMPRESS_ESCAPE - LORA_COMPRESS_CODE_BASE, "Dictionary must fill the code space exactly");
+
+// FIRST DICTIONARY INDEX AND ENTRY COUNT FOR EACH ASCII FIRST BYTE, BUILT ON FIRST USE
+static uint8_t groupStart[128];
+static uint8_t groupCount[128];
+static uint8_t entryLen[DICTIONARY_SIZE];
+static bool indexBuilt = false;
+
+static void buildIndex()
+{
+  for (size_t i = 0; i < DICTIONARY_SIZE; i++)
+  {
+    uint8_t first = (uint8_t)dictionary[i][0];
+    if (groupCount[first] == 0)
+      groupStart[first] = (uint8_t)i;
+    groupCount[first]++;
+    entryLen[i] = (uint8_t)strlen(dictionary[i]);
+  }
+  indexBuilt = true;
+}
+
+// ENCODE TEXT INTO OUT, RETURNS THE ENCODED LENGTH OR 0 IF IT WOULD NOT BE SHORTER
+size_t compressText(const char *text, size_t textLen, uint8_t *out, size_t outCapacity)
+{
+  if (textLen < 2)
+    return 0;
+  if (!indexBuilt)
+    buildIndex();
+
+  // ANYTHING NOT SHORTER THAN THE INPUT IS SENT RAW, SO NEVER WRITE THAT FAR
+  size_t limit = (textLen - 1 < outCapacity) ? textLen - 1 : outCapacity;
+  size_t outLen = 0;
+  size_t pos = 0;
+  while (pos < textLen)
+  {
+    uint8_t c = (uint8_t)text[pos];
+    if (c < 0x80)
+    {
+      // LONGEST MATCH IS FIRST IN THE GROUP THAT MATCHES
+      size_t matchLen = 0;
+      uint8_t code = 0;
+      for (uint8_t i = groupStart[c], end = groupStart[c] + groupCount[c]; i < end; i++)
+      {
+        size_t len = entryLen[i];
+        if (len <= textLen - pos && memcmp(text + pos, dictionary[i], len) == 0)
+        {
+          matchLen = len;
+          code = (uint8_t)(LORA_COMPRESS_CODE_BASE + i);
+          break;
+        }
+      }
+      if (outLen >= limit)
+        return 0;
+      if (matchLen)
+      {
+        out[outLen++] = code;
+        pos += matchLen;
+      }
+      else
+      {
+        out[outLen++] = c;
+        pos++;
+      }
+    }
+    else
+    {
+      // NON-ASCII (UTF-8) BYTES ARE ESCAPED
+      if (outLen + 2 > limit)
+        return 0;
+      out[outLen++] = LORA_COMPRESS_ESCAPE;
+      out[outLen++] = c;
+      pos++;
+    }
+  }
+  return outLen;
+}
+
+// DECODE INTO A NUL-TERMINATED STRING, RETURNS THE TEXT LENGTH OR 0 IF MALFORMED OR TOO LONG
+size_t decompressText(const uint8_t *in, size_t inLen, char *out, size_t outCapacity)
+{
+  size_t outLen = 0;
+  for (size_t pos = 0; pos < inLen; pos++)
+  {
+    uint8_t c = in[pos];
+    const char *chunk;
+    size_t chunkLen;
+    char literal;
+    if (c < LORA_COMPRESS_CODE_BASE)
+    {
+      literal = (char)c;
+      chunk = &literal;
+      chunkLen = 1;
+    }
+    else if (c < LORA_COMPRESS_ESCAPE)
+    {
+      chunk = dictionary[c - LORA_COMPRESS_CODE_BASE];
+      chunkLen = strlen(chunk);
+    }
+    else
+    {
+      if (++pos >= inLen)
+        return 0;
+      literal = (char)in[pos];
+      chunk = &literal;
+      chunkLen = 1;
+    }
+    if (c == 0 || outLen + chunkLen >= outCapacity)
+      return 0;
+    memcpy(out + outLen, chunk, chunkLen);
+    outLen += chunkLen;
+  }
+  out[outLen] = 0;
+  return outLen;
+}
@@ -0,0 +1,17 @@
+#ifndef LORA_COMPRESS_H
+#define LORA_COMPRESS_H
+
+#include <Arduino.h>
+
+// SHORT-TEXT CODEC (NO ALLOCATION, NO STATE BETWEEN MESSAGES)
+//   0x01-0x7F  ASCII LITERAL
+//   0x80-0xFE  STATIC DICTIONARY ENTRY (2-4 CHARACTERS)
+//   0xFF b     ESCAPED LITERAL BYTE (UTF-8 AND OTHER NON-ASCII)
+#define LORA_COMPRESS_CODE_BASE 0x80
+#define LORA_COMPRESS_ESCAPE 0xFF
+
+// FUNCTION DECLARATIONS
+size_t compressText(const char* text, size_t textLen, uint8_t* out, size_t outCapacity);
+size_t decompressText(const uint8_t* in, size_t inLen, char* out, size_t outCapacity);
+
+#endif
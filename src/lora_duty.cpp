@@ -0,0 +1,114 @@
+#include "lora_duty.h"
+#include <atomic>
+
+// DUTY-CYCLE SUB-BANDS (ETSI EN 300 220 / ERC REC 70-03, LORAWAN NAMES), FIRST MATCH WINS
+static const LoRaSubBand subBands[] = {
+    {433.05f, 434.79f, 100, "EU433"},
+    {863.0f, 868.0f, 10, "EU868 g"},
+    {868.0f, 868.6f, 10, "EU868 g1"},
+    {868.7f, 869.2f, 1, "EU868 g2"},
+    {869.4f, 869.65f, 100, "EU868 g3"},
+    {869.7f, 870.0f, 10, "EU868 g4"},
+    {902.0f, 928.0f, LORA_DUTY_FAIR_USE_PERMILLE, "US915"},
+};
+static const LoRaSubBand otherBand = {0.0f, 0.0f, LORA_DUTY_FAIR_USE_PERMILLE, "other"};
+#define SUB_BAND_COUNT (sizeof(subBands) / sizeof(subBands[0]))
+
+// ROLLING AIRTIME LEDGER PER SUB-BAND (THE LAST SLOT IS FOR FREQUENCIES OUTSIDE THE TABLE)
+// A BUCKET REMEMBERS WHICH SLICE OF TIME IT HOLDS, SO STALE ONES ARE SKIPPED RATHER THAN SWEPT. THE
+// PARTLY ELAPSED SLICE AT THE FAR END IS STILL COUNTED, SO AIRTIME IS NEVER FORGOTTEN EARLY
+// WRITTEN BY THE RADIO TASK ONLY, OTHER READERS GET A BEST-EFFORT SUM
+struct LoRaDutyBucket {
+    uint32_t slice;
+    uint32_t airtimeMs;
+};
+static LoRaDutyBucket ledger[SUB_BAND_COUNT + 1][LORA_DUTY_BUCKETS + 1];
+
+static const uint32_t BUCKET_MS = LORA_DUTY_WINDOW_MS / LORA_DUTY_BUCKETS;
+
+// SLICES ARE COUNTED BY ELAPSED TIME RATHER THAN DERIVED FROM millis(), SO ITS WRAP EVERY 49 DAYS NEITHER
+// RESTARTS THE COUNT NOR FORGETS AIRTIME SPENT JUST BEFORE IT. MOVED ON BY THE RADIO TASK ONLY
+static std::atomic<uint32_t> currentSlice{0};
+static std::atomic<uint32_t> sliceStart{0};     // millis() when currentSlice began
+
+// THE SLICE now FALLS IN, WITHOUT MOVING THE COUNT
+static uint32_t sliceAt(unsigned long now)
+{
+  return currentSlice.load() + ((uint32_t)now - sliceStart.load()) / BUCKET_MS;
+}
+
+static uint32_t advanceSlice(unsigned long now)
+{
+  uint32_t elapsed = (uint32_t)now - sliceStart.load();
+  if (elapsed >= BUCKET_MS)
+  {
+    uint32_t slices = elapsed / BUCKET_MS;
+    sliceStart = sliceStart.load() + slices * BUCKET_MS;
+    currentSlice = currentSlice.load() + slices;
+  }
+  return currentSlice.load();
+}
+
+static size_t subBandIndex(float frequencyMHz)
+{
+  for (size_t i = 0; i < SUB_BAND_COUNT; i++)
+  {
+    if (frequencyMHz >= subBands[i].lowMHz && frequencyMHz <= subBands[i].highMHz)
+      return i;
+  }
+  return SUB_BAND_COUNT;
+}
+
+const LoRaSubBand &dutySubBand(float frequencyMHz)
+{
+  size_t index = subBandIndex(frequencyMHz);
+  return index < SUB_BAND_COUNT ? subBands[index] : otherBand;
+}
+
+// AIRTIME THE SUB-BAND ALLOWS PER WINDOW
+uint32_t dutyBudgetMs(float frequencyMHz)
+{
+  return (uint32_t)((uint64_t)LORA_DUTY_WINDOW_MS * dutySubBand(frequencyMHz).dutyPermille / 1000);
+}
+
+// AIRTIME SPENT IN THE SUB-BAND OVER THE LAST WINDOW
+uint32_t dutyUsedMs(float frequencyMHz, unsigned long now)
+{
+  const LoRaDutyBucket *buckets = ledger[subBandIndex(frequencyMHz)];
+  uint32_t slice = sliceAt(now);
+  uint32_t used = 0;
+  for (size_t i = 0; i <= LORA_DUTY_BUCKETS; i++)
+  {
+    if (slice - buckets[i].slice <= LORA_DUTY_BUCKETS)
+      used += buckets[i].airtimeMs;
+  }
+  return used;
+}
+
+// CAN A FRAME OF THIS AIRTIME GO OUT AND STILL LEAVE reservePercent OF THE BUDGET FOR MORE URGENT TRAFFIC
+bool dutyAllows(float frequencyMHz, uint32_t airtimeMs, uint8_t reservePercent, unsigned long now)
+{
+  advanceSlice(now);
+  uint32_t budget = dutyBudgetMs(frequencyMHz);
+  uint32_t usable = budget - (uint32_t)((uint64_t)budget * reservePercent / 100);
+  return dutyUsedMs(frequencyMHz, now) + airtimeMs <= usable;
+}
+
+void dutyCharge(float frequencyMHz, uint32_t airtimeMs, unsigned long now)
+{
+  uint32_t slice = advanceSlice(now);
+  LoRaDutyBucket &bucket = ledger[subBandIndex(frequencyMHz)][slice % (LORA_DUTY_BUCKETS + 1)];
+  if (bucket.slice != slice)
+  {
+    bucket.slice = slice;
+    bucket.airtimeMs = 0;
+  }
+  bucket.airtimeMs += airtimeMs;
+}
+
+// TIME UNTIL THE OLDEST SLICE LEAVES THE WINDOW AND ITS AIRTIME CAN BE SPENT AGAIN
+uint32_t dutyNextReleaseMs(unsigned long now)
+{
+  advanceSlice(now);
+  return BUCKET_MS - ((uint32_t)now - sliceStart.load());
+}
@@ -0,0 +1,27 @@
+#ifndef LORA_DUTY_H
+#define LORA_DUTY_H
+
+#include <Arduino.h>
+
+// DUTY-CYCLE CONFIGURATION
+#define LORA_DUTY_WINDOW_MS 3600000UL       // Regulatory averaging period (ETSI EN 300 220: one hour)
+#define LORA_DUTY_BUCKETS 30                // Window slices, the oldest ages out every WINDOW / BUCKETS
+#define LORA_DUTY_FAIR_USE_PERMILLE 100     // Self-imposed cap where no duty cycle is regulated (e.g. US915)
+
+// A BAND WITH ONE DUTY-CYCLE LIMIT, TRANSMISSIONS ANYWHERE IN IT SHARE ONE BUDGET
+struct LoRaSubBand {
+    float lowMHz;
+    float highMHz;
+    uint16_t dutyPermille;      // Share of LORA_DUTY_WINDOW_MS we may spend on air
+    const char* name;
+};
+
+// FUNCTION DECLARATIONS
+const LoRaSubBand& dutySubBand(float frequencyMHz);
+uint32_t dutyBudgetMs(float frequencyMHz);
+uint32_t dutyUsedMs(float frequencyMHz, unsigned long now);
+bool dutyAllows(float frequencyMHz, uint32_t airtimeMs, uint8_t reservePercent, unsigned long now);
+void dutyCharge(float frequencyMHz, uint32_t airtimeMs, unsigned long now);
+uint32_t dutyNextReleaseMs(unsigned long now);
+
+#endif
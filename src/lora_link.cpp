@@ -0,0 +1,287 @@
+#include "lora_link.h"
+#include <math.h>
+
+// LINK TABLE AND OUR OWN LISTEN SF
+static LoRaLinkPeer linkPeers[LINK_MAX_PEERS];
+static uint8_t listenSf = LORA_SF_RENDEZVOUS;
+static unsigned long listenSfChanged = 0;
+static unsigned long lastHeardAny = 0;
+static bool heardAny = false;
+
+// SX1262 DEMODULATION FLOOR, 2.5 DB LOWER FOR EVERY SF STEP (DATASHEET TABLE 6-1)
+static float snrFloorDb(uint8_t sf)
+{
+  return -7.5f - 2.5f * (float)(sf - 7);
+}
+
+static bool linkPeerCurrent(const LoRaLinkPeer &peer, unsigned long now)
+{
+  return peer.active && now - peer.lastHeard <= LINK_PEER_TIMEOUT_MS;
+}
+
+static LoRaLinkPeer *findLinkPeer(uint16_t address)
+{
+  for (LoRaLinkPeer &peer : linkPeers)
+  {
+    if (peer.active && peer.address == address)
+      return &peer;
+  }
+  return nullptr;
+}
+
+// ENTRY FOR A NEIGHBOUR, RECYCLING THE LEAST RECENTLY HEARD ONE IF NEEDED
+static LoRaLinkPeer *linkPeerFor(uint16_t address)
+{
+  LoRaLinkPeer *peer = findLinkPeer(address);
+  if (peer)
+    return peer;
+  for (LoRaLinkPeer &candidate : linkPeers)
+  {
+    if (!candidate.active)
+    {
+      peer = &candidate;
+      break;
+    }
+    if (!peer || (long)(candidate.lastHeard - peer->lastHeard) < 0)
+      peer = &candidate;
+  }
+
+  memset(peer, 0, sizeof(*peer));
+  peer->address = address;
+  peer->active = true;
+  peer->peerSf = LORA_SF_RENDEZVOUS;
+  peer->txPower = LORA_POWER_MAX;
+  return peer;
+}
+
+// LOWEST POWER THAT STILL LEAVES THE MARGIN (PLUS WHAT RECENT LOSSES EARNED) AT THE PEER'S SF
+static void updateTxPower(LoRaLinkPeer &peer)
+{
+  if (!peer.reportValid)
+  {
+    peer.txPower = LORA_POWER_MAX;
+    return;
+  }
+  float headroom = peer.txSnr - snrFloorDb(peer.peerSf) - LINK_SNR_MARGIN_DB - peer.lossMarginDb;
+  int power = LORA_POWER_MAX - (headroom > 0 ? (int)floorf(headroom) : 0);
+  peer.txPower = (int8_t)constrain(power, LORA_POWER_MIN, LORA_POWER_MAX);
+}
+
+// ANY FRAME FROM ANOTHER NODE - MEASURE THE LINK TO WHOEVER PUT IT ON AIR AND LEARN WHICH SF IT LISTENS ON
+void linkFrameHeard(const LoRaFrameHeader &header, float rssi, float snr, unsigned long now)
+{
+  LoRaLinkPeer *peer = linkPeerFor(header.lastHop);
+  float normalised = snr + (float)(LORA_POWER_MAX - header.linkPower);
+  if (peer->framesHeard == 0)
+  {
+    peer->rssi = rssi;
+    peer->rxSnr = normalised;
+  }
+  else
+  {
+    peer->rssi += (rssi - peer->rssi) / 4;
+    peer->rxSnr += (normalised - peer->rxSnr) / 4;
+  }
+  peer->lastSnr = snr;
+  peer->lastHeard = now;
+  peer->framesHeard++;
+
+  uint8_t advertisedSf = (header.linkSf >= LORA_SF_MIN && header.linkSf <= LORA_SF_MAX) ? header.linkSf : LORA_SF_RENDEZVOUS;
+  if (advertisedSf != peer->peerSf)
+  {
+    Serial.printf("[Link] 0x%04X now listens on SF%u\n", peer->address, advertisedSf);
+    peer->peerSf = advertisedSf;
+    updateTxPower(*peer);
+  }
+  lastHeardAny = now;
+  heardAny = true;
+}
+
+// THE PEER TOLD US HOW IT HEARS OUR FRAMES
+void linkSnrReport(uint16_t address, int8_t snrReport)
+{
+  LoRaLinkPeer *peer = findLinkPeer(address);
+  if (!peer || snrReport == INT8_MIN)
+    return;
+
+  float normalised = (float)snrReport / 4 + (float)(LORA_POWER_MAX - peer->txPower);
+  if (!peer->reportValid)
+    peer->txSnr = normalised;
+  else
+    peer->txSnr += (normalised - peer->txSnr) / 4;
+  peer->reportValid = true;
+  updateTxPower(*peer);
+}
+
+// SNR OF THE PEER'S LATEST FRAME FOR AN OUTGOING ACK, INT8_MIN IF WE HAVE NOT HEARD IT
+int8_t linkSnrReportFor(uint16_t address)
+{
+  const LoRaLinkPeer *peer = findLinkPeer(address);
+  if (!peer || peer->framesHeard == 0)
+    return INT8_MIN;
+  return (int8_t)constrain(lroundf(peer->lastSnr * 4), INT8_MIN + 1, INT8_MAX);
+}
+
+// EVERY LOSS ADDS HEADROOM AND EVERY DELIVERY GIVES A LITTLE BACK, SO THE HEADROOM ONLY
+// KEEPS GROWING WHILE FEWER THAN LINK_DELIVERY_TARGET OF THE FRAMES GET THROUGH
+void linkDelivered(uint16_t address)
+{
+  LoRaLinkPeer *peer = findLinkPeer(address);
+  if (!peer)
+    return;
+  const float decay = LINK_LOSS_MARGIN_DB * (1.0f - LINK_DELIVERY_TARGET) / LINK_DELIVERY_TARGET;
+  peer->delivered++;
+  peer->losses = 0;
+  peer->lossMarginDb = (peer->lossMarginDb > decay) ? peer->lossMarginDb - decay : 0;
+  updateTxPower(*peer);
+}
+
+static void linkPeerLost(LoRaLinkPeer &peer)
+{
+  peer.lost++;
+  if (peer.losses < 0xFF)
+    peer.losses++;
+  peer.lossMarginDb = min(peer.lossMarginDb + LINK_LOSS_MARGIN_DB, LINK_LOSS_MARGIN_MAX_DB);
+  updateTxPower(peer);
+}
+
+// AN ACK NEVER CAME - A BROADCAST OR GROUP FRAME COULD HAVE BEEN MISSED BY ANY CURRENT PEER
+void linkLost(uint16_t address, unsigned long now)
+{
+  if (loRaIsNodeAddress(address))
+  {
+    LoRaLinkPeer *peer = findLinkPeer(address);
+    if (peer)
+      linkPeerLost(*peer);
+    return;
+  }
+  for (LoRaLinkPeer &peer : linkPeers)
+  {
+    if (linkPeerCurrent(peer, now))
+      linkPeerLost(peer);
+  }
+}
+
+// HEARD DIRECTLY, RECENTLY ENOUGH TO SEND TO AT ITS OWN RATE
+bool linkIsNeighbour(uint16_t address, unsigned long now)
+{
+  const LoRaLinkPeer *peer = findLinkPeer(address);
+  return peer && linkPeerCurrent(*peer, now);
+}
+
+// SF AND POWER FOR A FRAME TO ONE PEER
+// AFTER REPEATED LOSSES, FULL POWER AND EVERY OTHER ATTEMPT ON THE RENDEZVOUS SF IN CASE THE PEER FELL BACK TO IT
+void linkTxParams(uint16_t dstAddress, uint8_t &sf, int8_t &power)
+{
+  const LoRaLinkPeer *peer = findLinkPeer(dstAddress);
+  if (!peer)
+  {
+    sf = LORA_SF_RENDEZVOUS;
+    power = LORA_POWER_MAX;
+    return;
+  }
+  if (peer->losses >= LINK_LOSS_FALLBACK)
+  {
+    sf = (peer->losses & 1) ? LORA_SF_RENDEZVOUS : peer->peerSf;
+    power = LORA_POWER_MAX;
+    return;
+  }
+  sf = peer->peerSf;
+  power = peer->txPower;
+}
+
+// ONE COPY OF A BROADCAST PER SF THAT CURRENT PEERS LISTEN ON, LOUD ENOUGH FOR THE WEAKEST OF THEM
+// RETURNS THE NUMBER OF COPIES (THE RENDEZVOUS SF AT FULL POWER WHEN NO PEER IS KNOWN)
+// WITH rendezvous THE RENDEZVOUS SF AT FULL POWER IS ALWAYS AMONG THEM, FOR NODES THAT DO NOT KNOW US YET
+size_t linkBroadcastRates(uint8_t *sfs, int8_t *powers, size_t capacity, bool rendezvous, unsigned long now)
+{
+  size_t count = 0;
+  if (rendezvous && capacity > 0)
+  {
+    sfs[0] = LORA_SF_RENDEZVOUS;
+    powers[0] = LORA_POWER_MAX;
+    count = 1;
+  }
+  for (const LoRaLinkPeer &peer : linkPeers)
+  {
+    if (!linkPeerCurrent(peer, now))
+      continue;
+    uint8_t sf;
+    int8_t power;
+    linkTxParams(peer.address, sf, power);
+    size_t i = 0;
+    while (i < count && sfs[i] != sf)
+      i++;
+    if (i == count)
+    {
+      if (count == capacity)
+        continue;
+      sfs[count] = sf;
+      powers[count++] = power;
+    }
+    else if (power > powers[i])
+    {
+      powers[i] = power;
+    }
+  }
+  if (count == 0 && capacity > 0)
+  {
+    sfs[0] = LORA_SF_RENDEZVOUS;
+    powers[0] = LORA_POWER_MAX;
+    count = 1;
+  }
+  return count;
+}
+
+// PICK THE FASTEST SF EVERY CURRENT PEER CAN REACH US ON WITH MARGIN, RETURNS TRUE IF IT CHANGED
+// SLOWING DOWN IS IMMEDIATE, SPEEDING UP NEEDS EXTRA HEADROOM AND A SETTLED SF. AFTER A LONG SILENCE
+// PEERS MAY HAVE LOST TRACK OF US, SO WE GO BACK TO THE RENDEZVOUS SF EVERYONE STARTS FROM
+bool linkUpdateListenSf(unsigned long now)
+{
+  uint8_t target;
+  if (heardAny && now - lastHeardAny > LINK_SILENCE_FALLBACK_MS)
+  {
+    target = LORA_SF_RENDEZVOUS;
+  }
+  else
+  {
+    bool anyPeer = false;
+    float weakest = 0;
+    for (const LoRaLinkPeer &peer : linkPeers)
+    {
+      if (!linkPeerCurrent(peer, now))
+        continue;
+      if (!anyPeer || peer.rxSnr < weakest)
+        weakest = peer.rxSnr;
+      anyPeer = true;
+    }
+    if (!anyPeer)
+      return false;
+
+    target = LORA_SF_MIN;
+    while (target < LORA_SF_MAX &&
+           weakest - snrFloorDb(target) < LINK_SNR_MARGIN_DB + (target < listenSf ? LINK_SF_HYSTERESIS_DB : 0))
+      target++;
+    if (target < listenSf && now - listenSfChanged < LINK_SF_HOLD_MS)
+      return false;
+  }
+  if (target == listenSf)
+    return false;
+
+  Serial.printf("[Link] Listening on SF%u (was SF%u)\n", target, listenSf);
+  listenSf = target;
+  listenSfChanged = now;
+  return true;
+}
+
+uint8_t linkListenSf()
+{
+  return listenSf;
+}
+
+const LoRaLinkPeer *linkPeerAt(size_t index)
+{
+  if (index >= LINK_MAX_PEERS || !linkPeers[index].active)
+    return nullptr;
+  return &linkPeers[index];
+}
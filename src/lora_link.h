@@ -0,0 +1,52 @@
+#ifndef LORA_LINK_H
+#define LORA_LINK_H
+
+#include <Arduino.h>
+#include "lora_packet.h"
+
+// ADAPTIVE DATA RATE CONFIGURATION
+#define LINK_MAX_PEERS 8
+#define LINK_SNR_MARGIN_DB 6.0f         // Headroom kept above the demodulation floor of the chosen SF
+#define LINK_SF_HYSTERESIS_DB 3.0f      // Extra headroom needed before moving to a faster SF
+#define LINK_DELIVERY_TARGET 0.95f      // Frame delivery ratio the loss headroom steers towards
+#define LINK_LOSS_MARGIN_DB 2.0f        // Headroom added for every lost frame to a peer
+#define LINK_LOSS_MARGIN_MAX_DB 12.0f
+#define LINK_LOSS_FALLBACK 3            // Consecutive losses before full power, alternating with the rendezvous SF
+#define LINK_PEER_TIMEOUT_MS 600000UL   // Peers not heard for this long stop shaping our listen SF
+#define LINK_SILENCE_FALLBACK_MS 120000UL // Nothing heard for this long: go back to the rendezvous SF
+#define LINK_SF_HOLD_MS 30000UL         // Least time between moves to a faster listen SF
+
+// WHAT WE KNOW ABOUT THE RADIO LINK TO ONE NEIGHBOUR (PRE-ALLOCATED)
+// SNR FIGURES ARE NORMALISED TO LORA_POWER_MAX SO POWER CONTROL ON EITHER SIDE DOES NOT FEED BACK INTO THEM
+struct LoRaLinkPeer {
+    uint16_t address;
+    bool active;
+    unsigned long lastHeard;
+    uint32_t framesHeard;
+    float rssi;             // Smoothed RSSI of its frames, dBm
+    float lastSnr;          // Raw SNR of its latest frame, reported back with our ACKs
+    float rxSnr;            // Smoothed SNR of its frames as if sent at full power
+    uint8_t peerSf;         // SF it listens on, from its link byte
+    bool reportValid;
+    float txSnr;            // Smoothed SNR it reports for our frames, as if sent at full power
+    int8_t txPower;         // Power we send to it with
+    float lossMarginDb;     // Extra headroom earned by recent losses
+    uint8_t losses;         // Consecutive frames to it that went unacknowledged
+    uint32_t delivered;
+    uint32_t lost;
+};
+
+// FUNCTION DECLARATIONS
+void linkFrameHeard(const LoRaFrameHeader& header, float rssi, float snr, unsigned long now);
+void linkSnrReport(uint16_t peer, int8_t snrReport);
+int8_t linkSnrReportFor(uint16_t peer);
+void linkDelivered(uint16_t peer);
+void linkLost(uint16_t peer, unsigned long now);
+bool linkIsNeighbour(uint16_t address, unsigned long now);
+void linkTxParams(uint16_t dstAddress, uint8_t& sf, int8_t& power);
+size_t linkBroadcastRates(uint8_t* sfs, int8_t* powers, size_t capacity, bool rendezvous, unsigned long now);
+bool linkUpdateListenSf(unsigned long now);
+uint8_t linkListenSf();
+const LoRaLinkPeer* linkPeerAt(size_t index);
+
+#endif
@@ -2,360 +2,1242 @@
 #include "display_manager.h"
 #include "config.h"
 #include "encryption.h"
+#include "lora_arq.h"
+#include "lora_duty.h"
+#include "lora_compress.h"
+#include "lora_link.h"
+#include "lora_outbox.h"
+#include "lora_reassembly.h"
+#include "lora_relay.h"
+#include "lora_route.h"
+#include <Preferences.h>
+#include <mutex>
 
-// INITIALIZE LORA MODULE
-SX1262 radio = new Module(LORA_NSS_PIN, LORA_DIO1_PIN, LORA_RESET_PIN, LORA_BUSY_PIN);
-
-// LORA PHYSICAL LAYER PARAMETERS
-float lora_frequency = 915.0;
-float lora_bandwidth = 125.0;
-uint8_t lora_sf = 7;
-uint8_t lora_cr = 5;
-uint8_t lora_sync_word = 0x34;
-int8_t lora_power = 17;
-uint16_t lora_preamble = 8;
+static_assert(LORA_MAX_FRAGMENTS <= ARQ_WINDOW_SIZE && LORA_MAX_FRAGMENTS <= LORA_OUTGOING_SLOTS,
+              "A whole fragmented message must fit in one send window");
 
 // GLOBAL VARIABLES
-volatile bool loraPacketReceivedFlag = false;
-uint32_t currentLoRaMessageId = 0;
-std::vector<OutgoingMessage> outgoingMessageQueue;
+static uint16_t myLoRaNodeAddress = 0;
+
+// PRE-ALLOCATED OUTGOING SLOTS, REACHED THROUGH EACH STREAM'S WINDOW, WITH THEIR ACK DEADLINES
+static OutgoingMessage outgoingSlots[LORA_OUTGOING_SLOTS];
+static uint16_t freeSlotStack[LORA_OUTGOING_SLOTS];
+static size_t freeSlotCount = 0;
+static TimerWheel<LORA_OUTGOING_SLOTS, ACK_TIMER_WHEEL_SLOTS, ACK_TIMER_TICK_MS> ackTimerWheel;
+
+// SUBMISSIONS FROM THE WEB TASK, BUTTON AND OTHER PRODUCERS, DRAINED IN handleLoRaEvents()
+static MpscQueue<LoRaCommand, LORA_CMD_QUEUE_LEN> loraCommandQueue;
+static LoRaCommand heldCommand; // Popped but waiting for window room
+static bool commandHeld = false;
+
+// LAST SEEN RADIO TASK COUNTERS, FOR STATUS LINE UPDATES
+static uint32_t seenTxDone = 0;
+static uint32_t seenTxFailed = 0;
+static uint32_t seenRxCrcErrors = 0;
+static uint32_t seenRxFailed = 0;
+
+// SERIAL OF OUR NEXT ACK FRAME (EPOCH << 16 | COUNT), WHAT ITS NONCE IS BUILT FROM
+static uint32_t nextAckSerial = 0;
+static uint32_t nextBeaconSerial = 0; // Same for our beacons
+
+LoRaStackStats loraStackStats;
+
+// WHAT /diag SHOWS OF THE STATE ONLY THE LOOP TASK MAY TOUCH, COPIED BY IT EVERY LORA_DIAG_SNAPSHOT_MS
+// THE WEB SERVER'S TASK READS IT UNDER THE MUTEX, THE LOOP TASK SKIPS A COPY RATHER THAN WAIT FOR IT
+struct LoRaDiagSnapshot {
+    uint8_t listenSf;
+    uint16_t epoch;
+    uint32_t freeOutgoingSlots;
+    uint32_t outboxInFlight;
+    uint32_t outboxHeld;
+    size_t txCount;
+    ArqTxStream tx[ARQ_MAX_PEERS];
+    size_t linkCount;
+    LoRaLinkPeer links[LINK_MAX_PEERS];
+    size_t routeCount;
+    LoRaRoute routes[ROUTE_MAX_ENTRIES];
+};
+static LoRaDiagSnapshot diagSnapshot;
+static std::mutex diagMutex;
+static unsigned long lastDiagSnapshot = 0;
+static bool diagSnapshotTaken = false;
 
 // CALLBACK FUNCTION POINTERS
 static LoRaPacketCallback onExternalReceiveCallback = nullptr;
 static LoraAckStatusCallback onLoraAckStatusCallback = nullptr;
 
-const size_t ABSOLUTE_MIN_PACKET_LEN = 5;
+// BOOT EPOCH - BUMPED IN NVS ON EVERY BOOT AND WHENEVER A STREAM RUNS INTO THE NEXT EPOCH
+static uint16_t loRaEpoch = 0;
+
+static void persistLoRaEpoch(uint16_t epoch)
+{
+  Preferences prefs;
+  prefs.begin(LORA_NVS_NAMESPACE, false);
+  prefs.putUShort("epoch", epoch);
+  prefs.end();
+  loRaEpoch = epoch;
+}
 
-// INTERRUPT SERVICE ROUTINE - FLAG WHEN DIO1 IS TRIGGERED
-void IRAM_ATTR onLoRaInterrupt()
+static uint16_t loadNextLoRaEpoch()
 {
-  loraPacketReceivedFlag = true;
+  Preferences prefs;
+  prefs.begin(LORA_NVS_NAMESPACE, true);
+  uint16_t lastEpoch = prefs.getUShort("epoch", 0);
+  prefs.end();
+  return lastEpoch + 1;
+}
+
+// A COUNTER (EPOCH << 16 | COUNT) THAT OUTGREW ITS EPOCH CLAIMS THE NEXT ONE SO THE NEXT BOOT STARTS ABOVE IT
+static void claimLoRaEpochOf(uint32_t counter)
+{
+  uint16_t epoch = counter >> 16;
+  if ((int16_t)(epoch - loRaEpoch) > 0)
+  {
+    persistLoRaEpoch(epoch);
+    arqSetEpoch(loRaEpoch);
+  }
+}
+
+// A MESSAGE THAT ENDS UNDELIVERED WITHOUT A SLOT TO REPORT IT THROUGH - THE UI STOPS SHOWING IT PENDING
+static void reportMessageFailed(const char *localWebId)
+{
+  if (onLoraAckStatusCallback)
+    onLoraAckStatusCallback(localWebId, 0, false, true); // No frame carries it, so no LoRa message ID
 }
 
-// SETUP LORA RADIO MODULE
-void setupLoRa(const String &myDeviceId, const String &packetPrefix, LoRaPacketCallback rxCb, LoraAckStatusCallback ackCb)
+// THE OUTBOX DROPPED A HELD MESSAGE TO MAKE ROOM FOR A NEW ONE (IT LOGS WHICH RECORD ITSELF)
+static void onOutboxEvicted(uint32_t /*outboxId*/, const char *localWebId)
 {
+  reportMessageFailed(localWebId);
+}
+
+// SETUP LORA STACK AND RADIO
+void setupLoRa(uint16_t myNodeAddress, LoRaPacketCallback rxCb, LoraAckStatusCallback ackCb)
+{
+  myLoRaNodeAddress = myNodeAddress;
+  setupEncryption();
+  persistLoRaEpoch(loadNextLoRaEpoch());
+  arqSetEpoch(loRaEpoch);
+  nextAckSerial = (uint32_t)loRaEpoch << 16;
+  nextBeaconSerial = (uint32_t)loRaEpoch << 16;
+  Serial.printf("[LoRa] Boot epoch %u\n", loRaEpoch);
   onExternalReceiveCallback = rxCb;
   onLoraAckStatusCallback = ackCb;
+  for (uint16_t i = 0; i < LORA_OUTGOING_SLOTS; i++)
+    freeSlotStack[freeSlotCount++] = i;
+  outboxSetup(onOutboxEvicted);
+  setupLoRaRadio();
+}
 
-  Serial.print(F("[LoRa] Initializing ... "));
-  setDisplayStatusLine("LoRa Init...");
-
-  int radio_state = radio.begin(lora_frequency, lora_bandwidth, lora_sf, lora_cr, lora_sync_word, lora_power, lora_preamble);
-  if (radio_state == RADIOLIB_ERR_NONE)
+// HAND AN ENCODED LORA FRAME TO THE RADIO TASK
+static bool transmitLoRaPacket(const uint8_t *frame, size_t frameLen, uint8_t sf, int8_t power, LoRaTxClass txClass,
+                               LoRaTxTicket *ticket)
+{
+  Serial.printf("[LoRa] TX Queued (Length: %u, SF%u, %d dBm)\n", (unsigned)frameLen, sf, power);
+  if (!queueLoRaRadioFrame(frame, frameLen, sf, power, txClass, ticket))
   {
-#if defined(HELTEC_V3_BOARD)
-    radio.setDio2AsRfSwitch(true);
-    Serial.print(F("RF Switch (DIO2) enabled for Heltec. "));
-#endif
-    Serial.println(F("OK"));
-    setDisplayStatusLine("LoRa OK");
+    Serial.println(F("[LoRa] TX ring full, frame dropped."));
+    setDisplayStatusLine("LoRa TX Busy");
+    return false;
   }
+  setDisplayStatusLine("Sending LoRa...");
+  return true;
+}
+
+// PUT A FRAME ON AIR AT THE RATE ITS NEXT HOP LISTENS ON, RETURNS THE TOTAL AIRTIME OF THE COPIES QUEUED
+// (0 WHEN THE RADIO TASK TOOK NONE OF THEM)
+// A FRAME FOR A NEIGHBOUR GETS ONE COPY AT ITS RATE, A FLOODED ONE A COPY PER SF THE NEIGHBOURS ARE SPREAD OVER
+// (OUR OWN BEACONS ALSO ONE ON THE RENDEZVOUS SF, WHERE A NODE THAT HAS NOT HEARD US YET LISTENS)
+// lastCopy, IF GIVEN, TRACKS THE COPY QUEUED LAST (THE RADIO TASK TAKES A CLASS'S FRAMES IN ORDER)
+static uint32_t transmitFrame(LoRaFrameHeader &header, const uint8_t *payload, size_t payloadLen, LoRaTxClass txClass,
+                              LoRaTxTicket *lastCopy = nullptr)
+{
+  uint8_t sfs[LINK_MAX_PEERS];
+  int8_t powers[LINK_MAX_PEERS];
+  size_t copies = 1;
+  unsigned long now = millis();
+  if (header.nextHop != LORA_BROADCAST_ADDRESS && linkIsNeighbour(header.nextHop, now))
+    linkTxParams(header.nextHop, sfs[0], powers[0]);
   else
+    copies = linkBroadcastRates(sfs, powers, LINK_MAX_PEERS,
+                                header.type == LORA_FRAME_BEACON && header.srcAddress == myLoRaNodeAddress, now);
+
+  header.linkSf = linkListenSf();
+  uint8_t txFrame[LORA_MAX_FRAME_LEN];
+  uint32_t airtimeMs = 0;
+  for (size_t i = 0; i < copies; i++)
   {
-    Serial.print(F("FAILED, code: "));
-    Serial.println(radio_state);
-    setDisplayStatusLine("LoRa Fail " + String(radio_state));
-    while (true)
-      ; // Halt on critical LoRa failure
+    header.linkPower = powers[i];
+    size_t txLen = encodeLoRaFrame(header, payload, payloadLen, txFrame, sizeof(txFrame));
+    if (txLen > 0 && transmitLoRaPacket(txFrame, txLen, sfs[i], powers[i], txClass, lastCopy))
+      airtimeMs += loRaFrameAirtimeMs(txLen, sfs[i]);
   }
-  radio.setDio1Action(onLoRaInterrupt);
-  startLoRaReceive();
+  return airtimeMs;
+}
+
+// FRAMES NEEDED FOR A MESSAGE OF THIS LENGTH
+static uint8_t fragmentCountFor(size_t messageLen)
+{
+  if (messageLen <= LORA_MAX_PAYLOAD_LEN)
+    return 1;
+  return (uint8_t)((messageLen + LORA_MAX_FRAGMENT_PAYLOAD_LEN - 1) / LORA_MAX_FRAGMENT_PAYLOAD_LEN);
 }
 
-// SET LORA RADIO INTO RECEIVE MODE
-void startLoRaReceive()
+// CAN A NEW MESSAGE OF N FRAMES TO THIS DESTINATION GO OUT NOW (FREE SLOTS AND WINDOW ROOM)
+static bool canQueueLoRaMessage(uint16_t dstAddress, uint8_t fragCount)
 {
-  Serial.print(F("[LoRa] Starting RX mode ... "));
-  int radio_state = radio.startReceive();
-  if (radio_state == RADIOLIB_ERR_NONE)
+  if (freeSlotCount < fragCount)
+    return false;
+  ArqTxStream *tx = arqTxStreamFor(dstAddress, millis());
+  return tx && ARQ_WINDOW_SIZE - (tx->nextSeq - tx->base) >= fragCount;
+}
+
+// RETURN A SETTLED SLOT TO THE POOL AND SLIDE ITS STREAM'S WINDOW
+static void releaseOutgoingSlot(uint16_t slotIndex)
+{
+  OutgoingMessage &slot = outgoingSlots[slotIndex];
+  ackTimerWheel.cancel(slotIndex);
+  slot.status = OutgoingMessage::FREE;
+  freeSlotStack[freeSlotCount++] = slotIndex;
+
+  ArqTxStream *tx = arqFindTxStream(slot.dstAddress);
+  if (tx && tx->slotBySeq[slot.loraMessageId % ARQ_WINDOW_SIZE] == (int16_t)slotIndex)
   {
-    Serial.println(F("OK"));
-    setDisplayStatusLine("Listening...");
+    tx->slotBySeq[slot.loraMessageId % ARQ_WINDOW_SIZE] = -1;
+    arqAdvanceBase(*tx);
   }
-  else
+}
+
+// ARE ANY OTHER FRAGMENTS OF THIS SLOT'S MESSAGE STILL WAITING FOR AN ACK
+static bool otherFragmentsPending(const ArqTxStream &tx, uint16_t slotIndex)
+{
+  const OutgoingMessage &slot = outgoingSlots[slotIndex];
+  for (uint8_t i = 0; i < slot.fragCount; i++)
   {
-    Serial.print(F("FAILED, code: "));
-    Serial.println(radio_state);
-    setDisplayStatusLine("Listen Fail " + String(radio_state));
+    uint32_t seq = slot.firstSeq + i;
+    int16_t other = tx.slotBySeq[seq % ARQ_WINDOW_SIZE];
+    if (other >= 0 && other != (int16_t)slotIndex && outgoingSlots[other].loraMessageId == seq)
+      return true;
   }
+  return false;
 }
 
-// TRANSMIT A LORA PACKET WITH SPECIFIED CONTENT
-static bool transmitLoRaPacket(const String &packetToSend, const String &originalMessageContent)
+// GIVE UP ON EVERY FRAGMENT OF THIS SLOT'S MESSAGE
+static void releaseMessageSlots(const ArqTxStream &tx, uint16_t slotIndex)
 {
-  Serial.printf("[LoRa] TX Attempt: %s (Length: %d)\n", packetToSend.c_str(), packetToSend.length());
-  setLastLoRaTx(originalMessageContent);
-  setDisplayStatusLine("Sending LoRa...");
+  uint32_t firstSeq = outgoingSlots[slotIndex].firstSeq;
+  uint8_t fragCount = outgoingSlots[slotIndex].fragCount;
+  for (uint8_t i = 0; i < fragCount; i++)
+  {
+    uint32_t seq = firstSeq + i;
+    int16_t other = tx.slotBySeq[seq % ARQ_WINDOW_SIZE];
+    if (other >= 0 && outgoingSlots[other].loraMessageId == seq)
+      releaseOutgoingSlot(other);
+  }
+}
+
+// (RE)TRANSMIT AN OUTGOING SLOT WITH A FRESH WINDOW OFFSET AND ANY HELD ACK FOR ITS DESTINATION
+static void sendOutgoingSlot(uint16_t slotIndex)
+{
+  OutgoingMessage &slot = outgoingSlots[slotIndex];
+  LoRaFrameHeader header;
+  const uint8_t *payload = nullptr;
+  size_t payloadLen = 0;
+  if (!decodeLoRaFrame(slot.frame, slot.frameLen, header, payload, payloadLen))
+    return;
 
-  // TRANSMIT THE PACKET USING EXPLICIT LENGTH
-  int tx_state = radio.transmit((uint8_t *)packetToSend.c_str(), packetToSend.length());
+  ArqTxStream *tx = arqFindTxStream(slot.dstAddress);
+  if (tx)
+    header.windowOffset = (uint8_t)(slot.loraMessageId - tx->base);
 
-  if (tx_state == RADIOLIB_ERR_NONE)
+  // LET A HELD ACK RIDE ALONG INSTEAD OF COSTING A FRAME OF ITS OWN
+  ArqRxStream *rx = arqPendingAckFor(slot.dstAddress);
+  unsigned long ackDueTime = rx ? rx->ackDueTime : 0;
+  if (rx && slot.frameLen + LORA_PIGGYBACK_ACK_LEN + LORA_AUTH_TAG_LEN <= LORA_MAX_FRAME_LEN)
   {
-    Serial.println(F("  LoRa TX Success (RadioLib)"));
-    setDisplayStatusLine("LoRa Sent");
+    header.flags |= LORA_FLAG_PIGGYBACK_ACK;
+    header.piggyback.peer = rx->peer;
+    header.piggyback.stream = rx->stream;
+    header.piggyback.cumAck = rx->cumAck;
+    header.piggyback.bitmap = rx->bitmap;
+    header.piggyback.snrReport = linkSnrReportFor(rx->peer);
+    rx->ackPending = false;
+    loraStackStats.acksPiggybacked++;
+    Serial.printf("  Piggybacking ACK for 0x%04X: cumulative %u, bitmap 0x%08X\n", rx->peer, rx->cumAck, rx->bitmap);
+  }
+
+  // THE ATTEMPT IS PART OF THE NONCE, SO A SLOT THAT HAS USED EVERY VALUE IS NEVER SEALED AGAIN
+  // (MAX_SEND_RETRIES ENDS IT LONG BEFORE)
+  bool attemptLeft = slot.sendCount < 0xFF;
+  if (attemptLeft)
+    slot.sendCount++;
+  header.attempt = slot.sendCount;
+  slot.lastCopy.txClass = LORA_TX_CLASSES;
+  slot.timeoutDeferrals = 0;
+  slot.lastSendTime = millis();
+  header.nextHop = routeNextHop(slot.dstAddress, slot.lastSendTime);
+
+  // SEAL THIS ATTEMPT - THE TAG COVERS ITS WINDOW OFFSET AND PIGGYBACKED ACK, THE NONCE ITS ATTEMPT
+  uint8_t sealed[LORA_MAX_FRAME_LEN];
+  size_t headerLen = loRaHeaderLen(header);
+  uint8_t *body = sealed + headerLen;
+  uint8_t aad[LORA_MAX_HEADER_LEN];
+  uint32_t airtimeMs = 0;
+  if (!attemptLeft || encodeLoRaFrame(header, payload, payloadLen, sealed, sizeof(sealed) - LORA_AUTH_TAG_LEN) == 0 ||
+      !encryptPayload(body, payloadLen, aad, loRaAuthData(sealed, headerLen, aad), header, body + payloadLen))
+  {
+    Serial.printf("[LoRa] Could not seal MSG_ID: %u, left to the ACK timer.\n", slot.loraMessageId);
   }
   else
   {
-    Serial.print(F("  LoRa TX FAILED (RadioLib), code: "));
-    Serial.println(tx_state);
-    setDisplayStatusLine("LoRa Send Fail");
-    startLoRaReceive();
-    return false; // Indicate TX failure
+    airtimeMs = transmitFrame(header, body, payloadLen + LORA_AUTH_TAG_LEN, slot.sendCount == 1 ? LORA_TX_DATA : LORA_TX_RETRANSMIT,
+                              &slot.lastCopy);
+  }
+  // A SEND THAT NEVER REACHED THE RADIO TASK DOES NOT COUNT (NOR SPOIL AN RTT SAMPLE), THE ACK TIMER RETRIES IT
+  if (airtimeMs > 0)
+  {
+    loraStackStats.dataFramesSent++;
   }
-  startLoRaReceive(); // Reenable RX mode after a successful transmission
-  return true;        // Indicate TX success
+  else
+  {
+    if (attemptLeft)
+      slot.sendCount--;
+    if (header.flags & LORA_FLAG_PIGGYBACK_ACK)
+    {
+      // THE HELD ACK IS DUE AGAIN, WHEN IT WAS BEFORE, AND GOES OUT ON ITS OWN IF NOTHING ELSE CARRIES IT
+      rx->ackPending = true;
+      rx->ackDueTime = ackDueTime;
+      loraStackStats.acksPiggybacked--;
+    }
+  }
+
+  // NO ACK CAN ARRIVE BEFORE EVERY COPY, THE HELD ACK AND THE ACK FRAME HAVE ALL BEEN ON AIR
+  uint32_t floorMs = airtimeMs + ARQ_ACK_HOLD_MS + loRaFrameAirtimeMs(LORA_ACK_FRAME_LEN, linkListenSf()) + ARQ_RTO_MIN_MS;
+  uint32_t timeoutMs = tx ? arqRetransmitTimeout(*tx, floorMs) : ARQ_RTO_INITIAL_MS;
+  ackTimerWheel.schedule(slotIndex, slot.lastSendTime + timeoutMs);
 }
 
-// QUEUE A MESSAGE FOR LORA TRANSMISSION, MANAGE ACK TRACKING
-bool queueLoRaMessage(const String &messageContent, const String &myDeviceId, const String &packetPrefix, const String &localWebId)
+// QUEUE A MESSAGE FOR LORA TRANSMISSION, ONE SLOT PER FRAGMENT, MANAGE ACK TRACKING
+// outboxId IS THE MESSAGE'S OUTBOX RECORD, SETTLED WHEN THE LAST FRAGMENT IS ACKED (0 IF NOT PERSISTED)
+static bool queueLoRaMessage(const char *messageContent, const char *localWebId, uint16_t dstAddress, uint32_t outboxId)
 {
-  currentLoRaMessageId++;
-  if (currentLoRaMessageId == 0)
-    currentLoRaMessageId = 1;
+  size_t messageLen = strlen(messageContent);
+  if (messageLen == 0 || messageLen > LORA_MAX_MESSAGE_LEN)
+  {
+    Serial.printf("[LoRa] Message length %u outside 1..%u bytes, not queued.\n", (unsigned)messageLen, (unsigned)LORA_MAX_MESSAGE_LEN);
+    return false;
+  }
+
+  // COMPRESS THE WHOLE MESSAGE, FALLING BACK TO RAW TEXT WHEN THAT SAVES NOTHING
+  static uint8_t compressed[LORA_MAX_MESSAGE_LEN];
+  const uint8_t *body = compressed;
+  uint8_t bodyFlags = LORA_FLAG_ENCRYPTED | LORA_FLAG_COMPRESSED;
+  size_t bodyLen = compressText(messageContent, messageLen, compressed, sizeof(compressed));
+  if (bodyLen == 0)
+  {
+    body = (const uint8_t *)messageContent;
+    bodyLen = messageLen;
+    bodyFlags = LORA_FLAG_ENCRYPTED;
+  }
+  else
+  {
+    loraStackStats.compressedBytesSaved += messageLen - bodyLen;
+  }
+
+  uint8_t fragCount = fragmentCountFor(bodyLen);
+  if (!canQueueLoRaMessage(dstAddress, fragCount))
+  {
+    Serial.println(F("[LoRa] Send window full, not queued."));
+    return false;
+  }
+  ArqTxStream *tx = arqTxStreamFor(dstAddress, millis());
+  uint32_t firstSeq = tx->nextSeq;
+
+  for (uint8_t fragIndex = 0; fragIndex < fragCount; fragIndex++)
+  {
+    size_t chunkLen = (fragCount == 1) ? bodyLen : LORA_MAX_FRAGMENT_PAYLOAD_LEN;
+    size_t offset = (size_t)fragIndex * chunkLen;
+    if (offset + chunkLen > bodyLen)
+      chunkLen = bodyLen - offset;
 
-  // ENCRYPT THE MESSAGE CONTENT
-  String encryptedContent = encryptMessage(messageContent);
-  Serial.printf("[LoRa] Original: '%s', Encrypted: '%s'\n", messageContent.c_str(), encryptedContent.c_str());
+    uint32_t seq = tx->nextSeq;
+    LoRaFrameHeader header;
+    header.version = LORA_PROTOCOL_VERSION;
+    header.type = LORA_FRAME_DATA;
+    header.flags = bodyFlags;
+    header.dstAddress = dstAddress;
+    header.srcAddress = myLoRaNodeAddress;
+    header.messageId = seq;
+    header.linkSf = linkListenSf();
+    header.linkPower = LORA_POWER_MAX; // Per-transmission fields are rewritten by sendOutgoingSlot()
+    header.hopLimit = LORA_MESH_HOP_LIMIT;
+    header.hopCount = 0;
+    header.attempt = 0;
+    header.lastHop = myLoRaNodeAddress;
+    header.nextHop = LORA_BROADCAST_ADDRESS;
+    header.windowOffset = (uint8_t)(seq - tx->base);
+    if (fragCount > 1)
+    {
+      header.flags |= LORA_FLAG_FRAGMENT;
+      header.fragIndex = fragIndex;
+      header.fragCount = fragCount;
+    }
 
-  // SENDER_ID:PACKET_PREFIX:MESSAGE_ID:ENCRYPTED_MESSAGE_CONTENT
-  String loraPacket = myDeviceId + ":" + packetPrefix + String(currentLoRaMessageId) + ":" + encryptedContent;
+    uint16_t slotIndex = freeSlotStack[--freeSlotCount];
+    OutgoingMessage *slot = &outgoingSlots[slotIndex];
+    slot->frameLen = encodeLoRaFrame(header, body + offset, chunkLen, slot->frame, sizeof(slot->frame));
+    tx->nextSeq++;
+    tx->slotBySeq[seq % ARQ_WINDOW_SIZE] = (int16_t)slotIndex;
 
-  OutgoingMessage newMessage;
-  newMessage.localWebId = localWebId;
-  newMessage.loraMessageId = currentLoRaMessageId;
-  newMessage.packetContent = loraPacket;
-  newMessage.lastSendTime = millis();
-  newMessage.retriesLeft = MAX_SEND_RETRIES;
-  newMessage.status = OutgoingMessage::PENDING_ACK;
+    strncpy(slot->localWebId, localWebId, LORA_LOCAL_ID_MAX_LEN);
+    slot->localWebId[LORA_LOCAL_ID_MAX_LEN] = 0;
+    slot->loraMessageId = seq;
+    slot->firstSeq = firstSeq;
+    slot->fragCount = fragCount;
+    slot->dstAddress = dstAddress;
+    slot->outboxId = outboxId;
+    slot->retriesLeft = MAX_SEND_RETRIES;
+    slot->sendCount = 0;
+    slot->status = OutgoingMessage::PENDING_ACK;
+    sendOutgoingSlot(slotIndex);
+  }
 
-  outgoingMessageQueue.push_back(newMessage);
-  Serial.printf("[LoRa] Queued MSG_ID:%u (LocalWebID:%s) for TX. Content: %s\n", currentLoRaMessageId, localWebId.c_str(), messageContent.c_str());
+  claimLoRaEpochOf(tx->nextSeq);
 
-  transmitLoRaPacket(loraPacket, messageContent);
+  if (fragCount > 1)
+    loraStackStats.fragmentedSent++;
+  Serial.printf("[LoRa] Queued MSG_ID:%u (LocalWebID:%s, %u -> %u bytes, %u fragment(s), window %u/%u) for TX. Content: %s\n",
+                firstSeq, localWebId, (unsigned)messageLen, (unsigned)bodyLen, fragCount,
+                (unsigned)(tx->nextSeq - tx->base), (unsigned)ARQ_WINDOW_SIZE, messageContent);
+  setLastLoRaTx(messageContent);
 
   // NOTIFY WEB UI THAT MESSAGE IS SENT AND NOW PENDING ACKNOWLEDGMENT
   if (onLoraAckStatusCallback)
   {
-    onLoraAckStatusCallback(localWebId, currentLoRaMessageId, false, false); // acked=false, finalFailure=false
+    onLoraAckStatusCallback(localWebId, firstSeq, false, false); // acked=false, finalFailure=false
   }
   return true; // Successful queuing
 }
 
-// HANDLER FOR INCOMING LORA PACKETS AND ACK PROCESSING
-void handleLoRaEvents(const String &myDeviceId, const String &packetPrefix)
+// SUBMIT A MESSAGE FROM ANY TASK - THE STACK PICKS IT UP ON ITS NEXT PASS
+LoRaSubmitResult submitLoRaMessage(const char *text, const char *localWebId, uint16_t dstAddress)
 {
-  checkAckTimeouts();
+  size_t textLen = strlen(text);
+  if (textLen == 0 || textLen > LORA_MAX_MESSAGE_LEN || strlen(localWebId) > LORA_LOCAL_ID_MAX_LEN)
+    return LORA_SUBMIT_TOO_LONG;
 
-  bool rxEventOccurredThisCycle = false;
+  LoRaCommand command;
+  command.type = LoRaCommand::SEND_TEXT;
+  memcpy(command.text, text, textLen + 1);
+  strcpy(command.localWebId, localWebId);
+  command.dstAddress = dstAddress;
+  return loraCommandQueue.push(command) ? LORA_SUBMIT_OK : LORA_SUBMIT_QUEUE_FULL;
+}
+
+// APPLY A SELECTIVE ACK TO THE SENDER WINDOW - SETTLE ACKED FRAMES, RESEND ONLY THE GAPS
+// stream IS THE DESTINATION WE SENT TO - THE PEER ITSELF, OR A BROADCAST OR GROUP STREAM ANY MEMBER MAY SETTLE
+static void applySelectiveAck(uint16_t peer, uint16_t stream, uint32_t cumAck, uint32_t ackBitmap)
+{
+  Serial.printf("  Received SACK from 0x%04X for 0x%04X: cumulative %u, bitmap 0x%08X\n", peer, stream, cumAck, ackBitmap);
 
-  if (loraPacketReceivedFlag)
+  ArqTxStream *tx = (loRaIsNodeAddress(stream) && stream != peer) ? nullptr : arqFindTxStream(stream);
+  if (!tx)
   {
-    loraPacketReceivedFlag = false;  // Clear the ISR flag
-    rxEventOccurredThisCycle = true; // Mark that we are processing an RX event
+    Serial.println(F("  Warning: Received ACK with no matching send window."));
+    return;
+  }
 
-    // Attempt a read if the flag was set, then scrutinize the result.
-    String rawPacketStr;
-    int rx_state = radio.readData(rawPacketStr);
+  // SETTLE EVERYTHING THE ACK COVERS AND REMEMBER THE NEWEST FRAME IT CONFIRMS
+  bool sawAckedFrame = false;
+  uint32_t newestAcked = 0;
+  for (uint32_t seq = tx->base; seq != tx->nextSeq; seq++)
+  {
+    int16_t slotIndex = tx->slotBySeq[seq % ARQ_WINDOW_SIZE];
+    if (slotIndex < 0 || !arqSeqAcked(seq, cumAck, ackBitmap))
+      continue;
+    OutgoingMessage &slot = outgoingSlots[slotIndex];
+    Serial.printf("  Matched ACK to outgoing MSG_ID: %u (LocalWebID: %s). Marking ACKED.\n", seq, slot.localWebId);
+    linkDelivered(peer);
+    routeDelivered(peer);
+    // KARN: A RETRANSMITTED FRAME'S ACK COULD BELONG TO ANY COPY, SO IT GIVES NO SAMPLE
+    if (slot.sendCount == 1)
+    {
+      arqRttSample(*tx, millis() - slot.lastSendTime);
+      loraStackStats.rttSamples++;
+    }
+    // THE UI SEES ONE ACK PER MESSAGE, WHEN ITS LAST OUTSTANDING FRAGMENT IS CONFIRMED
+    if (!otherFragmentsPending(*tx, slotIndex))
+    {
+      outboxDone(slot.outboxId, true);
+      if (onLoraAckStatusCallback)
+        onLoraAckStatusCallback(slot.localWebId, slot.firstSeq, true, false);
+    }
+    releaseOutgoingSlot(slotIndex);
+    sawAckedFrame = true;
+    newestAcked = seq;
+  }
 
-    if (rx_state == RADIOLIB_ERR_NONE && rawPacketStr.length() < ABSOLUTE_MIN_PACKET_LEN)
+  // ANY UNACKED FRAME OLDER THAN A CONFIRMED ONE IS A GAP - RESEND IT NOW
+  unsigned long now = millis();
+  for (uint32_t seq = tx->base; sawAckedFrame && arqSeqBefore(seq, newestAcked); seq++)
+  {
+    int16_t slotIndex = tx->slotBySeq[seq % ARQ_WINDOW_SIZE];
+    if (slotIndex < 0)
+      continue;
+    OutgoingMessage &slot = outgoingSlots[slotIndex];
+    if (slot.retriesLeft > 0 && now - slot.lastSendTime > ARQ_GAP_RETX_GUARD_MS)
     {
-      Serial.printf("Ignored (Packet too short after read: %d chars). \n", rawPacketStr.length());
+      slot.retriesLeft--;
+      Serial.printf("  Gap at MSG_ID: %u, selective retransmit (%d left).\n", seq, slot.retriesLeft);
+      sendOutgoingSlot(slotIndex);
     }
-    else if (rx_state == RADIOLIB_ERR_NONE)
+  }
+}
+
+// STANDALONE ACK FRAME FROM A PEER
+static void processAckFrame(const LoRaFrameHeader &header)
+{
+  if (header.hopCount == 0)
+    linkSnrReport(header.srcAddress, header.snrReport);
+  applySelectiveAck(header.srcAddress, header.ackStream, header.messageId, header.ackBitmap);
+}
+
+// ACKNOWLEDGE A SENDER WITH ITS FULL RECEIVE WINDOW STATE
+static void sendSelectiveAck(ArqRxStream &rx)
+{
+  LoRaFrameHeader ackHeader;
+  ackHeader.version = LORA_PROTOCOL_VERSION;
+  ackHeader.type = LORA_FRAME_ACK;
+  ackHeader.flags = 0;
+  ackHeader.dstAddress = rx.peer;
+  ackHeader.srcAddress = myLoRaNodeAddress;
+  ackHeader.messageId = rx.cumAck;
+  ackHeader.attempt = 0;
+  ackHeader.windowOffset = 0;
+  ackHeader.ackBitmap = rx.bitmap;
+  ackHeader.snrReport = linkSnrReportFor(rx.peer);
+  ackHeader.ackStream = rx.stream;
+  ackHeader.ackSerial = nextAckSerial++;
+  ackHeader.linkSf = linkListenSf();
+  ackHeader.linkPower = LORA_POWER_MAX; // Rewritten per copy by transmitFrame()
+  ackHeader.hopLimit = LORA_MESH_HOP_LIMIT;
+  ackHeader.hopCount = 0;
+  ackHeader.lastHop = myLoRaNodeAddress;
+  ackHeader.nextHop = routeNextHop(rx.peer, millis());
+  Serial.printf("[LoRa] Queueing SACK to 0x%04X: cumulative %u, bitmap 0x%08X\n", rx.peer, rx.cumAck, rx.bitmap);
+
+  // AN ACK HAS NO PAYLOAD, ITS TAG COVERS THE HEADER SO NOBODY CAN SETTLE OR STALL OUR PEERS' FRAMES
+  uint8_t encoded[LORA_ACK_HEADER_LEN];
+  uint8_t aad[LORA_MAX_HEADER_LEN];
+  uint8_t tag[LORA_AUTH_TAG_LEN];
+  encodeLoRaFrame(ackHeader, nullptr, 0, encoded, sizeof(encoded));
+  claimLoRaEpochOf(nextAckSerial);
+  if (!encryptPayload(nullptr, 0, aad, loRaAuthData(encoded, LORA_ACK_HEADER_LEN, aad), ackHeader, tag))
+  {
+    Serial.println(F("[LoRa] Encryption failed, SACK dropped."));
+    rx.ackPending = false; // Left pending, flushDueAcks() would pick it straight back up
+    return;
+  }
+  if (transmitFrame(ackHeader, tag, sizeof(tag), LORA_TX_ACK) == 0)
+  {
+    // ACK QUEUE FULL - KEEP IT HELD AND TRY AGAIN AFTER ANOTHER HOLD TIME
+    rx.ackDueTime = millis() + ARQ_ACK_HOLD_MS;
+    return;
+  }
+  rx.ackPending = false;
+  loraStackStats.ackFramesSent++;
+}
+
+// HOLD THE ACK FOR A RECEIVED FRAME SO LATER FRAMES OR OUR OWN DATA CAN CARRY IT
+static void scheduleAck(ArqRxStream &rx)
+{
+  if (rx.ackPending)
+  {
+    loraStackStats.acksCoalesced++;
+    return;
+  }
+  rx.ackPending = true;
+  rx.ackDueTime = millis() + ARQ_ACK_HOLD_MS;
+}
+
+// SEND EVERY HELD ACK THAT FOUND NO DATA FRAME TO RIDE ON
+static void flushDueAcks()
+{
+  ArqRxStream *rx;
+  while ((rx = arqNextDueAck(millis())) != nullptr)
+    sendSelectiveAck(*rx);
+}
+
+// WHERE A DATA FRAME FOR US FALLS IN ITS SENDER'S RECEIVE WINDOW - CHECKED ON A SCRATCH COPY SO NOTHING IS
+// RECORDED YET. A SENDER WITHOUT A STREAM GETS NONE UNTIL ITS FRAME AUTHENTICATES, SO FORGERIES CANNOT EVICT ONE
+static ArqRxResult probeDataFrame(const LoRaFrameHeader &header)
+{
+  ArqRxStream *rx = arqFindRxStream(header.srcAddress, header.dstAddress);
+  if (!rx)
+    return ARQ_RX_NEW;
+  ArqRxStream probe = *rx;
+  return arqAcceptFrame(probe, header.messageId, header.windowOffset);
+}
+
+// A DATA FRAME FOR US THAT WILL NOT BE DELIVERED: A COPY WE ALREADY HAVE ONLY EARNS A RE-ACK
+static void refuseDataFrame(const LoRaFrameHeader &header, ArqRxResult result)
+{
+  if (result == ARQ_RX_OUT_OF_WINDOW)
+  {
+    Serial.printf("[LoRa] Ignored (MSG_ID %u from 0x%04X beyond receive window).\n", header.messageId, header.srcAddress);
+    return;
+  }
+  scheduleAck(*arqFindRxStream(header.srcAddress, header.dstAddress));
+  loraStackStats.duplicatesSuppressed++;
+  Serial.printf("[LoRa] Duplicate MSG_ID %u from 0x%04X, re-ACK only.\n", header.messageId, header.srcAddress);
+}
+
+// CHECK A FRAME'S TAG BEFORE ANYTHING IS CACHED, RELAYED, LEARNED OR RECORDED FROM IT - THE NETWORK KEY IS
+// SHARED, SO THIS HOLDS FOR FRAMES WE ONLY RELAY TOO. A DATA FRAME'S PAYLOAD IS DECRYPTED INTO PLAIN, AN ACK
+// OR BEACON CARRIES NOTHING BUT THE TAG OVER ITS HEADER
+static bool authenticateFrame(const LoRaFrameHeader &header, const uint8_t *frame, const uint8_t *payload, size_t payloadLen,
+                              uint8_t *plain, size_t &plainLen)
+{
+  uint8_t aad[LORA_MAX_HEADER_LEN];
+  size_t aadLen = loRaAuthData(frame, payload - frame, aad);
+  bool authentic;
+  if (header.type == LORA_FRAME_DATA)
+  {
+    if (!(header.flags & LORA_FLAG_ENCRYPTED) || payloadLen <= LORA_AUTH_TAG_LEN)
     {
-      Serial.print(F("[LoRa] RX Raw (passed initial checks): "));
-      Serial.println(rawPacketStr);
-      float rssi = radio.getRSSI();
-      float snr = radio.getSNR();
-      Serial.printf("  RSSI: %.2f dBm, SNR: %.2f dB\n", rssi, snr);
-
-      int firstColon = rawPacketStr.indexOf(':');
-      if (firstColon <= 0 || firstColon == rawPacketStr.length() - 1)
-      {
-        Serial.println(F("Ignored (No valid Device ID separator ':' found)."));
-        setLastLoRaRx("No ID");
-        setDisplayStatusLine("LoRa RX NoID");
-      }
-      else
-      {
-        String senderId = rawPacketStr.substring(0, firstColon);
-        String restOfPacket = rawPacketStr.substring(firstColon + 1);
-        Serial.print(F("  Parsed RX Sender ID: "));
-        Serial.println(senderId);
-
-        if (senderId.length() == 0 || senderId.length() > 20)
-        {
-          Serial.printf("  Ignored (Wrong Sender ID length: %d). Parsed: '%s'\n", senderId.length(), senderId.c_str());
-        }
-        else if (senderId == myDeviceId)
-        {
-          Serial.println(F("  Ignored (Self-Echo: ID Match)."));
-        }
-        else if (restOfPacket.startsWith(LORA_ACK_PREFIX))
-        {
-          String ackPayload = restOfPacket.substring(strlen(LORA_ACK_PREFIX));
-          uint32_t ackedMessageId = ackPayload.toInt();
-          Serial.printf("  Received ACK from %s for MSG_ID: %u (Raw ACK Payload: '%s')\n", senderId.c_str(), ackedMessageId, ackPayload.c_str());
-          bool foundAndUpdated = false;
-          for (auto it = outgoingMessageQueue.begin(); it != outgoingMessageQueue.end();)
-          {
-            if (it->loraMessageId == ackedMessageId && it->status == OutgoingMessage::PENDING_ACK)
-            {
-              Serial.printf("  Matched ACK to outgoing MSG_ID: %u (LocalWebID: %s). Marking ACKED.\n", ackedMessageId, it->localWebId.c_str());
-              it->status = OutgoingMessage::ACKNOWLEDGED;
-              if (onLoraAckStatusCallback)
-              {
-                onLoraAckStatusCallback(it->localWebId, it->loraMessageId, true, false);
-              }
-              it = outgoingMessageQueue.erase(it);
-              foundAndUpdated = true;
-            }
-            else
-            {
-              ++it;
-            }
-          }
-          if (!foundAndUpdated)
-          {
-            Serial.printf("  Warning: Received ACK for unknown/already-acked/failed MSG_ID: %u\n", ackedMessageId);
-          }
-        }
-        else if (restOfPacket.startsWith(packetPrefix))
-        {
-          if (restOfPacket.length() < packetPrefix.length() + 3)
-          {
-            Serial.println(F("  Ignored (Data packet too short after prefix)."));
-          }
-          else
-          {
-            String payloadWithMsgId = restOfPacket.substring(packetPrefix.length());
-            int secondColon = payloadWithMsgId.indexOf(':');
-            if (secondColon <= 0 || secondColon == payloadWithMsgId.length() - 1)
-            {
-              Serial.println(F("  Ignored (Malformed data packet - no valid MSG_ID:PAYLOAD separator)."));
-              setLastLoRaRx("Malformed");
-              setDisplayStatusLine("LoRa RX Bad");
-            }
-            else
-            {
-              uint32_t receivedMessageId = payloadWithMsgId.substring(0, secondColon).toInt();
-              String encryptedMessage = payloadWithMsgId.substring(secondColon + 1);
-
-              // Decrypt the message
-              String actualMessage = decryptMessage(encryptedMessage);
-              Serial.printf("  [LoRa] Encrypted: '%s', Decrypted: '%s'\n", encryptedMessage.c_str(), actualMessage.c_str());
-
-              Serial.print(F("  Peer Message (MSG_ID:"));
-              Serial.print(receivedMessageId);
-              Serial.print(F(") from "));
-              Serial.print(senderId);
-              Serial.print(F(": "));
-              Serial.println(actualMessage);
-              setLastLoRaRx(actualMessage);
-              setDisplayStatusLine("LoRa RX OK");
-
-              String ackPacket = myDeviceId + ":" + LORA_ACK_PREFIX + String(receivedMessageId); // Simple ACK
-              Serial.printf("  Sending ACK for MSG_ID %u to %s -> Packet: %s (Length: %d)\n", receivedMessageId, senderId.c_str(), ackPacket.c_str(), ackPacket.length());
-              int ack_tx_status = radio.transmit((uint8_t *)ackPacket.c_str(), ackPacket.length());
-              if (ack_tx_status == RADIOLIB_ERR_NONE)
-                Serial.println("    ACK sent successfully.");
-              else
-                Serial.printf("    ACK send failed, code: %d\n", ack_tx_status);
-              startLoRaReceive(); // After sending ACK
-
-              if (onExternalReceiveCallback)
-              {
-                onExternalReceiveCallback(senderId, actualMessage);
-              }
-            }
-          }
-        }
-        else
-        {
-          Serial.println(F("  Ignored (Packet has no known prefix for this app after sender ID)."));
-          if (senderId != myDeviceId)
-          {
-            setLastLoRaRx("Wrong Prefix");
-            setDisplayStatusLine("LoRa RX Prefix");
-          }
-        }
-      }
+      Serial.println(F("[LoRa] Ignored (Data frame without authenticated payload)."));
+      return false;
     }
-    else if (rx_state == RADIOLIB_ERR_CRC_MISMATCH)
+    plainLen = payloadLen - LORA_AUTH_TAG_LEN;
+    memcpy(plain, payload, plainLen);
+    authentic = decryptPayload(plain, plainLen, aad, aadLen, header, payload + plainLen);
+    plain[authentic ? plainLen : 0] = 0;
+  }
+  else
+  {
+    plainLen = 0;
+    authentic = payloadLen == LORA_AUTH_TAG_LEN && decryptPayload(nullptr, 0, aad, aadLen, header, payload);
+  }
+  if (!authentic)
+  {
+    loraStackStats.authFailures++;
+    Serial.printf("[LoRa] Ignored (Type %u frame %u from 0x%04X failed authentication).\n", header.type, header.messageId,
+                  header.srcAddress);
+  }
+  return authentic;
+}
+
+// RECORD A NEW, AUTHENTICATED DATA FRAME FOR US IN ITS RECEIVE WINDOW AND ACK IT, APPLYING ANY ACK IT CARRIES
+// FOR US - THE TAG COVERED THE SEQUENCE, WINDOW OFFSET AND PIGGYBACKED ACK
+// FALSE IF IT IS A FRAGMENT WE HAVE NO BUFFER FOR - IT IS NEITHER RECORDED NOR ACKED, SO THE SENDER RETRIES IT
+static bool acceptDataFrame(const LoRaFrameHeader &header, size_t plainLen)
+{
+  if ((header.flags & LORA_FLAG_PIGGYBACK_ACK) && header.piggyback.peer == myLoRaNodeAddress)
+  {
+    if (header.hopCount == 0)
+      linkSnrReport(header.srcAddress, header.piggyback.snrReport);
+    applySelectiveAck(header.srcAddress, header.piggyback.stream, header.piggyback.cumAck, header.piggyback.bitmap);
+  }
+  if ((header.flags & LORA_FLAG_FRAGMENT) && !reassemblyHasRoom(header, plainLen))
+  {
+    Serial.printf("[LoRa] Fragment %u/%u of MSG_ID %u from 0x%04X left unacknowledged (No reassembly buffer).\n",
+                  header.fragIndex + 1, header.fragCount, header.messageId - header.fragIndex, header.srcAddress);
+    return false;
+  }
+  ArqRxStream *rx = arqRxStreamFor(header.srcAddress, header.dstAddress, millis());
+  arqAcceptFrame(*rx, header.messageId, header.windowOffset);
+  scheduleAck(*rx);
+  return true;
+}
+
+// DELIVER A NEW, AUTHENTICATED DATA FRAME
+static void processDataFrame(const LoRaFrameHeader &header, const char *senderId, const uint8_t *plain, size_t plainLen)
+{
+  // FRAGMENTS WAIT IN A REASSEMBLY BUFFER UNTIL THE WHOLE MESSAGE IS IN
+  const uint8_t *body = plain;
+  size_t bodyLen = plainLen;
+  LoRaReassembly *reassembly = nullptr;
+  if (header.flags & LORA_FLAG_FRAGMENT)
+  {
+    LoRaReassemblyResult result = reassemblyAddFragment(header, plain, plainLen, millis(), reassembly);
+    if (result != REASSEMBLY_COMPLETE)
     {
-      Serial.println(F("[LoRa] RX CRC error!"));
-      setLastLoRaRx("CRC Error!");
-      setDisplayStatusLine("LoRa RX CRC");
+      Serial.printf("  Fragment %u/%u of MSG_ID %u %s.\n", header.fragIndex + 1, header.fragCount,
+                    header.messageId - header.fragIndex, result == REASSEMBLY_STORED ? "stored" : "rejected");
+      return;
     }
-    else
+    loraStackStats.reassembled++;
+    body = reassembly->data;
+    bodyLen = reassembly->totalLen;
+  }
+
+  // EXPAND A COMPRESSED BODY, RAW BODIES ARE ALREADY NUL-TERMINATED TEXT
+  static char expanded[LORA_MAX_MESSAGE_LEN + 1];
+  const char *messageText = (const char *)body;
+  size_t messageLen = bodyLen;
+  if (header.flags & LORA_FLAG_COMPRESSED)
+  {
+    messageLen = decompressText(body, bodyLen, expanded, sizeof(expanded));
+    messageText = expanded;
+  }
+
+  if (messageLen == 0)
+  {
+    Serial.println(F("  Ignored (Malformed compressed payload)."));
+  }
+  else
+  {
+    Serial.printf("  Peer Message (MSG_ID:%u) from %s: %s\n", header.messageId - header.fragIndex, senderId, messageText);
+    setLastLoRaRx(messageText);
+    setDisplayStatusLine("LoRa RX OK");
+
+    if (onExternalReceiveCallback)
     {
-      Serial.printf("  [LoRa DEBUG] radio.readData() returned error: %d. No valid packet to parse.\n", rx_state);
-      setLastLoRaRx("Read Fail");
-      setDisplayStatusLine("LoRa RX Fail");
+      onExternalReceiveCallback(senderId, messageText, messageLen);
     }
+  }
+  // THE TEXT MAY LIVE IN THE REASSEMBLY BUFFER, SO IT IS ONLY FREED ONCE DELIVERED
+  if (reassembly)
+    reassemblyRelease(*reassembly);
+}
 
-    delay(150);
-    startLoRaReceive();
-  } 
+// FRAMES ADDRESSED TO US: OUR OWN ADDRESS, BROADCAST OR A GROUP WE ARE IN
+static bool isOurDestination(uint16_t dstAddress)
+{
+  if (dstAddress == myLoRaNodeAddress || dstAddress == LORA_BROADCAST_ADDRESS)
+    return true;
+  for (uint16_t group : MY_GROUPS)
+  {
+    if (group == dstAddress)
+      return true;
+  }
+  return false;
+}
+
+// WHAT A NEW, TRUSTED FRAME TEACHES US - ONLY CALLED ONCE IT IS PAST THE SEEN CACHE AND ITS TAG
+static void learnFromFrame(const LoRaFrameHeader &header, const LoRaRadioFrame &rxFrame, unsigned long now)
+{
+  // IT TELLS US ABOUT THE LINK TO ITS TRANSMITTER
+  linkFrameHeard(header, rxFrame.rssi, rxFrame.snr, now);
+
+  // THE PATH IT TOOK, REVERSED, IS A ROUTE BACK TO ITS ORIGIN (AND THE TRANSMITTER IS ONE HOP AWAY)
+  float linkSnr = rxFrame.snr + (float)(LORA_POWER_MAX - header.linkPower);
+  if (header.lastHop != header.srcAddress)
+    routeLearn(header.lastHop, header.lastHop, 1, linkSnr, now);
+  routeLearn(header.srcAddress, header.lastHop, header.hopCount + 1, linkSnr, now);
+
+  // ITS ORIGIN IS REACHABLE AGAIN, SO MESSAGES HELD FOR IT MAY GO
+  outboxPeerHeard(header.srcAddress);
+}
 
-  if (rxEventOccurredThisCycle)
+// PARSE AND DISPATCH A FRAME TAKEN FROM THE RX RING
+static void processReceivedFrame(const LoRaRadioFrame &rxFrame)
+{
+  LoRaFrameHeader header;
+  const uint8_t *payload = nullptr;
+  size_t payloadLen = 0;
+
+  // A FRAME THAT IS NEITHER FOR US NOR OURS TO FORWARD IS DROPPED ON ITS ADDRESS BYTES ALONE -
+  // NO PARSING, DECRYPTION, ACK OR LOGGING ON BEHALF OF OTHER NODES' TRAFFIC
+  uint16_t peekDst, peekNextHop;
+  if (peekLoRaAddressing(rxFrame.data, rxFrame.len, peekDst, peekNextHop) && !isOurDestination(peekDst) &&
+      !(RELAY_ENABLED && (peekNextHop == myLoRaNodeAddress || peekNextHop == LORA_BROADCAST_ADDRESS)))
+  {
+    loraStackStats.foreignRejected++;
+    if (peekNextHop != LORA_BROADCAST_ADDRESS)
+      loraRouteStats.notOurHop++;
+    return;
+  }
+
+  if (!decodeLoRaFrame(rxFrame.data, rxFrame.len, header, payload, payloadLen))
+  {
+    Serial.printf("[LoRa] Ignored (Not a v%d frame for this app, %u bytes).\n", LORA_PROTOCOL_VERSION, (unsigned)rxFrame.len);
+    setLastLoRaRx("Malformed");
+    setDisplayStatusLine("LoRa RX Bad");
+    return;
+  }
+
+  if (header.srcAddress == myLoRaNodeAddress)
+  {
+    Serial.println(F("[LoRa] Ignored (Self-Echo: Address Match)."));
+    return;
+  }
+  unsigned long now = millis();
+
+  // MESH - EACH TRANSMISSION IS HANDLED ONCE. ANYTHING NOT MEANT FOR US ALONE IS FORWARDED BY ITS
+  // DESIGNATED NEXT HOP, OR BY MANAGED FLOODING WHEN THE SENDER HAD NO ROUTE
+  bool forOthers = header.dstAddress != myLoRaNodeAddress;
+  bool directed = header.nextHop == myLoRaNodeAddress;
+  bool forUs = isOurDestination(header.dstAddress);
+  bool relayThis = RELAY_ENABLED && forOthers && (directed || header.nextHop == LORA_BROADCAST_ADDRESS);
+  if (relayCheckSeen(header, rxFrame.data, rxFrame.len) == RELAY_DUPLICATE)
+  {
+    Serial.printf("[LoRa] Ignored (Copy of 0x%04X/%u already heard, via 0x%04X).\n", header.srcAddress, header.messageId, header.lastHop);
+    return;
+  }
+
+  // DATA FOR US THAT WE ALREADY HAVE IS RE-ACKED WITHOUT THE COST OF DECRYPTING IT, UNLESS IT IS ALSO OURS TO RELAY
+  ArqRxResult arqResult = (forUs && header.type == LORA_FRAME_DATA) ? probeDataFrame(header) : ARQ_RX_NEW;
+  if (arqResult != ARQ_RX_NEW && !relayThis)
   {
-    Serial.println(F("[LoRa DEBUG] Applying post-RX-event cool-down delay."));
-    // delay(150);
-    startLoRaReceive();
+    refuseDataFrame(header, arqResult);
+    return;
+  }
+
+  // FORGERIES STOP HERE - THEY NEVER ENTER THE SEEN CACHE (WHERE THEY WOULD HIDE THE GENUINE FRAME), ARE NEVER
+  // RELAYED AND TEACH NOTHING ABOUT LINKS, ROUTES OR WHO IS REACHABLE
+  uint8_t plain[LORA_MAX_PAYLOAD_LEN + 1];
+  size_t plainLen = 0;
+  if (!authenticateFrame(header, rxFrame.data, payload, payloadLen, plain, plainLen))
+    return;
+  relayAccept(header, rxFrame.data, rxFrame.len, rxFrame.snr, loRaFrameAirtimeMs(rxFrame.len, rxFrame.sf), relayThis,
+              directed, now);
+  learnFromFrame(header, rxFrame, now);
+  if (!forUs)
+  {
+    Serial.println(F("[LoRa] Relay only (Addressed to another node)."));
+    return;
+  }
+  if (arqResult != ARQ_RX_NEW)
+  {
+    refuseDataFrame(header, arqResult);
+    return;
+  }
+  if (header.type == LORA_FRAME_DATA && !acceptDataFrame(header, plainLen))
+    return;
+
+  char nameBuf[LORA_NODE_NAME_LEN];
+  const char *senderId = nodeNameForAddress(header.srcAddress, nameBuf, sizeof(nameBuf));
+  Serial.printf("[LoRa] RX type %u from %s (0x%04X), %u hop(s), %u bytes on SF%u. RSSI: %.2f dBm, SNR: %.2f dB, queued %lu ms\n",
+                header.type, senderId, header.srcAddress, header.hopCount + 1, (unsigned)rxFrame.len, rxFrame.sf,
+                rxFrame.rssi, rxFrame.snr, millis() - rxFrame.timestamp);
+
+  if (header.type == LORA_FRAME_ACK)
+  {
+    processAckFrame(header);
+  }
+  else if (header.type == LORA_FRAME_DATA)
+  {
+    processDataFrame(header, senderId, plain, plainLen);
+  }
+  else if (header.type == LORA_FRAME_BEACON)
+  {
+    Serial.printf("  Beacon from %s, %u hop(s) away.\n", senderId, header.hopCount + 1);
+  }
+  else
+  {
+    Serial.println(F("  Ignored (Unknown frame type)."));
+    setLastLoRaRx("Wrong Type");
+    setDisplayStatusLine("LoRa RX Type");
   }
 }
 
-// CHECK FOR ACK TIMEOUTS AND HANDLE RETRANSMISSIONS
-void checkAckTimeouts()
+// REBROADCAST EVERY RELAY WHOSE DELAY RAN OUT WITHOUT ENOUGH NEIGHBOURS BEATING US TO IT
+static void sendDueRelays()
 {
-  unsigned long currentTime = millis();
-  for (auto it = outgoingMessageQueue.begin(); it != outgoingMessageQueue.end();)
+  LoRaRelayPending *entry;
+  while ((entry = relayNextDue(millis())) != nullptr)
   {
-    if (it->status == OutgoingMessage::PENDING_ACK)
+    LoRaFrameHeader header;
+    const uint8_t *payload = nullptr;
+    size_t payloadLen = 0;
+    if (decodeLoRaFrame(entry->frame, entry->frameLen, header, payload, payloadLen))
     {
-      if (currentTime - it->lastSendTime > ACK_TIMEOUT_MS)
-      { // Check if timeout expired
-        if (it->retriesLeft > 0)
-        { 
-          it->retriesLeft--;
-          it->lastSendTime = currentTime; // Update last send time
-          Serial.printf("[LoRa] ACK Timeout for MSG_ID: %u (LocalWebID: %s). Retrying (%d left). Packet: %s\n",
-                        it->loraMessageId, it->localWebId.c_str(), it->retriesLeft, it->packetContent.c_str());
-          String originalMsg = it->packetContent.substring(it->packetContent.lastIndexOf(':') + 1);
-          transmitLoRaPacket(it->packetContent, originalMsg); // Retransmit
-          ++it;
-        }
-        else
-        { // No retries left
-          Serial.printf("[LoRa] ACK Timeout for MSG_ID: %u (LocalWebID: %s). MAX RETRIES REACHED. Marking FAILED.\n",
-                        it->loraMessageId, it->localWebId.c_str());
-          it->status = OutgoingMessage::FAILED_ACK;
-          if (onLoraAckStatusCallback)
-          { // Notify about final failure
-            onLoraAckStatusCallback(it->localWebId, it->loraMessageId, false, true);
-          }
-          it = outgoingMessageQueue.erase(it); // Remove from queue
-        }
-      }
+      header.hopLimit--;
+      header.hopCount++;
+      header.lastHop = myLoRaNodeAddress;
+      header.nextHop = routeNextHop(header.dstAddress, millis());
+      if (entry->directed)
+        loraRouteStats.forwarded++;
+      Serial.printf("[Relay] Rebroadcasting 0x%04X/%u to 0x%04X, hop %u.\n",
+                    header.srcAddress, header.messageId, header.dstAddress, header.hopCount);
+      LoRaTxClass txClass = LORA_TX_DATA;
+      if (header.type == LORA_FRAME_ACK)
+        txClass = LORA_TX_ACK;
+      else if (header.type == LORA_FRAME_BEACON)
+        txClass = LORA_TX_BEACON;
+      if (transmitFrame(header, payload, payloadLen, txClass) > 0)
+        loraRelayStats.relayed++;
       else
-      { // Timeout not yet expired
-        ++it;
-      }
+        loraRelayStats.dropped++;
     }
-    else
-    { 
-      if (it->status == OutgoingMessage::ACKNOWLEDGED || it->status == OutgoingMessage::FAILED_ACK)
-      {
-        Serial.printf("[LoRa DEBUG] Cleaning up already processed MSG_ID: %u (LocalWebID: %s) Status: %d\n", it->loraMessageId, it->localWebId.c_str(), it->status);
-        it = outgoingMessageQueue.erase(it); // Defensive removal
-      }
-      else
+    relayRelease(*entry);
+  }
+}
+
+// ANNOUNCE OURSELVES - EVERY NODE THE BEACON FLOODS TO LEARNS A ROUTE BACK TO US
+static void sendBeacon()
+{
+  LoRaFrameHeader header;
+  header.version = LORA_PROTOCOL_VERSION;
+  header.type = LORA_FRAME_BEACON;
+  header.flags = 0;
+  header.dstAddress = LORA_BROADCAST_ADDRESS;
+  header.srcAddress = myLoRaNodeAddress;
+  header.messageId = nextBeaconSerial++;
+  header.hopLimit = LORA_MESH_HOP_LIMIT;
+  header.hopCount = 0;
+  header.attempt = 0;
+  header.lastHop = myLoRaNodeAddress;
+  header.nextHop = LORA_BROADCAST_ADDRESS;
+  claimLoRaEpochOf(nextBeaconSerial);
+  Serial.printf("[Route] Sending beacon %u\n", header.messageId & 0xFFFF);
+
+  // LIKE AN ACK, THE TAG OVER AN EMPTY PAYLOAD IS ALL IT CARRIES - ROUTES ARE ONLY LEARNED FROM BEACONS IT VERIFIES
+  uint8_t encoded[LORA_FRAME_HEADER_LEN];
+  uint8_t aad[LORA_MAX_HEADER_LEN];
+  uint8_t tag[LORA_AUTH_TAG_LEN];
+  encodeLoRaFrame(header, nullptr, 0, encoded, sizeof(encoded));
+  if (!encryptPayload(nullptr, 0, aad, loRaAuthData(encoded, LORA_FRAME_HEADER_LEN, aad), header, tag))
+  {
+    Serial.println(F("[LoRa] Encryption failed, beacon dropped."));
+    return;
+  }
+  if (transmitFrame(header, tag, sizeof(tag), LORA_TX_BEACON) > 0)
+    loraRouteStats.beaconsSent++;
+}
+
+// REFLECT RADIO TASK TX/RX OUTCOMES ON THE DISPLAY
+static void updateRadioStatusLine()
+{
+  uint32_t txDone = loraRadioStats.txDone;
+  uint32_t txFailed = loraRadioStats.txFailed;
+  uint32_t rxCrcErrors = loraRadioStats.rxCrcErrors;
+  uint32_t rxFailed = loraRadioStats.rxFailed;
+
+  if (txDone != seenTxDone)
+  {
+    setDisplayStatusLine("LoRa Sent");
+  }
+  if (txFailed != seenTxFailed)
+  {
+    setDisplayStatusLine("LoRa Send Fail");
+  }
+  if (rxCrcErrors != seenRxCrcErrors)
+  {
+    Serial.println(F("[LoRa] RX CRC error!"));
+    setLastLoRaRx("CRC Error!");
+    setDisplayStatusLine("LoRa RX CRC");
+  }
+  if (rxFailed != seenRxFailed)
+  {
+    setLastLoRaRx("Read Fail");
+    setDisplayStatusLine("LoRa RX Fail");
+  }
+  seenTxDone = txDone;
+  seenTxFailed = txFailed;
+  seenRxCrcErrors = rxCrcErrors;
+  seenRxFailed = rxFailed;
+}
+
+// COPY WHAT /diag REPORTS ON, UNLESS A REQUEST IS READING THE LAST COPY RIGHT NOW
+static void snapshotDiagnostics(unsigned long now)
+{
+  if (diagSnapshotTaken && now - lastDiagSnapshot < LORA_DIAG_SNAPSHOT_MS)
+    return;
+  std::unique_lock<std::mutex> lock(diagMutex, std::try_to_lock);
+  if (!lock.owns_lock())
+    return;
+  diagSnapshot.listenSf = linkListenSf();
+  diagSnapshot.epoch = loRaEpoch;
+  diagSnapshot.freeOutgoingSlots = (uint32_t)freeSlotCount;
+  diagSnapshot.outboxInFlight = (uint32_t)outboxCount(LoRaOutboxEntry::IN_FLIGHT);
+  diagSnapshot.outboxHeld = (uint32_t)outboxCount(LoRaOutboxEntry::HELD);
+  diagSnapshot.txCount = 0;
+  for (size_t i = 0; i < ARQ_MAX_PEERS; i++)
+  {
+    const ArqTxStream *tx = arqTxStreamAt(i);
+    if (tx)
+      diagSnapshot.tx[diagSnapshot.txCount++] = *tx;
+  }
+  diagSnapshot.linkCount = 0;
+  for (size_t i = 0; i < LINK_MAX_PEERS; i++)
+  {
+    const LoRaLinkPeer *link = linkPeerAt(i);
+    if (link)
+      diagSnapshot.links[diagSnapshot.linkCount++] = *link;
+  }
+  diagSnapshot.routeCount = 0;
+  for (size_t i = 0; i < ROUTE_MAX_ENTRIES; i++)
+  {
+    const LoRaRoute *route = routeAt(i);
+    if (route)
+      diagSnapshot.routes[diagSnapshot.routeCount++] = *route;
+  }
+  lastDiagSnapshot = now;
+  diagSnapshotTaken = true;
+}
+
+// PUT ONE HELD MESSAGE BACK IN THE SEND WINDOW ONCE ITS DESTINATION HAS BEEN HEARD AGAIN
+static void reofferHeldMessage()
+{
+  LoRaOutboxEntry *entry = outboxNextDue(millis());
+  if (!entry || !canQueueLoRaMessage(entry->dstAddress, fragmentCountFor(entry->textLen)))
+    return;
+
+  static char text[LORA_MAX_MESSAGE_LEN + 1];
+  char localWebId[LORA_LOCAL_ID_MAX_LEN + 1];
+  if (!outboxLoad(*entry, text, sizeof(text), localWebId, sizeof(localWebId)))
+  {
+    Serial.printf("[Outbox] Message %u unreadable, dropped.\n", entry->id);
+    reportMessageFailed(entry->localWebId);
+    outboxDone(entry->id, false);
+    return;
+  }
+  Serial.printf("[Outbox] 0x%04X heard again, re-offering message %u (LocalWebID:%s).\n",
+                entry->dstAddress, entry->id, localWebId);
+  outboxOffered(*entry, millis());
+  if (!queueLoRaMessage(text, localWebId, entry->dstAddress, entry->id))
+  {
+    reportMessageFailed(localWebId);
+    outboxDone(entry->id, false);
+  }
+}
+
+// LORA STACK - CALLED EVERY LOOP, CONSUMES THE RX RING FILLED BY THE RADIO TASK
+void handleLoRaEvents()
+{
+  // HOLD THE NEXT COMMAND WHILE ITS FRAGMENTS DO NOT FIT THE SEND WINDOW - PRODUCERS SEE "QUEUE FULL"
+  while (commandHeld || loraCommandQueue.pop(heldCommand))
+  {
+    commandHeld = true;
+    if (heldCommand.type == LoRaCommand::SEND_TEXT)
+    {
+      if (!canQueueLoRaMessage(heldCommand.dstAddress, fragmentCountFor(strlen(heldCommand.text))))
+        break;
+      // PERSIST FIRST - A MESSAGE THE RADIO NEVER GETS THROUGH OUTLIVES ITS RETRIES AND A REBOOT
+      uint32_t outboxId = outboxAdd(heldCommand.text, heldCommand.localWebId, heldCommand.dstAddress, millis());
+      if (!queueLoRaMessage(heldCommand.text, heldCommand.localWebId, heldCommand.dstAddress, outboxId))
       {
-        ++it; 
+        reportMessageFailed(heldCommand.localWebId);
+        outboxDone(outboxId, false);
       }
     }
+    commandHeld = false;
+  }
+  reofferHeldMessage();
+
+  checkAckTimeouts();
+
+  LoRaRadioFrame *rxFrame;
+  while ((rxFrame = loraRxRing.peek()) != nullptr)
+  {
+    processReceivedFrame(*rxFrame);
+    loraRxRing.release();
   }
-}
\ No newline at end of file
+
+  flushDueAcks();
+  sendDueRelays();
+  if (routeBeaconDue(millis()))
+    sendBeacon();
+  if (linkUpdateListenSf(millis()))
+  {
+    // PEERS ONLY LEARN OUR NEW SF FROM A FRAME CARRYING IT - DO NOT LEAVE THEM SENDING ON THE OLD ONE UNTIL WE NEXT TALK
+    setLoRaListenSf(linkListenSf());
+    sendBeacon();
+  }
+  loraStackStats.reassemblyTimeouts += reassemblyExpire(millis());
+  outboxFlush(millis(), false);
+  updateRadioStatusLine();
+  snapshotDiagnostics(millis());
+}
+
+// ACK DEADLINE PASSED FOR AN OUTGOING SLOT - RETRY OR GIVE UP
+static void onAckTimeout(uint16_t slotIndex)
+{
+  OutgoingMessage &slot = outgoingSlots[slotIndex];
+  if (slot.status != OutgoingMessage::PENDING_ACK)
+    return;
+
+  // A FRAME STILL WAITING FOR THE RADIO (BEHIND THE CHANNEL OR THE DUTY-CYCLE BUDGET) CANNOT HAVE BEEN
+  // ACKED YET - LOOK AGAIN LATER RATHER THAN QUEUE MORE COPIES AND BLAME THE LINK. OTHER TRAFFIC IN
+  // THE QUEUE DOES NOT COUNT, AND A FRAME THAT NEVER GETS OUT IS RETRIED AFTER ENOUGH DEFERRALS
+  if (!loRaTxTaken(slot.lastCopy) && slot.timeoutDeferrals < MAX_ACK_TIMEOUT_DEFERRALS)
+  {
+    slot.timeoutDeferrals++;
+    loraStackStats.retransmitsDeferred++;
+    ackTimerWheel.schedule(slotIndex, millis() + ARQ_RTO_MIN_MS);
+    return;
+  }
+
+  loraStackStats.ackTimeouts++;
+  linkLost(slot.dstAddress, millis());
+  routeFailed(slot.dstAddress);
+  ArqTxStream *tx = arqFindTxStream(slot.dstAddress);
+  if (tx)
+    arqRtoBackoff(*tx);
+
+  if (slot.retriesLeft > 0)
+  {
+    slot.retriesLeft--;
+    Serial.printf("[LoRa] ACK Timeout for MSG_ID: %u (LocalWebID: %s). Retrying (%d left).\n",
+                  slot.loraMessageId, slot.localWebId, slot.retriesLeft);
+    sendOutgoingSlot(slotIndex); // Retransmit
+  }
+  else
+  { // No retries left
+    // A PERSISTED MESSAGE IS HELD FOR ITS DESTINATION TO COME BACK, THE UI KEEPS SHOWING IT PENDING
+    bool held = outboxHold(slot.outboxId, millis());
+    Serial.printf("[LoRa] ACK Timeout for MSG_ID: %u (LocalWebID: %s). MAX RETRIES REACHED. %s\n",
+                  slot.loraMessageId, slot.localWebId, held ? "Held in outbox." : "Marking FAILED.");
+    if (onLoraAckStatusCallback)
+    { // Notify about final failure
+      onLoraAckStatusCallback(slot.localWebId, slot.firstSeq, false, !held);
+    }
+    // THE MESSAGE CANNOT BE REASSEMBLED WITHOUT THIS FRAGMENT, SO DROP ITS SIBLINGS TOO
+    if (tx)
+      releaseMessageSlots(*tx, slotIndex);
+    else
+      releaseOutgoingSlot(slotIndex);
+  }
+}
+
+// CHECK FOR ACK TIMEOUTS AND HANDLE RETRANSMISSIONS
+void checkAckTimeouts()
+{
+  ackTimerWheel.advance(millis(), onAckTimeout);
+}
+
+// BEST-EFFORT SNAPSHOT OF STACK AND RADIO COUNTERS FOR THE /diag ENDPOINT
+// RUNS ON THE WEB SERVER'S TASK - COUNTERS ARE ATOMIC, THE REST COMES FROM THE LOOP TASK'S LAST SNAPSHOT
+void fillLoRaDiagnostics(JsonDocument &doc)
+{
+  std::lock_guard<std::mutex> lock(diagMutex);
+  const LoRaDiagSnapshot &snapshot = diagSnapshot;
+  JsonObject radioStats = doc["radio"].to<JsonObject>();
+  radioStats["rx_frames"] = loraRadioStats.rxFrames.load();
+  radioStats["rx_dropped"] = loraRadioStats.rxDropped.load();
+  radioStats["rx_crc_errors"] = loraRadioStats.rxCrcErrors.load();
+  radioStats["tx_done"] = loraRadioStats.txDone.load();
+  radioStats["tx_failed"] = loraRadioStats.txFailed.load();
+  radioStats["rate_changes"] = loraRadioStats.rateChanges.load();
+  radioStats["listen_sf"] = snapshot.listenSf;
+
+  // LISTEN-BEFORE-TALK - HOW OFTEN THE CHANNEL WAS BUSY, AND HOW OFTEN FRAMES STILL WENT UNHEARD
+  // (CRC ERRORS AND ACK TIMEOUTS ARE MOSTLY COLLISIONS ONCE LINKS HAVE MARGIN)
+  uint32_t channelChecks = loraRadioStats.channelChecks;
+  uint32_t channelBusy = loraRadioStats.channelBusy;
+  uint32_t rxFrames = loraRadioStats.rxFrames;
+  uint32_t rxCrcErrors = loraRadioStats.rxCrcErrors;
+  uint32_t dataSent = loraStackStats.dataFramesSent;
+  JsonObject csma = doc["csma"].to<JsonObject>();
+  csma["channel_checks"] = channelChecks;
+  csma["channel_busy"] = channelBusy;
+  csma["forced"] = loraRadioStats.csmaForced.load();
+  csma["backoff_ms"] = loraRadioStats.csmaBackoffMs.load();
+  csma["busy_ratio"] = channelChecks ? (float)channelBusy / channelChecks : 0.0f;
+  csma["rx_crc_error_ratio"] = (rxFrames + rxCrcErrors) ? (float)rxCrcErrors / (rxFrames + rxCrcErrors) : 0.0f;
+  csma["ack_timeout_ratio"] = dataSent ? (float)loraStackStats.ackTimeouts.load() / dataSent : 0.0f;
+
+  // DUTY-CYCLE BUDGET OF THE SUB-BAND WE TRANSMIT IN, AND WHAT WAITS FOR IT
+  float frequency = loRaFrequency();
+  uint32_t budgetMs = dutyBudgetMs(frequency);
+  uint32_t usedMs = dutyUsedMs(frequency, millis());
+  JsonObject airtime = doc["airtime"].to<JsonObject>();
+  airtime["sub_band"] = dutySubBand(frequency).name;
+  airtime["duty_permille"] = dutySubBand(frequency).dutyPermille;
+  airtime["window_ms"] = LORA_DUTY_WINDOW_MS;
+  airtime["budget_ms"] = budgetMs;
+  airtime["used_ms"] = usedMs;
+  airtime["remaining_ms"] = usedMs < budgetMs ? budgetMs - usedMs : 0;
+  airtime["deferrals"] = loraRadioStats.dutyDeferrals.load();
+  airtime["held_mask"] = loraRadioStats.dutyHeldMask.load();
+  airtime["retransmits_deferred"] = loraStackStats.retransmitsDeferred.load();
+  JsonObject queue = airtime["queue"].to<JsonObject>();
+  queue["ack"] = (uint32_t)loRaTxQueueDepth(LORA_TX_ACK);
+  queue["retransmit"] = (uint32_t)loRaTxQueueDepth(LORA_TX_RETRANSMIT);
+  queue["data"] = (uint32_t)loRaTxQueueDepth(LORA_TX_DATA);
+  queue["beacon"] = (uint32_t)loRaTxQueueDepth(LORA_TX_BEACON);
+
+  JsonObject outbox = doc["outbox"].to<JsonObject>();
+  outbox["in_flight"] = snapshot.outboxInFlight;
+  outbox["held"] = snapshot.outboxHeld;
+  outbox["recovered"] = loraOutboxStats.recovered.load();
+  outbox["reoffered"] = loraOutboxStats.reoffered.load();
+  outbox["delivered"] = loraOutboxStats.delivered.load();
+  outbox["evicted"] = loraOutboxStats.evicted.load();
+  outbox["torn_records"] = loraOutboxStats.tornRecords.load();
+  outbox["flushes"] = loraOutboxStats.flushes.load();
+  outbox["compactions"] = loraOutboxStats.compactions.load();
+  outbox["file_bytes"] = loraOutboxStats.fileBytes.load();
+
+  JsonObject stack = doc["stack"].to<JsonObject>();
+  stack["data_frames_sent"] = loraStackStats.dataFramesSent.load();
+  stack["ack_frames_sent"] = loraStackStats.ackFramesSent.load();
+  stack["acks_coalesced"] = loraStackStats.acksCoalesced.load();
+  stack["acks_piggybacked"] = loraStackStats.acksPiggybacked.load();
+  stack["ack_frames_saved"] = loraStackStats.acksCoalesced.load() + loraStackStats.acksPiggybacked.load();
+  stack["ack_timeouts"] = loraStackStats.ackTimeouts.load();
+  stack["rtt_samples"] = loraStackStats.rttSamples.load();
+  stack["duplicates_suppressed"] = loraStackStats.duplicatesSuppressed.load();
+  stack["auth_failures"] = loraStackStats.authFailures.load();
+  stack["epoch"] = snapshot.epoch;
+  stack["fragmented_sent"] = loraStackStats.fragmentedSent.load();
+  stack["compressed_bytes_saved"] = loraStackStats.compressedBytesSaved.load();
+  stack["reassembled"] = loraStackStats.reassembled.load();
+  stack["reassembly_timeouts"] = loraStackStats.reassemblyTimeouts.load();
+  stack["foreign_rejected"] = loraStackStats.foreignRejected.load();
+  stack["free_outgoing_slots"] = snapshot.freeOutgoingSlots;
+
+  JsonObject relay = doc["relay"].to<JsonObject>();
+  relay["enabled"] = RELAY_ENABLED;
+  relay["scheduled"] = loraRelayStats.scheduled.load();
+  relay["relayed"] = loraRelayStats.relayed.load();
+  relay["cancelled"] = loraRelayStats.cancelled.load();
+  relay["dropped"] = loraRelayStats.dropped.load();
+  relay["duplicates"] = loraRelayStats.duplicates.load();
+
+  JsonObject routing = doc["routing"].to<JsonObject>();
+  routing["beacons_sent"] = loraRouteStats.beaconsSent.load();
+  routing["routes_learned"] = loraRouteStats.routesLearned.load();
+  routing["routes_repaired"] = loraRouteStats.routesRepaired.load();
+  routing["forwarded"] = loraRouteStats.forwarded.load();
+  routing["not_our_hop"] = loraRouteStats.notOurHop.load();
+
+  // PER-DESTINATION SEND WINDOWS AND RETRANSMISSION TIMERS
+  JsonArray peers = doc["peers"].to<JsonArray>();
+  for (size_t i = 0; i < snapshot.txCount; i++)
+  {
+    const ArqTxStream *tx = &snapshot.tx[i];
+    JsonObject peer = peers.add<JsonObject>();
+    peer["address"] = tx->peer;
+    peer["in_flight"] = tx->nextSeq - tx->base;
+    peer["srtt_ms"] = tx->rttValid ? tx->srtt : 0;
+    peer["rttvar_ms"] = tx->rttvar;
+    peer["rto_ms"] = tx->rto;
+    peer["backoff"] = tx->backoff;
+  }
+
+  // PER-NEIGHBOUR LINK QUALITY AND THE RATE WE SEND TO EACH WITH
+  JsonArray links = doc["links"].to<JsonArray>();
+  unsigned long now = millis();
+  for (size_t i = 0; i < snapshot.linkCount; i++)
+  {
+    const LoRaLinkPeer *link = &snapshot.links[i];
+    JsonObject entry = links.add<JsonObject>();
+    entry["address"] = link->address;
+    entry["heard_ms_ago"] = now - link->lastHeard;
+    entry["rssi"] = link->rssi;
+    entry["rx_snr"] = link->rxSnr;
+    entry["tx_snr"] = link->reportValid ? link->txSnr : 0;
+    entry["peer_sf"] = link->peerSf;
+    entry["tx_power"] = link->txPower;
+    entry["loss_margin_db"] = link->lossMarginDb;
+    entry["delivered"] = link->delivered;
+    entry["lost"] = link->lost;
+  }
+
+  // ROUTE TABLE
+  JsonArray routes = doc["routes"].to<JsonArray>();
+  for (size_t i = 0; i < snapshot.routeCount; i++)
+  {
+    const LoRaRoute *route = &snapshot.routes[i];
+    JsonObject entry = routes.add<JsonObject>();
+    entry["address"] = route->dstAddress;
+    entry["next_hop"] = route->nextHop;
+    entry["hops"] = route->hops;
+    entry["cost"] = route->cost;
+    entry["age_ms"] = now - route->updated;
+    entry["failures"] = route->failures;
+  }
+}
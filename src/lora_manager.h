@@ -1,64 +1,93 @@
 #ifndef LORA_MANAGER_H
 #define LORA_MANAGER_H
 
-#include <RadioLib.h>
 #include <Arduino.h>
-#include <vector>
+#include <ArduinoJson.h>
+#include <atomic>
 #include "config.h" 
-
-// LORA PIN DEFINITIONS 
-#if defined(HELTEC_V3_BOARD)
-    #define LORA_SCK_PIN    9
-    #define LORA_MISO_PIN   11
-    #define LORA_MOSI_PIN   10
-    #define LORA_NSS_PIN    8
-    #define LORA_RESET_PIN  12
-    #define LORA_DIO1_PIN   14
-    #define LORA_BUSY_PIN   13
-#elif defined(XIAO_ESP32S3_BOARD)
-    #define LORA_SCK_PIN    7
-    #define LORA_MISO_PIN   8
-    #define LORA_MOSI_PIN   9
-    #define LORA_NSS_PIN    41 
-    #define LORA_RESET_PIN  42 
-    #define LORA_DIO1_PIN   39 
-    #define LORA_BUSY_PIN   40 
-#else
-    #error "LoRa pins not defined!"
-#endif
+#include "lora_packet.h"
+#include "lora_radio.h"
+#include "mpsc_queue.h"
+#include "timer_wheel.h"
 
 // ACK MECHANISM CONFIGURATION
-#define ACK_TIMEOUT_MS 5000    
 #define MAX_SEND_RETRIES 4      
-#define LORA_ACK_PREFIX "A:"    
+#define LORA_OUTGOING_SLOTS 16      // Messages in flight awaiting ACK, across all send windows
+#define ACK_TIMER_TICK_MS 50        // Timer wheel resolution
+#define ACK_TIMER_WHEEL_SLOTS 128   // Buckets per revolution (6.4 s at 50 ms)
+#define MAX_ACK_TIMEOUT_DEFERRALS 20 // Times one send's ACK timeout waits for its frame to leave the TX queue
+
+static_assert(MAX_SEND_RETRIES < 0xFF, "Every send of a frame must carry its own attempt byte in the nonce");
 
-extern SX1262 radio;
+// COMMAND QUEUE CONFIGURATION
+#define LORA_CMD_QUEUE_LEN 8        // Pending submissions from web/button (power of two)
 
-extern volatile bool loraPacketReceivedFlag;
+// DIAGNOSTICS CONFIGURATION
+#define LORA_DIAG_SNAPSHOT_MS 1000   // How often the loop task copies its tables for fillLoRaDiagnostics()
 
-extern uint32_t currentLoRaMessageId;
+// PERSISTENT STATE
+#define LORA_NVS_NAMESPACE "lora"    // Preferences namespace for the boot epoch
 
 // CALLBACK FUNCTIONS
-typedef void (*LoRaPacketCallback)(const String& senderId, const String& message); 
-typedef void (*LoraAckStatusCallback)(const String& localWebId, uint32_t loraMessageId, bool acked, bool finalFailure); 
+typedef void (*LoRaPacketCallback)(const char* senderId, const char* message, size_t messageLen); 
+typedef void (*LoraAckStatusCallback)(const char* localWebId, uint32_t loraMessageId, bool acked, bool finalFailure); 
 
-// STRUCTURE TO MANAGE OUTGOING MESSAGES
+// STRUCTURE TO MANAGE OUTGOING MESSAGES (ONE PRE-ALLOCATED SLOT PER MESSAGE IN FLIGHT)
 struct OutgoingMessage {
-    String localWebId;          // ID from the web UI to correlate messages
-    uint32_t loraMessageId;     // Unique LoRa message ID
-    String packetContent;       // Full packet content (SENDER:P:MSG_ID:PAYLOAD)
+    char localWebId[LORA_LOCAL_ID_MAX_LEN + 1]; // ID from the web UI to correlate messages
+    uint32_t loraMessageId;     // Sequence number in the stream to dstAddress
+    uint32_t firstSeq;          // Sequence number of the message's first fragment (the ID reported to the UI)
+    uint8_t fragCount;          // Fragments (consecutive sequence numbers) in the message, 1 if unfragmented
+    uint16_t dstAddress;        // Destination (selects the send window)
+    uint32_t outboxId;          // Outbox record of the message, 0 if not persisted
+    uint8_t frame[LORA_MAX_FRAME_LEN]; // Encoded frame with the plaintext fragment, sealed afresh on every send
+    size_t frameLen;            // Length of the encoded frame, without the tag
     unsigned long lastSendTime; // Timestamp of the last transmission attempt
+    uint8_t sendCount;          // Transmissions so far (RTT is only sampled when this is 1)
+    LoRaTxTicket lastCopy;      // Last copy of the latest transmission handed to the radio task
+    uint8_t timeoutDeferrals;   // ACK timeouts put off since then because that copy was still queued
     int retriesLeft;            // Number of retries remaining
-    enum Status { PENDING_ACK, ACKNOWLEDGED, FAILED_ACK } status; // Current status of the message
+    enum Status { FREE, PENDING_ACK } status; // Current status of the slot
+};
+
+// COMMANDS SUBMITTED TO THE LORA STACK FROM OTHER TASKS
+struct LoRaCommand {
+    enum Type { SEND_TEXT } type;
+    char text[LORA_MAX_MESSAGE_LEN + 1];
+    char localWebId[LORA_LOCAL_ID_MAX_LEN + 1];
+    uint16_t dstAddress;        // A node, a group or LORA_BROADCAST_ADDRESS
+};
+
+enum LoRaSubmitResult {
+    LORA_SUBMIT_OK,
+    LORA_SUBMIT_QUEUE_FULL,
+    LORA_SUBMIT_TOO_LONG
+};
+
+// STACK COUNTERS, WRITTEN BY THE LORA STACK ONLY
+struct LoRaStackStats {
+    std::atomic<uint32_t> dataFramesSent{0};
+    std::atomic<uint32_t> ackFramesSent{0};    // Standalone ACK frames
+    std::atomic<uint32_t> acksCoalesced{0};    // Frames covered by an ACK that was already held
+    std::atomic<uint32_t> acksPiggybacked{0};  // ACKs carried inside outgoing data frames
+    std::atomic<uint32_t> ackTimeouts{0};
+    std::atomic<uint32_t> retransmitsDeferred{0}; // Timeouts put off while the frame itself still waited for the radio
+    std::atomic<uint32_t> rttSamples{0};
+    std::atomic<uint32_t> duplicatesSuppressed{0}; // Retransmits answered with a re-ACK only
+    std::atomic<uint32_t> authFailures{0};     // Data and ACK frames dropped on a bad CCM tag
+    std::atomic<uint32_t> fragmentedSent{0};   // Messages split across several frames
+    std::atomic<uint32_t> compressedBytesSaved{0};
+    std::atomic<uint32_t> reassembled{0};
+    std::atomic<uint32_t> reassemblyTimeouts{0};
+    std::atomic<uint32_t> foreignRejected{0};  // Frames for other nodes dropped on their address bytes alone
 };
-extern std::vector<OutgoingMessage> outgoingMessageQueue; // Queue for messages awaiting ACKs
+extern LoRaStackStats loraStackStats;
 
 // FUNCTION DECLARATIONS
-void IRAM_ATTR onLoRaInterrupt();
-void setupLoRa(const String& myDeviceId, const String& packetPrefix, LoRaPacketCallback rxCb, LoraAckStatusCallback ackCb);
-bool queueLoRaMessage(const String& messageContent, const String& myDeviceId, const String& packetPrefix, const String& localWebId);
-void handleLoRaEvents(const String& myDeviceId, const String& packetPrefix); 
+void setupLoRa(uint16_t myNodeAddress, LoRaPacketCallback rxCb, LoraAckStatusCallback ackCb);
+LoRaSubmitResult submitLoRaMessage(const char* text, const char* localWebId, uint16_t dstAddress);
+void handleLoRaEvents(); 
 void checkAckTimeouts();
-void startLoRaReceive();
+void fillLoRaDiagnostics(JsonDocument& doc);
 
 #endif 
\ No newline at end of file
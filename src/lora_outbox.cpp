@@ -0,0 +1,480 @@
+#include "lora_outbox.h"
+#include <LittleFS.h>
+
+#define OUTBOX_RECORD_OVERHEAD 5  // Marker, type, length, CRC
+#define OUTBOX_ADD_FIXED_LEN 7    // ID, destination, local web ID length
+#define OUTBOX_MAX_RECORD_LEN (OUTBOX_RECORD_OVERHEAD + OUTBOX_ADD_FIXED_LEN + 255 + LORA_MAX_MESSAGE_LEN)
+
+#define OUTBOX_DONE_RECORD_LEN (OUTBOX_RECORD_OVERHEAD + 4)
+
+static_assert(OUTBOX_MAX_RECORD_LEN + OUTBOX_DONE_RECORD_LEN <= LORA_OUTBOX_WRITE_BUFFER,
+              "An ADD record and the DONE record of the message it evicts must fit the write buffer");
+
+// UNDELIVERED MESSAGES, THE LOG THEY LIVE IN AND THE RECORDS NOT YET ON FLASH
+static LoRaOutboxEntry entries[LORA_OUTBOX_MAX_ENTRIES];
+static uint32_t nextOutboxId = 1;
+static bool outboxReady = false;
+static uint32_t flushedBytes = 0;     // Log size on flash, buffered records follow it
+static uint8_t writeBuffer[LORA_OUTBOX_WRITE_BUFFER];
+static size_t writeLen = 0;
+static unsigned long writeSince = 0;
+static uint8_t recordBuffer[OUTBOX_MAX_RECORD_LEN];
+static LoRaOutboxEvictCallback onEvictCallback = nullptr;
+
+LoRaOutboxStats loraOutboxStats;
+
+// LITTLE-ENDIAN FIELD HELPERS
+static inline void writeU16(uint8_t *p, uint16_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void writeU32(uint8_t *p, uint32_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint16_t readU16(const uint8_t *p)
+{
+  return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static inline uint32_t readU32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// CRC-8 (POLYNOMIAL 0x07), CATCHES A RECORD CUT SHORT BY A POWER LOSS MID-WRITE
+static uint8_t crc8(const uint8_t *data, size_t len)
+{
+  uint8_t crc = 0;
+  for (size_t i = 0; i < len; i++)
+  {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+// KEEP A (POSSIBLY TRUNCATED) COPY OF A RECORD'S LOCAL WEB ID IN ITS ENTRY
+static void setEntryLocalWebId(LoRaOutboxEntry &entry, const uint8_t *localWebId, size_t idLen)
+{
+  if (idLen > LORA_LOCAL_ID_MAX_LEN)
+    idLen = LORA_LOCAL_ID_MAX_LEN;
+  memcpy(entry.localWebId, localWebId, idLen);
+  entry.localWebId[idLen] = 0;
+}
+
+static LoRaOutboxEntry *findEntry(uint32_t id)
+{
+  for (LoRaOutboxEntry &entry : entries)
+  {
+    if (entry.state != LoRaOutboxEntry::FREE && entry.id == id)
+      return &entry;
+  }
+  return nullptr;
+}
+
+// APPEND THE BUFFERED RECORDS TO THE LOG IN ONE WRITE
+// WHATEVER A SHORT WRITE DID PUT ON FLASH IS PART OF THE LOG, THE REST STAYS BUFFERED AND FOLLOWS IT NEXT TIME
+static void flushWrites()
+{
+  if (writeLen == 0)
+    return;
+  File log = LittleFS.open(LORA_OUTBOX_PATH, "a");
+  if (!log)
+  {
+    Serial.println(F("[Outbox] Cannot open the log, records kept in RAM."));
+    return;
+  }
+  size_t written = log.write(writeBuffer, writeLen);
+  log.close();
+  flushedBytes += written;
+  loraOutboxStats.fileBytes = flushedBytes;
+  if (written != writeLen)
+  {
+    Serial.printf("[Outbox] Short write (%u of %u bytes), retrying the rest later.\n", (unsigned)written, (unsigned)writeLen);
+    memmove(writeBuffer, writeBuffer + written, writeLen - written);
+    writeLen -= written;
+    writeSince = millis();
+    return;
+  }
+  writeLen = 0;
+  loraOutboxStats.flushes++;
+}
+
+// START A RECORD IN THE WRITE BUFFER, RETURNS ITS BODY AND SETS offset TO ITS PLACE IN THE LOG
+static uint8_t *beginRecord(uint8_t type, size_t bodyLen, uint32_t &offset, unsigned long now)
+{
+  if (writeLen + OUTBOX_RECORD_OVERHEAD + bodyLen > LORA_OUTBOX_WRITE_BUFFER)
+    flushWrites();
+  if (writeLen + OUTBOX_RECORD_OVERHEAD + bodyLen > LORA_OUTBOX_WRITE_BUFFER)
+    return nullptr;
+  if (writeLen == 0)
+    writeSince = now;
+  offset = flushedBytes + writeLen;
+  uint8_t *record = writeBuffer + writeLen;
+  record[0] = LORA_OUTBOX_MARKER;
+  record[1] = type;
+  writeU16(record + 2, (uint16_t)bodyLen);
+  return record + 4;
+}
+
+static void endRecord(size_t bodyLen)
+{
+  uint8_t *record = writeBuffer + writeLen;
+  record[4 + bodyLen] = crc8(record + 1, 3 + bodyLen);
+  writeLen += OUTBOX_RECORD_OVERHEAD + bodyLen;
+}
+
+static void appendDone(uint32_t id, unsigned long now)
+{
+  uint32_t offset;
+  uint8_t *body = beginRecord(LORA_OUTBOX_DONE, OUTBOX_DONE_RECORD_LEN - OUTBOX_RECORD_OVERHEAD, offset, now);
+  if (!body)
+    return;
+  writeU32(body, id);
+  endRecord(4);
+}
+
+// COPY A WHOLE RECORD INTO recordBuffer, FROM THE WRITE BUFFER AS FAR AS IT HAS NOT REACHED FLASH YET
+// (AFTER A SHORT WRITE A RECORD CAN START ON FLASH AND END IN THE BUFFER)
+static bool readRecord(uint32_t offset, size_t len)
+{
+  if (len > sizeof(recordBuffer) || offset + len > flushedBytes + writeLen)
+    return false;
+  size_t onFlash = (offset < flushedBytes) ? min(len, (size_t)(flushedBytes - offset)) : 0;
+  if (onFlash > 0)
+  {
+    File log = LittleFS.open(LORA_OUTBOX_PATH, "r");
+    if (!log)
+      return false;
+    bool ok = log.seek(offset) && log.read(recordBuffer, onFlash) == onFlash;
+    log.close();
+    if (!ok)
+      return false;
+  }
+  memcpy(recordBuffer + onFlash, writeBuffer + (offset + onFlash - flushedBytes), len - onFlash);
+  return true;
+}
+
+// A RECORD IN recordBuffer IS WHOLE AND UNDAMAGED
+static bool recordIntact(size_t len)
+{
+  return len >= OUTBOX_RECORD_OVERHEAD && recordBuffer[0] == LORA_OUTBOX_MARKER &&
+         (size_t)readU16(recordBuffer + 2) + OUTBOX_RECORD_OVERHEAD == len &&
+         crc8(recordBuffer + 1, len - 2) == recordBuffer[len - 1];
+}
+
+// REWRITE THE LOG WITH ONLY THE LIVE ADD RECORDS - THE OLD LOG STAYS UNTIL THE NEW ONE IS COMPLETE
+static void compactLog()
+{
+  flushWrites();
+  if (writeLen > 0)
+    return;
+  File compacted = LittleFS.open(LORA_OUTBOX_TMP_PATH, "w");
+  if (!compacted)
+  {
+    Serial.println(F("[Outbox] Cannot create the compacted log."));
+    return;
+  }
+  uint32_t newOffsets[LORA_OUTBOX_MAX_ENTRIES];
+  uint32_t newSize = 0;
+  for (size_t i = 0; i < LORA_OUTBOX_MAX_ENTRIES; i++)
+  {
+    LoRaOutboxEntry &entry = entries[i];
+    if (entry.state == LoRaOutboxEntry::FREE)
+      continue;
+    if (!readRecord(entry.recordOffset, entry.recordLen) || !recordIntact(entry.recordLen) ||
+        compacted.write(recordBuffer, entry.recordLen) != entry.recordLen)
+    {
+      compacted.close();
+      LittleFS.remove(LORA_OUTBOX_TMP_PATH);
+      Serial.println(F("[Outbox] Compaction failed, keeping the old log."));
+      return;
+    }
+    newOffsets[i] = newSize;
+    newSize += entry.recordLen;
+  }
+  compacted.close();
+  LittleFS.remove(LORA_OUTBOX_PATH);
+  if (!LittleFS.rename(LORA_OUTBOX_TMP_PATH, LORA_OUTBOX_PATH))
+  {
+    Serial.println(F("[Outbox] Cannot rename the compacted log, outbox disabled."));
+    outboxReady = false;
+    return;
+  }
+  for (size_t i = 0; i < LORA_OUTBOX_MAX_ENTRIES; i++)
+  {
+    if (entries[i].state != LoRaOutboxEntry::FREE)
+      entries[i].recordOffset = newOffsets[i];
+  }
+  Serial.printf("[Outbox] Compacted log from %u to %u bytes.\n", (unsigned)flushedBytes, (unsigned)newSize);
+  flushedBytes = newSize;
+  loraOutboxStats.compactions++;
+  loraOutboxStats.fileBytes = flushedBytes;
+}
+
+// REPLAY THE LOG INTO THE ENTRY TABLE - ONE SEQUENTIAL READ, TEXT IS ONLY CHECKSUMMED, NEVER KEPT
+static void recoverLog(unsigned long now)
+{
+  File log = LittleFS.open(LORA_OUTBOX_PATH, "r");
+  if (!log)
+    return;
+  size_t fileSize = log.size();
+  uint32_t offset = 0;
+  while (offset + OUTBOX_RECORD_OVERHEAD <= fileSize)
+  {
+    if (log.read(recordBuffer, 4) != 4 || recordBuffer[0] != LORA_OUTBOX_MARKER)
+      break;
+    size_t len = readU16(recordBuffer + 2) + OUTBOX_RECORD_OVERHEAD;
+    if (len > sizeof(recordBuffer) || offset + len > fileSize || log.read(recordBuffer + 4, len - 4) != len - 4 ||
+        !recordIntact(len))
+      break;
+
+    uint8_t type = recordBuffer[1];
+    uint32_t id = readU32(recordBuffer + 4);
+    if (type == LORA_OUTBOX_ADD && len >= (size_t)OUTBOX_RECORD_OVERHEAD + OUTBOX_ADD_FIXED_LEN + recordBuffer[10])
+    {
+      LoRaOutboxEntry *entry = nullptr;
+      for (LoRaOutboxEntry &candidate : entries)
+      {
+        if (candidate.state == LoRaOutboxEntry::FREE)
+        {
+          entry = &candidate;
+          break;
+        }
+      }
+      if (entry)
+      {
+        entry->state = LoRaOutboxEntry::HELD;
+        entry->id = id;
+        entry->dstAddress = readU16(recordBuffer + 8);
+        setEntryLocalWebId(*entry, recordBuffer + 4 + OUTBOX_ADD_FIXED_LEN, recordBuffer[10]);
+        entry->recordOffset = offset;
+        entry->recordLen = (uint16_t)len;
+        entry->textLen = (uint16_t)(len - OUTBOX_RECORD_OVERHEAD - OUTBOX_ADD_FIXED_LEN - recordBuffer[10]);
+        entry->peerHeard = false;
+        entry->lastOffered = now - LORA_OUTBOX_REOFFER_MS; // Offered as soon as its destination is heard
+      }
+    }
+    else if (type == LORA_OUTBOX_DONE)
+    {
+      LoRaOutboxEntry *entry = findEntry(id);
+      if (entry)
+        entry->state = LoRaOutboxEntry::FREE;
+    }
+    if ((int32_t)(id - nextOutboxId) >= 0)
+      nextOutboxId = id + 1;
+    offset += len;
+  }
+  log.close();
+  flushedBytes = offset;
+  loraOutboxStats.fileBytes = flushedBytes;
+  loraOutboxStats.recovered = outboxCount(LoRaOutboxEntry::HELD);
+
+  // A TORN TAIL WOULD SIT IN FRONT OF EVERY LATER RECORD, SO IT GOES NOW
+  if (offset < fileSize)
+  {
+    Serial.printf("[Outbox] Dropping %u bytes of incomplete records at the end of the log.\n", (unsigned)(fileSize - offset));
+    loraOutboxStats.tornRecords++;
+    compactLog();
+  }
+}
+
+// MOUNT THE FILESYSTEM AND RECOVER UNDELIVERED MESSAGES FROM THE LAST RUN
+// EVERYTHING IN RAM IS DROPPED FIRST, SO A SECOND CALL SEES EXACTLY WHAT A REBOOT WOULD
+void outboxSetup(LoRaOutboxEvictCallback evictCb)
+{
+  onEvictCallback = evictCb;
+  memset(entries, 0, sizeof(entries));
+  outboxReady = false;
+  flushedBytes = 0;
+  writeLen = 0;
+  if (!LittleFS.begin(true))
+  {
+    Serial.println(F("[Outbox] LittleFS mount failed, messages will not survive a reboot."));
+    return;
+  }
+  outboxReady = true;
+  // A CRASH DURING COMPACTION LEAVES EITHER THE OLD LOG (USE IT) OR ONLY THE FINISHED NEW ONE
+  if (LittleFS.exists(LORA_OUTBOX_TMP_PATH))
+  {
+    if (LittleFS.exists(LORA_OUTBOX_PATH))
+      LittleFS.remove(LORA_OUTBOX_TMP_PATH);
+    else
+      LittleFS.rename(LORA_OUTBOX_TMP_PATH, LORA_OUTBOX_PATH);
+  }
+  recoverLog(millis());
+  Serial.printf("[Outbox] %u undelivered message(s) recovered, log %u bytes.\n",
+                (unsigned)loraOutboxStats.recovered.load(), (unsigned)flushedBytes);
+}
+
+// PERSIST A NEW MESSAGE, RETURNS ITS OUTBOX ID OR 0 IF IT COULD NOT BE KEPT
+// A FULL OUTBOX MAKES ROOM BY EVICTING THE OLDEST HELD MESSAGE, NEVER ONE IN FLIGHT
+uint32_t outboxAdd(const char *text, const char *localWebId, uint16_t dstAddress, unsigned long now)
+{
+  if (!outboxReady)
+    return 0;
+  LoRaOutboxEntry *entry = nullptr;
+  LoRaOutboxEntry *oldestHeld = nullptr;
+  for (LoRaOutboxEntry &candidate : entries)
+  {
+    if (candidate.state == LoRaOutboxEntry::FREE)
+    {
+      entry = &candidate;
+      break;
+    }
+    if (candidate.state == LoRaOutboxEntry::HELD && (!oldestHeld || (int32_t)(candidate.id - oldestHeld->id) < 0))
+      oldestHeld = &candidate;
+  }
+  if (!entry && !oldestHeld)
+    return 0;
+
+  // THE NEW RECORD (AND AN EVICTED MESSAGE'S DONE) MUST FIT THE WRITE BUFFER BEFORE ANYTHING IS EVICTED
+  size_t idLen = strnlen(localWebId, 255);
+  size_t textLen = strnlen(text, LORA_MAX_MESSAGE_LEN);
+  size_t bodyLen = OUTBOX_ADD_FIXED_LEN + idLen + textLen;
+  size_t need = OUTBOX_RECORD_OVERHEAD + bodyLen + (entry ? 0 : OUTBOX_DONE_RECORD_LEN);
+  if (writeLen + need > LORA_OUTBOX_WRITE_BUFFER)
+    flushWrites();
+  if (writeLen + need > LORA_OUTBOX_WRITE_BUFFER)
+  {
+    Serial.printf("[Outbox] Write buffer full (%u bytes), message not kept.\n", (unsigned)writeLen);
+    return 0;
+  }
+
+  if (!entry)
+  {
+    Serial.printf("[Outbox] Full, evicting held message %u to 0x%04X.\n", oldestHeld->id, oldestHeld->dstAddress);
+    if (onEvictCallback)
+      onEvictCallback(oldestHeld->id, oldestHeld->localWebId);
+    outboxDone(oldestHeld->id, false);
+    loraOutboxStats.evicted++;
+    entry = oldestHeld;
+  }
+
+  uint32_t offset;
+  uint8_t *body = beginRecord(LORA_OUTBOX_ADD, bodyLen, offset, now);
+  if (!body)
+    return 0;
+  uint32_t id = nextOutboxId++;
+  writeU32(body, id);
+  writeU16(body + 4, dstAddress);
+  body[6] = (uint8_t)idLen;
+  memcpy(body + OUTBOX_ADD_FIXED_LEN, localWebId, idLen);
+  memcpy(body + OUTBOX_ADD_FIXED_LEN + idLen, text, textLen);
+  endRecord(bodyLen);
+
+  entry->state = LoRaOutboxEntry::IN_FLIGHT;
+  entry->id = id;
+  entry->dstAddress = dstAddress;
+  setEntryLocalWebId(*entry, (const uint8_t *)localWebId, idLen);
+  entry->recordOffset = offset;
+  entry->recordLen = (uint16_t)(OUTBOX_RECORD_OVERHEAD + bodyLen);
+  entry->textLen = (uint16_t)textLen;
+  entry->peerHeard = false;
+  entry->lastOffered = now;
+  return id;
+}
+
+// THE MESSAGE WAS DELIVERED (OR IS GIVEN UP ON) - ITS RECORD IS DEAD FROM NOW ON
+void outboxDone(uint32_t id, bool delivered)
+{
+  LoRaOutboxEntry *entry = findEntry(id);
+  if (!entry)
+    return;
+  appendDone(id, millis());
+  entry->state = LoRaOutboxEntry::FREE;
+  if (delivered)
+    loraOutboxStats.delivered++;
+}
+
+// RETRIES RAN OUT - KEEP THE MESSAGE UNTIL ITS DESTINATION IS HEARD AGAIN, FALSE IF IT WAS NEVER PERSISTED
+bool outboxHold(uint32_t id, unsigned long now)
+{
+  LoRaOutboxEntry *entry = findEntry(id);
+  if (!entry)
+    return false;
+  entry->state = LoRaOutboxEntry::HELD;
+  entry->peerHeard = false;
+  entry->lastOffered = now;
+  return true;
+}
+
+// A FRAME FROM srcAddress ARRIVED - ITS HELD MESSAGES (AND ANY FOR A GROUP OR EVERYONE) CAN GO AGAIN
+void outboxPeerHeard(uint16_t srcAddress)
+{
+  for (LoRaOutboxEntry &entry : entries)
+  {
+    if (entry.state == LoRaOutboxEntry::HELD && (entry.dstAddress == srcAddress || !loRaIsNodeAddress(entry.dstAddress)))
+      entry.peerHeard = true;
+  }
+}
+
+// THE OLDEST HELD MESSAGE WHOSE DESTINATION HAS BEEN HEARD AND THAT WAS NOT OFFERED TOO RECENTLY, OR NULLPTR
+LoRaOutboxEntry *outboxNextDue(unsigned long now)
+{
+  LoRaOutboxEntry *due = nullptr;
+  for (LoRaOutboxEntry &entry : entries)
+  {
+    if (entry.state == LoRaOutboxEntry::HELD && entry.peerHeard && now - entry.lastOffered >= LORA_OUTBOX_REOFFER_MS &&
+        (!due || (int32_t)(entry.id - due->id) < 0))
+      due = &entry;
+  }
+  return due;
+}
+
+// READ A HELD MESSAGE'S TEXT AND LOCAL WEB ID BACK FROM ITS ADD RECORD
+bool outboxLoad(const LoRaOutboxEntry &entry, char *text, size_t textCapacity, char *localWebId, size_t localWebIdCapacity)
+{
+  if (!readRecord(entry.recordOffset, entry.recordLen) || !recordIntact(entry.recordLen) ||
+      recordBuffer[1] != LORA_OUTBOX_ADD || readU32(recordBuffer + 4) != entry.id)
+    return false;
+  size_t idLen = recordBuffer[10];
+  const uint8_t *idStart = recordBuffer + 4 + OUTBOX_ADD_FIXED_LEN;
+  if (idLen >= localWebIdCapacity || entry.textLen >= textCapacity)
+    return false;
+  memcpy(localWebId, idStart, idLen);
+  localWebId[idLen] = 0;
+  memcpy(text, idStart + idLen, entry.textLen);
+  text[entry.textLen] = 0;
+  return true;
+}
+
+void outboxOffered(LoRaOutboxEntry &entry, unsigned long now)
+{
+  entry.state = LoRaOutboxEntry::IN_FLIGHT;
+  entry.peerHeard = false;
+  entry.lastOffered = now;
+  loraOutboxStats.reoffered++;
+}
+
+// WRITE BATCHED RECORDS ONCE THE BUFFER IS HALF FULL OR ITS OLDEST RECORD HAS WAITED LONG ENOUGH,
+// AND COMPACT A LOG THAT HAS OUTGROWN ITS BOUND
+void outboxFlush(unsigned long now, bool force)
+{
+  if (!outboxReady || writeLen == 0)
+    return;
+  if (!force && writeLen < LORA_OUTBOX_WRITE_BUFFER / 2 && now - writeSince < LORA_OUTBOX_FLUSH_MS)
+    return;
+  flushWrites();
+  if (flushedBytes > LORA_OUTBOX_MAX_FILE_BYTES)
+    compactLog();
+}
+
+size_t outboxCount(LoRaOutboxEntry::State state)
+{
+  size_t count = 0;
+  for (const LoRaOutboxEntry &entry : entries)
+  {
+    if (entry.state == state)
+      count++;
+  }
+  return count;
+}
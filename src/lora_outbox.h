@@ -0,0 +1,65 @@
+#ifndef LORA_OUTBOX_H
+#define LORA_OUTBOX_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "lora_packet.h"
+
+// STORE-AND-FORWARD OUTBOX CONFIGURATION
+#define LORA_OUTBOX_PATH "/outbox.log"
+#define LORA_OUTBOX_TMP_PATH "/outbox.tmp"
+#define LORA_OUTBOX_MAX_ENTRIES 32          // Undelivered messages kept, the oldest held one is evicted beyond this
+#define LORA_OUTBOX_MAX_FILE_BYTES 32768    // Log size that triggers compaction down to the live records
+#define LORA_OUTBOX_WRITE_BUFFER 2048       // Records batched in RAM before they are appended to flash
+#define LORA_OUTBOX_FLUSH_MS 2000           // Longest a record waits in RAM (a power cut loses at most this much)
+#define LORA_OUTBOX_REOFFER_MS 30000        // Minimum spacing between offers of one held message
+
+// LOG RECORD: MARKER (1), TYPE (1), BODY LENGTH (2), BODY, CRC-8 OVER TYPE, LENGTH AND BODY
+//   ADD:  OUTBOX ID (4), DESTINATION (2), LOCAL WEB ID LENGTH (1), LOCAL WEB ID, TEXT
+//   DONE: OUTBOX ID (4) - DELIVERED OR EVICTED, THE ADD BEFORE IT IS DEAD
+#define LORA_OUTBOX_MARKER 0xA5
+#define LORA_OUTBOX_ADD 0x01
+#define LORA_OUTBOX_DONE 0x02
+
+// ONE UNDELIVERED MESSAGE - THE TEXT STAYS IN THE LOG, ITS POSITION AND LOCAL WEB ID ARE KEPT IN RAM (PRE-ALLOCATED)
+struct LoRaOutboxEntry {
+    enum State { FREE, IN_FLIGHT, HELD } state;
+    uint32_t id;
+    uint16_t dstAddress;
+    char localWebId[LORA_LOCAL_ID_MAX_LEN + 1]; // So the UI can be told of a failure even if the record is unreadable
+    uint32_t recordOffset;      // Where its ADD record starts in the log (buffered records included)
+    uint16_t recordLen;
+    uint16_t textLen;
+    bool peerHeard;             // Destination heard since the message was held
+    unsigned long lastOffered;
+};
+
+// OUTBOX COUNTERS, WRITTEN BY THE LORA STACK ONLY
+struct LoRaOutboxStats {
+    std::atomic<uint32_t> recovered{0};     // Undelivered messages found in the log at boot
+    std::atomic<uint32_t> reoffered{0};
+    std::atomic<uint32_t> delivered{0};
+    std::atomic<uint32_t> evicted{0};       // Held messages dropped to make room
+    std::atomic<uint32_t> tornRecords{0};   // Incomplete records cut off the log tail at boot
+    std::atomic<uint32_t> flushes{0};
+    std::atomic<uint32_t> compactions{0};
+    std::atomic<uint32_t> fileBytes{0};
+};
+extern LoRaOutboxStats loraOutboxStats;
+
+// CALLED FOR A HELD MESSAGE DROPPED TO MAKE ROOM, IT WILL NOT BE DELIVERED
+typedef void (*LoRaOutboxEvictCallback)(uint32_t id, const char* localWebId);
+
+// FUNCTION DECLARATIONS
+void outboxSetup(LoRaOutboxEvictCallback evictCb);
+uint32_t outboxAdd(const char* text, const char* localWebId, uint16_t dstAddress, unsigned long now);
+void outboxDone(uint32_t id, bool delivered);
+bool outboxHold(uint32_t id, unsigned long now);
+void outboxPeerHeard(uint16_t srcAddress);
+LoRaOutboxEntry* outboxNextDue(unsigned long now);
+bool outboxLoad(const LoRaOutboxEntry& entry, char* text, size_t textCapacity, char* localWebId, size_t localWebIdCapacity);
+void outboxOffered(LoRaOutboxEntry& entry, unsigned long now);
+void outboxFlush(unsigned long now, bool force);
+size_t outboxCount(LoRaOutboxEntry::State state);
+
+#endif
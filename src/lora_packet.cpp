@@ -0,0 +1,197 @@
+#include "lora_packet.h"
+#include "config.h"
+
+// LITTLE-ENDIAN FIELD HELPERS
+static inline void writeU16(uint8_t *p, uint16_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void writeU32(uint8_t *p, uint32_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint16_t readU16(const uint8_t *p)
+{
+  return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static inline uint32_t readU32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ENCODED SIZE OF EVERYTHING BEFORE THE PAYLOAD
+size_t loRaHeaderLen(const LoRaFrameHeader &header)
+{
+  if (header.type == LORA_FRAME_ACK)
+    return LORA_ACK_HEADER_LEN;
+  if (header.type != LORA_FRAME_DATA)
+    return LORA_FRAME_HEADER_LEN;
+  size_t len = LORA_DATA_HEADER_LEN;
+  if (header.flags & LORA_FLAG_FRAGMENT)
+    len += LORA_FRAGMENT_HEADER_LEN;
+  if (header.flags & LORA_FLAG_PIGGYBACK_ACK)
+    len += LORA_PIGGYBACK_ACK_LEN;
+  return len;
+}
+
+// AN ENCODED HEADER AS FED TO THE CCM TAG: EVERYTHING BUT THE LINK, HOPS, LAST HOP AND NEXT HOP BYTES,
+// WHICH RELAYS REWRITE AND ARE ZEROED. WINDOW OFFSET, ATTEMPT AND ANY PIGGYBACKED ACK ARE COVERED,
+// SO THE SENDER SEALS EVERY TRANSMISSION AFRESH. OUT HOLDS UP TO LORA_MAX_HEADER_LEN BYTES
+size_t loRaAuthData(const uint8_t *frame, size_t headerLen, uint8_t *out)
+{
+  memcpy(out, frame, headerLen);
+  out[10] = 0;
+  out[11] = 0;
+  memset(out + 13, 0, 4);
+  return headerLen;
+}
+
+// BUILD A FRAME INTO OUT, RETURNS THE FRAME LENGTH OR 0 IF IT DOES NOT FIT
+size_t encodeLoRaFrame(const LoRaFrameHeader &header, const uint8_t *payload, size_t payloadLen, uint8_t *out, size_t outCapacity)
+{
+  size_t headerLen = loRaHeaderLen(header);
+  size_t frameLen = headerLen + payloadLen;
+  if (frameLen > outCapacity || frameLen > LORA_MAX_FRAME_LEN)
+    return 0;
+
+  out[0] = (uint8_t)((header.version << 4) | (header.type & 0x0F));
+  out[1] = header.flags;
+  writeU16(out + 2, header.dstAddress);
+  writeU16(out + 4, header.srcAddress);
+  writeU32(out + 6, header.messageId);
+  out[10] = (uint8_t)((header.linkSf << 4) | ((header.linkPower - LORA_POWER_MIN) & 0x0F));
+  out[11] = (uint8_t)((header.hopLimit << 4) | (header.hopCount & 0x0F));
+  out[12] = header.attempt;
+  writeU16(out + 13, header.lastHop);
+  writeU16(out + 15, header.nextHop);
+  if (header.type == LORA_FRAME_ACK)
+  {
+    writeU32(out + LORA_FRAME_HEADER_LEN, header.ackBitmap);
+    out[LORA_FRAME_HEADER_LEN + 4] = (uint8_t)header.snrReport;
+    writeU16(out + LORA_FRAME_HEADER_LEN + 5, header.ackStream);
+    writeU32(out + LORA_FRAME_HEADER_LEN + 7, header.ackSerial);
+  }
+  else if (header.type == LORA_FRAME_DATA)
+  {
+    out[LORA_FRAME_HEADER_LEN] = header.windowOffset;
+    uint8_t *p = out + LORA_DATA_HEADER_LEN;
+    if (header.flags & LORA_FLAG_FRAGMENT)
+    {
+      p[0] = header.fragIndex;
+      p[1] = header.fragCount;
+      p += LORA_FRAGMENT_HEADER_LEN;
+    }
+    if (header.flags & LORA_FLAG_PIGGYBACK_ACK)
+    {
+      writeU16(p, header.piggyback.peer);
+      writeU16(p + 2, header.piggyback.stream);
+      writeU32(p + 4, header.piggyback.cumAck);
+      writeU32(p + 8, header.piggyback.bitmap);
+      p[12] = (uint8_t)header.piggyback.snrReport;
+    }
+  }
+  if (payloadLen > 0)
+    memcpy(out + headerLen, payload, payloadLen);
+  return frameLen;
+}
+
+// READ ONLY THE ADDRESSING OF A RECEIVED FRAME, SO ONE MEANT FOR OTHERS CAN BE DROPPED BEFORE ANY PARSING
+// FALSE IF IT IS NOT A FRAME OF OUR VERSION AT ALL
+bool peekLoRaAddressing(const uint8_t *frame, size_t frameLen, uint16_t &dstAddress, uint16_t &nextHop)
+{
+  if (frameLen < LORA_FRAME_HEADER_LEN || (frame[0] >> 4) != LORA_PROTOCOL_VERSION)
+    return false;
+  dstAddress = readU16(frame + 2);
+  nextHop = readU16(frame + 15);
+  return true;
+}
+
+// A SINGLE NODE, AS OPPOSED TO A GROUP OR BROADCAST
+bool loRaIsNodeAddress(uint16_t address)
+{
+  return address < LORA_GROUP_ADDRESS_MIN;
+}
+
+// PARSE A RECEIVED FRAME, PAYLOAD POINTS INTO THE FRAME BUFFER (NO COPY)
+bool decodeLoRaFrame(const uint8_t *frame, size_t frameLen, LoRaFrameHeader &header, const uint8_t *&payload, size_t &payloadLen)
+{
+  if (frameLen < LORA_FRAME_HEADER_LEN || frameLen > LORA_MAX_FRAME_LEN)
+    return false;
+
+  header.version = frame[0] >> 4;
+  header.type = frame[0] & 0x0F;
+  if (header.version != LORA_PROTOCOL_VERSION)
+    return false;
+
+  header.flags = frame[1];
+  size_t headerLen = loRaHeaderLen(header);
+  if (frameLen < headerLen)
+    return false;
+
+  header.dstAddress = readU16(frame + 2);
+  header.srcAddress = readU16(frame + 4);
+  header.messageId = readU32(frame + 6);
+  header.linkSf = frame[10] >> 4;
+  header.linkPower = (int8_t)(LORA_POWER_MIN + (frame[10] & 0x0F));
+  header.hopLimit = frame[11] >> 4;
+  header.hopCount = frame[11] & 0x0F;
+  header.attempt = frame[12];
+  header.lastHop = readU16(frame + 13);
+  header.nextHop = readU16(frame + 15);
+  header.windowOffset = (header.type == LORA_FRAME_DATA) ? frame[LORA_FRAME_HEADER_LEN] : 0;
+  header.ackBitmap = (header.type == LORA_FRAME_ACK) ? readU32(frame + LORA_FRAME_HEADER_LEN) : 0;
+  header.snrReport = (header.type == LORA_FRAME_ACK) ? (int8_t)frame[LORA_FRAME_HEADER_LEN + 4] : 0;
+  header.ackStream = (header.type == LORA_FRAME_ACK) ? readU16(frame + LORA_FRAME_HEADER_LEN + 5) : 0;
+  header.ackSerial = (header.type == LORA_FRAME_ACK) ? readU32(frame + LORA_FRAME_HEADER_LEN + 7) : 0;
+  header.fragIndex = 0;
+  header.fragCount = 1;
+  if (header.type == LORA_FRAME_DATA)
+  {
+    const uint8_t *p = frame + LORA_DATA_HEADER_LEN;
+    if (header.flags & LORA_FLAG_FRAGMENT)
+    {
+      header.fragIndex = p[0];
+      header.fragCount = p[1];
+      if (header.fragCount == 0 || header.fragIndex >= header.fragCount)
+        return false;
+      p += LORA_FRAGMENT_HEADER_LEN;
+    }
+    if (header.flags & LORA_FLAG_PIGGYBACK_ACK)
+    {
+      header.piggyback.peer = readU16(p);
+      header.piggyback.stream = readU16(p + 2);
+      header.piggyback.cumAck = readU32(p + 4);
+      header.piggyback.bitmap = readU32(p + 8);
+      header.piggyback.snrReport = (int8_t)p[12];
+    }
+  }
+  payload = frame + headerLen;
+  payloadLen = frameLen - headerLen;
+  return true;
+}
+
+// RESOLVE A SHORT NODE ADDRESS TO A DISPLAY NAME, FORMATTED INTO BUF IF THE NODE IS UNKNOWN
+const char *nodeNameForAddress(uint16_t address, char *buf, size_t bufLen)
+{
+  for (const KnownNode &node : KNOWN_NODES)
+  {
+    if (node.address == address)
+      return node.name;
+  }
+  for (const KnownNode &group : KNOWN_GROUPS)
+  {
+    if (group.address == address)
+      return group.name;
+  }
+  if (address == LORA_BROADCAST_ADDRESS)
+    return "Everyone";
+  snprintf(buf, bufLen, loRaIsNodeAddress(address) ? "Node-%04X" : "Group-%04X", address);
+  return buf;
+}
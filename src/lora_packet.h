@@ -0,0 +1,121 @@
+#ifndef LORA_PACKET_H
+#define LORA_PACKET_H
+
+#include <Arduino.h>
+
+// BINARY LORA FRAME FORMAT (ALL MULTI-BYTE FIELDS LITTLE-ENDIAN)
+//   [0]    VERSION (HIGH NIBBLE) | FRAME TYPE (LOW NIBBLE)
+//   [1]    FLAGS
+//   [2-3]  DESTINATION: A NODE, A GROUP (LORA_GROUP_ADDRESS_MIN AND UP) OR BROADCAST
+//   [4-5]  SOURCE (ORIGINATING) NODE ADDRESS
+//   [6-9]  DATA: SEQUENCE NUMBER IN THE SRC->DST STREAM
+//          ACK:  CUMULATIVE ACK (EVERY SEQUENCE UP TO THIS ONE RECEIVED)
+//   [10]   LINK: SF THE TRANSMITTER LISTENS ON (HIGH NIBBLE) | TX POWER - LORA_POWER_MIN (LOW NIBBLE)
+//   [11]   HOPS: HOPS LEFT (HIGH NIBBLE) | HOPS TAKEN (LOW NIBBLE)
+//   [12]   ATTEMPT: SET BY THE ORIGIN, COUNTS A DATA FRAME'S TRANSMISSIONS FROM 1 (0 ON ACKS), SO RELAYS
+//          TELL A RETRANSMISSION FROM A RELAYED COPY
+//   [13-14] LAST HOP: NODE THAT PUT THIS COPY ON AIR (THE SOURCE, OR A RELAY)
+//   [15-16] NEXT HOP: THE ONLY NODE THAT MAY FORWARD THIS COPY, BROADCAST TO LET EVERY RELAY FLOOD IT
+//   DATA:  [17]    WINDOW OFFSET (SEQUENCE - OLDEST UNACKED SEQUENCE)
+//          [+2]    FRAGMENT INDEX (1), FRAGMENT COUNT (1), ONLY WITH LORA_FLAG_FRAGMENT
+//          [+11]   PIGGYBACKED ACK, ONLY WITH LORA_FLAG_PIGGYBACK_ACK:
+//                  ACKED PEER (2), ACKED STREAM (2), CUMULATIVE ACK (4), SELECTIVE ACK BITMAP (4), SNR REPORT (1)
+//          [..]    PAYLOAD (AES-CCM CIPHERTEXT WITH LORA_FLAG_ENCRYPTED)
+//          [-8]    CCM TAG OVER THE PAYLOAD AND THE HEADER (SEE loRaAuthData), SEALED AFRESH FOR EVERY ATTEMPT
+//   FRAGMENTS OF ONE MESSAGE USE CONSECUTIVE SEQUENCE NUMBERS, FRAGMENT 0 FIRST
+//   ACK:   [17-20] SELECTIVE ACK BITMAP, BIT i = CUMULATIVE ACK + 1 + i RECEIVED
+//          [21]    SNR REPORT
+//          [22-23] ACKED STREAM: THE DESTINATION THE ACKED DATA WAS SENT TO (US, BROADCAST OR A GROUP)
+//          [24-27] ACK SERIAL: THE ORIGIN'S ACK COUNTER (EPOCH << 16 | COUNT), NEVER REPEATED, IN PLACE OF THE
+//                  SEQUENCE IN THE NONCE (THE SAME CUMULATIVE ACK IS SENT AGAIN WITH A DIFFERENT BITMAP)
+//          [28-35] CCM TAG OVER THE HEADER (EMPTY PAYLOAD)
+//   BEACON: [17-24] CCM TAG OVER THE HEADER (EMPTY PAYLOAD), SEQUENCE IS THE ORIGIN'S BEACON SERIAL
+//          (EPOCH << 16 | COUNT, NEVER REPEATED)
+//   SNR REPORTS CARRY THE SNR OF THE ACKED PEER'S LATEST FRAME IN QUARTER DB (SIGNED)
+//   DESTINATION AND NEXT HOP SIT AT FIXED OFFSETS SO A RECEIVER CAN DROP FOREIGN FRAMES UNPARSED (peekLoRaAddressing)
+//   LINK, HOPS, LAST HOP AND NEXT HOP DESCRIBE ONE TRANSMISSION AND ARE REWRITTEN BY RELAYS, SO THEY ARE NOT AUTHENTICATED
+#define LORA_PROTOCOL_VERSION 7
+#define LORA_FRAME_HEADER_LEN 17
+#define LORA_DATA_HEADER_LEN (LORA_FRAME_HEADER_LEN + 1)
+#define LORA_ACK_HEADER_LEN (LORA_FRAME_HEADER_LEN + 11)
+#define LORA_PIGGYBACK_ACK_LEN 13
+#define LORA_FRAGMENT_HEADER_LEN 2
+#define LORA_MAX_HEADER_LEN (LORA_DATA_HEADER_LEN + LORA_FRAGMENT_HEADER_LEN + LORA_PIGGYBACK_ACK_LEN)
+#define LORA_AUTH_TAG_LEN 8         // Truncated CCM tag ending every frame
+#define LORA_ACK_FRAME_LEN (LORA_ACK_HEADER_LEN + LORA_AUTH_TAG_LEN)
+#define LORA_MAX_FRAME_LEN 255
+#define LORA_MAX_PAYLOAD_LEN (LORA_MAX_FRAME_LEN - LORA_DATA_HEADER_LEN - LORA_AUTH_TAG_LEN)
+#define LORA_MAX_FRAGMENT_PAYLOAD_LEN (LORA_MAX_PAYLOAD_LEN - LORA_FRAGMENT_HEADER_LEN)
+#define LORA_MAX_FRAGMENTS 4      // Largest message a receiver will reassemble, in fragments
+#define LORA_MAX_MESSAGE_LEN (LORA_MAX_FRAGMENTS * LORA_MAX_FRAGMENT_PAYLOAD_LEN)
+
+// FRAME TYPES
+#define LORA_FRAME_DATA 0x1
+#define LORA_FRAME_ACK  0x2
+#define LORA_FRAME_BEACON 0x3  // Flooded presence announcement, teaches routes back to its origin
+
+// FRAME FLAGS
+#define LORA_FLAG_ENCRYPTED 0x01
+#define LORA_FLAG_PIGGYBACK_ACK 0x02
+#define LORA_FLAG_FRAGMENT 0x04
+#define LORA_FLAG_COMPRESSED 0x08  // Payload (whole message, before fragmenting) is lora_compress encoded
+
+// RATES A LINK BYTE CAN SIGNAL (POWER IS SENT AS A 4-BIT OFFSET FROM LORA_POWER_MIN)
+#define LORA_SF_MIN 7
+#define LORA_SF_MAX 10
+#define LORA_SF_RENDEZVOUS LORA_SF_MAX  // Listened on at boot and assumed for peers we know nothing about
+#define LORA_POWER_MIN 2                // dBm
+#define LORA_POWER_MAX 17               // dBm
+
+#define LORA_MAX_HOPS 15            // Hop fields are 4 bits each
+
+#define LORA_NODE_NAME_LEN 12       // Buffer for a generated "Node-XXXX" name
+#define LORA_LOCAL_ID_MAX_LEN 48    // Longest web UI local_id carried through the stack
+
+// RESERVED ADDRESSES
+#define LORA_GROUP_ADDRESS_MIN 0xFF00   // 0xFF00..0xFFFE are groups, nodes use the addresses below
+#define LORA_BROADCAST_ADDRESS 0xFFFF
+
+// SELECTIVE ACK FOR ONE SENDER'S STREAM, CARRIED INSIDE A DATA FRAME
+struct LoRaPiggybackAck {
+    uint16_t peer;      // Sender whose stream is being acknowledged
+    uint16_t stream;    // Destination that sender addressed the stream to
+    uint32_t cumAck;
+    uint32_t bitmap;
+    int8_t snrReport;   // How the acking node hears the acked peer, quarter dB
+};
+
+struct LoRaFrameHeader {
+    uint8_t version;    // Protocol version, frames from other versions are dropped
+    uint8_t type;       // LORA_FRAME_DATA or LORA_FRAME_ACK
+    uint8_t flags;      // LORA_FLAG_* bits
+    uint16_t dstAddress; // Short address of the intended receiver, a group, or broadcast
+    uint16_t srcAddress; // Short address of the transmitting node
+    uint32_t messageId; // Data: sequence number. ACK: cumulative ACK
+    uint8_t linkSf;     // SF the sender is listening on, peers transmit to it with this SF
+    int8_t linkPower;   // Power this frame was sent with, dBm
+    uint8_t hopLimit;   // Further relays allowed
+    uint8_t hopCount;   // Relays so far
+    uint8_t attempt;    // Data: origin's transmission count of this frame, part of the nonce
+    uint16_t lastHop;   // Transmitter of this copy
+    uint16_t nextHop;   // Designated forwarder, or broadcast for flooding
+    uint8_t windowOffset; // Data only: distance back to the sender's window base
+    uint8_t fragIndex;  // Data only, valid with LORA_FLAG_FRAGMENT
+    uint8_t fragCount;  // Data only, valid with LORA_FLAG_FRAGMENT
+    uint32_t ackBitmap; // ACK only: frames received beyond the cumulative ACK
+    int8_t snrReport;   // ACK only: how the sender hears the acked peer, quarter dB
+    uint16_t ackStream; // ACK only: destination of the acknowledged stream
+    uint32_t ackSerial; // ACK only: sender's ACK counter, stands in for the sequence in the nonce
+    LoRaPiggybackAck piggyback; // Data only, valid with LORA_FLAG_PIGGYBACK_ACK
+};
+
+// FUNCTION DECLARATIONS
+size_t loRaHeaderLen(const LoRaFrameHeader& header);
+size_t loRaAuthData(const uint8_t* frame, size_t headerLen, uint8_t* out);
+size_t encodeLoRaFrame(const LoRaFrameHeader& header, const uint8_t* payload, size_t payloadLen, uint8_t* out, size_t outCapacity);
+bool peekLoRaAddressing(const uint8_t* frame, size_t frameLen, uint16_t& dstAddress, uint16_t& nextHop);
+bool loRaIsNodeAddress(uint16_t address);
+bool decodeLoRaFrame(const uint8_t* frame, size_t frameLen, LoRaFrameHeader& header, const uint8_t*& payload, size_t& payloadLen);
+const char* nodeNameForAddress(uint16_t address, char* buf, size_t bufLen);
+
+#endif
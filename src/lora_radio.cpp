@@ -0,0 +1,423 @@
+#include "lora_radio.h"
+#include "lora_airtime.h"
+#include "lora_duty.h"
+#include "display_manager.h"
+
+// INITIALIZE LORA MODULE
+SX1262 radio = new Module(LORA_NSS_PIN, LORA_DIO1_PIN, LORA_RESET_PIN, LORA_BUSY_PIN);
+
+// LORA PHYSICAL LAYER PARAMETERS
+float lora_frequency = 915.0;
+float lora_bandwidth = 125.0;
+uint8_t lora_sf = LORA_SF_RENDEZVOUS; // Boot setting, then chosen per frame by the link table
+uint8_t lora_cr = 5;
+uint8_t lora_sync_word = 0x34;
+int8_t lora_power = LORA_POWER_MAX;
+uint16_t lora_preamble = 8;
+
+// FRAME RINGS - RX: RADIO TASK -> STACK, TX: STACK -> RADIO TASK, ONE PER PRIORITY CLASS
+SpscRing<LoRaRadioFrame, LORA_RX_RING_LEN> loraRxRing;
+static SpscRing<LoRaRadioFrame, LORA_TX_RING_LEN> loraTxRings[LORA_TX_CLASSES];
+static const uint8_t dutyReservePct[LORA_TX_CLASSES] = {
+    LORA_DUTY_RESERVE_ACK_PCT, LORA_DUTY_RESERVE_RETRANSMIT_PCT, LORA_DUTY_RESERVE_DATA_PCT, LORA_DUTY_RESERVE_BEACON_PCT};
+LoRaRadioStats loraRadioStats;
+
+// TASK NOTIFICATION BITS
+#define RADIO_EVT_DIO1 0x01
+#define RADIO_EVT_TX_QUEUED 0x02
+#define RADIO_EVT_LISTEN_SF 0x04
+
+static TaskHandle_t loraRadioTaskHandle = nullptr;
+
+// TX STATE MACHINE (RADIO TASK ONLY)
+enum LoRaRadioState { LORA_RADIO_RX, LORA_RADIO_CAD, LORA_RADIO_TX };
+static LoRaRadioState loraRadioState = LORA_RADIO_RX;
+static unsigned long txStartTime = 0;
+static unsigned long cadStartTime = 0;
+
+// CONTENTION STATE OF THE FRAME BEING SENT, AT THE HEAD OF ITS CLASS'S RING (RADIO TASK ONLY)
+static bool csmaActive = false;
+static LoRaTxClass csmaClass = LORA_TX_ACK;
+static uint8_t csmaAttempts = 0;
+static uint8_t csmaCwExp = 0;
+static unsigned long csmaDeferUntil = 0;
+static unsigned long csmaStartTime = 0;
+
+// RATE THE SX1262 IS PROGRAMMED WITH (RADIO TASK ONLY) AND THE SF THE STACK WANTS TO LISTEN ON
+static uint8_t activeSf = LORA_SF_RENDEZVOUS;
+static int8_t activePower = LORA_POWER_MAX;
+static std::atomic<uint8_t> listenSf{LORA_SF_RENDEZVOUS};
+
+// INTERRUPT SERVICE ROUTINE - WAKE THE RADIO TASK WHEN DIO1 IS TRIGGERED
+void IRAM_ATTR onLoRaInterrupt()
+{
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+  if (loraRadioTaskHandle)
+  {
+    xTaskNotifyFromISR(loraRadioTaskHandle, RADIO_EVT_DIO1, eSetBits, &higherPriorityTaskWoken);
+  }
+  portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+// REPROGRAM SF AND POWER, THE MODULATION PARAMETERS CAN ONLY CHANGE IN STANDBY
+static void applyLoRaRate(uint8_t sf, int8_t power)
+{
+  if (sf == activeSf && power == activePower)
+    return;
+  radio.standby();
+  if (sf != activeSf && radio.setSpreadingFactor(sf) == RADIOLIB_ERR_NONE)
+    activeSf = sf;
+  if (power != activePower && radio.setOutputPower(power) == RADIOLIB_ERR_NONE)
+    activePower = power;
+  loraRadioStats.rateChanges++;
+}
+
+// SET LORA RADIO INTO RECEIVE MODE ON THE SF PEERS HAVE BEEN TOLD WE LISTEN ON
+static void startLoRaReceive()
+{
+  applyLoRaRate(listenSf.load(), activePower);
+  // LATCH HEADER_VALID FOR THE BUSY CHECK, BUT ONLY RX_DONE RAISES DIO1
+  int radio_state = radio.startReceive(RADIOLIB_SX126X_RX_TIMEOUT_INF,
+                                       RADIOLIB_IRQ_RX_DEFAULT_FLAGS | (1UL << RADIOLIB_IRQ_HEADER_VALID),
+                                       RADIOLIB_IRQ_RX_DEFAULT_MASK, 0);
+  if (radio_state != RADIOLIB_ERR_NONE)
+  {
+    Serial.printf("[Radio] Starting RX mode FAILED, code: %d\n", radio_state);
+  }
+}
+
+// COPY A FRAME INTO THE RX RING, CALLED AFTER AN RX DIO1 EVENT
+static void drainLoRaRx()
+{
+  size_t len = radio.getPacketLength();
+  if (len > LORA_MAX_FRAME_LEN)
+    len = LORA_MAX_FRAME_LEN;
+
+  LoRaRadioFrame *slot = loraRxRing.acquire();
+  if (!slot)
+  {
+    // STACK IS BEHIND - CLEAR THE RADIO BUFFER AND COUNT THE DROP
+    uint8_t scratch[LORA_MAX_FRAME_LEN];
+    radio.readData(scratch, len);
+    loraRadioStats.rxDropped++;
+    startLoRaReceive();
+    return;
+  }
+
+  int rx_state = radio.readData(slot->data, len);
+  if (rx_state == RADIOLIB_ERR_NONE)
+  {
+    slot->len = len;
+    slot->rssi = radio.getRSSI();
+    slot->snr = radio.getSNR();
+    slot->sf = activeSf;
+    slot->timestamp = millis();
+    loraRxRing.commit();
+    loraRadioStats.rxFrames++;
+  }
+  else if (rx_state == RADIOLIB_ERR_CRC_MISMATCH)
+  {
+    loraRadioStats.rxCrcErrors++;
+  }
+  else
+  {
+    Serial.printf("[Radio] readData() returned error: %d\n", rx_state);
+    loraRadioStats.rxFailed++;
+  }
+  startLoRaReceive();
+}
+
+// CSMA SLOT LENGTH FOR A FRAME'S SF
+static uint32_t csmaSlotMs(uint8_t sf)
+{
+  uint32_t symbolUs = (uint32_t)((float)(1UL << sf) * 1000.0f / lora_bandwidth);
+  return (LORA_CSMA_SLOT_SYMBOLS * symbolUs + 999) / 1000;
+}
+
+// KEY UP WITH THE FRAME IN CONTENTION, RETURNS IMMEDIATELY (DIO1 FIRES ON TX DONE)
+// ITS AIRTIME IS CHARGED TO THE SUB-BAND WHETHER OR NOT THE TRANSMISSION COMPLETES
+static void startLoRaTransmit(LoRaRadioFrame *slot)
+{
+  loraRadioStats.csmaBackoffMs += millis() - csmaStartTime;
+  csmaActive = false;
+  dutyCharge(lora_frequency, loRaFrameAirtimeMs(slot->len, slot->sf), millis());
+  int tx_state = radio.startTransmit(slot->data, slot->len);
+  loraTxRings[csmaClass].release();
+  if (tx_state == RADIOLIB_ERR_NONE)
+  {
+    loraRadioState = LORA_RADIO_TX;
+    txStartTime = millis();
+  }
+  else
+  {
+    Serial.printf("[Radio] startTransmit() FAILED, code: %d\n", tx_state);
+    loraRadioStats.txFailed++;
+    startLoRaReceive();
+  }
+}
+
+// CHANNEL IN USE - LISTEN FOR A RANDOM NUMBER OF SLOTS, DOUBLING THE WINDOW EACH TIME
+static void backOffLoRaTransmit(const LoRaRadioFrame *slot)
+{
+  uint8_t cwMaxExp = (slot->txClass == LORA_TX_ACK) ? LORA_CSMA_ACK_CW_MAX_EXP : LORA_CSMA_DATA_CW_MAX_EXP;
+  uint32_t slots = esp_random() % (1UL << csmaCwExp);
+  csmaDeferUntil = millis() + slots * csmaSlotMs(slot->sf);
+  if (csmaCwExp < cwMaxExp)
+    csmaCwExp++;
+  csmaAttempts++;
+  loraRadioStats.channelBusy++;
+}
+
+// OLDEST FRAME OF THE MOST URGENT NON-EMPTY CLASS, NULLPTR IF THERE IS NONE OR THE BUDGET HOLDS IT BACK
+// (LESS URGENT CLASSES KEEP LARGER RESERVES, SO THEY WOULD BE HELD BACK TOO)
+static LoRaRadioFrame *nextLoRaTxFrame(LoRaTxClass &txClass, unsigned long now)
+{
+  uint8_t heldMask = 0;
+  LoRaRadioFrame *slot = nullptr;
+  for (uint8_t c = 0; c < LORA_TX_CLASSES && !slot && !heldMask; c++)
+  {
+    LoRaRadioFrame *head = loraTxRings[c].peek();
+    if (!head)
+      continue;
+    if (dutyAllows(lora_frequency, loRaFrameAirtimeMs(head->len, head->sf), dutyReservePct[c], now))
+    {
+      slot = head;
+      txClass = (LoRaTxClass)c;
+    }
+    else
+    {
+      heldMask = 1 << c;
+      if (!(loraRadioStats.dutyHeldMask & heldMask))
+        loraRadioStats.dutyDeferrals++;
+    }
+  }
+  loraRadioStats.dutyHeldMask = heldMask;
+  return slot;
+}
+
+// CONTEND FOR THE CHANNEL FOR THE NEXT SCHEDULED FRAME - A CAD ONCE ITS DEFERRAL HAS RUN OUT
+static void serviceLoRaTransmit()
+{
+  unsigned long now = millis();
+  LoRaTxClass txClass = LORA_TX_ACK;
+  LoRaRadioFrame *slot = nextLoRaTxFrame(txClass, now);
+  if (!slot)
+  {
+    csmaActive = false;
+    return;
+  }
+
+  // A MORE URGENT FRAME QUEUED DURING A BACKOFF TAKES THE CHANNEL NEXT, THE OTHER KEEPS ITS PLACE
+  if (csmaActive && txClass != csmaClass)
+    csmaActive = false;
+  if (!csmaActive)
+  {
+    csmaActive = true;
+    csmaClass = txClass;
+    csmaAttempts = 0;
+    csmaStartTime = now;
+    bool ack = (slot->txClass == LORA_TX_ACK);
+    csmaCwExp = ack ? LORA_CSMA_ACK_CW_MIN_EXP : LORA_CSMA_DATA_CW_MIN_EXP;
+    csmaDeferUntil = now + (ack ? 0 : LORA_CSMA_DATA_DEFER_SLOTS * csmaSlotMs(slot->sf));
+  }
+  if ((long)(now - csmaDeferUntil) < 0)
+    return;
+
+  // A FRAME WE ARE ALREADY RECEIVING MEANS THE CHANNEL IS BUSY, AND A CAD WOULD CUT IT OFF
+  loraRadioStats.channelChecks++;
+  if (radio.getIrqFlags() & RADIOLIB_SX126X_IRQ_HEADER_VALID)
+  {
+    backOffLoRaTransmit(slot);
+    return;
+  }
+
+  // CAD ONLY SEES CHIRPS OF ITS OWN SF, SO SCAN ON THE ONE THE FRAME WILL GO OUT ON
+  applyLoRaRate(slot->sf, slot->power);
+  int cad_state = radio.startChannelScan();
+  if (cad_state != RADIOLIB_ERR_NONE)
+  {
+    Serial.printf("[Radio] startChannelScan() FAILED, code: %d\n", cad_state);
+    startLoRaTransmit(slot);
+    return;
+  }
+  loraRadioState = LORA_RADIO_CAD;
+  cadStartTime = now;
+}
+
+// CAD DONE (OR TIMED OUT) - SEND ON A CLEAR CHANNEL, OTHERWISE BACK OFF AND KEEP RECEIVING
+static void finishLoRaChannelScan(bool cadDone)
+{
+  LoRaRadioFrame *slot = loraTxRings[csmaClass].peek();
+  loraRadioState = LORA_RADIO_RX;
+  bool busy = cadDone && radio.getChannelScanResult() == RADIOLIB_LORA_DETECTED;
+  if (!busy)
+  {
+    startLoRaTransmit(slot);
+    return;
+  }
+  if (csmaAttempts + 1 >= LORA_CSMA_MAX_ATTEMPTS)
+  {
+    loraRadioStats.channelBusy++;
+    loraRadioStats.csmaForced++;
+    startLoRaTransmit(slot);
+    return;
+  }
+  backOffLoRaTransmit(slot);
+  startLoRaReceive();
+}
+
+// COMPLETE AN ONGOING TRANSMISSION AND RETURN TO RX MODE
+static void finishLoRaTransmit(bool txDone)
+{
+  radio.finishTransmit();
+  loraRadioState = LORA_RADIO_RX;
+  if (txDone)
+  {
+    loraRadioStats.txDone++;
+  }
+  else
+  {
+    Serial.println(F("[Radio] TX FAILED (No TX done interrupt)"));
+    loraRadioStats.txFailed++;
+  }
+  startLoRaReceive(); // Reenable RX mode after the transmission
+}
+
+// RADIO TASK - OWNS THE SX1262, SLEEPS UNTIL DIO1, A QUEUED TX, THE END OF A BACKOFF OR
+// (WHILE FRAMES ARE HELD BACK) THE NEXT RELEASE OF DUTY-CYCLE BUDGET WAKES IT
+static void loraRadioTask(void * /*param*/)
+{
+  for (;;)
+  {
+    uint32_t events = 0;
+    TickType_t wait = portMAX_DELAY;
+    if (loraRadioState == LORA_RADIO_TX)
+      wait = pdMS_TO_TICKS(LORA_TX_TIMEOUT_MS);
+    else if (loraRadioState == LORA_RADIO_CAD)
+      wait = pdMS_TO_TICKS(LORA_CAD_TIMEOUT_MS);
+    else if (csmaActive)
+      wait = pdMS_TO_TICKS(max(1L, (long)(csmaDeferUntil - millis()))); // Wake when the backoff runs out
+    else if (loraRadioStats.dutyHeldMask)
+      wait = pdMS_TO_TICKS(dutyNextReleaseMs(millis()));
+    xTaskNotifyWait(0, UINT32_MAX, &events, wait);
+
+    if (events & RADIO_EVT_DIO1)
+    {
+      if (loraRadioState == LORA_RADIO_TX)
+        finishLoRaTransmit(true);
+      else if (loraRadioState == LORA_RADIO_CAD)
+        finishLoRaChannelScan(true);
+      else
+        drainLoRaRx();
+    }
+    else if (loraRadioState == LORA_RADIO_TX && millis() - txStartTime > LORA_TX_TIMEOUT_MS)
+    {
+      finishLoRaTransmit(false);
+    }
+    else if (loraRadioState == LORA_RADIO_CAD && millis() - cadStartTime > LORA_CAD_TIMEOUT_MS)
+    {
+      finishLoRaChannelScan(false);
+    }
+    else if ((events & RADIO_EVT_LISTEN_SF) && loraRadioState == LORA_RADIO_RX && activeSf != listenSf.load())
+    {
+      startLoRaReceive(); // A TX in progress picks the new SF up when it returns to RX
+    }
+
+    if (loraRadioState == LORA_RADIO_RX)
+      serviceLoRaTransmit();
+  }
+}
+
+// SETUP LORA RADIO MODULE AND START THE RADIO TASK
+void setupLoRaRadio()
+{
+  Serial.print(F("[LoRa] Initializing ... "));
+  setDisplayStatusLine("LoRa Init...");
+
+  int radio_state = radio.begin(lora_frequency, lora_bandwidth, lora_sf, lora_cr, lora_sync_word, lora_power, lora_preamble);
+  if (radio_state == RADIOLIB_ERR_NONE)
+  {
+#if defined(HELTEC_V3_BOARD)
+    radio.setDio2AsRfSwitch(true);
+    Serial.print(F("RF Switch (DIO2) enabled for Heltec. "));
+#endif
+    Serial.println(F("OK"));
+    setDisplayStatusLine("LoRa OK");
+  }
+  else
+  {
+    Serial.print(F("FAILED, code: "));
+    Serial.println(radio_state);
+    char status[24];
+    snprintf(status, sizeof(status), "LoRa Fail %d", radio_state);
+    setDisplayStatusLine(status);
+    while (true)
+      ; // Halt on critical LoRa failure
+  }
+
+  xTaskCreatePinnedToCore(loraRadioTask, "lora_radio", LORA_RADIO_TASK_STACK, nullptr,
+                          LORA_RADIO_TASK_PRIORITY, &loraRadioTaskHandle, LORA_RADIO_TASK_CORE);
+  radio.setDio1Action(onLoRaInterrupt);
+  startLoRaReceive();
+  setDisplayStatusLine("Listening...");
+}
+
+// QUEUE AN ENCODED FRAME FOR THE RADIO TASK (SINGLE PRODUCER: THE LORA STACK)
+// TICKET, IF GIVEN, IS FILLED IN SO loRaTxTaken() CAN LATER SAY WHETHER THE FRAME HAS LEFT THE QUEUE
+bool queueLoRaRadioFrame(const uint8_t *frame, size_t frameLen, uint8_t sf, int8_t power, LoRaTxClass txClass,
+                         LoRaTxTicket *ticket)
+{
+  if (txClass >= LORA_TX_CLASSES)
+    return false;
+  SpscRing<LoRaRadioFrame, LORA_TX_RING_LEN> &ring = loraTxRings[txClass];
+  LoRaRadioFrame *slot = ring.acquire();
+  if (!slot || frameLen > LORA_MAX_FRAME_LEN)
+    return false;
+
+  memcpy(slot->data, frame, frameLen);
+  slot->len = frameLen;
+  slot->sf = sf;
+  slot->power = power;
+  slot->txClass = txClass;
+  slot->timestamp = millis();
+  if (ticket)
+  {
+    ticket->txClass = txClass;
+    ticket->position = ring.committed();
+  }
+  ring.commit();
+  xTaskNotify(loraRadioTaskHandle, RADIO_EVT_TX_QUEUED, eSetBits);
+  return true;
+}
+
+// HAS THE RADIO TASK TAKEN THIS FRAME OFF ITS RING - IT DOES SO AS IT KEYS UP (OR FAILS TO)
+bool loRaTxTaken(const LoRaTxTicket &ticket)
+{
+  if (ticket.txClass >= LORA_TX_CLASSES)
+    return true;
+  return (long)(loraTxRings[ticket.txClass].released() - ticket.position) > 0;
+}
+
+// MOVE RECEPTION TO ANOTHER SF, APPLIED BY THE RADIO TASK AS SOON AS IT IS NOT TRANSMITTING
+void setLoRaListenSf(uint8_t sf)
+{
+  listenSf = sf;
+  xTaskNotify(loraRadioTaskHandle, RADIO_EVT_LISTEN_SF, eSetBits);
+}
+
+// TIME ON AIR OF A FRAME AT THE GIVEN SF WITH THE OTHER PHY SETTINGS
+uint32_t loRaFrameAirtimeMs(size_t frameLen, uint8_t sf)
+{
+  return loRaTimeOnAirMs(frameLen, sf, lora_bandwidth, lora_cr, lora_preamble);
+}
+
+// FRAMES OF ONE CLASS WAITING FOR THE RADIO
+size_t loRaTxQueueDepth(LoRaTxClass txClass)
+{
+  return txClass < LORA_TX_CLASSES ? loraTxRings[txClass].size() : 0;
+}
+
+float loRaFrequency()
+{
+  return lora_frequency;
+}
@@ -0,0 +1,117 @@
+#ifndef LORA_RADIO_H
+#define LORA_RADIO_H
+
+#include <RadioLib.h>
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+#include "lora_packet.h"
+#include "spsc_ring.h"
+
+// LORA PIN DEFINITIONS 
+#if defined(HELTEC_V3_BOARD)
+    #define LORA_SCK_PIN    9
+    #define LORA_MISO_PIN   11
+    #define LORA_MOSI_PIN   10
+    #define LORA_NSS_PIN    8
+    #define LORA_RESET_PIN  12
+    #define LORA_DIO1_PIN   14
+    #define LORA_BUSY_PIN   13
+#elif defined(XIAO_ESP32S3_BOARD)
+    #define LORA_SCK_PIN    7
+    #define LORA_MISO_PIN   8
+    #define LORA_MOSI_PIN   9
+    #define LORA_NSS_PIN    41 
+    #define LORA_RESET_PIN  42 
+    #define LORA_DIO1_PIN   39 
+    #define LORA_BUSY_PIN   40 
+#else
+    #error "LoRa pins not defined!"
+#endif
+
+// RADIO TASK CONFIGURATION
+#define LORA_RADIO_TASK_STACK 4096
+#define LORA_RADIO_TASK_PRIORITY 5  // Above loop() so DIO1 is serviced immediately
+#define LORA_RADIO_TASK_CORE 1
+#define LORA_RX_RING_LEN 8          // Received frames waiting for the stack (power of two)
+#define LORA_TX_RING_LEN 8          // Frames waiting for the radio per priority class (power of two)
+#define LORA_TX_TIMEOUT_MS 4000     // Give up on a TX done interrupt after this long
+#define LORA_CAD_TIMEOUT_MS 500     // Give up on a CAD done interrupt after this long
+
+// LISTEN-BEFORE-TALK - CAD BEFORE EVERY FRAME, RANDOM BACKOFF OF 0..2^n - 1 SLOTS WHILE THE CHANNEL IS BUSY
+// ACKS SKIP THE INITIAL DEFERRAL AND DRAW FROM A SMALLER WINDOW, SO THEY WIN AGAINST NEW DATA
+#define LORA_CSMA_SLOT_SYMBOLS 3        // Slot length: a CAD plus turnaround, in symbols of the frame's SF
+#define LORA_CSMA_DATA_DEFER_SLOTS 2    // Data waits this long before its first CAD
+#define LORA_CSMA_DATA_CW_MIN_EXP 3
+#define LORA_CSMA_DATA_CW_MAX_EXP 7
+#define LORA_CSMA_ACK_CW_MIN_EXP 1
+#define LORA_CSMA_ACK_CW_MAX_EXP 4
+#define LORA_CSMA_MAX_ATTEMPTS 8        // Busy channel assessments before the frame is sent regardless
+
+// TRANSMIT SCHEDULER - STRICT PRIORITY BY CLASS, AND EACH CLASS STOPS SHORT OF THE DUTY-CYCLE BUDGET
+// BY ITS RESERVE, SO WHAT IS LEFT OF A NEARLY SPENT BUDGET GOES TO ACKS FIRST
+#define LORA_DUTY_RESERVE_ACK_PCT 0
+#define LORA_DUTY_RESERVE_RETRANSMIT_PCT 10
+#define LORA_DUTY_RESERVE_DATA_PCT 25
+#define LORA_DUTY_RESERVE_BEACON_PCT 50
+
+// PRIORITY CLASS OF A QUEUED FRAME, MOST URGENT FIRST
+enum LoRaTxClass : uint8_t {
+    LORA_TX_ACK,
+    LORA_TX_RETRANSMIT,
+    LORA_TX_DATA,           // First transmissions, ours or relayed
+    LORA_TX_BEACON,
+    LORA_TX_CLASSES
+};
+
+// A QUEUED FRAME'S PLACE IN ITS CLASS'S TX RING, SO THE STACK CAN TELL WHEN THE RADIO TASK HAS TAKEN IT
+struct LoRaTxTicket {
+    LoRaTxClass txClass;     // LORA_TX_CLASSES: nothing queued
+    size_t position;         // Frames committed to that ring before this one
+};
+
+// A FRAME AS IT CROSSES BETWEEN THE RADIO TASK AND THE STACK
+struct LoRaRadioFrame {
+    uint8_t data[LORA_MAX_FRAME_LEN];
+    size_t len;
+    float rssi;              // RX only
+    float snr;               // RX only
+    uint8_t sf;              // TX: spreading factor to send with. RX: SF it was heard on
+    int8_t power;            // TX only, dBm
+    LoRaTxClass txClass;     // TX only
+    unsigned long timestamp; // millis() when read from the radio or queued for TX
+};
+
+// RADIO TASK COUNTERS, WRITTEN BY THE RADIO TASK ONLY
+struct LoRaRadioStats {
+    std::atomic<uint32_t> rxFrames{0};
+    std::atomic<uint32_t> rxDropped{0};   // RX ring was full
+    std::atomic<uint32_t> rxCrcErrors{0};
+    std::atomic<uint32_t> rxFailed{0};
+    std::atomic<uint32_t> txDone{0};
+    std::atomic<uint32_t> txFailed{0};
+    std::atomic<uint32_t> rateChanges{0}; // SF or power reprogrammed between frames
+    std::atomic<uint32_t> channelChecks{0};  // CADs, plus checks that found a frame arriving
+    std::atomic<uint32_t> channelBusy{0};   // CAD found activity, or a frame was arriving
+    std::atomic<uint32_t> csmaForced{0};    // Sent on a busy channel after LORA_CSMA_MAX_ATTEMPTS
+    std::atomic<uint32_t> csmaBackoffMs{0}; // Total time frames spent backing off
+    std::atomic<uint32_t> dutyDeferrals{0}; // Times a queued frame was held back for the duty-cycle budget
+    std::atomic<uint8_t> dutyHeldMask{0};   // Bit per LoRaTxClass currently held back
+};
+
+extern SX1262 radio;
+extern SpscRing<LoRaRadioFrame, LORA_RX_RING_LEN> loraRxRing;
+extern LoRaRadioStats loraRadioStats;
+
+// FUNCTION DECLARATIONS
+void IRAM_ATTR onLoRaInterrupt();
+void setupLoRaRadio();
+bool queueLoRaRadioFrame(const uint8_t* frame, size_t frameLen, uint8_t sf, int8_t power, LoRaTxClass txClass,
+                         LoRaTxTicket* ticket = nullptr);
+bool loRaTxTaken(const LoRaTxTicket& ticket);
+void setLoRaListenSf(uint8_t sf);
+uint32_t loRaFrameAirtimeMs(size_t frameLen, uint8_t sf);
+size_t loRaTxQueueDepth(LoRaTxClass txClass);
+float loRaFrequency();
+
+#endif
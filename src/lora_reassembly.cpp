@@ -0,0 +1,96 @@
+#include "lora_reassembly.h"
+
+// REASSEMBLY BUFFERS
+static LoRaReassembly reassemblySlots[LORA_REASSEMBLY_SLOTS];
+
+// THE BUFFER ALREADY REBUILDING A FRAGMENT'S MESSAGE, OR NULLPTR
+static LoRaReassembly *findReassembly(const LoRaFrameHeader &header)
+{
+  uint32_t firstSeq = header.messageId - header.fragIndex;
+  for (LoRaReassembly &entry : reassemblySlots)
+  {
+    if (entry.active && entry.srcAddress == header.srcAddress && entry.dstAddress == header.dstAddress &&
+        entry.firstSeq == firstSeq)
+      return &entry;
+  }
+  return nullptr;
+}
+
+static LoRaReassembly *freeReassembly()
+{
+  for (LoRaReassembly &entry : reassemblySlots)
+  {
+    if (!entry.active)
+      return &entry;
+  }
+  return nullptr;
+}
+
+// CAN THIS FRAGMENT BE STORED - CHECKED BEFORE THE FRAME IS RECORDED AND ACKED, SO THAT A MESSAGE ARRIVING
+// WHILE EVERY BUFFER IS BUSY IS LEFT TO THE SENDER'S RETRIES INSTEAD OF EVICTING ONE ALREADY ACKED
+// EVERY FRAGMENT BUT THE LAST IS FULL, SO EACH ONE'S POSITION FOLLOWS FROM ITS INDEX
+bool reassemblyHasRoom(const LoRaFrameHeader &header, size_t fragmentLen)
+{
+  if (header.fragCount > LORA_MAX_FRAGMENTS)
+    return false;
+  bool last = (header.fragIndex == header.fragCount - 1);
+  if (fragmentLen == 0 || fragmentLen > LORA_MAX_FRAGMENT_PAYLOAD_LEN || (!last && fragmentLen != LORA_MAX_FRAGMENT_PAYLOAD_LEN))
+    return false;
+  LoRaReassembly *entry = findReassembly(header);
+  return entry ? entry->fragCount == header.fragCount : freeReassembly() != nullptr;
+}
+
+// STORE A DECRYPTED FRAGMENT - ONCE EVERY FRAGMENT IS IN, entry IS THE COMPLETE MESSAGE (CALLER RELEASES IT)
+LoRaReassemblyResult reassemblyAddFragment(const LoRaFrameHeader &header, const uint8_t *fragment, size_t fragmentLen,
+                                           unsigned long now, LoRaReassembly *&entry)
+{
+  if (!reassemblyHasRoom(header, fragmentLen))
+    return REASSEMBLY_REJECTED;
+  entry = findReassembly(header);
+  if (!entry)
+  {
+    entry = freeReassembly();
+    entry->active = true;
+    entry->srcAddress = header.srcAddress;
+    entry->dstAddress = header.dstAddress;
+    entry->firstSeq = header.messageId - header.fragIndex;
+    entry->fragCount = header.fragCount;
+    entry->receivedMask = 0;
+    entry->totalLen = 0;
+    entry->startTime = now;
+  }
+
+  size_t offset = (size_t)header.fragIndex * LORA_MAX_FRAGMENT_PAYLOAD_LEN;
+  memcpy(entry->data + offset, fragment, fragmentLen);
+  entry->receivedMask |= (1UL << header.fragIndex);
+  if (header.fragIndex == header.fragCount - 1)
+    entry->totalLen = offset + fragmentLen;
+
+  uint32_t allFragments = (header.fragCount == 32) ? 0xFFFFFFFFUL : ((1UL << header.fragCount) - 1);
+  if (entry->receivedMask != allFragments)
+    return REASSEMBLY_STORED;
+  entry->data[entry->totalLen] = 0;
+  return REASSEMBLY_COMPLETE;
+}
+
+void reassemblyRelease(LoRaReassembly &entry)
+{
+  entry.active = false;
+}
+
+// DROP PARTIAL MESSAGES WHOSE MISSING FRAGMENTS NEVER CAME, RETURNS HOW MANY
+size_t reassemblyExpire(unsigned long now)
+{
+  size_t expired = 0;
+  for (LoRaReassembly &entry : reassemblySlots)
+  {
+    if (entry.active && now - entry.startTime > LORA_REASSEMBLY_TIMEOUT_MS)
+    {
+      Serial.printf("[LoRa] Reassembly of 0x%04X/%u timed out (mask 0x%X of %u).\n",
+                    entry.srcAddress, entry.firstSeq, entry.receivedMask, entry.fragCount);
+      entry.active = false;
+      expired++;
+    }
+  }
+  return expired;
+}
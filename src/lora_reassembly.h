@@ -0,0 +1,39 @@
+#ifndef LORA_REASSEMBLY_H
+#define LORA_REASSEMBLY_H
+
+#include <Arduino.h>
+#include "lora_packet.h"
+
+// REASSEMBLY CONFIGURATION
+#define LORA_REASSEMBLY_SLOTS 2             // Fragmented messages being rebuilt at once, a further one waits unacknowledged
+#define LORA_REASSEMBLY_TIMEOUT_MS 60000    // Drop a partial message after this long (covers the sender's retries)
+
+static_assert(LORA_MAX_FRAGMENTS <= 32, "Fragment mask is 32 bits");
+
+// ONE MESSAGE BEING REBUILT FROM ITS FRAGMENTS (PRE-ALLOCATED)
+struct LoRaReassembly {
+    bool active;
+    uint16_t srcAddress;
+    uint16_t dstAddress;        // Destination the sender used (us, broadcast or a group), selects its stream
+    uint32_t firstSeq;          // Sequence number of fragment 0, identifies the message within the stream
+    uint8_t fragCount;
+    uint32_t receivedMask;      // Bit i set: fragment i stored
+    size_t totalLen;            // Known once the last fragment arrives
+    unsigned long startTime;
+    uint8_t data[LORA_MAX_MESSAGE_LEN + 1]; // Plaintext, NUL-terminated when complete
+};
+
+enum LoRaReassemblyResult {
+    REASSEMBLY_STORED,          // Kept, other fragments are still missing
+    REASSEMBLY_COMPLETE,        // Every fragment is in, the message is ready
+    REASSEMBLY_REJECTED         // Malformed, or no buffer for it
+};
+
+// FUNCTION DECLARATIONS
+bool reassemblyHasRoom(const LoRaFrameHeader& header, size_t fragmentLen);
+LoRaReassemblyResult reassemblyAddFragment(const LoRaFrameHeader& header, const uint8_t* fragment, size_t fragmentLen,
+                                           unsigned long now, LoRaReassembly*& entry);
+void reassemblyRelease(LoRaReassembly& entry);
+size_t reassemblyExpire(unsigned long now);
+
+#endif
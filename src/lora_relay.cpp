@@ -0,0 +1,131 @@
+#include "lora_relay.h"
+
+// SEEN CACHE AND PENDING REBROADCASTS
+static uint32_t seenKeys[LORA_MESH_SEEN_LEN];
+static size_t seenNext = 0;
+static size_t seenCount = 0;
+static LoRaRelayPending relayPending[LORA_RELAY_PENDING];
+
+LoRaRelayStats loraRelayStats;
+
+// FNV-1A OVER THE FIELDS THAT IDENTIFY ONE TRANSMISSION BY ITS ORIGIN, WHICHEVER RELAY CARRIED IT, AND ITS
+// CCM TAG (THE LAST LORA_AUTH_TAG_LEN BYTES OF EVERY FRAME). A FORGED HEADER CANNOT MATCH THE KEY OF THE
+// GENUINE FRAME IT COPIES (AN ACK REPEATS ITS CUMULATIVE ACK BUT NEVER ITS SERIAL)
+static uint32_t transmissionKey(const LoRaFrameHeader &header, const uint8_t *frame, size_t frameLen)
+{
+  uint32_t id = (header.type == LORA_FRAME_ACK) ? header.ackSerial : header.messageId;
+  uint8_t fields[10 + LORA_AUTH_TAG_LEN] = {
+      (uint8_t)header.srcAddress, (uint8_t)(header.srcAddress >> 8),
+      (uint8_t)header.dstAddress, (uint8_t)(header.dstAddress >> 8),
+      header.type, header.attempt,
+      (uint8_t)id, (uint8_t)(id >> 8), (uint8_t)(id >> 16), (uint8_t)(id >> 24)};
+  if (frameLen >= LORA_AUTH_TAG_LEN)
+    memcpy(fields + 10, frame + frameLen - LORA_AUTH_TAG_LEN, LORA_AUTH_TAG_LEN);
+  uint32_t hash = 2166136261UL;
+  for (uint8_t b : fields)
+  {
+    hash ^= b;
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+static bool seenBefore(uint32_t key)
+{
+  for (size_t i = 0; i < seenCount; i++)
+  {
+    if (seenKeys[i] == key)
+      return true;
+  }
+  return false;
+}
+
+static void rememberSeen(uint32_t key)
+{
+  seenKeys[seenNext] = key;
+  seenNext = (seenNext + 1) % LORA_MESH_SEEN_LEN;
+  if (seenCount < LORA_MESH_SEEN_LEN)
+    seenCount++;
+}
+
+// NODES THAT HEARD THE FRAME FAINTLY ARE FURTHER AWAY AND REACH MORE NEW NODES, SO THEY GO FIRST
+// ONE AIRTIME OF GRACE, UP TO LORA_RELAY_SNR_WINDOW_FRAMES MORE FOR A STRONG SIGNAL, PLUS ONE OF JITTER
+static uint32_t relayDelayMs(float snr, uint32_t airtimeMs)
+{
+  float weight = (snr - LORA_RELAY_SNR_WEAK) / (LORA_RELAY_SNR_STRONG - LORA_RELAY_SNR_WEAK);
+  weight = constrain(weight, 0.0f, 1.0f);
+  return airtimeMs + (uint32_t)(weight * LORA_RELAY_SNR_WINDOW_FRAMES * airtimeMs) + esp_random() % (airtimeMs + 1);
+}
+
+// RUN EVERY RECEIVED FRAME THROUGH THE SEEN CACHE BEFORE IT IS AUTHENTICATED - A REPEAT COUNTS TOWARDS
+// CANCELLING OUR OWN RELAY OF IT. ONLY AUTHENTICATED FRAMES ARE EVER REMEMBERED (relayAccept)
+LoRaRelayResult relayCheckSeen(const LoRaFrameHeader &header, const uint8_t *frame, size_t frameLen)
+{
+  uint32_t key = transmissionKey(header, frame, frameLen);
+  if (!seenBefore(key))
+    return RELAY_NEW;
+  loraRelayStats.duplicates++;
+  for (LoRaRelayPending &entry : relayPending)
+  {
+    if (entry.active && !entry.directed && entry.key == key && ++entry.copiesHeard >= LORA_RELAY_CANCEL_COPIES)
+    {
+      entry.active = false;
+      loraRelayStats.cancelled++;
+      Serial.printf("[Relay] Cancelled 0x%04X/%u, %u neighbours relayed it first.\n",
+                    header.srcAddress, header.messageId, entry.copiesHeard);
+    }
+  }
+  return RELAY_DUPLICATE;
+}
+
+// REMEMBER A NEW FRAME THAT HAS AUTHENTICATED AND, IF relayThis, SCHEDULE IT FOR REBROADCAST (WITHIN A
+// QUARTER AIRTIME WHEN directed, AS NO OTHER NODE WILL CARRY IT ON)
+void relayAccept(const LoRaFrameHeader &header, const uint8_t *frame, size_t frameLen, float snr,
+                 uint32_t airtimeMs, bool relayThis, bool directed, unsigned long now)
+{
+  uint32_t key = transmissionKey(header, frame, frameLen);
+  rememberSeen(key);
+
+  if (!relayThis || header.hopLimit == 0 || header.hopCount >= LORA_MAX_HOPS)
+    return;
+
+  LoRaRelayPending *slot = nullptr;
+  for (LoRaRelayPending &entry : relayPending)
+  {
+    if (!entry.active)
+    {
+      slot = &entry;
+      break;
+    }
+  }
+  if (!slot)
+  {
+    loraRelayStats.dropped++;
+    return;
+  }
+
+  slot->active = true;
+  slot->key = key;
+  slot->dueTime = now + (directed ? esp_random() % (airtimeMs / 4 + 1) : relayDelayMs(snr, airtimeMs));
+  slot->copiesHeard = 0;
+  slot->directed = directed;
+  memcpy(slot->frame, frame, frameLen);
+  slot->frameLen = frameLen;
+  loraRelayStats.scheduled++;
+}
+
+// A REBROADCAST WHOSE DELAY HAS RUN OUT, OR NULLPTR (CALLER SENDS IT AND RELEASES IT)
+LoRaRelayPending *relayNextDue(unsigned long now)
+{
+  for (LoRaRelayPending &entry : relayPending)
+  {
+    if (entry.active && (long)(now - entry.dueTime) >= 0)
+      return &entry;
+  }
+  return nullptr;
+}
+
+void relayRelease(LoRaRelayPending &entry)
+{
+  entry.active = false;
+}
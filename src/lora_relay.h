@@ -0,0 +1,50 @@
+#ifndef LORA_RELAY_H
+#define LORA_RELAY_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "lora_packet.h"
+
+// MANAGED FLOODING CONFIGURATION
+#define LORA_MESH_HOP_LIMIT 3           // Relays allowed for frames we originate
+#define LORA_MESH_SEEN_LEN 64           // Recently seen authenticated transmissions remembered (ring of 32-bit keys)
+#define LORA_RELAY_PENDING 4            // Rebroadcasts waiting for their delay at once
+#define LORA_RELAY_CANCEL_COPIES 2      // Copies overheard from other relays that make ours redundant
+#define LORA_RELAY_SNR_WEAK -15.0f      // At or below: relay after the shortest delay
+#define LORA_RELAY_SNR_STRONG 10.0f     // At or above: relay after the longest delay
+#define LORA_RELAY_SNR_WINDOW_FRAMES 3  // Delay range spanned by the SNR weighting, in frame airtimes
+
+// A RECEIVED FRAME WAITING TO BE REBROADCAST (PRE-ALLOCATED)
+struct LoRaRelayPending {
+    bool active;
+    uint32_t key;               // Seen-cache key of the transmission being relayed
+    unsigned long dueTime;
+    uint8_t copiesHeard;        // Copies relayed by others since we scheduled ours
+    bool directed;              // We are the designated next hop: forward promptly, never cancel
+    uint8_t frame[LORA_MAX_FRAME_LEN]; // As received, hop fields are updated when it goes out
+    size_t frameLen;
+};
+
+enum LoRaRelayResult {
+    RELAY_NEW,          // First copy of this transmission
+    RELAY_DUPLICATE     // Already heard (directly or through another relay)
+};
+
+// RELAY COUNTERS, WRITTEN BY THE LORA STACK ONLY
+struct LoRaRelayStats {
+    std::atomic<uint32_t> scheduled{0};
+    std::atomic<uint32_t> relayed{0};
+    std::atomic<uint32_t> cancelled{0};   // Enough neighbours relayed first
+    std::atomic<uint32_t> dropped{0};     // No pending slot free, or no room in the TX queue
+    std::atomic<uint32_t> duplicates{0};  // Copies dropped by the seen cache
+};
+extern LoRaRelayStats loraRelayStats;
+
+// FUNCTION DECLARATIONS
+LoRaRelayResult relayCheckSeen(const LoRaFrameHeader& header, const uint8_t* frame, size_t frameLen);
+void relayAccept(const LoRaFrameHeader& header, const uint8_t* frame, size_t frameLen, float snr,
+                 uint32_t airtimeMs, bool relayThis, bool directed, unsigned long now);
+LoRaRelayPending* relayNextDue(unsigned long now);
+void relayRelease(LoRaRelayPending& entry);
+
+#endif
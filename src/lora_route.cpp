@@ -0,0 +1,113 @@
+#include "lora_route.h"
+
+// ROUTE TABLE AND BEACON SCHEDULE
+static LoRaRoute routes[ROUTE_MAX_ENTRIES];
+static unsigned long nextBeaconTime = 0;
+static bool beaconScheduled = false;
+
+LoRaRouteStats loraRouteStats;
+
+static bool routeCurrent(const LoRaRoute &route, unsigned long now)
+{
+  return route.active && now - route.updated <= ROUTE_TIMEOUT_MS;
+}
+
+static LoRaRoute *findRoute(uint16_t dstAddress)
+{
+  for (LoRaRoute &route : routes)
+  {
+    if (route.active && route.dstAddress == dstAddress)
+      return &route;
+  }
+  return nullptr;
+}
+
+// A FRAME FROM dstAddress ARRIVED FROM NEIGHBOUR via AFTER hops TRANSMISSIONS - THE REVERSE PATH IS A ROUTE
+// A CHEAPER PATH, A STALE ENTRY OR NEWS FROM THE CURRENT NEXT HOP REPLACES WHAT WE HAVE
+void routeLearn(uint16_t dstAddress, uint16_t via, uint8_t hops, float linkSnrDb, unsigned long now)
+{
+  if (dstAddress == LORA_BROADCAST_ADDRESS)
+    return;
+  uint16_t cost = hops * ROUTE_HOP_COST + (linkSnrDb < ROUTE_WEAK_LINK_DB ? ROUTE_WEAK_LINK_COST : 0);
+
+  LoRaRoute *route = findRoute(dstAddress);
+  if (route)
+  {
+    if (routeCurrent(*route, now) && route->nextHop != via && cost >= route->cost)
+      return;
+  }
+  else
+  {
+    for (LoRaRoute &candidate : routes)
+    {
+      if (!candidate.active)
+      {
+        route = &candidate;
+        break;
+      }
+      if (!route || (long)(candidate.updated - route->updated) < 0)
+        route = &candidate;
+    }
+    route->failures = 0;
+    loraRouteStats.routesLearned++;
+  }
+
+  if (route->nextHop != via || !route->active)
+    Serial.printf("[Route] 0x%04X via 0x%04X, %u hop(s), cost %u\n", dstAddress, via, hops, cost);
+  route->active = true;
+  route->dstAddress = dstAddress;
+  route->nextHop = via;
+  route->hops = hops;
+  route->cost = cost;
+  route->updated = now;
+}
+
+// NEIGHBOUR TO HAND A FRAME FOR dstAddress TO, OR BROADCAST TO FLOOD IT
+uint16_t routeNextHop(uint16_t dstAddress, unsigned long now)
+{
+  const LoRaRoute *route = findRoute(dstAddress);
+  return (route && routeCurrent(*route, now)) ? route->nextHop : LORA_BROADCAST_ADDRESS;
+}
+
+void routeDelivered(uint16_t dstAddress)
+{
+  LoRaRoute *route = findRoute(dstAddress);
+  if (route)
+    route->failures = 0;
+}
+
+// ROUTE REPAIR - AFTER REPEATED TIMEOUTS THE ROUTE IS DROPPED, THE NEXT ATTEMPT FLOODS AND
+// THE ACK COMING BACK OVER THE MESH TEACHES A FRESH PATH
+void routeFailed(uint16_t dstAddress)
+{
+  LoRaRoute *route = findRoute(dstAddress);
+  if (!route || ++route->failures < ROUTE_REPAIR_FAILURES)
+    return;
+  Serial.printf("[Route] 0x%04X via 0x%04X failed %u times, flooding until rediscovered\n",
+                dstAddress, route->nextHop, route->failures);
+  route->active = false;
+  loraRouteStats.routesRepaired++;
+}
+
+// TIME TO ANNOUNCE OURSELVES, RESCHEDULES THE NEXT BEACON WHEN IT RETURNS TRUE
+bool routeBeaconDue(unsigned long now)
+{
+  if (!beaconScheduled)
+  {
+    // THE FIRST BEACON GOES OUT SHORTLY AFTER BOOT, NOT A FULL INTERVAL LATER
+    nextBeaconTime = now + esp_random() % ROUTE_BEACON_JITTER_MS;
+    beaconScheduled = true;
+    return false;
+  }
+  if ((long)(now - nextBeaconTime) < 0)
+    return false;
+  nextBeaconTime = now + ROUTE_BEACON_INTERVAL_MS + esp_random() % ROUTE_BEACON_JITTER_MS;
+  return true;
+}
+
+const LoRaRoute *routeAt(size_t index)
+{
+  if (index >= ROUTE_MAX_ENTRIES || !routes[index].active)
+    return nullptr;
+  return &routes[index];
+}
@@ -0,0 +1,47 @@
+#ifndef LORA_ROUTE_H
+#define LORA_ROUTE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "lora_packet.h"
+
+// ROUTING CONFIGURATION
+#define ROUTE_MAX_ENTRIES 16
+#define ROUTE_TIMEOUT_MS 900000UL        // Forget a route not refreshed by traffic or beacons for this long
+#define ROUTE_BEACON_INTERVAL_MS 300000UL
+#define ROUTE_BEACON_JITTER_MS 30000UL   // Random extra delay so neighbours do not beacon in step
+#define ROUTE_HOP_COST 10
+#define ROUTE_WEAK_LINK_DB 0.0f          // First hop heard below this (normalised to full power) ...
+#define ROUTE_WEAK_LINK_COST 5           // ... costs this much extra
+#define ROUTE_REPAIR_FAILURES 2          // ACK timeouts along a route before it is dropped and rediscovered by flooding
+
+// ONE DESTINATION REACHED THROUGH A NEIGHBOUR (PRE-ALLOCATED)
+struct LoRaRoute {
+    bool active;
+    uint16_t dstAddress;
+    uint16_t nextHop;
+    uint8_t hops;
+    uint16_t cost;
+    unsigned long updated;
+    uint8_t failures;       // ACK timeouts since the route last delivered
+};
+
+// ROUTING COUNTERS, WRITTEN BY THE LORA STACK ONLY
+struct LoRaRouteStats {
+    std::atomic<uint32_t> beaconsSent{0};
+    std::atomic<uint32_t> routesLearned{0};
+    std::atomic<uint32_t> routesRepaired{0};  // Dropped after repeated ACK failure
+    std::atomic<uint32_t> forwarded{0};       // Frames sent on as the designated next hop
+    std::atomic<uint32_t> notOurHop{0};       // Overheard frames left to their designated next hop
+};
+extern LoRaRouteStats loraRouteStats;
+
+// FUNCTION DECLARATIONS
+void routeLearn(uint16_t dstAddress, uint16_t via, uint8_t hops, float linkSnrDb, unsigned long now);
+uint16_t routeNextHop(uint16_t dstAddress, unsigned long now);
+void routeDelivered(uint16_t dstAddress);
+void routeFailed(uint16_t dstAddress);
+bool routeBeaconDue(unsigned long now);
+const LoRaRoute* routeAt(size_t index);
+
+#endif
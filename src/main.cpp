@@ -3,7 +3,6 @@
 #include "display_manager.h"
 #include "lora_manager.h"
 #include "web_manager.h"
-#include <ArduinoJson.h> 
 
 // BUTTON CONFIGURATION
 #define BUTTON_PIN 0
@@ -23,22 +22,16 @@ void IRAM_ATTR onButtonPressed() {
 }
 
 // CALLBACK WHEN A VALID PEER DATA MESSAGE IS RECEIVED
-void onLoRaPacketReceivedForWeb(const String& senderId, const String& message) {
-    Serial.printf("[MainApp] LoRa RX from %s: '%s'. Forwarding to WebSocket.\n", senderId.c_str(), message.c_str());
+void onLoRaPacketReceivedForWeb(const char* senderId, const char* message, size_t messageLen) {
+    Serial.printf("[MainApp] LoRa RX from %s: '%s'. Forwarding to WebSocket.\n", senderId, message);
     setLastLoRaRx(message); // Update display with the received message
-
-    JsonDocument doc; 
-    doc["sender"] = senderId;
-    doc["text"] = message;
-    String jsonMessage;
-    serializeJson(doc, jsonMessage);
-    sendWebSocketMessage(jsonMessage); 
+    sendLoRaTextToWebSocket(senderId, message, messageLen);
 }
 
 // CALLBACK WHEN A LORA ACK STATUS IS UPDATED TO WEB
-void onLoraAckStatusUpdateToWeb(const String& localWebId, uint32_t loraMessageId, bool acked, bool finalFailure) {
+void onLoraAckStatusUpdateToWeb(const char* localWebId, uint32_t loraMessageId, bool acked, bool finalFailure) {
     Serial.printf("[MainApp] LoRa ACK Status for MSG_ID: %u (WebLocalID: %s) -> Acked: %s, FinalFail: %s\n", 
-                  loraMessageId, localWebId.c_str(), acked ? "Yes" : "No", finalFailure ? "Yes" : "No");
+                  loraMessageId, localWebId, acked ? "Yes" : "No", finalFailure ? "Yes" : "No");
     
     sendLoraAckStatusToWebSocket(localWebId, loraMessageId, acked, finalFailure);
 }
@@ -48,8 +41,8 @@ void onWebSocketConnectionChanged(bool connected) {
     setDisplayWebSocketStatus(connected);
 }
 
-void onLoRaMessageSentFromUI(const String& message) {
-    Serial.printf("[MainApp] LoRa message sent from UI: %s\n", message.c_str());
+void onLoRaMessageSentFromUI(const char* message) {
+    Serial.printf("[MainApp] LoRa message sent from UI: %s\n", message);
     setLastLoRaTx(message);
 }
 
@@ -68,12 +61,12 @@ void setup() {
   attachInterrupt(digitalPinToInterrupt(BUTTON_PIN), onButtonPressed, FALLING);
 
   Serial.println(F("[Setup] Initializing LoRa Module..."));
-  // Pass Device ID, Packet Prefix, and callbacks to LoRa Manager
-  setupLoRa(MY_DEVICE_ID, LORA_PACKET_PREFIX, onLoRaPacketReceivedForWeb, onLoraAckStatusUpdateToWeb);
+  // Pass Node Address and callbacks to LoRa Manager
+  setupLoRa(MY_NODE_ADDRESS, onLoRaPacketReceivedForWeb, onLoraAckStatusUpdateToWeb);
 
   Serial.println(F("[Setup] Initializing Web Server Module..."));
-  // Pass Device ID, LoRa Prefix (for sending from UI), and AP credentials from config.h
-  setupWebServer(MY_DEVICE_ID, LORA_PACKET_PREFIX, WIFI_SSID, WIFI_PASSWORD);
+  // Pass Device ID and AP credentials from config.h
+  setupWebServer(MY_DEVICE_ID, WIFI_SSID, WIFI_PASSWORD);
   setDisplayAPIP(WiFi.softAPIP().toString());
   
   Serial.println(F("[Setup] System Setup Complete. Ready."));
@@ -92,10 +85,10 @@ void loop() {
     setDisplayStatusLine("Button: Sending...");
     
     // SEND "IM ALIVE" MESSAGE VIA LORA
-    String aliveMessage = "im alive";
-    bool queued = queueLoRaMessage(aliveMessage, MY_DEVICE_ID, LORA_PACKET_PREFIX, "button_msg");
+    const char* aliveMessage = "im alive";
+    LoRaSubmitResult result = submitLoRaMessage(aliveMessage, "button_msg", LORA_BROADCAST_ADDRESS);
     
-    if (queued) {
+    if (result == LORA_SUBMIT_OK) {
       Serial.println(F("[Button] 'im alive' message queued successfully"));
       setLastLoRaTx(aliveMessage);
       setDisplayStatusLine("Button: Sent OK");
@@ -105,7 +98,7 @@ void loop() {
     }
   }
 
-  handleLoRaEvents(MY_DEVICE_ID, LORA_PACKET_PREFIX);
+  handleLoRaEvents();
 
   if (millis() - lastWifiClientCheck > WIFI_CLIENT_CHECK_INTERVAL) {
     int numClients = WiFi.softAPgetStationNum();
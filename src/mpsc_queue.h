@@ -0,0 +1,74 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// BOUNDED LOCK-FREE MULTI-PRODUCER / SINGLE-CONSUMER QUEUE
+// Each cell carries a sequence number that tells producers whether it is free
+// and the consumer whether it has been published (Vyukov's bounded queue).
+// Producers never wait on each other: push() either claims a cell with one
+// CAS or reports the queue as full. Any number of tasks may push(), exactly
+// one task may pop().
+template <typename T, size_t N>
+class MpscQueue {
+public:
+    static_assert(N > 1 && (N & (N - 1)) == 0, "MpscQueue capacity must be a power of two");
+
+    MpscQueue() {
+        for (size_t i = 0; i < N; i++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // PRODUCERS: COPY ITEM IN, RETURNS FALSE WHEN THE QUEUE IS FULL
+    bool push(const T& item) {
+        Cell* cell;
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & (N - 1)];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = item;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // CONSUMER: COPY THE OLDEST ITEM OUT, RETURNS FALSE WHEN EMPTY
+    bool pop(T& out) {
+        Cell* cell = &cells_[dequeuePos_ & (N - 1)];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(dequeuePos_ + 1) < 0) {
+            return false;
+        }
+        out = cell->data;
+        cell->sequence.store(dequeuePos_ + N, std::memory_order_release);
+        dequeuePos_++;
+        return true;
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    Cell cells_[N];
+    std::atomic<size_t> enqueuePos_{0};
+    size_t dequeuePos_ = 0; // Consumer only
+};
+
+#endif
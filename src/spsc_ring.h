@@ -0,0 +1,61 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+
+// FIXED-SIZE SINGLE-PRODUCER / SINGLE-CONSUMER RING OF PRE-ALLOCATED SLOTS
+// The producer fills a slot in place with acquire()/commit() and the consumer
+// reads it in place with peek()/release(), so frames are never copied or
+// allocated. Safe across tasks as long as each side has exactly one caller.
+template <typename T, size_t N>
+class SpscRing {
+public:
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+    // PRODUCER: NEXT FREE SLOT, OR NULLPTR WHEN FULL
+    T* acquire() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= N) {
+            return nullptr;
+        }
+        return &slots_[head & (N - 1)];
+    }
+
+    // PRODUCER: PUBLISH THE SLOT RETURNED BY acquire()
+    void commit() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // CONSUMER: OLDEST PUBLISHED SLOT, OR NULLPTR WHEN EMPTY
+    T* peek() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots_[tail & (N - 1)];
+    }
+
+    // CONSUMER: HAND THE SLOT RETURNED BY peek() BACK TO THE PRODUCER
+    void release() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    // RUNNING COUNTS OF COMMITTED AND RELEASED SLOTS - SLOT NUMBER n (COUNTING COMMITS) HAS BEEN
+    // CONSUMED ONCE released() HAS PASSED n
+    size_t committed() const { return head_.load(std::memory_order_acquire); }
+    size_t released() const { return tail_.load(std::memory_order_acquire); }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    T slots_[N];
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+};
+
+#endif
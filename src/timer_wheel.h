@@ -0,0 +1,111 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// HASHED TIMER WHEEL OVER A FIXED SET OF TIMER IDS (0 .. CAPACITY-1)
+// Each ID is an intrusive node in the bucket for its deadline tick, so
+// schedule() and cancel() are O(1) and advance() only visits the buckets
+// that elapsed. Deadlines further out than one revolution stay in their
+// bucket until the wheel comes around again. Times are millis() values;
+// ticks are counted from the time the current one began, never derived from
+// the clock itself, so the wheel keeps turning when millis() wraps.
+template <size_t CAPACITY, size_t BUCKETS, unsigned long TICK_MS>
+class TimerWheel {
+public:
+    static_assert(CAPACITY < 0xFFFF, "TimerWheel capacity must fit in 16 bits");
+    static_assert(BUCKETS > 0 && (BUCKETS & (BUCKETS - 1)) == 0, "TimerWheel bucket count must be a power of two");
+
+    static const uint16_t NONE = 0xFFFF;
+
+    TimerWheel() {
+        for (size_t i = 0; i < BUCKETS; i++) heads_[i] = NONE;
+        for (size_t i = 0; i < CAPACITY; i++) {
+            next_[i] = prev_[i] = NONE;
+            scheduled_[i] = false;
+        }
+    }
+
+    // ARM (OR RE-ARM) TIMER ID TO FIRE AT DEADLINE
+    void schedule(uint16_t id, unsigned long deadline) {
+        if (scheduled_[id]) cancel(id);
+        if (!started_) {
+            tickStart_ = deadline;
+            started_ = true;
+        }
+        // NEVER FILE INTO A BUCKET THE WHEEL HAS ALREADY PASSED
+        long ahead = (long)(deadline - tickStart_);
+        unsigned long tick = currentTick_ + (ahead > 0 ? (unsigned long)ahead / TICK_MS : 0);
+        size_t bucket = tick & (BUCKETS - 1);
+
+        deadline_[id] = deadline;
+        prev_[id] = NONE;
+        next_[id] = heads_[bucket];
+        if (heads_[bucket] != NONE) prev_[heads_[bucket]] = id;
+        heads_[bucket] = id;
+        bucket_[id] = (uint16_t)bucket;
+        scheduled_[id] = true;
+    }
+
+    void cancel(uint16_t id) {
+        if (!scheduled_[id]) return;
+        if (prev_[id] != NONE) next_[prev_[id]] = next_[id];
+        else heads_[bucket_[id]] = next_[id];
+        if (next_[id] != NONE) prev_[next_[id]] = prev_[id];
+        next_[id] = prev_[id] = NONE;
+        scheduled_[id] = false;
+    }
+
+    bool isScheduled(uint16_t id) const { return scheduled_[id]; }
+
+    unsigned long deadline(uint16_t id) const { return deadline_[id]; }
+
+    // FIRE EVERY TIMER DUE BY NOW, onExpire(id) MAY RE-ARM OR CANCEL ANY ID, A RE-ARMED
+    // DEADLINE MUST BE LATER THAN now
+    template <typename F>
+    void advance(unsigned long now, F onExpire) {
+        if (!started_) return;
+        long elapsed = (long)(now - tickStart_);
+        unsigned long ticks = elapsed > 0 ? (unsigned long)elapsed / TICK_MS : 0;
+        // A LONG STALL ONLY NEEDS ONE FULL REVOLUTION TO SEE EVERY BUCKET
+        if (ticks >= BUCKETS) {
+            unsigned long skipped = ticks - (BUCKETS - 1);
+            currentTick_ += skipped;
+            tickStart_ += skipped * TICK_MS;
+            ticks = BUCKETS - 1;
+        }
+
+        for (;;) {
+            size_t bucket = currentTick_ & (BUCKETS - 1);
+            uint16_t id = heads_[bucket];
+            while (id != NONE) {
+                if ((long)(now - deadline_[id]) < 0) {
+                    id = next_[id];
+                    continue;
+                }
+                cancel(id);
+                onExpire(id);
+                // THE CALLBACK MAY HAVE UNLINKED OR MOVED ANY NODE OF THIS BUCKET, SO WALK IT AGAIN
+                id = heads_[bucket];
+            }
+            if (ticks == 0) break;
+            currentTick_++;
+            tickStart_ += TICK_MS;
+            ticks--;
+        }
+    }
+
+private:
+    uint16_t heads_[BUCKETS];
+    uint16_t next_[CAPACITY];
+    uint16_t prev_[CAPACITY];
+    uint16_t bucket_[CAPACITY];
+    unsigned long deadline_[CAPACITY];
+    bool scheduled_[CAPACITY];
+    unsigned long currentTick_ = 0;
+    unsigned long tickStart_ = 0;   // millis() at which currentTick_ began
+    bool started_ = false;
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include "web_history.h"
+#include <atomic>
+
+// EVENTS ARE STORED AS THE JSON SENT TO CLIENTS, BACK TO BACK: SEQUENCE (4), LENGTH (2), JSON
+// A RECORD NEVER WRAPS - WHEN THE END IS TOO CLOSE A WRAP MARKER (LENGTH 0xFFFF) SENDS READERS BACK TO 0
+#define HISTORY_WRAP_MARKER 0xFFFF
+#define HISTORY_AT_HEAD SIZE_MAX    // Offset of a cursor waiting for an event not yet stored
+
+static uint8_t* historyBuffer = nullptr;
+static size_t historyCapacity = 0;
+static size_t tailOffset = 0;       // Oldest record
+static size_t headOffset = 0;       // Where the next record goes
+static size_t newestOffset = 0;     // Newest record
+static size_t recordCount = 0;
+static uint32_t oldestSeq = 1;
+static uint32_t nextSeq = 1;        // Sequence numbers start at 1, a client that saw nothing sends 0
+static uint32_t bootHistoryId = 0;  // Tells a client whether its sequence numbers still mean anything here
+
+// COPIES OF THE ABOVE FOR OTHER TASKS, WRITTEN BY THE LOOP TASK ONCE AN APPEND IS COMPLETE
+static std::atomic<uint32_t> publishedHeadSeq{0};
+static std::atomic<uint32_t> publishedOldestSeq{1};
+static std::atomic<uint32_t> publishedBytes{0};
+
+static uint16_t recordLenAt(size_t offset) {
+    return (uint16_t)historyBuffer[offset + 4] | ((uint16_t)historyBuffer[offset + 5] << 8);
+}
+
+// START OF THE RECORD AFTER THE ONE AT offset, FOLLOWING A WRAP MARKER OR THE END OF THE BUFFER BACK TO 0
+static size_t followingRecord(size_t offset) {
+    offset += WEB_HISTORY_RECORD_HEADER + recordLenAt(offset);
+    if (offset + WEB_HISTORY_RECORD_HEADER > historyCapacity || recordLenAt(offset) == HISTORY_WRAP_MARKER) return 0;
+    return offset;
+}
+
+// WHERE THE RECORD FOR A SEQUENCE NUMBER THE RING HOLDS STARTS
+static size_t offsetOf(uint32_t seq) {
+    if (seq == nextSeq - 1) return newestOffset;
+    size_t offset = tailOffset;
+    for (uint32_t at = oldestSeq; at != seq; at++) offset = followingRecord(offset);
+    return offset;
+}
+
+static void publishState() {
+    publishedOldestSeq = oldestSeq;
+    publishedHeadSeq = nextSeq - 1;
+    size_t bytes = 0;
+    if (recordCount) bytes = headOffset > tailOffset ? headOffset - tailOffset : historyCapacity - tailOffset + headOffset;
+    publishedBytes = (uint32_t)bytes;
+}
+
+static void evictOldest() {
+    recordCount--;
+    oldestSeq++;
+    tailOffset = recordCount ? followingRecord(tailOffset) : headOffset;
+}
+
+// ALLOCATE THE RING ONCE - PSRAM HOLDS A LONG HISTORY, INTERNAL RAM ONLY THE LAST FEW DOZEN MESSAGES
+void historySetup() {
+    if (psramFound()) {
+        historyBuffer = (uint8_t*)ps_malloc(WEB_HISTORY_PSRAM_BYTES);
+        historyCapacity = WEB_HISTORY_PSRAM_BYTES;
+    }
+    if (!historyBuffer) {
+        historyBuffer = (uint8_t*)malloc(WEB_HISTORY_RAM_BYTES);
+        historyCapacity = historyBuffer ? WEB_HISTORY_RAM_BYTES : 0;
+    }
+    do { bootHistoryId = esp_random(); } while (bootHistoryId == 0);
+    Serial.printf("[History] %u byte ring in %s, id %08X\n", (unsigned)historyCapacity,
+                  historyCapacity == WEB_HISTORY_PSRAM_BYTES ? "PSRAM" : "RAM", bootHistoryId);
+}
+
+// SET BEFORE THE WEB SERVER STARTS, NEVER CHANGED AFTER
+uint32_t historyId() { return bootHistoryId; }
+uint32_t historyNextSeq() { return nextSeq; }
+uint32_t historyHeadSeq() { return publishedHeadSeq; }
+uint32_t historyOldestSeq() { return publishedOldestSeq; }
+size_t historyBytes() { return publishedBytes; }
+
+// STORE AN EVENT UNDER historyNextSeq(), EVICTING THE OLDEST ONES AS NEEDED, RETURNS ITS SEQUENCE NUMBER
+// THE EVENT IS EXPECTED TO CARRY THAT SEQUENCE NUMBER ITSELF SO CLIENTS CAN ORDER WHAT THEY RECEIVE
+uint32_t historyAppend(const char* event, size_t len) {
+    size_t need = WEB_HISTORY_RECORD_HEADER + len;
+    if (!historyBuffer || need > historyCapacity || len >= HISTORY_WRAP_MARKER) {
+        // THE RING ONLY EVER HOLDS CONSECUTIVE SEQUENCE NUMBERS, SO AN EVENT IT CANNOT HOLD EMPTIES IT
+        recordCount = 0;
+        tailOffset = headOffset;
+        oldestSeq = nextSeq + 1;
+        nextSeq++;
+        publishState();
+        return nextSeq - 1;
+    }
+
+    if (headOffset + need > historyCapacity) {
+        // THE RECORDS BETWEEN HEAD AND THE END ARE THE OLDEST - THEY GO BEFORE HEAD JUMPS BACK TO 0
+        while (recordCount && tailOffset >= headOffset) evictOldest();
+        if (headOffset + WEB_HISTORY_RECORD_HEADER <= historyCapacity) {
+            historyBuffer[headOffset + 4] = (uint8_t)HISTORY_WRAP_MARKER;
+            historyBuffer[headOffset + 5] = (uint8_t)(HISTORY_WRAP_MARKER >> 8);
+        }
+        headOffset = 0;
+        if (recordCount == 0) tailOffset = 0;
+    }
+    while (recordCount && tailOffset >= headOffset && tailOffset < headOffset + need) evictOldest();
+
+    uint8_t* record = historyBuffer + headOffset;
+    record[0] = (uint8_t)nextSeq;
+    record[1] = (uint8_t)(nextSeq >> 8);
+    record[2] = (uint8_t)(nextSeq >> 16);
+    record[3] = (uint8_t)(nextSeq >> 24);
+    record[4] = (uint8_t)len;
+    record[5] = (uint8_t)(len >> 8);
+    memcpy(record + WEB_HISTORY_RECORD_HEADER, event, len);
+    newestOffset = headOffset;
+    if (recordCount == 0) {
+        tailOffset = headOffset;
+        oldestSeq = nextSeq;
+    }
+    headOffset += need;
+    recordCount++;
+    nextSeq++;
+    publishState();
+    return nextSeq - 1;
+}
+
+// CURSOR FOR A CLIENT THAT HAS SEEN EVERYTHING UP TO lastSeenSeq - ANYTHING OLDER THAN THE RING
+// STARTS AT THE OLDEST EVENT STILL HELD
+WebHistoryCursor historySeek(uint32_t lastSeenSeq) {
+    uint32_t seq = lastSeenSeq + 1;
+    if ((int32_t)(seq - oldestSeq) < 0) seq = oldestSeq;
+    if ((int32_t)(seq - nextSeq) >= 0) return {nextSeq, HISTORY_AT_HEAD};
+    return {seq, offsetOf(seq)};
+}
+
+// THE EVENT AT THE CURSOR, OR nullptr ONCE IT HAS REACHED THE HEAD - A CURSOR THE RING HAS OVERTAKEN
+// SKIPS TO THE OLDEST EVENT FIRST (THE CLIENT SEES THE JUMP IN SEQUENCE NUMBERS)
+// A CURSOR THAT WAS AT THE HEAD FINDS ITS EVENT ONLY NOW: WHERE THE HEAD WAS THEN SAYS NOTHING ONCE
+// THE APPEND THAT STORED IT HAS WRAPPED BACK TO 0
+const char* historyPeek(WebHistoryCursor& cursor, uint16_t* len) {
+    if ((int32_t)(cursor.seq - oldestSeq) < 0) cursor = {oldestSeq, HISTORY_AT_HEAD};
+    if (cursor.seq == nextSeq) return nullptr;
+    if (cursor.offset == HISTORY_AT_HEAD) cursor.offset = offsetOf(cursor.seq);
+    *len = recordLenAt(cursor.offset);
+    return (const char*)historyBuffer + cursor.offset + WEB_HISTORY_RECORD_HEADER;
+}
+
+// MOVE A CURSOR historyPeek() RETURNED AN EVENT FOR TO THE NEXT ONE
+void historyAdvance(WebHistoryCursor& cursor) {
+    cursor.seq++;
+    cursor.offset = (cursor.seq == nextSeq) ? HISTORY_AT_HEAD : followingRecord(cursor.offset);
+}
@@ -0,0 +1,33 @@
+#ifndef WEB_HISTORY_H
+#define WEB_HISTORY_H
+
+#include <Arduino.h>
+
+// NODE-SIDE CHAT HISTORY CONFIGURATION
+#define WEB_HISTORY_PSRAM_BYTES (256 * 1024)   // Ring size on boards with PSRAM
+#define WEB_HISTORY_RAM_BYTES (16 * 1024)      // Ring size in internal RAM otherwise
+#define WEB_HISTORY_RECORD_HEADER 6            // Sequence number (4), event length (2)
+
+// WHERE A CLIENT'S CATCH-UP HAS GOT TO - THE NEXT SEQUENCE NUMBER IT NEEDS AND WHERE THAT RECORD LIVES
+// (LOOKED UP ONLY ONCE IT IS STORED WHILE THE CURSOR WAITS AT THE HEAD)
+struct WebHistoryCursor {
+    uint32_t seq;
+    size_t offset;
+};
+
+// FUNCTION DECLARATIONS (LOOP TASK ONLY)
+void historySetup();
+uint32_t historyNextSeq();
+uint32_t historyAppend(const char* event, size_t len);
+WebHistoryCursor historySeek(uint32_t lastSeenSeq);
+const char* historyPeek(WebHistoryCursor& cursor, uint16_t* len);
+void historyAdvance(WebHistoryCursor& cursor);
+
+// ANY TASK - WHAT THE LOOP TASK PUBLISHED AFTER ITS LAST APPEND (THE ASYNC TCP TASK READS THESE
+// FOR THE IDENTITY MESSAGE AND /diag)
+uint32_t historyId();
+uint32_t historyHeadSeq();
+uint32_t historyOldestSeq();
+size_t historyBytes();
+
+#endif
@@ -1,8 +1,12 @@
 #include "web_manager.h"
 #include "display_manager.h" 
 #include "lora_manager.h"    
+#include "mpsc_queue.h"
+#include "web_assets.h"
+#include "web_history.h"
 #include <WiFi.h>
 #include <ArduinoJson.h>
+#include <atomic>
 #include "config.h" 
 
 AsyncWebServer server(80);
@@ -10,264 +14,421 @@ AsyncWebSocket ws("/ws");
 
 //STATIC VARIABLES 
 static String currentMyDeviceId_web;
-static String currentLoraPacketPrefix_web;
 static String currentBoardName_web;
 
-
-// HTML WEB PAGE 
-const char index_html[] PROGMEM = R"rawliteral(
-<!DOCTYPE html>
-<html lang="en">
-<head>
-    <meta charset="UTF-8">
-    <meta name="viewport" content="width=device-width, initial-scale=1.0">
-    <title>LoRa Messenger Node</title> <!-- Generic Title -->
-    <style>
-        body { font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif; margin: 0; padding: 0; background-color: #f0f2f5; display: flex; flex-direction: column; height: 100vh; color: #333; }
-        .chat-container { display: flex; flex-direction: column; flex-grow: 1; max-width: 800px; width: 100%; margin: 0 auto; background-color: #fff; box-shadow: 0 0 15px rgba(0,0,0,0.1); overflow: hidden; border-radius: 8px; }
-        header { background-color: #007bff; color: white; padding: 12px 20px; text-align: center; font-size: 1.3em; box-shadow: 0 2px 5px rgba(0,0,0,0.1); z-index: 10; display: flex; justify-content: space-between; align-items: center; }
-        header .title { flex-grow: 1; text-align: center; }
-        #connectionStatus { width: 12px; height: 12px; border-radius: 50%; display: inline-block; margin-left: 10px; transition: background-color 0.3s ease; }
-        .status-connected { background-color: #28a745; } .status-disconnected { background-color: #dc3545; } .status-connecting { background-color: #ffc107; }
-        #chatbox { flex-grow: 1; overflow-y: auto; padding: 20px; background-color: #e9ecef; display: flex; flex-direction: column; }
-        .message { padding: 10px 15px; margin-bottom: 12px; border-radius: 18px; line-height: 1.5; max-width: 75%; word-wrap: break-word; position: relative; display: flex; flex-direction: column; }
-        .message .sender-info { font-size: 0.8em; font-weight: bold; margin-bottom: 4px; color: #495057; }
-        .message .timestamp { font-size: 0.7em; color: #888; margin-top: 5px; text-align: right; }
-        .sent { background-color: #007bff; color: white; align-self: flex-end; border-bottom-right-radius: 5px; }
-        .sent .sender-info { color: #e0e0e0; } .sent .timestamp { color: #e0e0e0; }
-        .received { background-color: #f8f9fa; color: #333; align-self: flex-start; border: 1px solid #dee2e6; border-bottom-left-radius: 5px; }
-        .received .sender-info { color: #007bff; } .received .timestamp { color: #6c757d; }
-        .system-message { font-style: italic; color: #6c757d; text-align: center; font-size: 0.9em; margin: 10px 0; padding: 5px; width: 100%; align-self: center; background-color: #f8f9fa; border-radius: 4px; }
-        #controls { display: flex; padding: 15px; background-color: #fff; border-top: 1px solid #dee2e6; }
-        #messageInput { flex-grow: 1; padding: 12px 15px; border: 1px solid #ced4da; border-radius: 20px; margin-right: 10px; font-size: 1em; outline: none; }
-        #messageInput:focus { border-color: #007bff; box-shadow: 0 0 0 0.2rem rgba(0,123,255,.25); }
-        #sendButton, #clearChatButton { padding: 12px 20px; color: white; border: none; cursor: pointer; border-radius: 20px; font-size: 1em; transition: background-color 0.2s ease; }
-        #sendButton { background-color: #007bff; } #sendButton:hover { background-color: #0056b3; }
-        #clearChatButton { margin-left: 10px; background-color: #6c757d; } #clearChatButton:hover { background-color: #5a6268; }
-        #chatbox::-webkit-scrollbar { width: 8px; } #chatbox::-webkit-scrollbar-track { background: #f1f1f1; }
-        #chatbox::-webkit-scrollbar-thumb { background: #007bff; border-radius: 4px; } #chatbox::-webkit-scrollbar-thumb:hover { background: #0056b3; }
-        .typing-indicator { font-style: italic; color: #6c757d; padding: 5px 20px; font-size: 0.9em; height: 20px; }
-        
-        /* ACK Status Styling - Applied to the message div directly */
-        .message.status-acked { background-color: #d4edda !important; border-color: #c3e6cb !important; color: #155724 !important; }
-        .message.status-acked .sender-info, .message.status-acked .timestamp { color: #0c5460 !important; }
-        .message.status-failed-ack { background-color: #f8d7da !important; border-color: #f5c6cb !important; color: #721c24 !important; }
-        .message.status-failed-ack .sender-info, .message.status-failed-ack .timestamp { color: #721c24 !important; }
-        .message.status-pending-ack { background-color: #fff3cd !important; border-color: #ffeeba !important; color: #856404 !important; }
-        .message.status-pending-ack .sender-info, .message.status-pending-ack .timestamp { color: #856404 !important; }
-
-        @media (max-width: 600px) { /* Responsive adjustments */
-            .chat-container { max-width: 100vw; border-radius: 0; box-shadow: none; margin: 0; } #chatbox { padding: 8px; }
-            #controls { flex-direction: column; padding: 8px; } #messageInput { margin-right: 0; margin-bottom: 8px; font-size: 1em; }
-            #sendButton, #clearChatButton { width: 100%; font-size: 1em; padding: 12px 0; }
-            #clearChatButton { margin-left: 0; margin-top: 8px;} header { font-size: 1em; padding: 10px 8px; }
-        }
-    </style>
-</head>
-<body>
-    <div class="chat-container">
-        <header><span class="title" id="pageTitle">LoRa Messenger</span><span id="connectionStatus" title="Connection Status"></span></header>
-        <div id="chatbox"></div>
-        <div class="typing-indicator" id="typingIndicator"></div>
-        <div id="controls">
-            <input type="text" id="messageInput" placeholder="Type a message...">
-            <button id="sendButton">Send</button>
-            <button id="clearChatButton">Clear Chat</button>
-        </div>
-    </div>
-    <script>
-        const chatbox = document.getElementById('chatbox');
-        const messageInput = document.getElementById('messageInput');
-        const sendButton = document.getElementById('sendButton');
-        const connectionStatusElement = document.getElementById('connectionStatus');
-        const pageTitleElement = document.getElementById('pageTitle');
-        let websocket;
-        let myDeviceId = 'UnknownDevice';
-        let boardName = 'Node';
-
-        function generateLocalId() { return 'local_msg_' + Date.now() + '_' + Math.random().toString(36).substr(2, 5); }
-        function getCurrentTime() { return new Date().toLocaleTimeString([], { hour: '2-digit', minute: '2-digit' }); }
-
-        function updateConnectionStatus(status) {
-            connectionStatusElement.className = ''; 
-            let statusTitle = 'Connection Status';
-            if (status === 'connected') { connectionStatusElement.classList.add('status-connected'); statusTitle = 'Connected to ' + boardName; }
-            else if (status === 'disconnected') { connectionStatusElement.classList.add('status-disconnected'); statusTitle = 'Disconnected from ' + boardName; }
-            else { connectionStatusElement.classList.add('status-connecting'); statusTitle = 'Connecting to ' + boardName + '...'; }
-            connectionStatusElement.title = statusTitle;
+// OUTGOING EVENT JSON IS BUILT HERE, NOT ON THE HEAP - LOOP TASK ONLY
+// (SIZED FOR THE WORST CASE: EVERY TEXT AND LOCAL ID BYTE ESCAPED AS \u00XX)
+#define WS_JSON_BUFFER_LEN (6 * (LORA_MAX_MESSAGE_LEN + LORA_LOCAL_ID_MAX_LEN) + 128)
+static char wsJsonBuffer[WS_JSON_BUFFER_LEN];
+
+// CLIENT CATCH-UP FROM THE NODE'S HISTORY RING - HELLOS AND ECHOES OF SENT MESSAGES ARRIVE FROM THE
+// ASYNC TCP TASK AND ARE APPLIED IN THE LOOP TASK, WHICH OWNS THE RING
+#define WEB_MAX_CLIENTS 8
+#define WEB_SENT_ECHO_QUEUE_LEN 4
+#define WEB_HISTORY_BATCH_LEN (WS_JSON_BUFFER_LEN + 128) // Always room for the largest single event
+
+// OUTBOUND BACKPRESSURE - A CLIENT THAT HAS THIS MUCH QUEUED GETS NO MORE LIVE FRAMES, IT CATCHES UP FROM
+// THE RING ONCE IT HAS DRAINED, SO ONE SLOW PHONE HOLDS AT MOST THIS MUCH HEAP IN ASYNCTCP'S QUEUES
+#define WEB_CLIENT_BYTE_BUDGET 8192
+#define WEB_CLIENT_TRACKED_FRAMES 32        // Latest frame sizes kept per client to work out its queued bytes
+#define WEB_COALESCE_LOOKAHEAD 32           // Events a catch-up looks ahead for a newer status of the same message
+struct WebHello {
+    uint32_t clientId;
+    uint32_t historyId;     // The node boot the client's sequence numbers belong to
+    uint32_t lastSeq;
+    bool binary;            // Live events as binary frames instead of JSON
+};
+struct WebSentEcho {
+    char text[LORA_MAX_MESSAGE_LEN + 1];
+    char localWebId[LORA_LOCAL_ID_MAX_LEN + 1];
+    uint16_t dstAddress;
+};
+// A CLIENT THAT HAS SAID HELLO - ONLY THESE GET LIVE EVENTS, A CLIENT IS ALWAYS CAUGHT UP FROM THE RING FIRST
+// (ONLY THE LOOP TASK WRITES A SLOT, THE ATOMICS ARE ALSO READ BY /diag ON THE ASYNC TCP TASK)
+struct WebClient {
+    std::atomic<bool> active{false};
+    std::atomic<uint32_t> id{0};
+    std::atomic<bool> binary{false};
+    std::atomic<bool> resyncing{false};     // Still reading the ring, live events reach it that way until it catches up
+    WebHistoryCursor cursor;
+    uint16_t frameLens[WEB_CLIENT_TRACKED_FRAMES];  // Frames handed to AsyncWebSocket, a ring ending before frameNext
+    uint8_t frameNext;
+    uint8_t framesQueued;   // How many of those are still in its queue
+    std::atomic<uint32_t> queueLen{0};
+    std::atomic<uint32_t> queuedBytes{0};
+    std::atomic<uint32_t> bytesSent{0};
+    std::atomic<uint32_t> catchUps{0};      // Times it fell behind the budget and was moved to catch-up
+    std::atomic<uint32_t> coalesced{0};     // Superseded ACK updates left out of its catch-ups
+};
+static MpscQueue<WebHello, WEB_MAX_CLIENTS> helloQueue;
+static MpscQueue<uint32_t, WEB_MAX_CLIENTS> disconnectQueue;   // Ids of clients that have gone, for the loop task to free
+static MpscQueue<WebSentEcho, WEB_SENT_ECHO_QUEUE_LEN> sentEchoQueue;
+static WebClient webClients[WEB_MAX_CLIENTS];
+static char historyBatch[WEB_HISTORY_BATCH_LEN];
+
+// LIVE EVENTS ARE COALESCED PER LOOP TICK - EACH CLIENT GETS ONE FRAME WITH EVERYTHING THE TICK PRODUCED,
+// {"type":"events","events":[...]} OR, IF ITS HELLO ASKED FOR "binary", THIS (LITTLE-ENDIAN, NO PADDING):
+//   FRAME:  VERSION (1), EVENT COUNT (1), EVENTS
+//   EVENT:  TYPE (1), SEQ (4), THEN BY TYPE
+//     RX:         SENDER LENGTH (1), SENDER, TEXT LENGTH (2), TEXT
+//     ACK STATUS: LOCAL ID LENGTH (1), LOCAL ID, LORA MESSAGE ID (4), STATUS (1)
+//     SENT:       LOCAL ID LENGTH (1), LOCAL ID, TO LENGTH (1), TO, TEXT LENGTH (2), TEXT
+// STRINGS ARE UTF-8 AS RECEIVED, NOTHING IS ESCAPED. HISTORY BATCHES STAY JSON, THE RING HOLDS JSON
+#define WEB_EVENT_FRAME_VERSION 1
+#define WEB_EVENT_RX 1
+#define WEB_EVENT_ACK_STATUS 2
+#define WEB_EVENT_SENT 3
+#define WEB_ACK_PENDING 0
+#define WEB_ACK_ACKED 1
+#define WEB_ACK_FAILED 2
+#define WEB_EVENT_NAME_MAX 255
+#define WEB_EVENT_BINARY_MAX (5 + 1 + LORA_LOCAL_ID_MAX_LEN + 1 + WEB_EVENT_NAME_MAX + 2 + LORA_MAX_MESSAGE_LEN)
+#define WEB_TICK_JSON_LEN (WS_JSON_BUFFER_LEN + 64)            // Always room for the largest single event
+#define WEB_TICK_BINARY_LEN (2 + 2 * WEB_EVENT_BINARY_MAX)
+static char tickJson[WEB_TICK_JSON_LEN];
+static size_t tickJsonLen = 0;          // 0 while the tick has no events for JSON clients
+static uint32_t tickJsonFirstSeq = 0;
+static uint8_t tickBinary[WEB_TICK_BINARY_LEN];
+static size_t tickBinaryLen = 0;        // 0 while the tick has no events for binary clients
+static uint32_t tickBinaryFirstSeq = 0;
+
+// ACK STATUS EVENTS START {"seq":N, FOLLOWED BY THIS - HOW A CATCH-UP SPOTS THEM IN THE RING
+static const char ACK_STATUS_KEY[] = "\"type\":\"ack_status\",\"local_id\":";
+
+// APPEND TEXT AS A QUOTED, ESCAPED JSON STRING, RETURNS THE NEW LENGTH OR 0 IF IT DOES NOT FIT
+static size_t appendJsonString(char* out, size_t outLen, size_t outCapacity, const char* text, size_t textLen) {
+    static const char hexDigits[] = "0123456789abcdef";
+    if (outLen + 2 > outCapacity) return 0;
+    out[outLen++] = '"';
+    for (size_t i = 0; i < textLen; i++) {
+        uint8_t c = (uint8_t)text[i];
+        if (outLen + 7 > outCapacity) return 0;
+        if (c == '"' || c == '\\') { out[outLen++] = '\\'; out[outLen++] = (char)c; }
+        else if (c == '\n') { out[outLen++] = '\\'; out[outLen++] = 'n'; }
+        else if (c == '\r') { out[outLen++] = '\\'; out[outLen++] = 'r'; }
+        else if (c == '\t') { out[outLen++] = '\\'; out[outLen++] = 't'; }
+        else if (c < 0x20) {
+            memcpy(out + outLen, "\\u00", 4); outLen += 4;
+            out[outLen++] = hexDigits[c >> 4];
+            out[outLen++] = hexDigits[c & 0x0F];
         }
+        else { out[outLen++] = (char)c; }
+    }
+    out[outLen++] = '"';
+    return outLen;
+}
 
-        function appendMessage(text, sender, typeOverride = null, localId = null) {
-            const msgDiv = document.createElement('div');
-            let messageType = typeOverride || ((sender === myDeviceId) ? 'sent' : 'received');
-            msgDiv.className = 'message ' + messageType; // Base classes
-            if (localId) { msgDiv.setAttribute('data-local-id', localId); }
-            if (messageType === 'system-message') { msgDiv.classList.remove('message'); }
-
-            const senderInfoSpan = document.createElement('span');
-            senderInfoSpan.className = 'sender-info';
-            if (messageType !== 'system-message') {
-                 senderInfoSpan.textContent = (sender === myDeviceId) ? `Me (${myDeviceId})` : sender;
-                 msgDiv.appendChild(senderInfoSpan);
-            }
-            const contentSpan = document.createElement('span');
-            contentSpan.textContent = text;
-            msgDiv.appendChild(contentSpan);
-
-            const timestampSpan = document.createElement('span');
-            timestampSpan.className = 'timestamp';
-            timestampSpan.textContent = getCurrentTime();
-            msgDiv.appendChild(timestampSpan);
-
-            chatbox.appendChild(msgDiv);
-            chatbox.scrollTop = chatbox.scrollHeight;
-            saveChatToLocalStorage(); // Save after each append
-        }
+// APPEND A LITERAL FRAGMENT, RETURNS THE NEW LENGTH OR 0 IF IT DOES NOT FIT
+static size_t appendJsonRaw(char* out, size_t outLen, size_t outCapacity, const char* raw) {
+    size_t rawLen = strlen(raw);
+    if (outLen == 0 || outLen + rawLen >= outCapacity) return 0;
+    memcpy(out + outLen, raw, rawLen);
+    return outLen + rawLen;
+}
 
-        function updateMessageStatus(localId, status) {
-            const msgDiv = chatbox.querySelector(`div[data-local-id="${localId}"]`);
-            if (msgDiv) {
-                msgDiv.classList.remove('status-pending-ack', 'status-acked', 'status-failed-ack'); // Clear previous ACK statuses
-                // Re-apply base sent/received class if it got removed by status, then add new status
-                if (!msgDiv.classList.contains('sent') && !msgDiv.classList.contains('received') && !msgDiv.classList.contains('system-message')) {
-                    // This case should ideally not happen if classes are managed well, but as a safeguard:
-                    // Determine original type if possible, or default to 'sent' if it has a localId
-                    msgDiv.classList.add(myDeviceId && msgDiv.querySelector('.sender-info')?.textContent.startsWith('Me') ? 'sent' : 'received');
-                }
-                if (status === 'acked') { msgDiv.classList.add('status-acked'); }
-                else if (status === 'failed_ack') { msgDiv.classList.add('status-failed-ack'); }
-                else if (status === 'pending_ack') { msgDiv.classList.add('status-pending-ack'); }
-                saveChatToLocalStorage(); // Save after status update
-            } else { console.warn(`Could not find message with local_id ${localId} to update status.`); }
-        }
+// OPEN A SEQUENCED EVENT IN wsJsonBuffer, RETURNS ITS LENGTH SO FAR
+static size_t beginHistoryEvent() {
+    int len = snprintf(wsJsonBuffer, WS_JSON_BUFFER_LEN, "{\"seq\":%u,", (unsigned)historyNextSeq());
+    return len > 0 ? (size_t)len : 0;
+}
 
-        function initWebSocket() {
-            console.log('Attempting to connect WebSocket...');
-            updateConnectionStatus('connecting');
-            // appendMessage('Connecting to ESP32...', 'System', 'system-message'); // Initial system message is less critical now
-            
-            websocket = new WebSocket(`ws://${window.location.hostname}/ws`);
-
-            websocket.onopen = () => { console.log('WebSocket connection established'); updateConnectionStatus('connected'); };
-            websocket.onclose = () => {
-                console.log('WebSocket connection closed. Retrying...');
-                updateConnectionStatus('disconnected');
-                appendMessage(`Disconnected from ${boardName}. Retrying in 3s...`, 'System', 'system-message');
-                setTimeout(initWebSocket, 3000);
-            };
-            websocket.onmessage = event => {
-                console.log('Message from server:', event.data);
-                try {
-                    const parsed = JSON.parse(event.data);
-                    if (parsed.type === 'system' && parsed.event === 'identity') {
-                        myDeviceId = parsed.deviceId;
-                        boardName = parsed.boardName || 'Node'; // Use board name from server
-                        pageTitleElement.textContent = `${boardName} LoRa Messenger`;
-                        document.title = `${boardName} LoRa Messenger`;
-                        updateConnectionStatus('connected'); // Update status with board name
-                        appendMessage(`Connected to ${boardName}. Your ID: ${myDeviceId} `, 'System', 'system-message');
-                    } else if (parsed.type === 'ack_status') { updateMessageStatus(parsed.local_id, parsed.status); }
-                    else if (parsed.sender && parsed.text) { appendMessage(parsed.text, parsed.sender); }
-                    else { appendMessage(event.data, 'Peer?');  }
-                } catch (e) { console.error("Error processing message from server:", e); appendMessage(event.data, 'RawData'); }
-            };
-            websocket.onerror = error => { console.error('WebSocket Error:', error); appendMessage('WebSocket error. Check console.', 'System', 'system-message'); };
-        }
+// WORK OUT WHAT IS STILL QUEUED TO A CLIENT - ITS QUEUE IS FIFO, SO WHAT HAS LEFT IT ARE OUR OLDEST FRAMES
+static void refreshClientQueue(WebClient& webClient, AsyncWebSocketClient* client) {
+    size_t queued = client->queueLen();
+    if (queued < webClient.framesQueued) webClient.framesQueued = (uint8_t)queued;
+    uint32_t bytes = 0;
+    for (uint8_t i = 1; i <= webClient.framesQueued; i++) {
+        bytes += webClient.frameLens[(webClient.frameNext + WEB_CLIENT_TRACKED_FRAMES - i) % WEB_CLIENT_TRACKED_FRAMES];
+    }
+    webClient.queueLen = queued;
+    webClient.queuedBytes = bytes;
+}
 
-        sendButton.onclick = () => {
-            const messageText = messageInput.value;
-            if (messageText.trim() === "" || !websocket || websocket.readyState !== WebSocket.OPEN) { return; }
-            const localMsgId = generateLocalId();
-            const payload = JSON.stringify({ text: messageText, local_id: localMsgId }); 
-            websocket.send(payload);
-            appendMessage(messageText, myDeviceId, 'sent', localMsgId); // Explicitly 'sent'
-            updateMessageStatus(localMsgId, 'pending_ack'); // Set initial status for UI
-            messageInput.value = "";
-            messageInput.focus();
-        };
-        messageInput.addEventListener('keypress', e => { if (e.key === 'Enter') { sendButton.onclick(); } });
-
-        function saveChatToLocalStorage() {
-            const messagesToSave = [];
-            chatbox.querySelectorAll('div[class*="message"], div.system-message').forEach(div => {
-                let status = null;
-                if (div.classList.contains('status-acked')) status = 'acked';
-                else if (div.classList.contains('status-failed-ack')) status = 'failed_ack';
-                else if (div.classList.contains('status-pending-ack')) status = 'pending_ack';
-                
-                messagesToSave.push({
-                    htmlContent: div.innerHTML, // Save innerHTML to reconstruct sender/content/timestamp
-                    classes: Array.from(div.classList), // Save all classes
-                    localId: div.getAttribute('data-local-id') || null,
-                    // 'status' is implicitly saved via classes now
-                });
-            });
-            localStorage.setItem('loraChatHistory-' + myDeviceId, JSON.stringify(messagesToSave));
-        }
+static bool clientHasRoom(const WebClient& webClient, AsyncWebSocketClient* client, size_t len) {
+    return !client->queueIsFull() && webClient.queuedBytes + len <= WEB_CLIENT_BYTE_BUDGET;
+}
 
-        function loadChatFromLocalStorage() {
-            const storedMessages = JSON.parse(localStorage.getItem('loraChatHistory-' + myDeviceId) || '[]');
-            chatbox.innerHTML = ''; // Clear existing chatbox content
-            storedMessages.forEach(msgData => {
-                const msgDiv = document.createElement('div');
-                msgData.classes.forEach(cls => msgDiv.classList.add(cls));
-                msgDiv.innerHTML = msgData.htmlContent;
-                if (msgData.localId) {
-                    msgDiv.setAttribute('data-local-id', msgData.localId);
-                }
-                chatbox.appendChild(msgDiv);
-            });
-            if (chatbox.children.length > 0) {
-                 chatbox.scrollTop = chatbox.scrollHeight;
-            }
+static void sendToClient(WebClient& webClient, AsyncWebSocketClient* client, const void* frame, size_t len, bool binary) {
+    if (binary) client->binary((const uint8_t*)frame, len);
+    else client->text((const char*)frame, len);
+    webClient.frameLens[webClient.frameNext] = (uint16_t)len;
+    webClient.frameNext = (webClient.frameNext + 1) % WEB_CLIENT_TRACKED_FRAMES;
+    if (webClient.framesQueued < WEB_CLIENT_TRACKED_FRAMES) webClient.framesQueued++;
+    webClient.queueLen++;
+    webClient.queuedBytes += len;
+    webClient.bytesSent += len;
+}
+
+// SEND THE TICK'S FRAME IN ONE ENCODING TO EVERY LIVE CLIENT USING IT - CLIENTS STILL CATCHING UP READ THE EVENTS FROM THE RING
+// A CLIENT WITHOUT ROOM FOR THE FRAME JOINS THEM: IT IS SENT NOTHING MORE UNTIL IT HAS DRAINED, THEN CATCHES UP FROM THIS FRAME ON
+static void flushTickFrame(bool binary) {
+    if (!binary && tickJsonLen) {
+        tickJson[tickJsonLen++] = ']';
+        tickJson[tickJsonLen++] = '}';
+    }
+    const void* frame = binary ? (const void*)tickBinary : (const void*)tickJson;
+    size_t len = binary ? tickBinaryLen : tickJsonLen;
+    uint32_t firstSeq = binary ? tickBinaryFirstSeq : tickJsonFirstSeq;
+    if (binary) tickBinaryLen = 0;
+    else tickJsonLen = 0;
+    if (len == 0) return;
+
+    for (WebClient& webClient : webClients) {
+        if (!webClient.active || webClient.resyncing || webClient.binary != binary) continue;
+        AsyncWebSocketClient* client = ws.client(webClient.id);
+        if (!client || client->status() != WS_CONNECTED) { webClient.active = false; continue; }
+        if (!clientHasRoom(webClient, client, len)) {
+            webClient.resyncing = true;
+            webClient.cursor = historySeek(firstSeq - 1);
+            webClient.catchUps++;
+            Serial.printf("[Web] WS Client #%u has %u bytes queued, catching up from seq %u once it drains.\n",
+                          webClient.id.load(), (unsigned)webClient.queuedBytes, webClient.cursor.seq);
+            continue;
         }
-        
-        document.getElementById('clearChatButton').onclick = () => {
-            if (confirm('Are you sure you want to clear the chat history?')) {
-                localStorage.removeItem('loraChatHistory-' + myDeviceId);
-                chatbox.innerHTML = '';
-                appendMessage('Chat history cleared.', 'System', 'system-message');
-            }
-        };
-        
-        window.onload = () => { 
-            // myDeviceId might not be set yet, so loadChatFromLocalStorage might load generic history
-            // It's better to load history AFTER identity is received, or make storage key independent of myDeviceId if it can change.
-            // For now, let's try loading. If myDeviceId changes, old history might not be relevant or could be keyed differently.
-            // A simple approach: always load 'loraChatHistory' (generic key)
-            // Or, wait for identity. For now, let's load what we can.
-            const genericHistory = JSON.parse(localStorage.getItem('loraChatHistory-UnknownDevice') || localStorage.getItem('loraChatHistory-undefined') || '[]');
-            if (genericHistory.length > 0 && !localStorage.getItem('loraChatHistory-' + myDeviceId) ) {
-                 // If there's generic history and no device-specific, maybe it's from before ID was set.
-                 // This logic can be refined. For simplicity, we load based on current (possibly unset) myDeviceId.
-            }
-            loadChatFromLocalStorage(); // Will use 'UnknownDevice' initially if myDeviceId isn't set
-            initWebSocket(); 
-        };
-    </script>
-</body>
-</html>
-)rawliteral";
+        sendToClient(webClient, client, frame, len, binary);
+    }
+}
+
+static bool liveClientsWant(bool binary) {
+    for (const WebClient& webClient : webClients) {
+        if (webClient.active && !webClient.resyncing && webClient.binary == binary) return true;
+    }
+    return false;
+}
+
+// KEEP THE EVENT IN wsJsonBuffer FOR CLIENTS THAT ARE AWAY AND ADD IT TO THE TICK'S JSON FRAME, RETURNS ITS SEQUENCE NUMBER
+static uint32_t publishHistoryEvent(size_t len) {
+    uint32_t seq = historyAppend(wsJsonBuffer, len);
+    if (!liveClientsWant(false)) return seq;
+    if (tickJsonLen && tickJsonLen + 1 + len + 2 > WEB_TICK_JSON_LEN) flushTickFrame(false);
+    if (tickJsonLen == 0) {
+        tickJsonFirstSeq = seq;
+        static const char prefix[] = "{\"type\":\"events\",\"events\":[";
+        memcpy(tickJson, prefix, sizeof(prefix) - 1);
+        tickJsonLen = sizeof(prefix) - 1;
+    } else {
+        tickJson[tickJsonLen++] = ',';
+    }
+    memcpy(tickJson + tickJsonLen, wsJsonBuffer, len);
+    tickJsonLen += len;
+    return seq;
+}
+
+// OPEN A BINARY EVENT WITH A bodyLen BYTE BODY IN THE TICK'S BINARY FRAME, OR nullptr IF NO LIVE CLIENT WANTS ONE
+static uint8_t* beginBinaryEvent(uint8_t type, uint32_t seq, size_t bodyLen) {
+    if (!liveClientsWant(true)) return nullptr;
+    size_t need = 5 + bodyLen;
+    if (tickBinaryLen && (tickBinaryLen + need > WEB_TICK_BINARY_LEN || tickBinary[1] == 255)) flushTickFrame(true);
+    if (tickBinaryLen == 0) {
+        tickBinaryFirstSeq = seq;
+        tickBinary[0] = WEB_EVENT_FRAME_VERSION;
+        tickBinary[1] = 0;
+        tickBinaryLen = 2;
+    }
+    tickBinary[1]++;
+    uint8_t* out = tickBinary + tickBinaryLen;
+    out[0] = type;
+    memcpy(out + 1, &seq, 4); // The ESP32 is little-endian
+    tickBinaryLen += need;
+    return out + 5;
+}
+
+static uint8_t* putBinaryString8(uint8_t* out, const char* text, size_t len) {
+    *out++ = (uint8_t)len;
+    memcpy(out, text, len);
+    return out + len;
+}
+
+static uint8_t* putBinaryString16(uint8_t* out, const char* text, size_t len) {
+    *out++ = (uint8_t)len;
+    *out++ = (uint8_t)(len >> 8);
+    memcpy(out, text, len);
+    return out + len;
+}
+
+// FORWARD A RECEIVED LORA MESSAGE TO ALL WEBSOCKET CLIENTS
+void sendLoRaTextToWebSocket(const char* senderId, const char* text, size_t textLen) {
+    size_t len = appendJsonRaw(wsJsonBuffer, beginHistoryEvent(), WS_JSON_BUFFER_LEN, "\"sender\":");
+    len = len ? appendJsonString(wsJsonBuffer, len, WS_JSON_BUFFER_LEN, senderId, strlen(senderId)) : 0;
+    len = appendJsonRaw(wsJsonBuffer, len, WS_JSON_BUFFER_LEN, ",\"text\":");
+    len = len ? appendJsonString(wsJsonBuffer, len, WS_JSON_BUFFER_LEN, text, textLen) : 0;
+    len = appendJsonRaw(wsJsonBuffer, len, WS_JSON_BUFFER_LEN, "}");
+    if (len == 0) {
+        Serial.println(F("[Web] LoRa message too large for the WS buffer, not forwarded."));
+        return;
+    }
+    uint32_t seq = publishHistoryEvent(len);
+    size_t senderLen = strnlen(senderId, WEB_EVENT_NAME_MAX);
+    if (textLen > LORA_MAX_MESSAGE_LEN) textLen = LORA_MAX_MESSAGE_LEN;
+    uint8_t* out = beginBinaryEvent(WEB_EVENT_RX, seq, 1 + senderLen + 2 + textLen);
+    if (out) putBinaryString16(putBinaryString8(out, senderId, senderLen), text, textLen);
+}
 
 // SEND LoRa ACK STATUS UPDATES TO ALL WEBSOCKET CLIENTS
-void sendLoraAckStatusToWebSocket(const String& localWebId, uint32_t loraMessageId, bool acked, bool finalFailure) {
-    JsonDocument doc;
-    doc["type"] = "ack_status";
-    doc["local_id"] = localWebId;
-    doc["lora_msg_id"] = loraMessageId; 
+void sendLoraAckStatusToWebSocket(const char* localWebId, uint32_t loraMessageId, bool acked, bool finalFailure) {
+    const char* status = finalFailure ? "failed_ack" : (acked ? "acked" : "pending_ack");
+    size_t len = appendJsonRaw(wsJsonBuffer, beginHistoryEvent(), WS_JSON_BUFFER_LEN, ACK_STATUS_KEY);
+    len = len ? appendJsonString(wsJsonBuffer, len, WS_JSON_BUFFER_LEN, localWebId, strlen(localWebId)) : 0;
+    if (len) {
+        int tail = snprintf(wsJsonBuffer + len, WS_JSON_BUFFER_LEN - len, ",\"lora_msg_id\":%u,\"status\":\"%s\"}",
+                            (unsigned)loraMessageId, status);
+        len = (tail > 0 && len + tail < WS_JSON_BUFFER_LEN) ? len + tail : 0;
+    }
+    if (len == 0) return;
+    uint32_t seq = publishHistoryEvent(len);
+    Serial.printf("[Web] Sent ACK status to WS: %.*s\n", (int)len, wsJsonBuffer);
+    size_t idLen = strnlen(localWebId, LORA_LOCAL_ID_MAX_LEN);
+    uint8_t* out = beginBinaryEvent(WEB_EVENT_ACK_STATUS, seq, 1 + idLen + 5);
+    if (!out) return;
+    out = putBinaryString8(out, localWebId, idLen);
+    memcpy(out, &loraMessageId, 4);
+    out[4] = finalFailure ? WEB_ACK_FAILED : (acked ? WEB_ACK_ACKED : WEB_ACK_PENDING);
+}
 
-    if (finalFailure) { doc["status"] = "failed_ack"; }
-    else if (acked) { doc["status"] = "acked"; }
-    else { doc["status"] = "pending_ack"; }
+// TELL EVERY CLIENT ABOUT A MESSAGE ONE OF THEM SENT, SO ALL OF THEM SHOW THE SAME CONVERSATION
+static void sendSentEchoToWebSocket(const WebSentEcho& echo) {
+    char nameBuf[LORA_NODE_NAME_LEN];
+    const char* toName = nodeNameForAddress(echo.dstAddress, nameBuf, sizeof(nameBuf));
+    size_t len = appendJsonRaw(wsJsonBuffer, beginHistoryEvent(), WS_JSON_BUFFER_LEN, "\"type\":\"sent\",\"local_id\":");
+    len = len ? appendJsonString(wsJsonBuffer, len, WS_JSON_BUFFER_LEN, echo.localWebId, strlen(echo.localWebId)) : 0;
+    len = appendJsonRaw(wsJsonBuffer, len, WS_JSON_BUFFER_LEN, ",\"to\":");
+    len = len ? appendJsonString(wsJsonBuffer, len, WS_JSON_BUFFER_LEN, toName, strlen(toName)) : 0;
+    len = appendJsonRaw(wsJsonBuffer, len, WS_JSON_BUFFER_LEN, ",\"text\":");
+    len = len ? appendJsonString(wsJsonBuffer, len, WS_JSON_BUFFER_LEN, echo.text, strlen(echo.text)) : 0;
+    len = appendJsonRaw(wsJsonBuffer, len, WS_JSON_BUFFER_LEN, "}");
+    if (len == 0) return;
+    uint32_t seq = publishHistoryEvent(len);
+    size_t idLen = strnlen(echo.localWebId, LORA_LOCAL_ID_MAX_LEN);
+    size_t toLen = strnlen(toName, WEB_EVENT_NAME_MAX);
+    size_t textLen = strlen(echo.text);
+    uint8_t* out = beginBinaryEvent(WEB_EVENT_SENT, seq, 1 + idLen + 1 + toLen + 2 + textLen);
+    if (!out) return;
+    out = putBinaryString8(out, echo.localWebId, idLen);
+    putBinaryString16(putBinaryString8(out, toName, toLen), echo.text, textLen);
+}
 
-    String jsonOutput;
-    serializeJson(doc, jsonOutput);
-    ws.textAll(jsonOutput);
-    Serial.printf("[Web] Sent ACK status to WS: %s\n", jsonOutput.c_str());
+// START (OR RESTART) A CLIENT'S CATCH-UP AFTER THE LAST EVENT IT SAW - ALL OF THE RING IF ITS
+// SEQUENCE NUMBERS ARE FROM AN EARLIER BOOT
+static void startResync(const WebHello& hello) {
+    WebClient* slot = nullptr;
+    for (WebClient& webClient : webClients) {
+        if (webClient.active && webClient.id == hello.clientId) { slot = &webClient; break; }
+    }
+    for (WebClient& webClient : webClients) {
+        if (slot || webClient.active) continue;
+        slot = &webClient;
+        slot->framesQueued = 0;
+        slot->queueLen = 0;
+        slot->queuedBytes = 0;
+        slot->bytesSent = 0;
+        slot->catchUps = 0;
+        slot->coalesced = 0;
+    }
+    if (!slot) {
+        Serial.printf("[Web] No client slot for WS Client #%u, its page says hello again until one is free.\n", hello.clientId);
+        return;
+    }
+    uint32_t lastSeq = (hello.historyId == historyId()) ? hello.lastSeq : 0;
+    slot->id = hello.clientId;
+    slot->binary = hello.binary;
+    slot->resyncing = true;
+    slot->cursor = historySeek(lastSeq);
+    slot->active = true;    // Last, so /diag never sees a new slot with the previous client's fields
+    Serial.printf("[Web] WS Client #%u (%s) resyncing from seq %u (head %u).\n", hello.clientId,
+                  hello.binary ? "binary" : "JSON", slot->cursor.seq, historyHeadSeq());
+}
+
+// THE local_id OF AN ACK STATUS EVENT, STILL QUOTED AND ESCAPED AS STORED - false FOR ANY OTHER EVENT
+static bool ackStatusLocalId(const char* event, uint16_t len, const char** id, size_t* idLen) {
+    size_t pos = 7; // Past {"seq":
+    while (pos < len && isdigit((uint8_t)event[pos])) pos++;
+    size_t keyLen = sizeof(ACK_STATUS_KEY) - 1;
+    if (pos + 1 + keyLen + 2 > len || event[pos] != ',' || memcmp(event + pos + 1, ACK_STATUS_KEY, keyLen) != 0) return false;
+    size_t start = pos + 1 + keyLen;
+    for (size_t i = start + 1; i < len; i++) {
+        if (event[i] == '\\') { i++; continue; }
+        if (event[i] != '"') continue;
+        *id = event + start;
+        *idLen = i + 1 - start;
+        return true;
+    }
+    return false;
+}
+
+// WHETHER A LATER ACK STATUS EVENT FOR THE SAME MESSAGE REPLACES THIS ONE (THE CURSOR at IS ON IT)
+// A CLIENT CATCHING UP ONLY NEEDS THE LATEST
+static bool ackStatusSuperseded(const char* event, uint16_t len, WebHistoryCursor at) {
+    const char* id;
+    size_t idLen;
+    if (!ackStatusLocalId(event, len, &id, &idLen)) return false;
+    historyAdvance(at);
+    const char* later;
+    uint16_t laterLen;
+    for (int i = 0; i < WEB_COALESCE_LOOKAHEAD && (later = historyPeek(at, &laterLen)); i++) {
+        const char* laterId;
+        size_t laterIdLen;
+        if (ackStatusLocalId(later, laterLen, &laterId, &laterIdLen) && laterIdLen == idLen && memcmp(laterId, id, idLen) == 0) return true;
+        historyAdvance(at);
+    }
+    return false;
+}
+
+// SEND EACH CATCHING-UP CLIENT ITS NEXT BATCH, BUT ONLY WHEN IT HAS ROOM FOR A FULL ONE IN ITS BUDGET
+// A BATCH THAT REACHES head_seq (OR IS EMPTY) ENDS THE CATCH-UP, LIVE EVENTS CARRY ON FROM THERE
+static void serveResyncs() {
+    for (WebClient& webClient : webClients) {
+        if (!webClient.active || !webClient.resyncing) continue;
+        AsyncWebSocketClient* client = ws.client(webClient.id);
+        if (!client || client->status() != WS_CONNECTED) { webClient.active = false; continue; }
+        if (!clientHasRoom(webClient, client, WEB_HISTORY_BATCH_LEN)) continue;
+
+        // from_seq LETS THE PAGE TELL EVENTS THE RING NO LONGER HOLDS FROM ONES LEFT OUT AS SUPERSEDED
+        uint32_t fromSeq = webClient.cursor.seq;
+        if ((int32_t)(fromSeq - historyOldestSeq()) < 0) fromSeq = historyOldestSeq();
+        int prefix = snprintf(historyBatch, WEB_HISTORY_BATCH_LEN, "{\"type\":\"history\",\"history_id\":%u,\"head_seq\":%u,\"from_seq\":%u,\"events\":[",
+                              (unsigned)historyId(), (unsigned)historyHeadSeq(), (unsigned)fromSeq);
+        size_t len = prefix;
+        const char* event;
+        uint16_t eventLen;
+        while ((event = historyPeek(webClient.cursor, &eventLen))) {
+            if (ackStatusSuperseded(event, eventLen, webClient.cursor)) {
+                webClient.coalesced++;
+            } else {
+                if (len + 1 + eventLen > WEB_HISTORY_BATCH_LEN - 2) break;
+                if (len > (size_t)prefix) historyBatch[len++] = ',';
+                memcpy(historyBatch + len, event, eventLen);
+                len += eventLen;
+            }
+            historyAdvance(webClient.cursor);
+        }
+        historyBatch[len++] = ']';
+        historyBatch[len++] = '}';
+        sendToClient(webClient, client, historyBatch, len, false);
+        if (webClient.cursor.seq == historyNextSeq()) {
+            webClient.resyncing = false;
+            Serial.printf("[Web] WS Client #%u caught up at seq %u.\n", webClient.id.load(), historyHeadSeq());
+        }
+    }
+}
+
+// SEND A PRECOMPRESSED ASSET - A BROWSER THAT ALREADY HOLDS THIS BUILD'S COPY GETS A BODILESS 304
+// (EVERY BROWSER ACCEPTS GZIP, SO THERE IS NO UNCOMPRESSED FALLBACK)
+static void serveWebAsset(AsyncWebServerRequest *request, const WebAsset& asset) {
+    const AsyncWebHeader* ifNoneMatch = request->getHeader("If-None-Match");
+    AsyncWebServerResponse* response;
+    if (webAssetNotModified(asset, ifNoneMatch ? ifNoneMatch->value().c_str() : nullptr)) {
+        response = request->beginResponse(304);
+    } else {
+        response = request->beginResponse_P(200, asset.contentType, asset.data, asset.len);
+        response->addHeader("Content-Encoding", "gzip");
+    }
+    response->addHeader("ETag", asset.etag);
+    response->addHeader("Cache-Control", asset.cacheControl);
+    request->send(response);
 }
 
 // WEBSOCKET EVENT HANDLER
-void onWSEvent(AsyncWebSocket *socket_server, AsyncWebSocketClient *client, AwsEventType type,
+void onWSEvent(AsyncWebSocket * /*socket_server*/, AsyncWebSocketClient *client, AwsEventType type,
                      void *arg, uint8_t *data, size_t len) {
   switch (type) {
     case WS_EVT_CONNECT: {
@@ -278,6 +439,24 @@ void onWSEvent(AsyncWebSocket *socket_server, AsyncWebSocketClient *client, AwsE
       identityDoc["event"] = "identity";
       identityDoc["deviceId"] = currentMyDeviceId_web;
       identityDoc["boardName"] = currentBoardName_web; 
+      identityDoc["history_id"] = historyId();
+      identityDoc["head_seq"] = historyHeadSeq();
+      // RECIPIENTS THE UI CAN ADDRESS: EVERYONE, EACH OTHER KNOWN NODE AND EACH KNOWN GROUP
+      JsonArray recipients = identityDoc["recipients"].to<JsonArray>();
+      JsonObject everyone = recipients.add<JsonObject>();
+      everyone["address"] = LORA_BROADCAST_ADDRESS;
+      everyone["name"] = "Everyone";
+      for (const KnownNode& node : KNOWN_NODES) {
+          if (node.address == MY_NODE_ADDRESS) continue;
+          JsonObject entry = recipients.add<JsonObject>();
+          entry["address"] = node.address;
+          entry["name"] = node.name;
+      }
+      for (const KnownNode& group : KNOWN_GROUPS) {
+          JsonObject entry = recipients.add<JsonObject>();
+          entry["address"] = group.address;
+          entry["name"] = group.name;
+      }
       String identityMessage;
       serializeJson(identityDoc, identityMessage);
       client->text(identityMessage);
@@ -286,16 +465,16 @@ void onWSEvent(AsyncWebSocket *socket_server, AsyncWebSocketClient *client, AwsE
     case WS_EVT_DISCONNECT:
       Serial.printf("[Web] WS Client #%u disconnected\n", client->id());
       setDisplayWebSocketStatus(false); 
+      // THE LOOP TASK OWNS THE SLOT - IF THIS IS LOST, ITS NEXT STATUS CHECK FREES THE SLOT INSTEAD
+      disconnectQueue.push(client->id());
       break;
     case WS_EVT_DATA: {
       AwsFrameInfo *info = (AwsFrameInfo*)arg;
       if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
-        data[len] = 0; 
-        String messagePayload = (char*)data;
-        Serial.printf("[Web] WS RX from Client #%u: %s\n", client->id(), messagePayload.c_str());
+        Serial.printf("[Web] WS RX from Client #%u: %.*s\n", client->id(), (int)len, (const char*)data);
 
         JsonDocument doc; 
-        DeserializationError error = deserializeJson(doc, messagePayload);
+        DeserializationError error = deserializeJson(doc, (const char*)data, len);
 
         if (error) {
           Serial.print(F("[Web] deserializeJson() failed: ")); Serial.println(error.f_str());
@@ -303,23 +482,47 @@ void onWSEvent(AsyncWebSocket *socket_server, AsyncWebSocketClient *client, AwsE
           return;
         }
 
+        // A CLIENT ANSWERING THE IDENTITY MESSAGE WITH THE LAST EVENT IT SAW - THE LOOP TASK SENDS THE REST
+        const char* msgType = doc["type"];
+        if (msgType && strcmp(msgType, "hello") == 0) {
+          const char* encoding = doc["encoding"];
+          bool binary = encoding && strcmp(encoding, "binary") == 0;
+          WebHello hello = { client->id(), doc["history_id"].as<uint32_t>(), doc["last_seq"].as<uint32_t>(), binary };
+          if (!helloQueue.push(hello)) Serial.println(F("[Web] Hello queue full, the page sends it again until history arrives."));
+          return;
+        }
+
         const char* ws_text_cstr = doc["text"];
         const char* local_id_cstr = doc["local_id"];
+        // NO VALID "to" (OR AN OLDER PAGE) MEANS EVERYONE
+        uint16_t dstAddress = doc["to"].is<uint16_t>() ? doc["to"].as<uint16_t>() : (uint16_t)LORA_BROADCAST_ADDRESS;
 
         if (ws_text_cstr && local_id_cstr) {
-          String messageContent = String(ws_text_cstr);
-          String localWebId = String(local_id_cstr);
-          
-          Serial.printf("  Parsed from WS: text='%s', local_id='%s'\n", messageContent.c_str(), localWebId.c_str());
-
-          if (!currentMyDeviceId_web.isEmpty() && !currentLoraPacketPrefix_web.isEmpty()) {
-              bool queued = queueLoRaMessage(messageContent, currentMyDeviceId_web, currentLoraPacketPrefix_web, localWebId);
-              if (!queued) {
-                  Serial.println("  Error: Failed to queue message for LoRa TX.");
-                  // client->text("{\"type\":\"error\", \"message\":\"Failed to queue LoRa message\", \"local_id\":\"" + localWebId + "\"}");
-              }
+          Serial.printf("  Parsed from WS: text='%s', local_id='%s', to=0x%04X\n", ws_text_cstr, local_id_cstr, dstAddress);
+
+          // HAND OFF TO THE LORA STACK - THIS TASK NEVER TOUCHES THE RADIO OR THE OUTGOING TABLE
+          LoRaSubmitResult result = submitLoRaMessage(ws_text_cstr, local_id_cstr, dstAddress);
+          if (result == LORA_SUBMIT_OK) {
+              static WebSentEcho echo; // Async TCP task only, too big for its stack
+              strlcpy(echo.text, ws_text_cstr, sizeof(echo.text));
+              strlcpy(echo.localWebId, local_id_cstr, sizeof(echo.localWebId));
+              echo.dstAddress = dstAddress;
+              if (!sentEchoQueue.push(echo)) Serial.println(F("[Web] Echo queue full, other clients will not see this message."));
           } else {
-              Serial.println("[Web] Error: Device ID or LoRa prefix not set for sending LoRa from WS.");
+              const char* reason = (result == LORA_SUBMIT_QUEUE_FULL) ? "queue_full" : "too_long";
+              Serial.printf("  Error: Failed to queue message for LoRa TX (%s).\n", reason);
+              char errorMessage[LORA_LOCAL_ID_MAX_LEN * 6 + 128];
+              size_t errorLen = appendJsonRaw(errorMessage, 1, sizeof(errorMessage), "\"type\":\"error\",\"message\":");
+              errorMessage[0] = '{';
+              const char* errorText = (result == LORA_SUBMIT_QUEUE_FULL) ? "LoRa queue full, try again" : "Message too long";
+              errorLen = errorLen ? appendJsonString(errorMessage, errorLen, sizeof(errorMessage), errorText, strlen(errorText)) : 0;
+              errorLen = appendJsonRaw(errorMessage, errorLen, sizeof(errorMessage), ",\"reason\":");
+              errorLen = errorLen ? appendJsonString(errorMessage, errorLen, sizeof(errorMessage), reason, strlen(reason)) : 0;
+              errorLen = appendJsonRaw(errorMessage, errorLen, sizeof(errorMessage), ",\"local_id\":");
+              size_t idLen = strnlen(local_id_cstr, LORA_LOCAL_ID_MAX_LEN);
+              errorLen = errorLen ? appendJsonString(errorMessage, errorLen, sizeof(errorMessage), local_id_cstr, idLen) : 0;
+              errorLen = appendJsonRaw(errorMessage, errorLen, sizeof(errorMessage), "}");
+              if (errorLen) client->text(errorMessage, errorLen);
           }
         } else {
             Serial.println("[Web] Error: WS JSON message does not contain 'text' and/or 'local_id' field.");
@@ -334,9 +537,8 @@ void onWSEvent(AsyncWebSocket *socket_server, AsyncWebSocketClient *client, AwsE
 }
 
 // SETS UP THE WEB SERVER, WEBSOCKET, AND WIFI ACCESS POINT
-void setupWebServer(const String& myDeviceId, const String& loraPrefix, const String& apSsid, const String& apPassword) {
+void setupWebServer(const String& myDeviceId, const String& apSsid, const String& apPassword) {
   currentMyDeviceId_web = myDeviceId;
-  currentLoraPacketPrefix_web = loraPrefix;
   currentBoardName_web = BOARD_TYPE_NAME; 
 
   Serial.print(F("[Web] Setting up AP: ")); Serial.println(apSsid);
@@ -347,7 +549,7 @@ void setupWebServer(const String& myDeviceId, const String& loraPrefix, const St
   setDisplayAPIP(AP_IP.toString()); 
 
   // WIFI EVENT HANDLER TO TRACK CONNECTED STATIONS AND UPDATE DISPLAY
-  WiFi.onEvent([](WiFiEvent_t event, WiFiEventInfo_t info){
+  WiFi.onEvent([](WiFiEvent_t event, WiFiEventInfo_t /*info*/){
     Serial.printf("[WiFiEvt] Event: %d\n", event);
     if (event == ARDUINO_EVENT_WIFI_AP_STACONNECTED) {
         Serial.println("  Client Connected to AP");
@@ -358,12 +560,51 @@ void setupWebServer(const String& myDeviceId, const String& loraPrefix, const St
     }
   });
 
+  historySetup();
   ws.onEvent(onWSEvent); 
   server.addHandler(&ws);
 
-  // SERVE THE MAIN HTML PAGE
-  server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-    request->send_P(200, "text/html", index_html);
+  // SERVE THE WEB UI FROM web/, GZIPPED AND HASHED AT BUILD TIME (scripts/embed_web_assets.py)
+  for (const WebAsset& asset : WEB_ASSETS) {
+    server.on(asset.path, HTTP_GET, [&asset](AsyncWebServerRequest *request){
+      serveWebAsset(request, asset);
+    });
+  }
+  // LORA STACK COUNTERS AS JSON
+  server.on("/diag", HTTP_GET, [](AsyncWebServerRequest *request){
+    JsonDocument doc;
+    fillLoRaDiagnostics(doc);
+    JsonObject history = doc["history"].to<JsonObject>();
+    history["id"] = historyId();
+    history["oldest_seq"] = historyOldestSeq();
+    history["head_seq"] = historyHeadSeq();
+    history["bytes"] = (uint32_t)historyBytes();
+    uint32_t resyncing = 0, binary = 0;
+    for (const WebClient& webClient : webClients) {
+        if (!webClient.active) continue;
+        resyncing += webClient.resyncing ? 1 : 0;
+        binary += webClient.binary ? 1 : 0;
+    }
+    history["clients_resyncing"] = resyncing;
+    history["clients_binary"] = binary;
+    // PER-CLIENT OUTBOUND QUEUES, AS OF THE LOOP TASK'S LAST LOOK
+    JsonArray clients = doc["web_clients"].to<JsonArray>();
+    for (const WebClient& webClient : webClients) {
+        if (!webClient.active) continue;
+        JsonObject entry = clients.add<JsonObject>();
+        entry["id"] = webClient.id.load();
+        entry["encoding"] = webClient.binary ? "binary" : "json";
+        entry["state"] = webClient.resyncing ? "catching_up" : "live";
+        entry["queue_len"] = webClient.queueLen.load();
+        entry["queued_bytes"] = webClient.queuedBytes.load();
+        entry["budget_bytes"] = WEB_CLIENT_BYTE_BUDGET;
+        entry["bytes_sent"] = webClient.bytesSent.load();
+        entry["catch_ups"] = webClient.catchUps.load();
+        entry["coalesced"] = webClient.coalesced.load();
+    }
+    String jsonOutput;
+    serializeJson(doc, jsonOutput);
+    request->send(200, "application/json", jsonOutput);
   });
   server.onNotFound([](AsyncWebServerRequest *request){
     request->send(404, "text/plain", "Not found");
@@ -373,14 +614,25 @@ void setupWebServer(const String& myDeviceId, const String& loraPrefix, const St
   Serial.println(F("[Web] HTTP server started."));
 }
 
-// SENDS A JSON MESSAGE TO ALL CONNECTED WEBSOCKET CLIENTS
-void sendWebSocketMessage(const String& jsonMessage) { 
-  if (ws.count() > 0) { 
-    ws.textAll(jsonMessage);
-    // Serial.printf("[Web] Sent to WS (%u clients): %s\n", ws.count(), jsonMessage.c_str());
-  }
-}
-
 void loopWebManager() {
+    for (WebClient& webClient : webClients) {
+        if (!webClient.active) continue;
+        AsyncWebSocketClient* client = ws.client(webClient.id);
+        if (client && client->status() == WS_CONNECTED) refreshClientQueue(webClient, client);
+        else webClient.active = false;
+    }
+    WebHello hello;
+    while (helloQueue.pop(hello)) startResync(hello);
+    uint32_t goneId;
+    while (disconnectQueue.pop(goneId)) {
+        for (WebClient& webClient : webClients) {
+            if (webClient.active && webClient.id == goneId) webClient.active = false;
+        }
+    }
+    static WebSentEcho echo;
+    while (sentEchoQueue.pop(echo)) sendSentEchoToWebSocket(echo);
+    if (tickJsonLen) flushTickFrame(false);
+    if (tickBinaryLen) flushTickFrame(true);
+    serveResyncs();
     ws.cleanupClients();
 }
\ No newline at end of file
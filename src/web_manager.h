@@ -9,9 +9,9 @@ extern AsyncWebServer server;
 extern AsyncWebSocket ws;
 
 // FUNCTION DECLARATIONS
-void setupWebServer(const String& myDeviceId, const String& loraPrefix, const String& apSsid, const String& apPassword);
-void sendWebSocketMessage(const String& jsonMessage);
-void sendLoraAckStatusToWebSocket(const String& localWebId, uint32_t loraMessageId, bool acked, bool finalFailure);
+void setupWebServer(const String& myDeviceId, const String& apSsid, const String& apPassword);
+void sendLoRaTextToWebSocket(const char* senderId, const char* text, size_t textLen);
+void sendLoraAckStatusToWebSocket(const char* localWebId, uint32_t loraMessageId, bool acked, bool finalFailure);
 void loopWebManager(); 
 
 #endif 
\ No newline at end of file
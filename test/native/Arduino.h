@@ -0,0 +1,149 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// HOST STAND-IN FOR THE PARTS OF THE ARDUINO CORE THE LORA MODULES USE, FOR [env:native] TESTS ONLY
+// (THE FIRMWARE NEVER SEES THIS FILE, test/native IS ONLY ON THE NATIVE ENV'S INCLUDE PATH)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#define IRAM_ATTR
+#define PROGMEM
+#define F(text) text
+
+using std::max;
+using std::min;
+
+template <typename T, typename L, typename H>
+inline T constrain(T value, L low, H high) {
+    return value < low ? (T)low : (value > high ? (T)high : value);
+}
+
+typedef uint8_t byte;
+#define HEX 16
+
+// ONLY WHAT config.h NEEDS TO DEFINE ITS CONSTANTS, web_manager.cpp TO SERIALIZE JSON INTO ONE
+// (ArduinoJson WRITES TO ANY TYPE WITH THESE write() METHODS) AND test_encryption's COPY OF THE OLD CIPHER
+class String {
+public:
+    String(const char* text = "") : text_(text ? text : "") {}
+    String(byte value, int base) {
+        char digits[9];
+        snprintf(digits, sizeof(digits), base == HEX ? "%x" : "%u", (unsigned)value);
+        text_ = digits;
+    }
+    const char* c_str() const { return text_.c_str(); }
+    size_t length() const { return text_.size(); }
+    char charAt(size_t index) const { return index < text_.size() ? text_[index] : 0; }
+    String substring(size_t from, size_t to) const { return String(text_.substr(from, to - from).c_str()); }
+    String& operator+=(const String& other) {
+        text_ += other.text_;
+        return *this;
+    }
+    String& operator+=(const char* text) {
+        text_ += text;
+        return *this;
+    }
+    String& operator+=(char c) {
+        text_ += c;
+        return *this;
+    }
+    size_t write(uint8_t c) {
+        text_ += (char)c;
+        return 1;
+    }
+    size_t write(const uint8_t* buf, size_t len) {
+        text_.append((const char*)buf, len);
+        return len;
+    }
+private:
+    std::string text_;
+};
+
+class HardwareSerial {
+public:
+    void begin(unsigned long) {}
+    void print(const char* text) { fputs(text, stdout); }
+    void println(const char* text = "") { puts(text); }
+    void print(const String& text) { print(text.c_str()); }
+    void println(const String& text) { println(text.c_str()); }
+    void println(int value) { printf("%d\n", value); }
+    void printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        vprintf(format, args);
+        va_end(args);
+    }
+};
+inline HardwareSerial Serial;
+
+// TIME SINCE THE TEST PROGRAM STARTED, LIKE TIME SINCE BOOT ON THE BOARD
+inline unsigned long micros() {
+    static const auto start = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long millis() {
+    return micros() / 1000;
+}
+
+// A TEST CAN PIN esp_random() TO ONE VALUE, E.G. UINT32_MAX FOR THE LONGEST BACKOFF EVERY TIME (0 UNPINS IT)
+inline std::atomic<uint32_t> nativeRandomPin{0};
+
+inline uint32_t esp_random() {
+    uint32_t pinned = nativeRandomPin.load();
+    return pinned ? pinned : ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+// NO PSRAM ON THE HOST, SO web_history.cpp TAKES ITS SMALLER INTERNAL-RAM RING
+inline bool psramFound() {
+    return false;
+}
+
+inline void* ps_malloc(size_t size) {
+    return malloc(size);
+}
+
+// FREERTOS TASKS AND NOTIFICATIONS, EACH TASK A std::thread (native_tasks.cpp), ONE TICK IS 1 MS
+typedef struct NativeTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+enum eNotifyAction { eNoAction, eSetBits, eIncrement };
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portYIELD_FROM_ISR(woken) (void)(woken)
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stackDepth, void* param,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t* higherPriorityTaskWoken);
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t* value, TickType_t ticksToWait);
+void delay(unsigned long ms);
+
+// GLIBC ONLY GAINED strlcpy IN 2.38
+#if defined(__GLIBC__) && !(__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 38))
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t len = strlen(src);
+    if (size) {
+        size_t copy = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, copy);
+        dst[copy] = '\0';
+    }
+    return len;
+}
+#endif
+
+#endif
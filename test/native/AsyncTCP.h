@@ -0,0 +1,6 @@
+#ifndef NATIVE_ASYNC_TCP_H
+#define NATIVE_ASYNC_TCP_H
+
+// HOST STAND-IN FOR AsyncTCP - web_manager.h INCLUDES IT, ESPAsyncWebServer.h HOLDS EVERYTHING THE TESTS USE
+
+#endif
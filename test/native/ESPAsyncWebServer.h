@@ -0,0 +1,153 @@
+#ifndef NATIVE_ESP_ASYNC_WEB_SERVER_H
+#define NATIVE_ESP_ASYNC_WEB_SERVER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <functional>
+#include <list>
+#include <vector>
+
+// HOST STAND-IN FOR ESPAsyncWebServer: A WEBSOCKET WHOSE CLIENTS KEEP EVERY FRAME SENT TO THEM AND ONLY DRAIN
+// THEIR OUTBOUND QUEUES WHEN A TEST SAYS SO, SO THE BATCHING AND BACKPRESSURE IN web_manager.cpp CAN BE CHECKED
+// THE HTTP SERVER ONLY HAS TO COMPILE, NO REQUEST EVER REACHES IT
+#define NATIVE_WS_MAX_QUEUED_MESSAGES 32   // WS_MAX_QUEUED_MESSAGES in the library
+
+enum AwsEventType { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA };
+enum AwsFrameType { WS_CONTINUATION = 0, WS_TEXT = 1, WS_BINARY = 2, WS_DISCONNECT = 8, WS_PING = 9, WS_PONG = 10 };
+enum AwsClientStatus { WS_DISCONNECTED, WS_CONNECTED, WS_DISCONNECTING };
+enum WebRequestMethod { HTTP_GET = 1, HTTP_POST = 2 };
+
+struct AwsFrameInfo {
+    uint8_t message_opcode;
+    uint32_t num;
+    uint8_t final;
+    uint8_t masked;
+    uint8_t opcode;
+    uint64_t len;
+    uint8_t mask[4];
+    uint64_t index;
+};
+
+// ONE FRAME HANDED TO A CLIENT, AS SENT
+struct NativeWsFrame {
+    std::string data;
+    bool binary;
+};
+
+class AsyncWebSocketClient {
+public:
+    explicit AsyncWebSocketClient(uint32_t id) : id_(id) {}
+    uint32_t id() const { return id_; }
+    AwsClientStatus status() const { return status_; }
+    IPAddress remoteIP() const { return IPAddress(); }
+    bool queueIsFull() const { return queued_ >= NATIVE_WS_MAX_QUEUED_MESSAGES || status_ != WS_CONNECTED; }
+    size_t queueLen() const { return queued_; }
+    bool text(const char* message, size_t len) { return send(message, len, false); }
+    bool text(const char* message) { return send(message, strlen(message), false); }
+    bool text(const String& message) { return send(message.c_str(), message.length(), false); }
+    bool binary(const uint8_t* message, size_t len) { return send((const char*)message, len, true); }
+
+    // TEST SIDE: EVERY FRAME SENT SO FAR, OLDEST FIRST, AND THE PHONE CATCHING UP WITH ITS QUEUE
+    std::vector<NativeWsFrame> nativeFrames;
+    void nativeDrain() { queued_ = 0; }
+    void nativeClose() { status_ = WS_DISCONNECTED; }
+
+private:
+    bool send(const char* message, size_t len, bool isBinary) {
+        if (queueIsFull())
+            return false;
+        nativeFrames.push_back({std::string(message, len), isBinary});
+        queued_++;
+        return true;
+    }
+    uint32_t id_;
+    AwsClientStatus status_ = WS_CONNECTED;
+    size_t queued_ = 0;
+};
+
+class AsyncWebSocket;
+typedef std::function<void(AsyncWebSocket*, AsyncWebSocketClient*, AwsEventType, void*, uint8_t*, size_t)> AwsEventHandler;
+
+class AsyncWebHandler {};
+
+class AsyncWebSocket : public AsyncWebHandler {
+public:
+    explicit AsyncWebSocket(const char* url) {}
+    void onEvent(AwsEventHandler handler) { handler_ = handler; }
+    AsyncWebSocketClient* client(uint32_t id) {
+        for (AsyncWebSocketClient& candidate : clients_) {
+            if (candidate.id() == id && candidate.status() == WS_CONNECTED)
+                return &candidate;
+        }
+        return nullptr;
+    }
+    void cleanupClients() {}
+
+    // TEST SIDE: A PHONE OPENING THE SOCKET, SENDING A TEXT FRAME AND GOING AWAY, AS THE ASYNC TCP TASK REPORTS THEM
+    AsyncWebSocketClient* nativeConnect() {
+        clients_.emplace_back(++lastId_);
+        AsyncWebSocketClient* newClient = &clients_.back();
+        if (handler_)
+            handler_(this, newClient, WS_EVT_CONNECT, nullptr, nullptr, 0);
+        return newClient;
+    }
+    void nativeReceive(AsyncWebSocketClient* from, const char* text) {
+        size_t len = strlen(text);
+        AwsFrameInfo info = {};
+        info.final = 1;
+        info.opcode = WS_TEXT;
+        info.message_opcode = WS_TEXT;
+        info.len = len;
+        if (handler_)
+            handler_(this, from, WS_EVT_DATA, &info, (uint8_t*)text, len);
+    }
+    void nativeDisconnect(AsyncWebSocketClient* gone) {
+        gone->nativeClose();
+        if (handler_)
+            handler_(this, gone, WS_EVT_DISCONNECT, nullptr, nullptr, 0);
+    }
+
+private:
+    AwsEventHandler handler_;
+    std::list<AsyncWebSocketClient> clients_;   // A list, so a client stays put while others join
+    uint32_t lastId_ = 0;
+};
+
+class AsyncWebHeader {
+public:
+    const String& value() const { return value_; }
+private:
+    String value_;
+};
+
+class AsyncWebServerResponse {
+public:
+    void addHeader(const char* name, const char* value) {}
+    void addHeader(const char* name, const String& value) {}
+};
+
+class AsyncWebServerRequest {
+public:
+    const AsyncWebHeader* getHeader(const char* name) const { return nullptr; }
+    AsyncWebServerResponse* beginResponse(int code) { return &response_; }
+    AsyncWebServerResponse* beginResponse_P(int code, const char* contentType, const uint8_t* content, size_t len) {
+        return &response_;
+    }
+    void send(AsyncWebServerResponse* response) {}
+    void send(int code, const char* contentType, const String& content) {}
+private:
+    AsyncWebServerResponse response_;
+};
+
+typedef std::function<void(AsyncWebServerRequest*)> ArRequestHandlerFunction;
+
+class AsyncWebServer {
+public:
+    explicit AsyncWebServer(uint16_t port) {}
+    void on(const char* uri, WebRequestMethod method, ArRequestHandlerFunction handler) {}
+    void onNotFound(ArRequestHandlerFunction handler) {}
+    void addHandler(AsyncWebHandler* handler) {}
+    void begin() {}
+};
+
+#endif
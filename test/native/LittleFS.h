@@ -0,0 +1,100 @@
+#ifndef NATIVE_LITTLEFS_H
+#define NATIVE_LITTLEFS_H
+
+#include <Arduino.h>
+
+// IN-MEMORY FLASH FILESYSTEM FOR THE OUTBOX LOG, FIXED-SIZE SO A TEST CAN COUNT THE STACK'S OWN HEAP USE
+// (THE REAL LittleFS ALLOCATES A FILE HANDLE PER open(), ONCE PER OUTBOX FLUSH RATHER THAN PER FRAME)
+#define NATIVE_FS_MAX_FILES 4
+#define NATIVE_FS_PATH_LEN 32
+#define NATIVE_FS_MAX_FILE_BYTES 65536
+
+struct NativeFsFile {
+    char path[NATIVE_FS_PATH_LEN];  // Empty: unused
+    uint8_t data[NATIVE_FS_MAX_FILE_BYTES];
+    size_t size;
+};
+
+inline NativeFsFile nativeFsFiles[NATIVE_FS_MAX_FILES];
+inline size_t nativeFsFreeBytes = SIZE_MAX;    // Flash left for writes, a test lowers it to cut writes short
+
+class File {
+public:
+    File(NativeFsFile* file = nullptr) : file_(file), position_(0) {}
+    explicit operator bool() const { return file_ != nullptr; }
+    size_t write(const uint8_t* buf, size_t len) {
+        if (!file_)
+            return 0;
+        len = min(len, min(NATIVE_FS_MAX_FILE_BYTES - file_->size, nativeFsFreeBytes));
+        if (nativeFsFreeBytes != SIZE_MAX)
+            nativeFsFreeBytes -= len;
+        memcpy(file_->data + file_->size, buf, len);
+        file_->size += len;
+        return len;
+    }
+    size_t read(uint8_t* buf, size_t len) {
+        if (!file_)
+            return 0;
+        len = min(len, file_->size - position_);
+        memcpy(buf, file_->data + position_, len);
+        position_ += len;
+        return len;
+    }
+    bool seek(uint32_t pos) {
+        if (!file_ || pos > file_->size)
+            return false;
+        position_ = pos;
+        return true;
+    }
+    size_t size() const { return file_ ? file_->size : 0; }
+    size_t position() const { return position_; }
+    void close() { file_ = nullptr; }
+private:
+    NativeFsFile* file_;
+    size_t position_;
+};
+
+class LittleFSClass {
+public:
+    bool begin(bool formatOnFail = false) { return true; }
+    // "r" READS FROM THE START, "w" TRUNCATES, "a" APPENDS (WRITES ALWAYS GO TO THE END)
+    File open(const char* path, const char* mode) {
+        NativeFsFile* file = find(path);
+        if (!file && mode[0] != 'r') {
+            file = find("");
+            if (file)
+                strncpy(file->path, path, NATIVE_FS_PATH_LEN - 1);
+        }
+        if (file && mode[0] == 'w')
+            file->size = 0;
+        return File(file);
+    }
+    bool exists(const char* path) { return find(path) != nullptr; }
+    bool remove(const char* path) {
+        NativeFsFile* file = find(path);
+        if (!file)
+            return false;
+        file->path[0] = 0;
+        file->size = 0;
+        return true;
+    }
+    bool rename(const char* from, const char* to) {
+        NativeFsFile* file = find(from);
+        if (!file || find(to))
+            return false;
+        strncpy(file->path, to, NATIVE_FS_PATH_LEN - 1);
+        return true;
+    }
+private:
+    NativeFsFile* find(const char* path) {
+        for (NativeFsFile& file : nativeFsFiles) {
+            if (strncmp(file.path, path, NATIVE_FS_PATH_LEN) == 0)
+                return &file;
+        }
+        return nullptr;
+    }
+};
+
+inline LittleFSClass LittleFS;
+
+#endif
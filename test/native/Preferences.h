@@ -0,0 +1,49 @@
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+#include <Arduino.h>
+
+// IN-MEMORY NVS FOR THE KEYS lora_manager.cpp KEEPS (THE BOOT EPOCH), LOST WHEN THE TEST EXITS
+#define NATIVE_NVS_MAX_KEYS 8
+#define NATIVE_NVS_KEY_LEN 16
+
+struct NativeNvsEntry {
+    char key[NATIVE_NVS_KEY_LEN];
+    uint32_t value;
+};
+
+inline NativeNvsEntry nativeNvs[NATIVE_NVS_MAX_KEYS];
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false) { readOnly_ = readOnly; return true; }
+    void end() {}
+    uint16_t getUShort(const char* key, uint16_t defaultValue = 0) {
+        NativeNvsEntry* entry = find(key, false);
+        return entry ? (uint16_t)entry->value : defaultValue;
+    }
+    size_t putUShort(const char* key, uint16_t value) {
+        NativeNvsEntry* entry = readOnly_ ? nullptr : find(key, true);
+        if (!entry)
+            return 0;
+        entry->value = value;
+        return sizeof(value);
+    }
+private:
+    NativeNvsEntry* find(const char* key, bool create) {
+        for (NativeNvsEntry& entry : nativeNvs) {
+            if (strncmp(entry.key, key, NATIVE_NVS_KEY_LEN) == 0)
+                return &entry;
+        }
+        for (NativeNvsEntry& entry : nativeNvs) {
+            if (create && entry.key[0] == 0) {
+                strncpy(entry.key, key, NATIVE_NVS_KEY_LEN - 1);
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+    bool readOnly_ = false;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef NATIVE_RADIOLIB_H
+#define NATIVE_RADIOLIB_H
+
+// SIMULATED SX1262 FOR [env:native] TESTS - THE RADIOLIB CALLS lora_radio.cpp MAKES, WITHOUT RF
+// A TRANSMISSION OR CAD TAKES ITS REAL TIME ON AIR, THEN "DIO1" FIRES ON ANOTHER THREAD LIKE THE INTERRUPT WOULD
+// NOTHING IS EVER RECEIVED, AND THE CHANNEL IS CLEAR UNLESS A TEST SAYS OTHERWISE
+
+#include <Arduino.h>
+#include <atomic>
+
+#define RADIOLIB_ERR_NONE 0
+#define RADIOLIB_ERR_CRC_MISMATCH (-7)
+#define RADIOLIB_ERR_RX_TIMEOUT (-6)
+#define RADIOLIB_LORA_DETECTED (-701)
+#define RADIOLIB_CHANNEL_FREE (-702)
+
+#define RADIOLIB_SX126X_IRQ_HEADER_VALID 0x0010
+#define RADIOLIB_SX126X_RX_TIMEOUT_INF 0x00FFFFFF
+#define RADIOLIB_IRQ_RX_DONE 0x01
+#define RADIOLIB_IRQ_HEADER_VALID 0x04
+#define RADIOLIB_IRQ_CRC_ERR 0x06
+#define RADIOLIB_IRQ_TIMEOUT 0x09
+#define RADIOLIB_IRQ_RX_DEFAULT_FLAGS ((1UL << RADIOLIB_IRQ_RX_DONE) | (1UL << RADIOLIB_IRQ_TIMEOUT) | (1UL << RADIOLIB_IRQ_CRC_ERR))
+#define RADIOLIB_IRQ_RX_DEFAULT_MASK (1UL << RADIOLIB_IRQ_RX_DONE)
+
+#define SIM_RADIO_SCAN_LOG 32   // CAD start times kept for a test to look at
+
+class Module {
+public:
+    Module(int cs, int irq, int rst, int gpio) {}
+};
+
+class SX1262 {
+public:
+    SX1262(Module* module) {}
+
+    int16_t begin(float freq, float bw, uint8_t sf, uint8_t cr, uint8_t syncWord, int8_t power, uint16_t preambleLength);
+    int16_t setDio2AsRfSwitch(bool enable = true) { return RADIOLIB_ERR_NONE; }
+    void setDio1Action(void (*func)(void)) { dio1Action_ = func; }
+    int16_t standby();
+    int16_t setSpreadingFactor(uint8_t sf);
+    int16_t setOutputPower(int8_t power);
+
+    int16_t startReceive(uint32_t timeout, uint32_t irqFlags, uint32_t irqMask, size_t len);
+    size_t getPacketLength(bool update = true) { return 0; }
+    int16_t readData(uint8_t* data, size_t len) { return RADIOLIB_ERR_RX_TIMEOUT; }
+    float getRSSI() { return 0.0f; }
+    float getSNR() { return 0.0f; }
+    uint32_t getIrqFlags() { return 0; }
+
+    int16_t startChannelScan();
+    int16_t getChannelScanResult() { return channelBusy_.load() ? RADIOLIB_LORA_DETECTED : RADIOLIB_CHANNEL_FREE; }
+
+    int16_t startTransmit(const uint8_t* data, size_t len, uint8_t addr = 0);
+    int16_t finishTransmit();
+    int16_t transmit(const uint8_t* data, size_t len, uint8_t addr = 0);  // Blocks for the time on air
+
+    uint32_t framesSent() const { return framesSent_.load(); }
+
+    // EVERY CAD FINDS A PREAMBLE WHILE THE CHANNEL IS BUSY
+    void setChannelBusy(bool busy) { channelBusy_ = busy; }
+    uint32_t channelScans() const { return channelScans_.load(); }
+    unsigned long channelScanStartUs(uint32_t scan) const { return scanStartUs_[scan % SIM_RADIO_SCAN_LOG].load(); }
+
+private:
+    uint32_t airtimeUs(size_t len) const;
+    void raiseDio1After(uint32_t us);
+
+    float bw_ = 125.0f;
+    uint8_t sf_ = 7;
+    uint8_t cr_ = 5;
+    uint16_t preambleLength_ = 8;
+    void (*dio1Action_)(void) = nullptr;
+    std::atomic<uint32_t> operation_{0};     // Bumped by every new operation, so a stale DIO1 is not raised
+    std::atomic<uint32_t> framesSent_{0};
+    std::atomic<bool> channelBusy_{false};
+    std::atomic<uint32_t> channelScans_{0};
+    std::atomic<unsigned long> scanStartUs_[SIM_RADIO_SCAN_LOG] = {};
+};
+
+#endif
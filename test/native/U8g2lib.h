@@ -0,0 +1,9 @@
+#ifndef NATIVE_U8G2LIB_H
+#define NATIVE_U8G2LIB_H
+
+// ONLY THE DISPLAY TYPES display_manager.h NAMES - THE DISPLAY ITSELF IS NOT BUILT FOR [env:native]
+#define U8X8_PIN_NONE 255
+class U8G2_SSD1306_128X64_NONAME_F_HW_I2C;
+class U8G2_SH1106_128X64_NONAME_F_HW_I2C;
+
+#endif
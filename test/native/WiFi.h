@@ -0,0 +1,29 @@
+#ifndef NATIVE_WIFI_H
+#define NATIVE_WIFI_H
+
+#include <Arduino.h>
+#include <functional>
+
+// HOST STAND-IN FOR THE SOFT-AP CALLS web_manager.cpp MAKES - THERE IS NO NETWORK, NO STATION EVER JOINS
+#define ARDUINO_EVENT_WIFI_AP_STACONNECTED 12
+#define ARDUINO_EVENT_WIFI_AP_STADISCONNECTED 13
+
+typedef int WiFiEvent_t;
+struct WiFiEventInfo_t {};
+
+class IPAddress {
+public:
+    String toString() const { return String("192.168.4.1"); }
+    operator String() const { return toString(); } // Serial.println() takes it as Printable on the board
+};
+
+class WiFiClass {
+public:
+    bool softAP(const char* ssid, const char* password) { return true; }
+    IPAddress softAPIP() { return IPAddress(); }
+    uint8_t softAPgetStationNum() { return 0; }
+    void onEvent(std::function<void(WiFiEvent_t, WiFiEventInfo_t)> handler) {}
+};
+inline WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,15 @@
+#include "display_manager.h"
+
+// THE STATUS LINE THE LORA MODULES WRITE GOES TO THE TEST OUTPUT INSTEAD OF THE OLED, THE LAST RX/TX TEXT NOWHERE
+
+void setDisplayStatusLine(const char* status) {
+    Serial.printf("[Display] %s\n", status);
+}
+
+void setLastLoRaRx(const char* rx) {}
+void setLastLoRaTx(const char* tx) {}
+
+// THE SOFT-AP AND WEBSOCKET STATUS web_manager.cpp REPORTS, NOTHING TO SHOW ON THE HOST
+void setDisplayAPIP(const String& ipAddress) {}
+void setDisplayWiFiClientCount(int count) {}
+void setDisplayWebSocketStatus(bool connected) {}
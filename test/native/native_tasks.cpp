@@ -0,0 +1,60 @@
+#include <Arduino.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// HOST FREERTOS TASKS - A THREAD PER TASK WITH A NOTIFICATION VALUE GUARDED BY A MUTEX
+// TASKS ARE NEVER DELETED (LIKE THE FIRMWARE'S), SO THEIR STATE IS NEVER FREED EITHER
+struct NativeTask {
+    std::mutex lock;
+    std::condition_variable notified;
+    uint32_t value = 0;
+    bool pending = false;
+};
+
+static thread_local NativeTask* currentTask = nullptr;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stackDepth, void* param,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    NativeTask* nativeTask = new NativeTask();
+    if (handle) *handle = nativeTask;
+    std::thread([=]() {
+        currentTask = nativeTask;
+        task(param);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    if (!task) return pdFALSE;
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        if (action == eSetBits) task->value |= value;
+        else if (action == eIncrement) task->value++;
+        task->pending = true;
+    }
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t* higherPriorityTaskWoken) {
+    if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+    return xTaskNotify(task, value, action);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t* value, TickType_t ticksToWait) {
+    NativeTask* task = currentTask;
+    std::unique_lock<std::mutex> guard(task->lock);
+    if (!task->pending) task->value &= ~clearOnEntry;
+    if (ticksToWait == portMAX_DELAY) task->notified.wait(guard, [task] { return task->pending; });
+    else task->notified.wait_for(guard, std::chrono::milliseconds(ticksToWait), [task] { return task->pending; });
+    if (value) *value = task->value;
+    if (!task->pending) return pdFALSE;
+    task->pending = false;
+    task->value &= ~clearOnExit;
+    return pdTRUE;
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
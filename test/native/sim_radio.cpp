@@ -0,0 +1,69 @@
+#include <RadioLib.h>
+#include <thread>
+#include "lora_airtime.h"
+
+// SIMULATED SX1262 (SEE RadioLib.h)
+
+int16_t SX1262::begin(float freq, float bw, uint8_t sf, uint8_t cr, uint8_t syncWord, int8_t power, uint16_t preambleLength) {
+    bw_ = bw;
+    sf_ = sf;
+    cr_ = cr;
+    preambleLength_ = preambleLength;
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::standby() {
+    operation_++;
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::setSpreadingFactor(uint8_t sf) {
+    sf_ = sf;
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::setOutputPower(int8_t power) {
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::startReceive(uint32_t timeout, uint32_t irqFlags, uint32_t irqMask, size_t len) {
+    operation_++;
+    return RADIOLIB_ERR_NONE;
+}
+
+// A CAD LASTS ABOUT TWO SYMBOLS
+int16_t SX1262::startChannelScan() {
+    scanStartUs_[channelScans_.load() % SIM_RADIO_SCAN_LOG] = micros();
+    channelScans_++;
+    raiseDio1After((uint32_t)(2.0f * (float)(1UL << sf_) * 1000.0f / bw_));
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::startTransmit(const uint8_t* data, size_t len, uint8_t addr) {
+    raiseDio1After(airtimeUs(len));
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::finishTransmit() {
+    framesSent_++;
+    return standby();
+}
+
+int16_t SX1262::transmit(const uint8_t* data, size_t len, uint8_t addr) {
+    operation_++;
+    std::this_thread::sleep_for(std::chrono::microseconds(airtimeUs(len)));
+    framesSent_++;
+    return RADIOLIB_ERR_NONE;
+}
+
+uint32_t SX1262::airtimeUs(size_t len) const {
+    return loRaTimeOnAirUs(len, sf_, bw_, cr_, preambleLength_);
+}
+
+void SX1262::raiseDio1After(uint32_t us) {
+    uint32_t operation = ++operation_;
+    std::thread([this, operation, us]() {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+        if (operation_.load() == operation && dio1Action_) dio1Action_();
+    }).detach();
+}
@@ -0,0 +1,307 @@
+#include <unity.h>
+#include <atomic>
+#include <pthread.h>
+#include <thread>
+#include "encryption.h"
+#include "lora_arq.h"
+#include "lora_compress.h"
+#include "lora_manager.h"
+
+// HEAP ALLOCATIONS ON THE LOOP THREAD WHILE THE LORA STACK SENDS AND RECEIVES MESSAGES IN STEADY STATE.
+// A PEER'S FRAMES (DATA, A REPLAYED COPY AND ACKS) ARE PUT IN THE RX RING AS THE RADIO TASK WOULD, OUR FRAMES
+// GO OUT THROUGH THE RADIO TASK TO THE SIMULATED SX1262. THE CALLBACKS STAND IN FOR THE WEB FORWARDING
+#define MY_ADDRESS 0x0001
+#define PEER_ADDRESS 0x0002
+#define PEER_FIRST_SEQ 0x00030000
+#define WARMUP_ROUNDS 8
+#define MEASURED_ROUNDS 32
+#define ROUND_TIMEOUT_MS 3000
+
+static const char *const messages[] = {
+    "On my way, be there in 10",
+    "Copy that. Heading back to camp now",
+    "QXZJKV 4412.5N 07312.9W",
+    "Did you see the weather report for tomorrow? The north trail will be closed after the second turn, "
+    "so we will meet at the south trailhead instead. Bring water for everyone, the spring is dry this time "
+    "of year. If the wind picks up we will wait at the bridge until it is safe to go on. Call me on channel "
+    "3 when you are close and I will come down to meet you there. KD2ABC has the spare radio and the "
+    "first aid kit, so stay with them if we get split up. Battery at 45%, going to save power after this "
+    "message, next check in at 1800 on the hour. QXZJKV 7 4412.5N 07312.9W grid ref for the camp.",
+    "Roger, out",
+};
+#define MESSAGE_COUNT (sizeof(messages) / sizeof(messages[0]))
+
+// COUNTS EVERY HEAP ALLOCATION MADE BY THE LOOP THREAD WHILE counting IS SET
+static std::atomic<bool> counting{false};
+static std::atomic<uint32_t> allocations{0};
+static pthread_t loopThread;
+
+static void noteAllocation()
+{
+  if (counting.load(std::memory_order_relaxed) && pthread_equal(pthread_self(), loopThread))
+    allocations++;
+}
+
+#if defined(__GLIBC__)
+// MALLOC ITSELF, SO C CODE AND operator new (WHICH CALLS MALLOC) ARE BOTH SEEN
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void *malloc(size_t size) noexcept
+{
+  noteAllocation();
+  return __libc_malloc(size);
+}
+extern "C" void *calloc(size_t count, size_t size) noexcept
+{
+  noteAllocation();
+  return __libc_calloc(count, size);
+}
+extern "C" void *realloc(void *ptr, size_t size) noexcept
+{
+  noteAllocation();
+  return __libc_realloc(ptr, size);
+}
+#else
+void *operator new(size_t size)
+{
+  noteAllocation();
+  void *ptr = malloc(size ? size : 1);
+  if (!ptr)
+    abort();
+  return ptr;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+#endif
+
+static uint32_t delivered = 0;
+static uint32_t pending = 0;
+static uint32_t acked = 0;
+static uint32_t failed = 0;
+static uint32_t peerSeq = PEER_FIRST_SEQ;
+static uint32_t peerAckSerial = 0;
+static const char *expectedText = nullptr;
+static uint32_t mismatches = 0;
+
+static void onMessage(const char *senderId, const char *message, size_t messageLen)
+{
+  delivered++;
+  if (!expectedText || strlen(expectedText) != messageLen || memcmp(expectedText, message, messageLen) != 0)
+    mismatches++;
+}
+
+static void onAckStatus(const char *localWebId, uint32_t loraMessageId, bool isAcked, bool finalFailure)
+{
+  if (isAcked)
+    acked++;
+  else if (finalFailure)
+    failed++;
+  else
+    pending++;
+}
+
+// PUT A FRAME FROM THE PEER IN THE RX RING, AS IF THE RADIO TASK HAD JUST READ IT
+static void receiveFromPeer(const uint8_t *frame, size_t frameLen)
+{
+  LoRaRadioFrame *rxFrame = loraRxRing.acquire();
+  TEST_ASSERT_NOT_NULL(rxFrame);
+  memcpy(rxFrame->data, frame, frameLen);
+  rxFrame->len = frameLen;
+  rxFrame->rssi = -60.0f;
+  rxFrame->snr = 9.0f;
+  rxFrame->sf = LORA_SF_MIN;
+  rxFrame->timestamp = millis();
+  loraRxRing.commit();
+}
+
+static LoRaFrameHeader peerHeader(uint8_t type)
+{
+  LoRaFrameHeader header = {};
+  header.version = LORA_PROTOCOL_VERSION;
+  header.type = type;
+  header.dstAddress = MY_ADDRESS;
+  header.srcAddress = PEER_ADDRESS;
+  header.linkSf = LORA_SF_MIN;
+  header.linkPower = 10;
+  header.hopLimit = 3;
+  header.attempt = (type == LORA_FRAME_DATA) ? 1 : 0;
+  header.lastHop = PEER_ADDRESS;
+  header.nextHop = MY_ADDRESS;
+  return header;
+}
+
+// THE PEER'S SIDE OF queueLoRaMessage() AND sendOutgoingSlot(): COMPRESS, FRAGMENT, SEAL, SEND.
+// THE FIRST FRAME IS HEARD TWICE, THE SECOND COPY MUST BE DROPPED AS A REPEAT
+static void sendFromPeer(const char *text)
+{
+  static uint8_t body[LORA_MAX_MESSAGE_LEN];
+  size_t textLen = strlen(text);
+  uint8_t flags = LORA_FLAG_ENCRYPTED | LORA_FLAG_COMPRESSED;
+  size_t bodyLen = compressText(text, textLen, body, sizeof(body));
+  if (bodyLen == 0)
+  {
+    memcpy(body, text, textLen);
+    bodyLen = textLen;
+    flags = LORA_FLAG_ENCRYPTED;
+  }
+  uint8_t fragCount = 1;
+  size_t chunkLen = bodyLen;
+  if (bodyLen > LORA_MAX_PAYLOAD_LEN)
+  {
+    chunkLen = LORA_MAX_FRAGMENT_PAYLOAD_LEN;
+    fragCount = (uint8_t)((bodyLen + chunkLen - 1) / chunkLen);
+    flags |= LORA_FLAG_FRAGMENT;
+  }
+
+  uint32_t base = peerSeq;
+  for (uint8_t fragIndex = 0; fragIndex < fragCount; fragIndex++)
+  {
+    LoRaFrameHeader header = peerHeader(LORA_FRAME_DATA);
+    header.flags = flags;
+    header.messageId = peerSeq++;
+    header.windowOffset = (uint8_t)(header.messageId - base);
+    header.fragIndex = fragIndex;
+    header.fragCount = fragCount;
+    size_t offset = (size_t)fragIndex * chunkLen;
+    size_t len = min(chunkLen, bodyLen - offset);
+
+    uint8_t frame[LORA_MAX_FRAME_LEN];
+    size_t headerLen = loRaHeaderLen(header);
+    size_t frameLen = encodeLoRaFrame(header, body + offset, len, frame, sizeof(frame) - LORA_AUTH_TAG_LEN);
+    uint8_t aad[LORA_MAX_HEADER_LEN];
+    TEST_ASSERT_TRUE(encryptPayload(frame + headerLen, len, aad, loRaAuthData(frame, headerLen, aad), header,
+                                    frame + frameLen));
+    receiveFromPeer(frame, frameLen + LORA_AUTH_TAG_LEN);
+    if (fragIndex == 0)
+      receiveFromPeer(frame, frameLen + LORA_AUTH_TAG_LEN);
+  }
+}
+
+// THE PEER'S SIDE OF sendSelectiveAck(): EVERYTHING WE HAVE SENT IT SO FAR ARRIVED
+static void ackFromPeer()
+{
+  const ArqTxStream *tx = arqFindTxStream(PEER_ADDRESS);
+  TEST_ASSERT_NOT_NULL(tx);
+  LoRaFrameHeader header = peerHeader(LORA_FRAME_ACK);
+  header.messageId = tx->nextSeq - 1;
+  header.ackStream = PEER_ADDRESS;
+  header.ackSerial = ++peerAckSerial;
+
+  uint8_t encoded[LORA_ACK_HEADER_LEN];
+  uint8_t aad[LORA_MAX_HEADER_LEN];
+  uint8_t tag[LORA_AUTH_TAG_LEN];
+  encodeLoRaFrame(header, nullptr, 0, encoded, sizeof(encoded));
+  TEST_ASSERT_TRUE(encryptPayload(nullptr, 0, aad, loRaAuthData(encoded, LORA_ACK_HEADER_LEN, aad), header, tag));
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+  receiveFromPeer(frame, encodeLoRaFrame(header, tag, sizeof(tag), frame, sizeof(frame)));
+}
+
+// EVERY FRAME THE STACK HANDED THE RADIO TASK HAS LEFT IT
+static bool txRingEmpty()
+{
+  return loraRadioStats.txDone.load() + loraRadioStats.txFailed.load() ==
+         loraStackStats.dataFramesSent.load() + loraStackStats.ackFramesSent.load();
+}
+
+// RUN THE LOOP UNTIL done() OR THE ROUND TIMES OUT
+template <typename Done>
+static bool runLoopUntil(Done done)
+{
+  unsigned long deadline = millis() + ROUND_TIMEOUT_MS;
+  while (!done())
+  {
+    if ((long)(millis() - deadline) >= 0)
+      return false;
+    handleLoRaEvents();
+    delay(1);
+  }
+  return true;
+}
+
+// ONE MESSAGE EACH WAY: THE PEER'S IS DELIVERED, OURS CARRIES THE ACK FOR IT AND IS ACKED IN TURN
+static void runRound(uint32_t round)
+{
+  expectedText = messages[round % MESSAGE_COUNT];
+  uint32_t deliveredBefore = delivered;
+  sendFromPeer(expectedText);
+  TEST_ASSERT_TRUE(runLoopUntil([&]() { return delivered == deliveredBefore + 1; }));
+
+  char localWebId[16];
+  snprintf(localWebId, sizeof(localWebId), "web-%u", (unsigned)round);
+  uint32_t pendingBefore = pending;
+  uint32_t ackedBefore = acked;
+  TEST_ASSERT_EQUAL(LORA_SUBMIT_OK, submitLoRaMessage(messages[(round + 1) % MESSAGE_COUNT], localWebId, PEER_ADDRESS));
+  TEST_ASSERT_TRUE(runLoopUntil([&]() { return pending == pendingBefore + 1; }));
+  ackFromPeer();
+  TEST_ASSERT_TRUE(runLoopUntil([&]() {
+    return acked == ackedBefore + 1 && !arqPendingAckFor(PEER_ADDRESS) && txRingEmpty();
+  }));
+}
+
+void setUp() {}
+void tearDown() {}
+
+// THE HOOK ITSELF: AN ALLOCATION ON THE LOOP THREAD IS COUNTED, ONE ON ANOTHER THREAD IS NOT
+static void test_counter_sees_loop_thread_allocations()
+{
+  loopThread = pthread_self();
+  std::atomic<int> step{0};
+  std::thread other([&step]() {
+    while (step.load() != 1)
+      std::this_thread::yield();
+    void *volatile block = malloc(32);
+    free(block);
+    step = 2;
+  });
+  counting = true;
+  void *volatile block = malloc(32);
+  free(block);
+  step = 1;
+  while (step.load() != 2)
+    std::this_thread::yield();
+  counting = false;
+  other.join();
+  TEST_ASSERT_EQUAL_UINT32(1, allocations.load());
+  allocations = 0;
+}
+
+static void test_steady_state_send_and_receive_do_not_allocate()
+{
+  loopThread = pthread_self();
+  setupLoRa(MY_ADDRESS, onMessage, onAckStatus);
+  uint32_t round = 0;
+  for (; round < WARMUP_ROUNDS; round++)
+    runRound(round);
+
+  uint32_t deliveredBefore = delivered;
+  uint32_t ackedBefore = acked;
+  uint32_t framesBefore = loraRadioStats.txDone.load();
+  counting = true;
+  for (; round < WARMUP_ROUNDS + MEASURED_ROUNDS; round++)
+    runRound(round);
+  counting = false;
+
+  char report[160];
+  snprintf(report, sizeof(report), "%u messages each way, %u frames sent (%u ACKs piggybacked): %u heap allocations on the loop thread",
+           MEASURED_ROUNDS, (unsigned)(loraRadioStats.txDone.load() - framesBefore),
+           (unsigned)loraStackStats.acksPiggybacked.load(), (unsigned)allocations.load());
+  TEST_MESSAGE(report);
+  TEST_ASSERT_EQUAL_UINT32(MEASURED_ROUNDS, delivered - deliveredBefore);
+  TEST_ASSERT_EQUAL_UINT32(MEASURED_ROUNDS, acked - ackedBefore);
+  TEST_ASSERT_EQUAL_UINT32(0, mismatches);
+  TEST_ASSERT_EQUAL_UINT32(0, failed);
+  TEST_ASSERT_EQUAL_UINT32(0, loraStackStats.authFailures.load());
+  TEST_ASSERT_EQUAL_UINT32(0, allocations.load());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_counter_sees_loop_thread_allocations);
+  RUN_TEST(test_steady_state_send_and_receive_do_not_allocate);
+  return UNITY_END();
+}
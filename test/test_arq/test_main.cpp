@@ -0,0 +1,285 @@
+#include <unity.h>
+#include "lora_arq.h"
+
+// HOST TESTS FOR THE SLIDING WINDOWS: THE RECEIVER'S SACK STATE ACROSS LOSSES, REORDERING AND A SENDER THAT
+// GAVE UP, A WHOLE TRANSFER OVER A LOSSY CHANNEL, BOOT EPOCHS, RECYCLED STREAMS AND THE RETRANSMISSION
+// TIMEOUT. EACH TEST USES ITS OWN PEER ADDRESSES, THE STREAM TABLES CARRY OVER
+#define MY_ADDRESS 0x0001
+#define TRANSFER_FRAMES 60
+
+static unsigned long now = 1000;
+
+void setUp()
+{
+  now += 1000;
+}
+
+void tearDown() {}
+
+// THE FIRST FRAME SYNCHRONISES THE WINDOW, A LOST ONE SHOWS AS A GAP IN THE BITMAP UNTIL ITS RETRANSMIT FILLS IT
+static void test_receiver_sacks_around_a_loss()
+{
+  ArqRxStream *rx = arqRxStreamFor(0x0301, MY_ADDRESS, now);
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqAcceptFrame(*rx, 100, 0));
+  TEST_ASSERT_EQUAL_UINT32(100, rx->cumAck);
+
+  // 101 IS LOST, 102 AND 104 GET THROUGH
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqAcceptFrame(*rx, 102, 1));
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqAcceptFrame(*rx, 104, 3));
+  TEST_ASSERT_EQUAL_UINT32(100, rx->cumAck);
+  TEST_ASSERT_EQUAL_UINT32(0x0A, rx->bitmap);
+  TEST_ASSERT_FALSE(arqSeqAcked(101, rx->cumAck, rx->bitmap));
+  TEST_ASSERT_TRUE(arqSeqAcked(102, rx->cumAck, rx->bitmap));
+  TEST_ASSERT_FALSE(arqSeqAcked(103, rx->cumAck, rx->bitmap));
+  TEST_ASSERT_TRUE(arqSeqAcked(104, rx->cumAck, rx->bitmap));
+  TEST_ASSERT_EQUAL(ARQ_RX_DUPLICATE, arqAcceptFrame(*rx, 102, 1));
+
+  // THE RETRANSMIT OF 101 CLOSES THE FIRST GAP, THE CUMULATIVE ACK MOVES UP TO THE NEXT ONE
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqAcceptFrame(*rx, 101, 0));
+  TEST_ASSERT_EQUAL_UINT32(102, rx->cumAck);
+  TEST_ASSERT_EQUAL_UINT32(0x02, rx->bitmap);
+  TEST_ASSERT_EQUAL(ARQ_RX_DUPLICATE, arqAcceptFrame(*rx, 101, 0));
+  TEST_ASSERT_EQUAL(ARQ_RX_DUPLICATE, arqAcceptFrame(*rx, 100, 0));
+
+  // THE BITMAP DESCRIBES 32 FRAMES PAST THE CUMULATIVE ACK, NOTHING FURTHER
+  TEST_ASSERT_EQUAL(ARQ_RX_OUT_OF_WINDOW, arqAcceptFrame(*rx, 102 + 33, 32));
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqAcceptFrame(*rx, 102 + 32, 31));
+}
+
+// A SENDER THAT RAN OUT OF RETRIES MOVES ITS BASE ON - THE RECEIVER FOLLOWS INSTEAD OF WAITING FOR THE GAP
+static void test_receiver_follows_a_sender_that_gave_up()
+{
+  ArqRxStream *rx = arqRxStreamFor(0x0302, MY_ADDRESS, now);
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqAcceptFrame(*rx, 200, 0));
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqAcceptFrame(*rx, 203, 2)); // 201 outstanding, sender base 201
+  TEST_ASSERT_EQUAL_UINT32(200, rx->cumAck);
+
+  // 201 AND 202 ABANDONED: THE NEXT FRAME SAYS THE BASE IS 203
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqAcceptFrame(*rx, 204, 1));
+  TEST_ASSERT_EQUAL_UINT32(204, rx->cumAck);
+  TEST_ASSERT_EQUAL_UINT32(0, rx->bitmap);
+  TEST_ASSERT_EQUAL(ARQ_RX_DUPLICATE, arqAcceptFrame(*rx, 201, 0)); // A late copy is not delivered twice
+}
+
+// A FIXED PATTERN OF LOST FRAMES AND LOST ACKS
+static bool lost(uint32_t round, uint32_t seq)
+{
+  return (round * 7 + seq * 3) % 5 < 2;
+}
+
+// A WHOLE TRANSFER OVER A CHANNEL THAT LOSES 40 % OF FRAMES AND OF ACKS: NEVER MORE THAN A WINDOW IN FLIGHT,
+// EVERY FRAME DELIVERED EXACTLY ONCE, THE SENDER'S WINDOW SETTLED BY SELECTIVE ACKS ALONE
+static void test_lossy_transfer_delivers_every_frame_once()
+{
+  ArqTxStream *tx = arqTxStreamFor(0x0303, now);
+  TEST_ASSERT_NOT_NULL(tx);
+  ArqRxStream *rx = arqRxStreamFor(MY_ADDRESS, 0x0303, now);
+  uint32_t first = tx->base;
+  uint8_t deliveries[TRANSFER_FRAMES] = {};
+
+  uint32_t round = 0;
+  while (tx->base != first + TRANSFER_FRAMES)
+  {
+    TEST_ASSERT_TRUE_MESSAGE(++round < 200, "Transfer stalled");
+    while (arqWindowOpen(*tx) && tx->nextSeq != first + TRANSFER_FRAMES)
+    {
+      tx->slotBySeq[tx->nextSeq % ARQ_WINDOW_SIZE] = 0;
+      tx->nextSeq++;
+    }
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(ARQ_WINDOW_SIZE, tx->nextSeq - tx->base);
+
+    // EVERY UNSETTLED FRAME IN THE WINDOW GOES OUT, SOME OF THEM ARRIVE
+    for (uint32_t seq = tx->base; seq != tx->nextSeq; seq++)
+    {
+      if (tx->slotBySeq[seq % ARQ_WINDOW_SIZE] < 0 || lost(round, seq))
+        continue;
+      ArqRxResult result = arqAcceptFrame(*rx, seq, seq - tx->base);
+      TEST_ASSERT_TRUE(result != ARQ_RX_OUT_OF_WINDOW);
+      if (result == ARQ_RX_NEW)
+        deliveries[seq - first]++;
+    }
+
+    // THE RECEIVER'S SACK, WHEN IT GETS THROUGH, SETTLES EVERYTHING IT COVERS
+    if (lost(round, 0))
+      continue;
+    for (uint32_t seq = tx->base; seq != tx->nextSeq; seq++)
+    {
+      if (arqSeqAcked(seq, rx->cumAck, rx->bitmap))
+        tx->slotBySeq[seq % ARQ_WINDOW_SIZE] = -1;
+    }
+    arqAdvanceBase(*tx);
+  }
+
+  for (size_t i = 0; i < TRANSFER_FRAMES; i++)
+    TEST_ASSERT_EQUAL_UINT8(1, deliveries[i]);
+  TEST_ASSERT_EQUAL_UINT32(first + TRANSFER_FRAMES - 1, rx->cumAck);
+  TEST_ASSERT_EQUAL_UINT32(0, rx->bitmap);
+}
+
+// A REBOOTED SENDER RESUMES IN A NEWER EPOCH: ITS NEW FRAMES ARE DELIVERED, REPLAYS FROM BEFORE THE REBOOT ARE NOT
+static void test_old_epoch_frames_are_duplicates_after_a_reboot()
+{
+  ArqRxStream *rx = arqRxStreamFor(0x0304, MY_ADDRESS, now);
+  uint32_t before = (uint32_t)5 << 16;
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqAcceptFrame(*rx, before, 0));
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqAcceptFrame(*rx, before + 1, 1));
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqAcceptFrame(*rx, before + 3, 3)); // before + 2 never arrives
+
+  uint32_t after = (uint32_t)6 << 16;
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqAcceptFrame(*rx, after, 0));
+  TEST_ASSERT_EQUAL_UINT32(after, rx->cumAck);
+  TEST_ASSERT_EQUAL(ARQ_RX_DUPLICATE, arqAcceptFrame(*rx, before + 1, 1));
+  TEST_ASSERT_EQUAL(ARQ_RX_DUPLICATE, arqAcceptFrame(*rx, before + 2, 2));
+  TEST_ASSERT_EQUAL(ARQ_RX_DUPLICATE, arqAcceptFrame(*rx, before + 4, 0));
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqAcceptFrame(*rx, after + 1, 1));
+}
+
+// OUR OWN STREAMS START IN THE EPOCH THIS BOOT WAS GIVEN, AND A RECYCLED ONE ABOVE EVERYTHING ITS PREDECESSOR SENT
+static void test_new_streams_start_above_earlier_sequences()
+{
+  arqSetEpoch(9);
+  arqSetEpoch(8); // An older epoch never moves sequence numbers back
+  ArqTxStream *tx = nullptr;
+  for (uint16_t peer = 0x0310; peer < 0x0310 + ARQ_MAX_PEERS; peer++)
+  {
+    now++;
+    tx = arqTxStreamFor(peer, now);
+    TEST_ASSERT_NOT_NULL(tx);
+    TEST_ASSERT_FALSE(arqSeqBefore(tx->base, (uint32_t)9 << 16));
+  }
+
+  // EVERY STREAM IS NOW OURS: THE OLDEST, 0x0310, IS RECYCLED AFTER SENDING A FEW FRAMES
+  ArqTxStream *oldest = arqFindTxStream(0x0310);
+  oldest->nextSeq += 5;
+  oldest->base = oldest->nextSeq;
+  uint32_t sent = oldest->nextSeq;
+  tx = arqTxStreamFor(0x0320, ++now);
+  TEST_ASSERT_TRUE(tx == oldest);
+  TEST_ASSERT_NULL(arqFindTxStream(0x0310));
+  TEST_ASSERT_FALSE(arqSeqBefore(tx->base, sent));
+
+  // A RECEIVER STILL TRACKING THE RECYCLED STREAM TAKES THE NEW ONE'S FRAMES AS NEW
+  ArqRxStream *rx = arqRxStreamFor(MY_ADDRESS, 0x0310, now);
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqAcceptFrame(*rx, sent - 1, 0));
+  tx = arqTxStreamFor(0x0310, ++now);
+  TEST_ASSERT_NOT_NULL(tx);
+  TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqAcceptFrame(*rx, tx->base, 0));
+
+  // A STREAM WITH FRAMES IN FLIGHT IS NEVER RECYCLED
+  for (size_t i = 0; i < ARQ_MAX_PEERS; i++)
+  {
+    ArqTxStream *busy = const_cast<ArqTxStream *>(arqTxStreamAt(i));
+    busy->nextSeq = busy->base + 1;
+  }
+  TEST_ASSERT_NULL(arqTxStreamFor(0x0330, ++now));
+  for (size_t i = 0; i < ARQ_MAX_PEERS; i++)
+  {
+    ArqTxStream *busy = const_cast<ArqTxStream *>(arqTxStreamAt(i));
+    busy->base = busy->nextSeq;
+  }
+}
+
+// A STREAM WITH FRAMES IN FLIGHT IS NEVER RECYCLED, AN IDLE ONE IS
+static void test_only_idle_streams_are_recycled()
+{
+  for (uint16_t peer = 0x0350; peer < 0x0350 + ARQ_MAX_PEERS; peer++)
+  {
+    now++;
+    ArqTxStream *tx = arqTxStreamFor(peer, now);
+    TEST_ASSERT_NOT_NULL(tx);
+    tx->nextSeq = tx->base + 1;
+  }
+  TEST_ASSERT_NULL(arqTxStreamFor(0x0360, ++now));
+
+  // 0x0351 SETTLES ITS FRAME, IT IS THE ONLY ONE THAT CAN MAKE WAY
+  ArqTxStream *idle = arqFindTxStream(0x0351);
+  idle->base = idle->nextSeq;
+  ArqTxStream *tx = arqTxStreamFor(0x0360, ++now);
+  TEST_ASSERT_TRUE(tx == idle);
+  TEST_ASSERT_NULL(arqFindTxStream(0x0351));
+  TEST_ASSERT_NOT_NULL(arqFindTxStream(0x0350));
+  TEST_ASSERT_EQUAL_UINT32(tx->base, tx->nextSeq);
+}
+
+// EVERY TIMEOUT FOR A STREAM LIES BETWEEN ITS BASE VALUE AND 50 % ABOVE IT
+static void assertTimeout(const ArqTxStream &tx, uint32_t floorMs, uint32_t expected)
+{
+  for (int i = 0; i < 50; i++)
+  {
+    uint32_t timeout = arqRetransmitTimeout(tx, floorMs);
+    TEST_ASSERT_TRUE(timeout >= expected && timeout <= expected + expected / 2);
+  }
+}
+
+// RFC 6298: THE FIRST SAMPLE SEEDS THE ESTIMATE, LATER ONES ARE SMOOTHED, THE RESULT KEPT WITHIN ITS BOUNDS
+static void test_rto_follows_the_measured_round_trip()
+{
+  ArqTxStream *tx = arqTxStreamFor(0x0340, now);
+  TEST_ASSERT_NOT_NULL(tx);
+  TEST_ASSERT_FALSE(tx->rttValid);
+  TEST_ASSERT_EQUAL_UINT32(ARQ_RTO_INITIAL_MS, tx->rto);
+  assertTimeout(*tx, 0, ARQ_RTO_INITIAL_MS);
+
+  arqRttSample(*tx, 1000);
+  TEST_ASSERT_EQUAL_UINT32(1000, tx->srtt);
+  TEST_ASSERT_EQUAL_UINT32(500, tx->rttvar);
+  TEST_ASSERT_EQUAL_UINT32(3000, tx->rto);
+  arqRttSample(*tx, 1000);
+  TEST_ASSERT_EQUAL_UINT32(1000, tx->srtt);
+  TEST_ASSERT_EQUAL_UINT32(375, tx->rttvar);
+  TEST_ASSERT_EQUAL_UINT32(2500, tx->rto);
+  arqRttSample(*tx, 1800);
+  TEST_ASSERT_EQUAL_UINT32(1100, tx->srtt);
+  TEST_ASSERT_EQUAL_UINT32(481, tx->rttvar);
+  TEST_ASSERT_EQUAL_UINT32(1100 + 4 * 481, tx->rto);
+
+  // A STEADY FAST LINK IS STILL GIVEN ARQ_RTO_MIN_MS OF SLACK, AND NEVER LESS THAN THE AIRTIME FLOOR
+  for (int i = 0; i < 40; i++)
+    arqRttSample(*tx, 100);
+  TEST_ASSERT_EQUAL_UINT32(tx->srtt + ARQ_RTO_MIN_MS, tx->rto);
+  assertTimeout(*tx, 2000, 2000);
+
+  // A VERY SLOW ONE IS CAPPED
+  tx = arqTxStreamFor(0x0341, now);
+  TEST_ASSERT_NOT_NULL(tx);
+  arqRttSample(*tx, 50000);
+  TEST_ASSERT_EQUAL_UINT32(ARQ_RTO_MAX_MS, tx->rto);
+  assertTimeout(*tx, 0, ARQ_RTO_MAX_MS);
+}
+
+// CONSECUTIVE TIMEOUTS DOUBLE THE NEXT ONE, UP TO A LIMIT, UNTIL A CLEAN SAMPLE ARRIVES
+static void test_timeouts_back_off_until_a_clean_sample()
+{
+  ArqTxStream *tx = arqTxStreamFor(0x0342, now);
+  TEST_ASSERT_NOT_NULL(tx);
+  arqRttSample(*tx, 200); // rto 200 + 400
+  TEST_ASSERT_EQUAL_UINT32(600, tx->rto);
+
+  arqRtoBackoff(*tx);
+  assertTimeout(*tx, 0, 1200);
+  arqRtoBackoff(*tx);
+  assertTimeout(*tx, 0, 2400);
+  for (int i = 0; i < 10; i++)
+    arqRtoBackoff(*tx);
+  TEST_ASSERT_EQUAL_UINT8(ARQ_RTO_MAX_BACKOFF, tx->backoff);
+  assertTimeout(*tx, 0, 600 << ARQ_RTO_MAX_BACKOFF);
+  assertTimeout(*tx, 5000, ARQ_RTO_MAX_MS);
+
+  arqRttSample(*tx, 200);
+  TEST_ASSERT_EQUAL_UINT8(0, tx->backoff);
+  assertTimeout(*tx, 0, tx->rto);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_receiver_sacks_around_a_loss);
+  RUN_TEST(test_receiver_follows_a_sender_that_gave_up);
+  RUN_TEST(test_lossy_transfer_delivers_every_frame_once);
+  RUN_TEST(test_old_epoch_frames_are_duplicates_after_a_reboot);
+  RUN_TEST(test_new_streams_start_above_earlier_sequences);
+  RUN_TEST(test_only_idle_streams_are_recycled);
+  RUN_TEST(test_rto_follows_the_measured_round_trip);
+  RUN_TEST(test_timeouts_back_off_until_a_clean_sample);
+  return UNITY_END();
+}
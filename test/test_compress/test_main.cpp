@@ -0,0 +1,158 @@
+#include <unity.h>
+#include "lora_compress.h"
+#include "lora_packet.h"
+
+// HOST TESTS FOR THE SHORT-TEXT CODEC, WITH ITS RATIO AND COST ON A SAMPLE OF CHAT TRAFFIC
+
+#define BENCH_ROUNDS 2000
+
+static const char *const corpus[] = {
+    "ok",
+    "On my way, be there in 10",
+    "Where are you?",
+    "At the north trailhead, meet you there",
+    "Copy that. Heading back to camp now",
+    "Is anyone on channel 3?",
+    "KD2ABC here, signal is good",
+    "Water at the spring is ok to drink",
+    "I will wait for you at the bridge",
+    "Did you see the weather report for tomorrow?",
+    "Battery at 45%, going to save power",
+    "Grid 4412.5N 07312.9W, all good",
+    "We have the others with us, all fine",
+    "Need help with the tent, wind is strong",
+    "Thanks! See you in the morning",
+    "Roger, out",
+    "Can you check on the north camp at 1800?",
+    "The road is closed after the second turn",
+    "Meet at checkpoint 7 around 14:30",
+    "Have you heard from Sam and Alex yet?",
+};
+#define CORPUS_SIZE (sizeof(corpus) / sizeof(corpus[0]))
+
+static void assertRoundTrip(const char *text)
+{
+  size_t textLen = strlen(text);
+  uint8_t packed[LORA_MAX_MESSAGE_LEN];
+  size_t packedLen = compressText(text, textLen, packed, sizeof(packed));
+  if (packedLen == 0)
+    return; // Sent raw
+  TEST_ASSERT_LESS_THAN(textLen, packedLen);
+  char unpacked[LORA_MAX_MESSAGE_LEN + 1];
+  TEST_ASSERT_EQUAL_size_t(textLen, decompressText(packed, packedLen, unpacked, sizeof(unpacked)));
+  TEST_ASSERT_EQUAL_STRING(text, unpacked);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_corpus_round_trips()
+{
+  for (size_t i = 0; i < CORPUS_SIZE; i++)
+    assertRoundTrip(corpus[i]);
+}
+
+static void test_utf8_and_control_bytes_round_trip()
+{
+  assertRoundTrip("Caf\xC3\xA9 at the plaza, ni\xC3\xB1os are with me");
+  assertRoundTrip("line one\nline two\tand the rest");
+  assertRoundTrip("the the the the the the");
+}
+
+// TOO SHORT, OR NOT SHORTER ONCE ENCODED: 0, AND THE CALLER SENDS IT RAW
+static void test_incompressible_text_is_left_raw()
+{
+  uint8_t packed[64];
+  TEST_ASSERT_EQUAL_size_t(0, compressText("", 0, packed, sizeof(packed)));
+  TEST_ASSERT_EQUAL_size_t(0, compressText("k", 1, packed, sizeof(packed)));
+  TEST_ASSERT_EQUAL_size_t(0, compressText("QXZJKV", 6, packed, sizeof(packed)));
+  const char *utf8 = "\xE2\x9C\x93\xE2\x9C\x93"; // Every byte escaped doubles
+  TEST_ASSERT_EQUAL_size_t(0, compressText(utf8, strlen(utf8), packed, sizeof(packed)));
+}
+
+static void test_encoder_respects_output_capacity()
+{
+  const char *text = "Where are you? At the north trailhead";
+  uint8_t packed[64];
+  size_t fullLen = compressText(text, strlen(text), packed, sizeof(packed));
+  TEST_ASSERT_GREATER_THAN(0, fullLen);
+  memset(packed, 0xAA, sizeof(packed));
+  TEST_ASSERT_EQUAL_size_t(0, compressText(text, strlen(text), packed, fullLen - 1));
+  TEST_ASSERT_EQUAL_HEX8(0xAA, packed[fullLen - 1]);
+}
+
+static void test_decoder_rejects_malformed_input()
+{
+  char out[32];
+  const uint8_t truncatedEscape[] = {'h', 'i', LORA_COMPRESS_ESCAPE};
+  TEST_ASSERT_EQUAL_size_t(0, decompressText(truncatedEscape, sizeof(truncatedEscape), out, sizeof(out)));
+  const uint8_t embeddedNul[] = {'h', 0, 'i'};
+  TEST_ASSERT_EQUAL_size_t(0, decompressText(embeddedNul, sizeof(embeddedNul), out, sizeof(out)));
+
+  // EXPANDS PAST THE BUFFER (EACH CODE IS SEVERAL CHARACTERS), ROOM IS ALWAYS LEFT FOR THE NUL
+  uint8_t codes[16];
+  memset(codes, LORA_COMPRESS_CODE_BASE, sizeof(codes));
+  TEST_ASSERT_EQUAL_size_t(0, decompressText(codes, sizeof(codes), out, sizeof(out)));
+  const uint8_t exact[] = {'a', 'b', 'c'};
+  TEST_ASSERT_EQUAL_size_t(0, decompressText(exact, sizeof(exact), out, 3));
+  TEST_ASSERT_EQUAL_size_t(3, decompressText(exact, sizeof(exact), out, 4));
+  TEST_ASSERT_EQUAL_STRING("abc", out);
+}
+
+// WHAT THE CODEC SAVES ON THE CORPUS (RAW WHERE IT WOULD NOT HELP, AS ON AIR) AND WHAT IT COSTS
+static void test_benchmark_ratio_and_cost()
+{
+  size_t rawBytes = 0, sentBytes = 0, packedTotal = 0;
+  static uint8_t packed[CORPUS_SIZE][LORA_MAX_MESSAGE_LEN];
+  static size_t packedLen[CORPUS_SIZE];
+  for (size_t i = 0; i < CORPUS_SIZE; i++)
+  {
+    size_t textLen = strlen(corpus[i]);
+    packedLen[i] = compressText(corpus[i], textLen, packed[i], sizeof(packed[i]));
+    rawBytes += textLen;
+    sentBytes += packedLen[i] ? packedLen[i] : textLen;
+    packedTotal += packedLen[i];
+  }
+
+  unsigned long start = micros();
+  size_t sink = 0;
+  for (int round = 0; round < BENCH_ROUNDS; round++)
+  {
+    for (size_t i = 0; i < CORPUS_SIZE; i++)
+      sink += compressText(corpus[i], strlen(corpus[i]), packed[i], sizeof(packed[i]));
+  }
+  unsigned long encodeUs = micros() - start;
+
+  char text[LORA_MAX_MESSAGE_LEN + 1];
+  start = micros();
+  for (int round = 0; round < BENCH_ROUNDS; round++)
+  {
+    for (size_t i = 0; i < CORPUS_SIZE; i++)
+    {
+      if (packedLen[i])
+        sink += decompressText(packed[i], packedLen[i], text, sizeof(text));
+    }
+  }
+  unsigned long decodeUs = micros() - start;
+
+  char report[160];
+  snprintf(report, sizeof(report), "%u messages: %u bytes raw, %u sent (%u%%), encode %.1f ns/byte, decode %.1f ns/byte",
+           (unsigned)CORPUS_SIZE, (unsigned)rawBytes, (unsigned)sentBytes, (unsigned)(100 * sentBytes / rawBytes),
+           1000.0 * encodeUs / ((double)BENCH_ROUNDS * rawBytes),
+           1000.0 * decodeUs / ((double)BENCH_ROUNDS * (packedTotal ? packedTotal : 1)));
+  TEST_MESSAGE(report);
+  TEST_ASSERT_GREATER_THAN(0, sink);
+  TEST_ASSERT_LESS_THAN(rawBytes * 85 / 100, sentBytes);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_corpus_round_trips);
+  RUN_TEST(test_utf8_and_control_bytes_round_trip);
+  RUN_TEST(test_incompressible_text_is_left_raw);
+  RUN_TEST(test_encoder_respects_output_capacity);
+  RUN_TEST(test_decoder_rejects_malformed_input);
+  RUN_TEST(test_benchmark_ratio_and_cost);
+  return UNITY_END();
+}
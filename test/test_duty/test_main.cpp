@@ -0,0 +1,85 @@
+#include <unity.h>
+#include "lora_duty.h"
+
+// HOST TESTS FOR THE DUTY-CYCLE LEDGER: AIRTIME COUNTS AGAINST ITS SUB-BAND FOR A FULL WINDOW, NOT A
+// MOMENT LONGER THAN ONE SLICE MORE, ACROSS A millis() WRAP TOO (TIME IS KEPT IN 32 BITS, AS ON THE BOARD)
+#define G1_MHZ 868.3f    // EU868 g1, 1 %
+#define G2_MHZ 869.0f    // EU868 g2, 0.1 %
+#define US_MHZ 915.0f    // No regulated duty cycle, fair-use cap
+#define SLICE_MS (LORA_DUTY_WINDOW_MS / LORA_DUTY_BUCKETS)
+
+static uint32_t now = 1000;
+
+void setUp()
+{
+  now += 2 * LORA_DUTY_WINDOW_MS; // Everything earlier tests spent has aged out
+}
+
+void tearDown() {}
+
+static void test_budget_follows_the_sub_band()
+{
+  TEST_ASSERT_EQUAL_UINT32(36000, dutyBudgetMs(G1_MHZ));
+  TEST_ASSERT_EQUAL_UINT32(3600, dutyBudgetMs(G2_MHZ));
+  TEST_ASSERT_EQUAL_UINT32(LORA_DUTY_WINDOW_MS * LORA_DUTY_FAIR_USE_PERMILLE / 1000, dutyBudgetMs(US_MHZ));
+  TEST_ASSERT_EQUAL_STRING("EU868 g1", dutySubBand(G1_MHZ).name);
+  TEST_ASSERT_EQUAL_STRING("other", dutySubBand(2400.0f).name);
+}
+
+// A FRAME'S AIRTIME STAYS CHARGED FOR THE WHOLE WINDOW, AND IS RELEASED WITHIN ONE SLICE AFTER IT
+static void test_airtime_ages_out_after_one_window()
+{
+  dutyCharge(G1_MHZ, 500, now);
+  dutyCharge(G1_MHZ, 700, now + SLICE_MS);
+  TEST_ASSERT_EQUAL_UINT32(1200, dutyUsedMs(G1_MHZ, now + SLICE_MS));
+  TEST_ASSERT_EQUAL_UINT32(0, dutyUsedMs(G2_MHZ, now + SLICE_MS)); // Another sub-band's budget
+  TEST_ASSERT_EQUAL_UINT32(1200, dutyUsedMs(G1_MHZ, now + LORA_DUTY_WINDOW_MS - 1));
+  TEST_ASSERT_EQUAL_UINT32(700, dutyUsedMs(G1_MHZ, now + LORA_DUTY_WINDOW_MS + SLICE_MS));
+  TEST_ASSERT_EQUAL_UINT32(0, dutyUsedMs(G1_MHZ, now + LORA_DUTY_WINDOW_MS + 2 * SLICE_MS));
+}
+
+// LOWER CLASSES LEAVE THEIR RESERVE OF THE BUDGET TO MORE URGENT TRAFFIC
+static void test_reserve_holds_back_part_of_the_budget()
+{
+  dutyCharge(G2_MHZ, 3000, now);
+  TEST_ASSERT_TRUE(dutyAllows(G2_MHZ, 600, 0, now));
+  TEST_ASSERT_FALSE(dutyAllows(G2_MHZ, 601, 0, now));
+  TEST_ASSERT_FALSE(dutyAllows(G2_MHZ, 100, 50, now));
+  TEST_ASSERT_TRUE(dutyAllows(G2_MHZ, 100, 50, now + LORA_DUTY_WINDOW_MS + SLICE_MS));
+}
+
+// THE RADIO TASK SLEEPS UNTIL THE NEXT SLICE BOUNDARY WHILE FRAMES ARE HELD BACK
+static void test_next_release_is_the_end_of_the_current_slice()
+{
+  uint32_t wait = dutyNextReleaseMs(now);
+  TEST_ASSERT_TRUE(wait > 0 && wait <= SLICE_MS);
+  TEST_ASSERT_EQUAL_UINT32(wait - 100, dutyNextReleaseMs(now + 100));
+  TEST_ASSERT_EQUAL_UINT32(SLICE_MS, dutyNextReleaseMs(now + wait));
+}
+
+// AIRTIME SPENT JUST BEFORE millis() WRAPS IS STILL CHARGED JUST AFTER IT, AND AGES OUT ON TIME
+static void test_airtime_is_kept_across_a_millis_wrap()
+{
+  now = 0xFFFFFFFFUL - 5000;
+  dutyAllows(US_MHZ, 0, 0, now);
+  dutyCharge(US_MHZ, 300000, now);
+  TEST_ASSERT_FALSE(dutyAllows(US_MHZ, 60001, 0, now));
+  now += 10000; // Wrapped
+  TEST_ASSERT_TRUE(now < 10000);
+  TEST_ASSERT_EQUAL_UINT32(300000, dutyUsedMs(US_MHZ, now));
+  TEST_ASSERT_FALSE(dutyAllows(US_MHZ, 60001, 0, now));
+  dutyCharge(US_MHZ, 1000, now);
+  TEST_ASSERT_EQUAL_UINT32(301000, dutyUsedMs(US_MHZ, now));
+  TEST_ASSERT_EQUAL_UINT32(0, dutyUsedMs(US_MHZ, now + LORA_DUTY_WINDOW_MS + SLICE_MS));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_budget_follows_the_sub_band);
+  RUN_TEST(test_airtime_ages_out_after_one_window);
+  RUN_TEST(test_reserve_holds_back_part_of_the_budget);
+  RUN_TEST(test_next_release_is_the_end_of_the_current_slice);
+  RUN_TEST(test_airtime_is_kept_across_a_millis_wrap);
+  return UNITY_END();
+}
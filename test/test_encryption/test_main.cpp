@@ -0,0 +1,455 @@
+#include <unity.h>
+#include <atomic>
+#include <pthread.h>
+#include "encryption.h"
+#include "lora_arq.h"
+#include "lora_packet.h"
+
+// HOST TESTS FOR FRAME AUTHENTICATION: AES-CCM OVER THE PAYLOAD AND THE HEADER (SEE loRaAuthData),
+// ON DATA FRAMES AND ON ACKS
+
+#define TEST_SRC 0x0001
+#define TEST_DST 0x0002
+#define BENCH_FRAMES 20000
+
+// COUNTS EVERY HEAP ALLOCATION MADE BY THE TEST THREAD WHILE counting IS SET (AS IN test_allocations)
+static std::atomic<bool> counting{false};
+static std::atomic<uint32_t> allocations{0};
+static pthread_t testThread;
+
+static void noteAllocation()
+{
+  if (counting.load(std::memory_order_relaxed) && pthread_equal(pthread_self(), testThread))
+    allocations++;
+}
+
+#if defined(__GLIBC__)
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void *malloc(size_t size) noexcept
+{
+  noteAllocation();
+  return __libc_malloc(size);
+}
+extern "C" void *calloc(size_t count, size_t size) noexcept
+{
+  noteAllocation();
+  return __libc_calloc(count, size);
+}
+extern "C" void *realloc(void *ptr, size_t size) noexcept
+{
+  noteAllocation();
+  return __libc_realloc(ptr, size);
+}
+#else
+void *operator new(size_t size)
+{
+  noteAllocation();
+  void *ptr = malloc(size ? size : 1);
+  if (!ptr)
+    abort();
+  return ptr;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+#endif
+
+// THE CIPHER THIS REPLACED, AS IT WAS: XOR WITH A REPEATING KEY, SENT AS HEX BUILT UP ONE String += AT A TIME
+static const char *OLD_ENCRYPTION_KEY = "SecureLoraComms1";
+
+static String oldEncryptMessage(const String &plaintext)
+{
+  if (plaintext.length() == 0)
+    return "";
+  String encrypted = "";
+  size_t keyLength = strlen(OLD_ENCRYPTION_KEY);
+  for (size_t i = 0; i < plaintext.length(); i++)
+  {
+    char encryptedChar = plaintext.charAt(i) ^ OLD_ENCRYPTION_KEY[i % keyLength];
+    if ((byte)encryptedChar < 16)
+      encrypted += "0";
+    encrypted += String((byte)encryptedChar, HEX);
+  }
+  return encrypted;
+}
+
+static String oldDecryptMessage(const String &encrypted)
+{
+  if (encrypted.length() == 0 || encrypted.length() % 2 != 0)
+    return "";
+  String decrypted = "";
+  size_t keyLength = strlen(OLD_ENCRYPTION_KEY);
+  for (size_t i = 0; i < encrypted.length(); i += 2)
+  {
+    String byteHex = encrypted.substring(i, i + 2);
+    byte encryptedByte = (byte)strtol(byteHex.c_str(), NULL, 16);
+    decrypted += (char)(encryptedByte ^ OLD_ENCRYPTION_KEY[(i / 2) % keyLength]);
+  }
+  return decrypted;
+}
+
+static LoRaFrameHeader dataHeader()
+{
+  LoRaFrameHeader header = {};
+  header.version = LORA_PROTOCOL_VERSION;
+  header.type = LORA_FRAME_DATA;
+  header.flags = LORA_FLAG_ENCRYPTED | LORA_FLAG_PIGGYBACK_ACK;
+  header.dstAddress = TEST_DST;
+  header.srcAddress = TEST_SRC;
+  header.messageId = 0x00010005;
+  header.linkSf = 9;
+  header.linkPower = 10;
+  header.hopLimit = 3;
+  header.attempt = 1;
+  header.lastHop = TEST_SRC;
+  header.nextHop = LORA_BROADCAST_ADDRESS;
+  header.windowOffset = 2;
+  header.piggyback = {TEST_DST, TEST_SRC, 7, 0x3, -4};
+  return header;
+}
+
+static LoRaFrameHeader ackHeader()
+{
+  LoRaFrameHeader header = {};
+  header.version = LORA_PROTOCOL_VERSION;
+  header.type = LORA_FRAME_ACK;
+  header.dstAddress = TEST_SRC;
+  header.srcAddress = TEST_DST;
+  header.messageId = 7;
+  header.linkSf = 9;
+  header.linkPower = 10;
+  header.hopLimit = 3;
+  header.attempt = 0;
+  header.lastHop = TEST_DST;
+  header.nextHop = LORA_BROADCAST_ADDRESS;
+  header.ackBitmap = 0x5;
+  header.snrReport = 3;
+  header.ackStream = TEST_DST;
+  header.ackSerial = 0x00010003;
+  return header;
+}
+
+// AS sendOutgoingSlot() DOES: ENCODE, THEN ENCRYPT THE PAYLOAD IN PLACE AND APPEND THE TAG
+static size_t sealDataFrame(const LoRaFrameHeader &header, const char *text, uint8_t *frame)
+{
+  size_t textLen = strlen(text);
+  size_t headerLen = loRaHeaderLen(header);
+  size_t frameLen = encodeLoRaFrame(header, (const uint8_t *)text, textLen, frame, LORA_MAX_FRAME_LEN - LORA_AUTH_TAG_LEN);
+  TEST_ASSERT_GREATER_THAN(0, frameLen);
+  uint8_t aad[LORA_MAX_HEADER_LEN];
+  size_t aadLen = loRaAuthData(frame, headerLen, aad);
+  TEST_ASSERT_TRUE(encryptPayload(frame + headerLen, textLen, aad, aadLen, header, frame + frameLen));
+  return frameLen + LORA_AUTH_TAG_LEN;
+}
+
+// AS acceptDataFrame() DOES: DECODE, THEN VERIFY AND DECRYPT INTO plain
+static bool openDataFrame(const uint8_t *frame, size_t frameLen, LoRaFrameHeader &header, char *plain)
+{
+  const uint8_t *payload;
+  size_t payloadLen;
+  if (!decodeLoRaFrame(frame, frameLen, header, payload, payloadLen) || payloadLen <= LORA_AUTH_TAG_LEN)
+    return false;
+  size_t plainLen = payloadLen - LORA_AUTH_TAG_LEN;
+  uint8_t aad[LORA_MAX_HEADER_LEN];
+  size_t aadLen = loRaAuthData(frame, payload - frame, aad);
+  memcpy(plain, payload, plainLen);
+  if (!decryptPayload((uint8_t *)plain, plainLen, aad, aadLen, header, payload + plainLen))
+    return false;
+  plain[plainLen] = 0;
+  return true;
+}
+
+// AS sendSelectiveAck() DOES: THE TAG OVER THE HEADER IS THE ACK'S WHOLE PAYLOAD
+static size_t sealAckFrame(const LoRaFrameHeader &header, uint8_t *frame)
+{
+  uint8_t encoded[LORA_ACK_HEADER_LEN];
+  TEST_ASSERT_EQUAL_size_t(LORA_ACK_HEADER_LEN, encodeLoRaFrame(header, nullptr, 0, encoded, sizeof(encoded)));
+  uint8_t aad[LORA_MAX_HEADER_LEN];
+  uint8_t tag[LORA_AUTH_TAG_LEN];
+  TEST_ASSERT_TRUE(encryptPayload(nullptr, 0, aad, loRaAuthData(encoded, LORA_ACK_HEADER_LEN, aad), header, tag));
+  return encodeLoRaFrame(header, tag, sizeof(tag), frame, LORA_MAX_FRAME_LEN);
+}
+
+static bool openAckFrame(const uint8_t *frame, size_t frameLen, LoRaFrameHeader &header)
+{
+  const uint8_t *payload;
+  size_t payloadLen;
+  if (!decodeLoRaFrame(frame, frameLen, header, payload, payloadLen) || payloadLen != LORA_AUTH_TAG_LEN)
+    return false;
+  uint8_t aad[LORA_MAX_HEADER_LEN];
+  return decryptPayload(nullptr, 0, aad, loRaAuthData(frame, LORA_ACK_HEADER_LEN, aad), header, payload);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_data_frame_round_trips()
+{
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+  const char *text = "Meet at checkpoint 7 around 14:30";
+  size_t frameLen = sealDataFrame(dataHeader(), text, frame);
+  TEST_ASSERT_EQUAL_size_t(loRaHeaderLen(dataHeader()) + strlen(text) + LORA_AUTH_TAG_LEN, frameLen);
+  TEST_ASSERT_NULL(memmem(frame, frameLen, "checkpoint", 10)); // Not sent in the clear
+
+  LoRaFrameHeader header;
+  char plain[LORA_MAX_FRAME_LEN];
+  TEST_ASSERT_TRUE(openDataFrame(frame, frameLen, header, plain));
+  TEST_ASSERT_EQUAL_STRING(text, plain);
+  TEST_ASSERT_EQUAL_UINT8(2, header.windowOffset);
+  TEST_ASSERT_EQUAL_UINT32(7, header.piggyback.cumAck);
+}
+
+// EVERY BIT OF THE PAYLOAD, THE TAG AND THE HEADER IS COVERED
+static void test_data_frame_rejects_any_flipped_bit()
+{
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+  size_t frameLen = sealDataFrame(dataHeader(), "On my way", frame);
+  LoRaFrameHeader header;
+  char plain[LORA_MAX_FRAME_LEN];
+  uint32_t accepted = 0;
+  for (size_t byte = 0; byte < frameLen; byte++)
+  {
+    // LINK (10), HOPS (11), LAST HOP AND NEXT HOP (13-16) ARE PER TRANSMISSION, RELAYS REWRITE THEM
+    if (byte == 10 || byte == 11 || (byte >= 13 && byte <= 16))
+      continue;
+    for (int bit = 0; bit < 8; bit++)
+    {
+      uint8_t tampered[LORA_MAX_FRAME_LEN];
+      memcpy(tampered, frame, frameLen);
+      tampered[byte] ^= 1 << bit;
+      if (openDataFrame(tampered, frameLen, header, plain))
+        accepted++;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, accepted);
+}
+
+// A RELAY MAY REWRITE THE PER-TRANSMISSION FIELDS WITHOUT BREAKING THE TAG
+static void test_relay_fields_may_change()
+{
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+  size_t frameLen = sealDataFrame(dataHeader(), "On my way", frame);
+  frame[10] = 0x70;           // Relay's own link byte: SF7, lowest power
+  frame[11] = (2 << 4) | 1;   // One hop taken
+  frame[13] = 0x09;           // Last hop: the relay
+  frame[14] = 0x00;
+  frame[15] = 0x02;           // Next hop
+  frame[16] = 0x00;
+  LoRaFrameHeader header;
+  char plain[LORA_MAX_FRAME_LEN];
+  TEST_ASSERT_TRUE(openDataFrame(frame, frameLen, header, plain));
+  TEST_ASSERT_EQUAL_STRING("On my way", plain);
+  TEST_ASSERT_EQUAL_UINT8(7, header.linkSf);
+  TEST_ASSERT_EQUAL_UINT8(1, header.hopCount);
+  TEST_ASSERT_EQUAL_UINT16(0x0009, header.lastHop);
+}
+
+static void test_ack_frame_round_trips_and_rejects_tampering()
+{
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+  size_t frameLen = sealAckFrame(ackHeader(), frame);
+  TEST_ASSERT_EQUAL_size_t(LORA_ACK_FRAME_LEN, frameLen);
+  LoRaFrameHeader header;
+  TEST_ASSERT_TRUE(openAckFrame(frame, frameLen, header));
+  TEST_ASSERT_EQUAL_UINT32(7, header.messageId);
+  TEST_ASSERT_EQUAL_UINT32(0x5, header.ackBitmap);
+
+  // CUMULATIVE ACK (6-9), ATTEMPT (12), BITMAP (17-20), SNR REPORT (21), ACKED STREAM (22-23), SERIAL (24-27)
+  // AND THE TAG
+  const size_t covered[] = {6, 9, 12, 17, 20, 21, 22, 23, 24, 27, 28, 35};
+  for (size_t i = 0; i < sizeof(covered) / sizeof(covered[0]); i++)
+  {
+    uint8_t tampered[LORA_MAX_FRAME_LEN];
+    memcpy(tampered, frame, frameLen);
+    tampered[covered[i]] ^= 0x01;
+    TEST_ASSERT_FALSE(openAckFrame(tampered, frameLen, header));
+  }
+  // A TAG COPIED FROM ANOTHER ACK DOES NOT VERIFY
+  LoRaFrameHeader other = ackHeader();
+  other.messageId = 8;
+  uint8_t otherFrame[LORA_MAX_FRAME_LEN];
+  sealAckFrame(other, otherFrame);
+  memcpy(otherFrame + LORA_ACK_HEADER_LEN, frame + LORA_ACK_HEADER_LEN, LORA_AUTH_TAG_LEN);
+  TEST_ASSERT_FALSE(openAckFrame(otherFrame, frameLen, header));
+}
+
+// AN ACK REPEATS ITS CUMULATIVE ACK AS THE BITMAP FILLS IN, BUT EACH ONE HAS ITS OWN SERIAL - AND SO ITS
+// OWN NONCE - AND A TAG DOES NOT CARRY OVER TO ANOTHER SERIAL
+static void test_acks_for_the_same_cumulative_ack_use_their_own_nonce()
+{
+  LoRaFrameHeader first = ackHeader();
+  LoRaFrameHeader second = ackHeader();
+  second.ackBitmap = 0x7;
+  second.ackSerial = first.ackSerial + 1;
+  uint8_t firstFrame[LORA_MAX_FRAME_LEN];
+  uint8_t secondFrame[LORA_MAX_FRAME_LEN];
+  size_t frameLen = sealAckFrame(first, firstFrame);
+  sealAckFrame(second, secondFrame);
+
+  // THE SERIAL, NOT THE CUMULATIVE ACK, PICKS THE NONCE: THE SAME HEADER SEALED UNDER ANOTHER SERIAL GETS
+  // ANOTHER TAG, AND A SERIAL SWAPPED IN AFTERWARDS BREAKS IT
+  LoRaFrameHeader reused = second;
+  reused.ackSerial = first.ackSerial;
+  uint8_t reusedFrame[LORA_MAX_FRAME_LEN];
+  sealAckFrame(reused, reusedFrame);
+  TEST_ASSERT_TRUE(memcmp(secondFrame + LORA_ACK_HEADER_LEN, reusedFrame + LORA_ACK_HEADER_LEN, LORA_AUTH_TAG_LEN) != 0);
+
+  LoRaFrameHeader header;
+  TEST_ASSERT_TRUE(openAckFrame(secondFrame, frameLen, header));
+  TEST_ASSERT_EQUAL_UINT32(second.ackSerial, header.ackSerial);
+  memcpy(secondFrame + LORA_ACK_HEADER_LEN - 4, firstFrame + LORA_ACK_HEADER_LEN - 4, 4);
+  TEST_ASSERT_FALSE(openAckFrame(secondFrame, frameLen, header));
+}
+
+// A RECORDED FRAME PLAYED BACK VERIFIES, BUT ITS RECEIVE WINDOW ONLY TAKES IT ONCE
+static void test_replayed_frame_is_delivered_once()
+{
+  arqSetEpoch(1);
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+  size_t frameLen = sealDataFrame(dataHeader(), "Roger, out", frame);
+  LoRaFrameHeader header;
+  char plain[LORA_MAX_FRAME_LEN];
+  uint32_t delivered = 0;
+  for (int copy = 0; copy < 3; copy++)
+  {
+    TEST_ASSERT_TRUE(openDataFrame(frame, frameLen, header, plain));
+    ArqRxStream *rx = arqRxStreamFor(header.srcAddress, header.dstAddress, millis());
+    TEST_ASSERT_NOT_NULL(rx);
+    if (arqAcceptFrame(*rx, header.messageId, header.windowOffset) == ARQ_RX_NEW)
+      delivered++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, delivered);
+
+  // RE-LABELLING THE REPLAY AS A NEW ATTEMPT OR A LATER SEQUENCE BREAKS THE TAG
+  uint8_t relabelled[LORA_MAX_FRAME_LEN];
+  memcpy(relabelled, frame, frameLen);
+  relabelled[12]++;
+  TEST_ASSERT_FALSE(openDataFrame(relabelled, frameLen, header, plain));
+  memcpy(relabelled, frame, frameLen);
+  relabelled[6]++;
+  TEST_ASSERT_FALSE(openDataFrame(relabelled, frameLen, header, plain));
+}
+
+// A FRAME RECORDED FURTHER BACK THAN THE SENDER WINDOW VERIFIES BUT IS STILL A DUPLICATE, AND DOES NOT
+// REWIND THE STREAM SO THAT NEWER FRAMES ARE TAKEN AGAIN
+static void test_frame_replayed_from_behind_the_window_is_a_duplicate()
+{
+  arqSetEpoch(1);
+  LoRaFrameHeader header = dataHeader();
+  header.srcAddress = TEST_SRC + 2;
+  header.windowOffset = 0;
+  header.messageId = 0x00010000;
+  uint8_t recorded[LORA_MAX_FRAME_LEN];
+  size_t recordedLen = sealDataFrame(header, "Roger, out", recorded);
+
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+  char plain[LORA_MAX_FRAME_LEN];
+  LoRaFrameHeader opened;
+  ArqRxStream *rx = nullptr;
+  for (int i = 0; i < 4 * ARQ_WINDOW_SIZE; i++)
+  {
+    header.messageId = 0x00010000 + i;
+    size_t frameLen = sealDataFrame(header, "Roger, out", frame);
+    TEST_ASSERT_TRUE(openDataFrame(frame, frameLen, opened, plain));
+    rx = arqRxStreamFor(opened.srcAddress, opened.dstAddress, millis());
+    TEST_ASSERT_EQUAL(ARQ_RX_NEW, arqAcceptFrame(*rx, opened.messageId, opened.windowOffset));
+  }
+
+  TEST_ASSERT_TRUE(openDataFrame(recorded, recordedLen, opened, plain));
+  TEST_ASSERT_EQUAL(ARQ_RX_DUPLICATE, arqAcceptFrame(*rx, opened.messageId, opened.windowOffset));
+  TEST_ASSERT_EQUAL(ARQ_RX_DUPLICATE, arqAcceptFrame(*rx, header.messageId, 0));
+  TEST_ASSERT_EQUAL_UINT32(header.messageId, rx->cumAck);
+}
+
+// COST OF SEALING AND OPENING A FULL-SIZE DATA FRAME AND AN ACK, AND OF THE OLD CIPHER ON THE SAME TEXT
+// (THE HOST String IS A std::string, SO THE OLD SIDE'S COUNT IS A FLOOR FOR THE ARDUINO String'S)
+static void test_benchmark_seal_and_open()
+{
+  char text[LORA_MAX_PAYLOAD_LEN - LORA_PIGGYBACK_ACK_LEN + 1];
+  memset(text, 'x', sizeof(text) - 1);
+  text[sizeof(text) - 1] = 0;
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+  LoRaFrameHeader header = dataHeader();
+  size_t frameLen = 0;
+  testThread = pthread_self();
+
+  allocations = 0;
+  counting = true;
+  unsigned long start = micros();
+  for (int i = 0; i < BENCH_FRAMES; i++)
+  {
+    header.attempt = (uint8_t)i;
+    frameLen = sealDataFrame(header, text, frame);
+  }
+  unsigned long sealUs = micros() - start;
+
+  LoRaFrameHeader decoded;
+  char plain[LORA_MAX_FRAME_LEN];
+  uint32_t opened = 0;
+  start = micros();
+  for (int i = 0; i < BENCH_FRAMES; i++)
+    opened += openDataFrame(frame, frameLen, decoded, plain);
+  unsigned long openUs = micros() - start;
+  counting = false;
+  uint32_t newAllocations = allocations.load();
+
+  LoRaFrameHeader ack = ackHeader();
+  uint8_t ackFrame[LORA_MAX_FRAME_LEN];
+  start = micros();
+  for (int i = 0; i < BENCH_FRAMES; i++)
+  {
+    ack.ackSerial = (uint32_t)i;
+    sealAckFrame(ack, ackFrame);
+  }
+  unsigned long ackUs = micros() - start;
+
+  String message(text);
+  String encrypted;
+  allocations = 0;
+  counting = true;
+  start = micros();
+  for (int i = 0; i < BENCH_FRAMES; i++)
+    encrypted = oldEncryptMessage(message);
+  unsigned long oldEncryptUs = micros() - start;
+  uint32_t oldRoundTrips = 0;
+  start = micros();
+  for (int i = 0; i < BENCH_FRAMES; i++)
+    oldRoundTrips += oldDecryptMessage(encrypted).length() == message.length();
+  unsigned long oldDecryptUs = micros() - start;
+  counting = false;
+  uint32_t oldAllocations = allocations.load();
+
+  char report[320];
+  snprintf(report, sizeof(report),
+           "%u-byte text: XOR/hex encrypt %.2f us, decrypt %.2f us, %.1f allocations per message | "
+           "CCM seal %.2f us, open %.2f us (%.1f ns/byte), %.1f allocations per message | ACK seal %.2f us",
+           (unsigned)strlen(text), (double)oldEncryptUs / BENCH_FRAMES, (double)oldDecryptUs / BENCH_FRAMES,
+           (double)oldAllocations / BENCH_FRAMES, (double)sealUs / BENCH_FRAMES, (double)openUs / BENCH_FRAMES,
+           1000.0 * openUs / ((double)BENCH_FRAMES * frameLen), (double)newAllocations / BENCH_FRAMES,
+           (double)ackUs / BENCH_FRAMES);
+  TEST_MESSAGE(report);
+  TEST_ASSERT_EQUAL_size_t(LORA_MAX_FRAME_LEN, frameLen);
+  TEST_ASSERT_EQUAL_UINT32(BENCH_FRAMES, opened);
+  TEST_ASSERT_EQUAL_UINT32(BENCH_FRAMES, oldRoundTrips);
+  TEST_ASSERT_TRUE(strcmp(oldDecryptMessage(encrypted).c_str(), text) == 0);
+  TEST_ASSERT_EQUAL_UINT32(0, newAllocations);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  setupEncryption();
+  RUN_TEST(test_data_frame_round_trips);
+  RUN_TEST(test_data_frame_rejects_any_flipped_bit);
+  RUN_TEST(test_relay_fields_may_change);
+  RUN_TEST(test_ack_frame_round_trips_and_rejects_tampering);
+  RUN_TEST(test_acks_for_the_same_cumulative_ack_use_their_own_nonce);
+  RUN_TEST(test_replayed_frame_is_delivered_once);
+  RUN_TEST(test_frame_replayed_from_behind_the_window_is_a_duplicate);
+  RUN_TEST(test_benchmark_seal_and_open);
+  return UNITY_END();
+}
@@ -0,0 +1,147 @@
+#include <unity.h>
+#include "lora_link.h"
+
+// HOST TESTS FOR LINK ADAPTATION: THE SF WE LISTEN ON FOLLOWS THE WEAKEST CURRENT PEER, THE SF AND POWER
+// WE SEND WITH FOLLOW WHAT EACH PEER ANNOUNCES, AND OUR BEACONS ALWAYS REACH THE RENDEZVOUS SF
+// EACH TEST STARTS LATE ENOUGH THAT THE PREVIOUS ONE'S PEERS ARE NO LONGER CURRENT
+static unsigned long now = 1000;
+
+// A FRAME PUT ON AIR BY address AT FULL POWER, SAYING IT LISTENS ON linkSf, HEARD WITH THE GIVEN SNR
+static void hear(uint16_t address, uint8_t linkSf, float snr)
+{
+  LoRaFrameHeader header = {};
+  header.version = LORA_PROTOCOL_VERSION;
+  header.type = LORA_FRAME_DATA;
+  header.srcAddress = address;
+  header.lastHop = address;
+  header.linkSf = linkSf;
+  header.linkPower = LORA_POWER_MAX;
+  linkFrameHeard(header, -90.0f, snr, now);
+}
+
+void setUp()
+{
+  now += LINK_PEER_TIMEOUT_MS + LINK_SF_HOLD_MS + 1;
+}
+
+void tearDown() {}
+
+static void test_listen_sf_follows_the_weakest_peer()
+{
+  hear(0x0201, LORA_SF_RENDEZVOUS, 5.0f);
+  TEST_ASSERT_TRUE(linkUpdateListenSf(now));
+  TEST_ASSERT_EQUAL_UINT8(LORA_SF_MIN, linkListenSf());
+
+  // A WEAKER PEER SLOWS US DOWN AT ONCE
+  hear(0x0202, LORA_SF_RENDEZVOUS, -6.0f);
+  TEST_ASSERT_TRUE(linkUpdateListenSf(now));
+  TEST_ASSERT_EQUAL_UINT8(9, linkListenSf());
+  TEST_ASSERT_FALSE(linkUpdateListenSf(now));
+
+  // ITS LINK IMPROVES, BUT WE ONLY SPEED UP AGAIN ONCE THE SF HAS SETTLED
+  now += 1000;
+  for (int i = 0; i < 30; i++)
+    hear(0x0202, LORA_SF_RENDEZVOUS, 6.0f);
+  TEST_ASSERT_FALSE(linkUpdateListenSf(now));
+  TEST_ASSERT_EQUAL_UINT8(9, linkListenSf());
+  now += LINK_SF_HOLD_MS;
+  TEST_ASSERT_TRUE(linkUpdateListenSf(now));
+  TEST_ASSERT_EQUAL_UINT8(LORA_SF_MIN, linkListenSf());
+}
+
+// A FASTER SF NEEDS LINK_SF_HYSTERESIS_DB MORE THAN THE MARGIN THAT KEEPS US ON IT
+static void test_speeding_up_needs_extra_headroom()
+{
+  hear(0x0210, LORA_SF_RENDEZVOUS, -3.0f); // SF7 leaves 4.5 dB, SF8 7 dB
+  TEST_ASSERT_TRUE(linkUpdateListenSf(now));
+  TEST_ASSERT_EQUAL_UINT8(8, linkListenSf());
+
+  now += LINK_PEER_TIMEOUT_MS + LINK_SF_HOLD_MS + 1;
+  hear(0x0211, LORA_SF_RENDEZVOUS, -0.5f); // SF7 leaves 7 dB: enough to stay, not to move
+  TEST_ASSERT_FALSE(linkUpdateListenSf(now));
+  TEST_ASSERT_EQUAL_UINT8(8, linkListenSf());
+  for (int i = 0; i < 30; i++)
+    hear(0x0211, LORA_SF_RENDEZVOUS, 2.0f);
+  TEST_ASSERT_TRUE(linkUpdateListenSf(now));
+  TEST_ASSERT_EQUAL_UINT8(LORA_SF_MIN, linkListenSf());
+}
+
+// AFTER A LONG SILENCE PEERS MAY HAVE LOST TRACK OF US, SO WE GO BACK TO THE SF EVERYONE STARTS FROM
+static void test_silence_returns_to_the_rendezvous_sf()
+{
+  hear(0x0220, LORA_SF_RENDEZVOUS, 5.0f);
+  linkUpdateListenSf(now);
+  TEST_ASSERT_EQUAL_UINT8(LORA_SF_MIN, linkListenSf());
+  now += LINK_SILENCE_FALLBACK_MS + 1;
+  TEST_ASSERT_TRUE(linkUpdateListenSf(now));
+  TEST_ASSERT_EQUAL_UINT8(LORA_SF_RENDEZVOUS, linkListenSf());
+}
+
+// WE SEND TO A PEER ON WHATEVER SF ITS LATEST FRAME ANNOUNCED, AND TO A PEER WE DO NOT KNOW ON THE RENDEZVOUS SF
+static void test_announced_listen_sf_is_honoured()
+{
+  uint8_t sf;
+  int8_t power;
+  linkTxParams(0x0299, sf, power);
+  TEST_ASSERT_EQUAL_UINT8(LORA_SF_RENDEZVOUS, sf);
+  TEST_ASSERT_EQUAL_INT8(LORA_POWER_MAX, power);
+
+  hear(0x0230, 8, 0.0f);
+  linkTxParams(0x0230, sf, power);
+  TEST_ASSERT_EQUAL_UINT8(8, sf);
+  hear(0x0230, LORA_SF_MIN, 0.0f);
+  linkTxParams(0x0230, sf, power);
+  TEST_ASSERT_EQUAL_UINT8(LORA_SF_MIN, sf);
+
+  // REPEATED LOSSES: FULL POWER, EVERY OTHER ATTEMPT ON THE RENDEZVOUS SF IN CASE THE PEER FELL BACK TO IT
+  for (int i = 0; i < LINK_LOSS_FALLBACK; i++)
+    linkLost(0x0230, now);
+  uint8_t first, second;
+  linkTxParams(0x0230, first, power);
+  TEST_ASSERT_EQUAL_INT8(LORA_POWER_MAX, power);
+  linkLost(0x0230, now);
+  linkTxParams(0x0230, second, power);
+  TEST_ASSERT_TRUE(first != second);
+  TEST_ASSERT_TRUE(first == LORA_SF_RENDEZVOUS || second == LORA_SF_RENDEZVOUS);
+  linkDelivered(0x0230);
+  linkTxParams(0x0230, sf, power);
+  TEST_ASSERT_EQUAL_UINT8(LORA_SF_MIN, sf);
+}
+
+// A COPY PER SF OUR PEERS LISTEN ON - AND FOR OUR BEACONS ONE ON THE RENDEZVOUS SF, WHERE A NODE THAT HAS
+// NOT HEARD US YET IS LISTENING
+static void test_broadcast_copies_cover_every_listen_sf()
+{
+  uint8_t sfs[LINK_MAX_PEERS];
+  int8_t powers[LINK_MAX_PEERS];
+  TEST_ASSERT_EQUAL_size_t(1, linkBroadcastRates(sfs, powers, LINK_MAX_PEERS, false, now));
+  TEST_ASSERT_EQUAL_UINT8(LORA_SF_RENDEZVOUS, sfs[0]);
+
+  hear(0x0240, LORA_SF_MIN, 5.0f);
+  hear(0x0241, 9, 5.0f);
+  hear(0x0242, LORA_SF_MIN, 5.0f);
+  size_t copies = linkBroadcastRates(sfs, powers, LINK_MAX_PEERS, false, now);
+  TEST_ASSERT_EQUAL_size_t(2, copies);
+  for (size_t i = 0; i < copies; i++)
+    TEST_ASSERT_TRUE(sfs[i] != LORA_SF_RENDEZVOUS);
+
+  copies = linkBroadcastRates(sfs, powers, LINK_MAX_PEERS, true, now);
+  TEST_ASSERT_EQUAL_size_t(3, copies);
+  TEST_ASSERT_EQUAL_UINT8(LORA_SF_RENDEZVOUS, sfs[0]);
+  TEST_ASSERT_EQUAL_INT8(LORA_POWER_MAX, powers[0]);
+
+  // A PEER ALREADY ON THE RENDEZVOUS SF SHARES THAT COPY
+  hear(0x0243, LORA_SF_RENDEZVOUS, 5.0f);
+  TEST_ASSERT_EQUAL_size_t(3, linkBroadcastRates(sfs, powers, LINK_MAX_PEERS, true, now));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_listen_sf_follows_the_weakest_peer);
+  RUN_TEST(test_speeding_up_needs_extra_headroom);
+  RUN_TEST(test_silence_returns_to_the_rendezvous_sf);
+  RUN_TEST(test_announced_listen_sf_is_honoured);
+  RUN_TEST(test_broadcast_copies_cover_every_listen_sf);
+  return UNITY_END();
+}
@@ -0,0 +1,318 @@
+#include <unity.h>
+#include "encryption.h"
+#include "lora_link.h"
+#include "lora_manager.h"
+#include "lora_arq.h"
+#include "lora_radio.h"
+#include "lora_relay.h"
+#include "lora_route.h"
+
+// HOST TESTS FOR THE LORA STACK: OTHER NODES' FRAMES ARE PUT IN THE RX RING AS THE RADIO TASK WOULD, OURS GO
+// OUT THROUGH THE RADIO TASK TO THE SIMULATED SX1262. EACH TEST TALKS TO ITS OWN ADDRESSES, THE STACK KEEPS
+// ITS STATE FROM ONE TEST TO THE NEXT
+#define MY_ADDRESS 0x0001
+#define LOOP_TIMEOUT_MS 3000
+
+static uint32_t delivered = 0;
+
+static void onMessage(const char *senderId, const char *message, size_t messageLen)
+{
+  delivered++;
+}
+
+static void onAckStatus(const char *localWebId, uint32_t loraMessageId, bool acked, bool finalFailure) {}
+
+static LoRaFrameHeader headerFrom(uint16_t src, uint8_t type, uint16_t dst)
+{
+  LoRaFrameHeader header = {};
+  header.version = LORA_PROTOCOL_VERSION;
+  header.type = type;
+  header.flags = (type == LORA_FRAME_DATA) ? LORA_FLAG_ENCRYPTED : 0;
+  header.dstAddress = dst;
+  header.srcAddress = src;
+  header.messageId = 0x00050000;
+  header.hopLimit = 3;
+  header.attempt = (type == LORA_FRAME_DATA) ? 1 : 0;
+  header.lastHop = src;
+  header.nextHop = LORA_BROADCAST_ADDRESS;
+  return header;
+}
+
+// SEAL A FRAME AS ITS SENDER WOULD - A DATA FRAME'S TEXT IS ENCRYPTED, AN ACK ONLY GETS THE TAG
+static size_t sealFrame(const LoRaFrameHeader &header, const char *text, uint8_t *frame)
+{
+  size_t textLen = text ? strlen(text) : 0;
+  size_t headerLen = loRaHeaderLen(header);
+  size_t frameLen = encodeLoRaFrame(header, (const uint8_t *)text, textLen, frame, LORA_MAX_FRAME_LEN - LORA_AUTH_TAG_LEN);
+  TEST_ASSERT_GREATER_THAN(0, frameLen);
+  uint8_t aad[LORA_MAX_HEADER_LEN];
+  TEST_ASSERT_TRUE(encryptPayload(frame + headerLen, textLen, aad, loRaAuthData(frame, headerLen, aad), header,
+                                  frame + frameLen));
+  return frameLen + LORA_AUTH_TAG_LEN;
+}
+
+// THE SAME FRAME WITH A TAG THE SENDER NEVER HAD THE KEY FOR
+static size_t forgeFrame(const LoRaFrameHeader &header, const char *text, uint8_t *frame)
+{
+  size_t frameLen = sealFrame(header, text, frame);
+  frame[frameLen - 1] ^= 0x5A;
+  return frameLen;
+}
+
+// PUT A FRAME IN THE RX RING AND LET THE STACK HANDLE IT
+static void receive(const uint8_t *frame, size_t frameLen)
+{
+  LoRaRadioFrame *rxFrame = loraRxRing.acquire();
+  TEST_ASSERT_NOT_NULL(rxFrame);
+  memcpy(rxFrame->data, frame, frameLen);
+  rxFrame->len = frameLen;
+  rxFrame->rssi = -70.0f;
+  rxFrame->snr = 5.0f;
+  rxFrame->sf = LORA_SF_MIN;
+  rxFrame->timestamp = millis();
+  loraRxRing.commit();
+  handleLoRaEvents();
+}
+
+// RECEIVE A GENUINE FRAME
+static void receive(const LoRaFrameHeader &header, const char *text)
+{
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+  receive(frame, sealFrame(header, text, frame));
+}
+
+void setUp() {}
+void tearDown() {}
+
+// A FORGED HEADER HEARD FIRST MUST NOT MAKE THE GENUINE FRAME A "DUPLICATE", NOR TAKE A RECEIVE STREAM
+static void test_forged_copy_does_not_hide_the_genuine_frame()
+{
+  uint8_t forged[LORA_MAX_FRAME_LEN];
+  uint8_t genuine[LORA_MAX_FRAME_LEN];
+  LoRaFrameHeader header = headerFrom(0x0010, LORA_FRAME_DATA, MY_ADDRESS);
+  size_t forgedLen = forgeFrame(header, "Meet at the bridge", forged);
+  size_t genuineLen = sealFrame(header, "Meet at the bridge", genuine);
+
+  uint32_t deliveredBefore = delivered;
+  uint32_t failuresBefore = loraStackStats.authFailures;
+  receive(forged, forgedLen);
+  TEST_ASSERT_EQUAL_UINT32(deliveredBefore, delivered);
+  TEST_ASSERT_EQUAL_UINT32(failuresBefore + 1, loraStackStats.authFailures.load());
+  TEST_ASSERT_NULL(arqFindRxStream(0x0010, MY_ADDRESS));
+  receive(genuine, genuineLen);
+  TEST_ASSERT_EQUAL_UINT32(deliveredBefore + 1, delivered);
+  TEST_ASSERT_NOT_NULL(arqFindRxStream(0x0010, MY_ADDRESS));
+
+  // A REPLAY OF IT IS A COPY ALREADY HEARD, AND RELABELLING IT AS A NEW SEQUENCE BREAKS ITS TAG
+  uint32_t duplicatesBefore = loraRelayStats.duplicates;
+  receive(genuine, genuineLen);
+  TEST_ASSERT_EQUAL_UINT32(duplicatesBefore + 1, loraRelayStats.duplicates.load());
+  genuine[6]++;
+  receive(genuine, genuineLen);
+  TEST_ASSERT_EQUAL_UINT32(deliveredBefore + 1, delivered);
+  TEST_ASSERT_EQUAL_UINT32(failuresBefore + 2, loraStackStats.authFailures.load());
+
+  // THE SAME FOR A FRAME WE ONLY RELAY: THE FORGERY IS NOT SCHEDULED, THE GENUINE FRAME IS
+  header = headerFrom(0x0011, LORA_FRAME_DATA, 0x0031);
+  forgedLen = forgeFrame(header, "Relay me", forged);
+  genuineLen = sealFrame(header, "Relay me", genuine);
+  uint32_t scheduledBefore = loraRelayStats.scheduled;
+  receive(forged, forgedLen);
+  TEST_ASSERT_EQUAL_UINT32(scheduledBefore, loraRelayStats.scheduled.load());
+  receive(genuine, genuineLen);
+  TEST_ASSERT_EQUAL_UINT32(scheduledBefore + 1, loraRelayStats.scheduled.load());
+  TEST_ASSERT_EQUAL_UINT32(deliveredBefore + 1, delivered);
+}
+
+// ONLY FRAMES THAT AUTHENTICATE TEACH ROUTES AND LINKS - A BEACON INCLUDED, AND WHETHER OR NOT IT IS FOR US
+static void test_only_authenticated_frames_teach_routes()
+{
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+  LoRaFrameHeader beacon = headerFrom(0x0020, LORA_FRAME_BEACON, LORA_BROADCAST_ADDRESS);
+  beacon.lastHop = 0x0021;
+  beacon.hopCount = 1;
+  receive(frame, forgeFrame(beacon, nullptr, frame));
+  TEST_ASSERT_EQUAL_UINT16(LORA_BROADCAST_ADDRESS, routeNextHop(0x0020, millis()));
+  TEST_ASSERT_FALSE(linkIsNeighbour(0x0021, millis()));
+
+  // A BEACON WITHOUT ANY TAG
+  receive(frame, encodeLoRaFrame(beacon, nullptr, 0, frame, sizeof(frame)));
+  TEST_ASSERT_EQUAL_UINT16(LORA_BROADCAST_ADDRESS, routeNextHop(0x0020, millis()));
+
+  LoRaFrameHeader data = headerFrom(0x0022, LORA_FRAME_DATA, 0x0032);
+  data.lastHop = 0x0023;
+  data.hopCount = 1;
+  receive(frame, forgeFrame(data, "Relay me", frame));
+  TEST_ASSERT_EQUAL_UINT16(LORA_BROADCAST_ADDRESS, routeNextHop(0x0022, millis()));
+  TEST_ASSERT_FALSE(linkIsNeighbour(0x0023, millis()));
+
+  receive(frame, sealFrame(beacon, nullptr, frame));
+  TEST_ASSERT_EQUAL_UINT16(0x0021, routeNextHop(0x0020, millis()));
+  TEST_ASSERT_TRUE(linkIsNeighbour(0x0021, millis()));
+  receive(frame, sealFrame(data, "Relay me", frame));
+  TEST_ASSERT_EQUAL_UINT16(0x0023, routeNextHop(0x0022, millis()));
+}
+
+// A FORGED ACK SETTLES NOTHING, THE GENUINE ONE STILL DOES
+static void test_forged_ack_settles_nothing()
+{
+  TEST_ASSERT_EQUAL(LORA_SUBMIT_OK, submitLoRaMessage("Anyone there?", "web-1", 0x0070));
+  handleLoRaEvents();
+  ArqTxStream *tx = arqFindTxStream(0x0070);
+  TEST_ASSERT_NOT_NULL(tx);
+  uint32_t inFlight = tx->nextSeq - tx->base;
+  TEST_ASSERT_GREATER_THAN(0, inFlight);
+
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+  LoRaFrameHeader ack = headerFrom(0x0070, LORA_FRAME_ACK, MY_ADDRESS);
+  ack.messageId = tx->nextSeq - 1;
+  ack.ackStream = 0x0070;
+  ack.ackSerial = 0x00010000;
+  receive(frame, forgeFrame(ack, nullptr, frame));
+  TEST_ASSERT_EQUAL_UINT32(inFlight, tx->nextSeq - tx->base);
+
+  // AN ACK WITHOUT ANY TAG, AS EARLIER VERSIONS SENT THEM
+  receive(frame, encodeLoRaFrame(ack, nullptr, 0, frame, sizeof(frame)));
+  TEST_ASSERT_EQUAL_UINT32(inFlight, tx->nextSeq - tx->base);
+
+  receive(frame, sealFrame(ack, nullptr, frame));
+  TEST_ASSERT_TRUE(tx->base == tx->nextSeq);
+}
+
+// ANOTHER NODE'S UNICAST THAT IS NOT OURS TO FORWARD IS DROPPED UNPARSED, A GROUP WE ARE IN IS DELIVERED
+static void test_foreign_frames_are_dropped_and_groups_delivered()
+{
+  LoRaFrameHeader foreign = headerFrom(0x0080, LORA_FRAME_DATA, 0x0081);
+  foreign.nextHop = 0x0081;
+  uint32_t rejectedBefore = loraStackStats.foreignRejected;
+  uint32_t failuresBefore = loraStackStats.authFailures;
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+  receive(frame, forgeFrame(foreign, "Not for you", frame));
+  TEST_ASSERT_EQUAL_UINT32(rejectedBefore + 1, loraStackStats.foreignRejected.load());
+  TEST_ASSERT_EQUAL_UINT32(failuresBefore, loraStackStats.authFailures.load());
+
+  uint32_t deliveredBefore = delivered;
+  receive(headerFrom(0x0082, LORA_FRAME_DATA, MY_GROUPS[0]), "Team meeting");
+  TEST_ASSERT_EQUAL_UINT32(deliveredBefore + 1, delivered);
+  TEST_ASSERT_NOT_NULL(arqFindRxStream(0x0082, MY_GROUPS[0]));
+  TEST_ASSERT_NULL(arqFindRxStream(0x0082, MY_ADDRESS));
+}
+
+// THE SACK A PEER SENDS FOR THE OLDEST FRAME WE HAVE IN FLIGHT TO IT
+static void ackOldestFrame(uint16_t peer)
+{
+  ArqTxStream *tx = arqFindTxStream(peer);
+  TEST_ASSERT_NOT_NULL(tx);
+  TEST_ASSERT_TRUE(tx->base != tx->nextSeq);
+  LoRaFrameHeader ack = headerFrom(peer, LORA_FRAME_ACK, MY_ADDRESS);
+  ack.messageId = tx->base;
+  ack.ackStream = peer;
+  receive(ack, nullptr);
+  TEST_ASSERT_TRUE(tx->base == tx->nextSeq);
+}
+
+// KARN: AN ACK FOR A FRAME SENT ONCE TIMES THE ROUND TRIP, ONE FOR A RETRANSMITTED FRAME COULD ANSWER EITHER
+// COPY AND IS NOT SAMPLED, SO THE BACKOFF THE TIMEOUT BROUGHT STAYS
+static void test_only_frames_sent_once_give_rtt_samples()
+{
+  uint32_t samplesBefore = loraStackStats.rttSamples;
+  TEST_ASSERT_EQUAL(LORA_SUBMIT_OK, submitLoRaMessage("First try", "web-1", 0x0060));
+  handleLoRaEvents();
+  ackOldestFrame(0x0060);
+  TEST_ASSERT_EQUAL_UINT32(samplesBefore + 1, loraStackStats.rttSamples.load());
+  ArqTxStream *tx = arqFindTxStream(0x0060);
+  TEST_ASSERT_TRUE(tx->rttValid);
+  TEST_ASSERT_EQUAL_UINT8(0, tx->backoff);
+
+  TEST_ASSERT_EQUAL(LORA_SUBMIT_OK, submitLoRaMessage("Second try", "web-2", 0x0060));
+  uint32_t timeoutsBefore = loraStackStats.ackTimeouts;
+  unsigned long deadline = millis() + LOOP_TIMEOUT_MS;
+  while (loraStackStats.ackTimeouts == timeoutsBefore && (long)(millis() - deadline) < 0)
+  {
+    handleLoRaEvents();
+    checkAckTimeouts();
+    delay(10);
+  }
+  TEST_ASSERT_EQUAL_UINT32(timeoutsBefore + 1, loraStackStats.ackTimeouts.load());
+  ackOldestFrame(0x0060);
+  TEST_ASSERT_EQUAL_UINT32(samplesBefore + 1, loraStackStats.rttSamples.load());
+  TEST_ASSERT_EQUAL_UINT8(1, tx->backoff);
+}
+
+// FRAGMENT index OF A TWO-FRAGMENT MESSAGE, THE FIRST ONE FULL AS THE SENDER SPLITS THEM, ON ITS attempt-TH
+// TRANSMISSION
+static void receiveFragment(uint16_t src, uint8_t index, uint8_t attempt = 1)
+{
+  static char text[LORA_MAX_FRAGMENT_PAYLOAD_LEN + 1];
+  LoRaFrameHeader header = headerFrom(src, LORA_FRAME_DATA, MY_ADDRESS);
+  header.flags |= LORA_FLAG_FRAGMENT;
+  header.messageId += index;
+  header.windowOffset = index;
+  header.fragIndex = index;
+  header.fragCount = 2;
+  header.attempt = attempt;
+  size_t len = (index == 0) ? LORA_MAX_FRAGMENT_PAYLOAD_LEN : 12;
+  memset(text, 'a' + index, len);
+  text[len] = 0;
+  receive(header, text);
+}
+
+// A MESSAGE STARTED WHILE EVERY REASSEMBLY BUFFER IS BUSY IS LEFT UNACKED FOR ITS SENDER TO RETRY, THE
+// MESSAGES WHOSE FRAGMENTS WERE ALREADY ACKED ARE NOT DROPPED TO MAKE ROOM FOR IT
+static void test_fragment_without_a_buffer_is_left_unacked()
+{
+  uint32_t deliveredBefore = delivered;
+  receiveFragment(0x0040, 0);
+  receiveFragment(0x0041, 0);
+  TEST_ASSERT_TRUE(arqFindRxStream(0x0040, MY_ADDRESS)->ackPending);
+  TEST_ASSERT_TRUE(arqFindRxStream(0x0041, MY_ADDRESS)->ackPending);
+  receiveFragment(0x0042, 0);
+  TEST_ASSERT_NULL(arqFindRxStream(0x0042, MY_ADDRESS));
+
+  receiveFragment(0x0040, 1);
+  receiveFragment(0x0041, 1);
+  TEST_ASSERT_EQUAL_UINT32(deliveredBefore + 2, delivered);
+
+  // THE SENDER'S RETRY, NOW THERE IS ROOM
+  receiveFragment(0x0042, 0, 2);
+  TEST_ASSERT_TRUE(arqFindRxStream(0x0042, MY_ADDRESS)->ackPending);
+  receiveFragment(0x0042, 1);
+  TEST_ASSERT_EQUAL_UINT32(deliveredBefore + 3, delivered);
+}
+
+// A DATA FRAME THAT NEVER REACHES THE RADIO TASK GIVES BACK THE HELD ACK IT WAS TO CARRY, STILL DUE
+// (RUN LAST: THE TX RING IS LEFT FULL OF FILLER FRAMES FOR SEVERAL SECONDS)
+static void test_failed_send_gives_back_its_piggybacked_ack()
+{
+  receive(headerFrom(0x0050, LORA_FRAME_DATA, MY_ADDRESS), "Are you there?");
+  ArqRxStream *rx = arqFindRxStream(0x0050, MY_ADDRESS);
+  TEST_ASSERT_NOT_NULL(rx);
+  TEST_ASSERT_TRUE(rx->ackPending);
+  unsigned long ackDueTime = rx->ackDueTime;
+
+  uint8_t filler[LORA_MAX_FRAME_LEN] = {};
+  while (queueLoRaRadioFrame(filler, sizeof(filler), LORA_SF_RENDEZVOUS, LORA_POWER_MAX, LORA_TX_DATA))
+    ;
+  uint32_t piggybackedBefore = loraStackStats.acksPiggybacked;
+  uint32_t sentBefore = loraStackStats.dataFramesSent;
+  TEST_ASSERT_EQUAL(LORA_SUBMIT_OK, submitLoRaMessage("Yes", "web-1", 0x0050));
+  handleLoRaEvents();
+  TEST_ASSERT_EQUAL_UINT32(sentBefore, loraStackStats.dataFramesSent.load());
+  TEST_ASSERT_EQUAL_UINT32(piggybackedBefore, loraStackStats.acksPiggybacked.load());
+  TEST_ASSERT_TRUE(rx->ackPending);
+  TEST_ASSERT_EQUAL_UINT32(ackDueTime, rx->ackDueTime);
+}
+
+int main(int argc, char **argv)
+{
+  setupLoRa(MY_ADDRESS, onMessage, onAckStatus);
+  UNITY_BEGIN();
+  RUN_TEST(test_forged_copy_does_not_hide_the_genuine_frame);
+  RUN_TEST(test_forged_ack_settles_nothing);
+  RUN_TEST(test_only_authenticated_frames_teach_routes);
+  RUN_TEST(test_foreign_frames_are_dropped_and_groups_delivered);
+  RUN_TEST(test_only_frames_sent_once_give_rtt_samples);
+  RUN_TEST(test_fragment_without_a_buffer_is_left_unacked);
+  RUN_TEST(test_failed_send_gives_back_its_piggybacked_ack);
+  return UNITY_END();
+}
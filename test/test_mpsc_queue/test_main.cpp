@@ -0,0 +1,167 @@
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "mpsc_queue.h"
+
+// HOST TESTS FOR THE COMMAND QUEUE FROM THE WEB, BUTTON AND OTHER PRODUCERS INTO THE LORA STACK
+
+#define TEST_QUEUE_LEN 8
+#define TEST_PRODUCERS 4
+#define TEST_ITEMS_PER_PRODUCER 100000
+
+struct TestItem {
+  uint32_t producer;
+  uint32_t seq;
+};
+
+void setUp() {}
+void tearDown() {}
+
+static void test_refuses_when_full_and_pops_in_order()
+{
+  MpscQueue<uint32_t, TEST_QUEUE_LEN> queue;
+  uint32_t value;
+  TEST_ASSERT_FALSE(queue.pop(value));
+  for (uint32_t i = 0; i < TEST_QUEUE_LEN; i++)
+    TEST_ASSERT_TRUE(queue.push(i));
+  TEST_ASSERT_FALSE(queue.push(TEST_QUEUE_LEN));
+  for (uint32_t i = 0; i < TEST_QUEUE_LEN; i++)
+  {
+    TEST_ASSERT_TRUE(queue.pop(value));
+    TEST_ASSERT_EQUAL_UINT32(i, value);
+  }
+  TEST_ASSERT_FALSE(queue.pop(value));
+}
+
+static void test_wraps_around()
+{
+  MpscQueue<uint32_t, TEST_QUEUE_LEN> queue;
+  uint32_t value;
+  for (uint32_t i = 0; i < 10 * TEST_QUEUE_LEN; i++)
+  {
+    TEST_ASSERT_TRUE(queue.push(i));
+    TEST_ASSERT_TRUE(queue.push(i + 1000));
+    TEST_ASSERT_TRUE(queue.pop(value));
+    TEST_ASSERT_EQUAL_UINT32(i, value);
+    TEST_ASSERT_TRUE(queue.pop(value));
+    TEST_ASSERT_EQUAL_UINT32(i + 1000, value);
+  }
+}
+
+// PRODUCER THREADS RETRY UNTIL EVERY ITEM IS IN: NOTHING IS LOST OR DUPLICATED, AND EACH PRODUCER'S
+// ITEMS COME OUT IN THE ORDER IT PUT THEM IN
+static void test_stress_every_item_arrives_once_in_producer_order()
+{
+  static MpscQueue<TestItem, TEST_QUEUE_LEN> queue;
+  std::atomic<uint32_t> fullResults{0};
+  std::vector<std::thread> producers;
+  for (uint32_t p = 0; p < TEST_PRODUCERS; p++)
+  {
+    producers.emplace_back([p, &fullResults]() {
+      for (uint32_t seq = 0; seq < TEST_ITEMS_PER_PRODUCER;)
+      {
+        if (queue.push(TestItem{p, seq}))
+          seq++;
+        else
+        {
+          fullResults++;
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  uint32_t nextSeq[TEST_PRODUCERS] = {};
+  uint32_t received = 0, outOfOrder = 0, badProducer = 0;
+  TestItem item;
+  while (received < TEST_PRODUCERS * TEST_ITEMS_PER_PRODUCER)
+  {
+    if (!queue.pop(item))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    received++;
+    if (item.producer >= TEST_PRODUCERS)
+    {
+      badProducer++;
+      continue;
+    }
+    if (item.seq != nextSeq[item.producer])
+      outOfOrder++;
+    nextSeq[item.producer] = item.seq + 1;
+  }
+  for (std::thread &producer : producers)
+    producer.join();
+
+  char report[96];
+  snprintf(report, sizeof(report), "%u items from %u producers, %u pushes found the queue full",
+           (unsigned)received, TEST_PRODUCERS, (unsigned)fullResults.load());
+  TEST_MESSAGE(report);
+  TEST_ASSERT_EQUAL_UINT32(0, badProducer);
+  TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+  for (uint32_t p = 0; p < TEST_PRODUCERS; p++)
+    TEST_ASSERT_EQUAL_UINT32(TEST_ITEMS_PER_PRODUCER, nextSeq[p]);
+  TestItem extra;
+  TEST_ASSERT_FALSE(queue.pop(extra));
+}
+
+// PRODUCERS THAT GIVE UP ON "QUEUE FULL", AS THE WEB HANDLER DOES: EXACTLY THE ACCEPTED ITEMS COME OUT
+static void test_stress_accepted_items_match_consumed()
+{
+  static MpscQueue<TestItem, TEST_QUEUE_LEN> queue;
+  std::atomic<uint32_t> accepted{0};
+  std::atomic<bool> producing{true};
+  std::vector<std::thread> producers;
+  for (uint32_t p = 0; p < TEST_PRODUCERS; p++)
+  {
+    producers.emplace_back([p, &accepted]() {
+      for (uint32_t seq = 0; seq < TEST_ITEMS_PER_PRODUCER; seq++)
+      {
+        if (queue.push(TestItem{p, seq}))
+          accepted++;
+      }
+    });
+  }
+  std::thread joiner([&producers, &producing]() {
+    for (std::thread &producer : producers)
+      producer.join();
+    producing = false;
+  });
+
+  uint32_t consumed = 0;
+  uint32_t lastSeq[TEST_PRODUCERS];
+  bool seen[TEST_PRODUCERS] = {};
+  bool inOrder = true;
+  TestItem item;
+  for (;;)
+  {
+    bool done = !producing.load();
+    while (queue.pop(item))
+    {
+      consumed++;
+      if (seen[item.producer] && item.seq <= lastSeq[item.producer])
+        inOrder = false;
+      seen[item.producer] = true;
+      lastSeq[item.producer] = item.seq;
+    }
+    if (done)
+      break;
+    std::this_thread::yield();
+  }
+  joiner.join();
+
+  TEST_ASSERT_TRUE(inOrder);
+  TEST_ASSERT_EQUAL_UINT32(accepted.load(), consumed);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_refuses_when_full_and_pops_in_order);
+  RUN_TEST(test_wraps_around);
+  RUN_TEST(test_stress_every_item_arrives_once_in_producer_order);
+  RUN_TEST(test_stress_accepted_items_match_consumed);
+  return UNITY_END();
+}
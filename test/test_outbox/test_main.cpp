@@ -0,0 +1,202 @@
+#include <unity.h>
+#include <LittleFS.h>
+#include "lora_outbox.h"
+
+// HOST TESTS FOR THE STORE-AND-FORWARD OUTBOX: UNDELIVERED MESSAGES COME BACK AFTER A REBOOT (outboxSetup()
+// AGAIN), WHATEVER THE LOG'S TAIL LOOKS LIKE, AND THE LOG STAYS BOUNDED AND READABLE AS IT IS COMPACTED
+#define PEER 0x0042
+
+static uint32_t evictions = 0;
+
+static void onEvict(uint32_t id, const char *localWebId)
+{
+  evictions++;
+}
+
+static void reboot()
+{
+  outboxSetup(onEvict);
+}
+
+// THE HELD ENTRY FOR AN OUTBOX ID, OR NULLPTR - FOUND AS THE STACK FINDS THEM, BY OFFERING EVERY DUE ONE
+// IN TURN ONCE THEIR DESTINATION IS HEARD, THEN HOLDING THEM AGAIN
+static LoRaOutboxEntry *heldEntry(uint32_t id)
+{
+  static unsigned long later = 0;
+  later += 2 * LORA_OUTBOX_REOFFER_MS;
+  outboxPeerHeard(PEER);
+  LoRaOutboxEntry *entry;
+  LoRaOutboxEntry *found = nullptr;
+  uint32_t offered[LORA_OUTBOX_MAX_ENTRIES];
+  size_t count = 0;
+  while ((entry = outboxNextDue(later)) != nullptr)
+  {
+    if (entry->id == id)
+      found = entry;
+    offered[count++] = entry->id;
+    outboxOffered(*entry, later);
+  }
+  for (size_t i = 0; i < count; i++)
+    outboxHold(offered[i], later);
+  return found;
+}
+
+static void assertText(uint32_t id, const char *expectedText, const char *expectedLocalWebId)
+{
+  char text[LORA_MAX_MESSAGE_LEN + 1];
+  char localWebId[LORA_LOCAL_ID_MAX_LEN + 1];
+  LoRaOutboxEntry *entry = heldEntry(id);
+  TEST_ASSERT_NOT_NULL(entry);
+  TEST_ASSERT_TRUE(outboxLoad(*entry, text, sizeof(text), localWebId, sizeof(localWebId)));
+  TEST_ASSERT_EQUAL_STRING(expectedText, text);
+  TEST_ASSERT_EQUAL_STRING(expectedLocalWebId, localWebId);
+}
+
+void setUp()
+{
+  LittleFS.remove(LORA_OUTBOX_PATH);
+  LittleFS.remove(LORA_OUTBOX_TMP_PATH);
+  nativeFsFreeBytes = SIZE_MAX;
+  reboot();
+}
+
+void tearDown() {}
+
+static void test_undelivered_messages_survive_a_reboot()
+{
+  uint32_t first = outboxAdd("Still on its way", "web-1", PEER, millis());
+  uint32_t second = outboxAdd("Delivered", "web-2", PEER, millis());
+  TEST_ASSERT_TRUE(first != 0 && second != 0);
+  outboxDone(second, true);
+  outboxFlush(millis(), true);
+
+  reboot();
+  TEST_ASSERT_EQUAL_UINT32(1, loraOutboxStats.recovered.load());
+  TEST_ASSERT_EQUAL_size_t(1, outboxCount(LoRaOutboxEntry::HELD));
+  assertText(first, "Still on its way", "web-1");
+
+  // NEW IDS CARRY ON AFTER THE RECOVERED ONES
+  uint32_t third = outboxAdd("After the reboot", "web-3", PEER, millis());
+  TEST_ASSERT_TRUE((int32_t)(third - second) > 0);
+}
+
+// A WRITE THAT COMES UP SHORT KEEPS THE REST BUFFERED - NOTHING IS LOST, AND THE LOG NEVER GETS A GAP
+static void test_short_write_keeps_the_rest_for_the_next_flush()
+{
+  uint32_t first = outboxAdd("Written in two goes", "web-1", PEER, millis());
+  uint32_t second = outboxAdd("And so is this one", "web-2", PEER, millis());
+  nativeFsFreeBytes = 20;
+  outboxFlush(millis(), true);
+  TEST_ASSERT_EQUAL_UINT32(20, loraOutboxStats.fileBytes.load());
+  outboxHold(first, millis());
+  outboxHold(second, millis());
+  assertText(first, "Written in two goes", "web-1"); // Partly on flash, partly still buffered
+  assertText(second, "And so is this one", "web-2");
+
+  nativeFsFreeBytes = SIZE_MAX;
+  outboxFlush(millis(), true);
+  uint32_t tornBefore = loraOutboxStats.tornRecords;
+  reboot();
+  TEST_ASSERT_EQUAL_UINT32(tornBefore, loraOutboxStats.tornRecords.load());
+  TEST_ASSERT_EQUAL_UINT32(2, loraOutboxStats.recovered.load());
+  assertText(first, "Written in two goes", "web-1");
+  assertText(second, "And so is this one", "web-2");
+}
+
+// A POWER CUT MID-WRITE LEAVES A TORN RECORD AT THE END - IT IS CUT OFF SO LATER RECORDS ARE NOT LOST BEHIND IT
+static void test_torn_tail_is_dropped_at_boot()
+{
+  uint32_t id = outboxAdd("Before the power cut", "web-1", PEER, millis());
+  outboxFlush(millis(), true);
+  File log = LittleFS.open(LORA_OUTBOX_PATH, "a");
+  const uint8_t torn[] = {LORA_OUTBOX_MARKER, LORA_OUTBOX_ADD, 40, 0, 1, 2, 3};
+  log.write(torn, sizeof(torn));
+  log.close();
+
+  uint32_t tornBefore = loraOutboxStats.tornRecords;
+  reboot();
+  TEST_ASSERT_EQUAL_UINT32(tornBefore + 1, loraOutboxStats.tornRecords.load());
+  uint32_t later = outboxAdd("After the power cut", "web-2", PEER, millis());
+  outboxFlush(millis(), true);
+  reboot();
+  TEST_ASSERT_EQUAL_UINT32(2, loraOutboxStats.recovered.load());
+  assertText(id, "Before the power cut", "web-1");
+  assertText(later, "After the power cut", "web-2");
+}
+
+// DELIVERED MESSAGES' RECORDS ARE COMPACTED AWAY ONCE THE LOG OUTGROWS ITS BOUND, THE LIVE ONES STAY READABLE
+static void test_log_is_compacted_to_the_live_records()
+{
+  uint32_t kept = outboxAdd("Kept through every compaction", "web-kept", PEER, millis());
+  char text[200];
+  memset(text, 'x', sizeof(text) - 1);
+  text[sizeof(text) - 1] = 0;
+  uint32_t compactionsBefore = loraOutboxStats.compactions;
+  for (int i = 0; i < 400; i++)
+  {
+    uint32_t id = outboxAdd(text, "web-n", PEER, millis());
+    outboxDone(id, true);
+    outboxFlush(millis(), false);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(LORA_OUTBOX_MAX_FILE_BYTES + LORA_OUTBOX_WRITE_BUFFER, loraOutboxStats.fileBytes.load());
+  }
+  TEST_ASSERT_TRUE(loraOutboxStats.compactions > compactionsBefore);
+  outboxFlush(millis(), true);
+  reboot();
+  TEST_ASSERT_EQUAL_UINT32(1, loraOutboxStats.recovered.load());
+  assertText(kept, "Kept through every compaction", "web-kept");
+}
+
+// A FULL OUTBOX MAKES ROOM BY EVICTING THE OLDEST HELD MESSAGE, NEVER ONE STILL IN FLIGHT
+static void test_full_outbox_evicts_the_oldest_held_message()
+{
+  uint32_t ids[LORA_OUTBOX_MAX_ENTRIES];
+  for (size_t i = 0; i < LORA_OUTBOX_MAX_ENTRIES; i++)
+    ids[i] = outboxAdd("Waiting", "web", PEER, millis());
+  TEST_ASSERT_EQUAL_UINT32(0, outboxAdd("No room", "web", PEER, millis())); // Every one in flight
+  outboxHold(ids[5], millis());
+  outboxHold(ids[3], millis());
+  uint32_t evictionsBefore = evictions;
+  TEST_ASSERT_TRUE(outboxAdd("Room now", "web", PEER, millis()) != 0);
+  TEST_ASSERT_EQUAL_UINT32(evictionsBefore + 1, evictions);
+  TEST_ASSERT_NULL(heldEntry(ids[3]));
+  TEST_ASSERT_NOT_NULL(heldEntry(ids[5]));
+}
+
+// WITH FLASH FULL AND THE WRITE BUFFER TOO FULL FOR THE NEW RECORD, NOTHING IS EVICTED FOR A MESSAGE THAT
+// CANNOT BE KEPT ANYWAY - THE HELD ONE STAYS UNTIL THERE IS ROOM
+static void test_no_eviction_without_room_for_the_new_record()
+{
+  static char longText[LORA_MAX_MESSAGE_LEN + 1];
+  memset(longText, 'x', LORA_MAX_MESSAGE_LEN);
+  uint32_t ids[LORA_OUTBOX_MAX_ENTRIES];
+  for (size_t i = 0; i < LORA_OUTBOX_MAX_ENTRIES - 2; i++)
+    ids[i] = outboxAdd("Waiting", "web", PEER, millis());
+  outboxFlush(millis(), true);
+  nativeFsFreeBytes = 0;
+  ids[LORA_OUTBOX_MAX_ENTRIES - 2] = outboxAdd(longText, "web", PEER, millis());
+  ids[LORA_OUTBOX_MAX_ENTRIES - 1] = outboxAdd(longText, "web", PEER, millis());
+  TEST_ASSERT_TRUE(ids[LORA_OUTBOX_MAX_ENTRIES - 1] != 0);
+  outboxHold(ids[0], millis());
+
+  uint32_t evictionsBefore = evictions;
+  TEST_ASSERT_EQUAL_UINT32(0, outboxAdd(longText, "web", PEER, millis()));
+  TEST_ASSERT_EQUAL_UINT32(evictionsBefore, evictions);
+  TEST_ASSERT_NOT_NULL(heldEntry(ids[0]));
+
+  nativeFsFreeBytes = SIZE_MAX;
+  TEST_ASSERT_TRUE(outboxAdd(longText, "web", PEER, millis()) != 0);
+  TEST_ASSERT_EQUAL_UINT32(evictionsBefore + 1, evictions);
+  TEST_ASSERT_NULL(heldEntry(ids[0]));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_undelivered_messages_survive_a_reboot);
+  RUN_TEST(test_short_write_keeps_the_rest_for_the_next_flush);
+  RUN_TEST(test_torn_tail_is_dropped_at_boot);
+  RUN_TEST(test_log_is_compacted_to_the_live_records);
+  RUN_TEST(test_full_outbox_evicts_the_oldest_held_message);
+  RUN_TEST(test_no_eviction_without_room_for_the_new_record);
+  return UNITY_END();
+}
@@ -0,0 +1,264 @@
+#include <unity.h>
+#include "lora_packet.h"
+
+// HOST TESTS FOR THE BINARY FRAME FORMAT - ENCODE/DECODE ROUND TRIPS AND REJECTION OF MALFORMED FRAMES
+
+static LoRaFrameHeader baseHeader(uint8_t type)
+{
+  LoRaFrameHeader header = {};
+  header.version = LORA_PROTOCOL_VERSION;
+  header.type = type;
+  header.dstAddress = 0x0002;
+  header.srcAddress = 0x0001;
+  header.messageId = 0x12345678;
+  header.linkSf = 9;
+  header.linkPower = 14;
+  header.hopLimit = 3;
+  header.hopCount = 1;
+  header.attempt = 2;
+  header.lastHop = 0x0003;
+  header.nextHop = LORA_BROADCAST_ADDRESS;
+  return header;
+}
+
+static void assertCommonFields(const LoRaFrameHeader &expected, const LoRaFrameHeader &actual)
+{
+  TEST_ASSERT_EQUAL_UINT8(expected.version, actual.version);
+  TEST_ASSERT_EQUAL_UINT8(expected.type, actual.type);
+  TEST_ASSERT_EQUAL_HEX8(expected.flags, actual.flags);
+  TEST_ASSERT_EQUAL_HEX16(expected.dstAddress, actual.dstAddress);
+  TEST_ASSERT_EQUAL_HEX16(expected.srcAddress, actual.srcAddress);
+  TEST_ASSERT_EQUAL_UINT32(expected.messageId, actual.messageId);
+  TEST_ASSERT_EQUAL_UINT8(expected.linkSf, actual.linkSf);
+  TEST_ASSERT_EQUAL_INT8(expected.linkPower, actual.linkPower);
+  TEST_ASSERT_EQUAL_UINT8(expected.hopLimit, actual.hopLimit);
+  TEST_ASSERT_EQUAL_UINT8(expected.hopCount, actual.hopCount);
+  TEST_ASSERT_EQUAL_UINT8(expected.attempt, actual.attempt);
+  TEST_ASSERT_EQUAL_HEX16(expected.lastHop, actual.lastHop);
+  TEST_ASSERT_EQUAL_HEX16(expected.nextHop, actual.nextHop);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_data_frame_round_trip()
+{
+  LoRaFrameHeader header = baseHeader(LORA_FRAME_DATA);
+  header.flags = LORA_FLAG_ENCRYPTED;
+  header.windowOffset = 5;
+  const uint8_t payload[] = {0xDE, 0xAD, 0xBE, 0xEF, 0x00, 0x7F};
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+
+  size_t frameLen = encodeLoRaFrame(header, payload, sizeof(payload), frame, sizeof(frame));
+  TEST_ASSERT_EQUAL_size_t(LORA_DATA_HEADER_LEN + sizeof(payload), frameLen);
+
+  LoRaFrameHeader decoded;
+  const uint8_t *decodedPayload;
+  size_t decodedLen;
+  TEST_ASSERT_TRUE(decodeLoRaFrame(frame, frameLen, decoded, decodedPayload, decodedLen));
+  assertCommonFields(header, decoded);
+  TEST_ASSERT_EQUAL_UINT8(5, decoded.windowOffset);
+  TEST_ASSERT_EQUAL_PTR(frame + LORA_DATA_HEADER_LEN, decodedPayload);
+  TEST_ASSERT_EQUAL_size_t(sizeof(payload), decodedLen);
+  TEST_ASSERT_EQUAL_MEMORY(payload, decodedPayload, sizeof(payload));
+}
+
+static void test_fragment_with_piggyback_round_trip()
+{
+  LoRaFrameHeader header = baseHeader(LORA_FRAME_DATA);
+  header.flags = LORA_FLAG_ENCRYPTED | LORA_FLAG_FRAGMENT | LORA_FLAG_PIGGYBACK_ACK | LORA_FLAG_COMPRESSED;
+  header.fragIndex = 2;
+  header.fragCount = 3;
+  header.piggyback.peer = 0x0004;
+  header.piggyback.stream = 0xFF01;
+  header.piggyback.cumAck = 0xA0B0C0D0;
+  header.piggyback.bitmap = 0x80000001;
+  header.piggyback.snrReport = -37;
+  const uint8_t payload[] = {1, 2, 3};
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+
+  size_t frameLen = encodeLoRaFrame(header, payload, sizeof(payload), frame, sizeof(frame));
+  size_t headerLen = LORA_DATA_HEADER_LEN + LORA_FRAGMENT_HEADER_LEN + LORA_PIGGYBACK_ACK_LEN;
+  TEST_ASSERT_EQUAL_size_t(headerLen, loRaHeaderLen(header));
+  TEST_ASSERT_EQUAL_size_t(headerLen + sizeof(payload), frameLen);
+
+  LoRaFrameHeader decoded;
+  const uint8_t *decodedPayload;
+  size_t decodedLen;
+  TEST_ASSERT_TRUE(decodeLoRaFrame(frame, frameLen, decoded, decodedPayload, decodedLen));
+  assertCommonFields(header, decoded);
+  TEST_ASSERT_EQUAL_UINT8(2, decoded.fragIndex);
+  TEST_ASSERT_EQUAL_UINT8(3, decoded.fragCount);
+  TEST_ASSERT_EQUAL_HEX16(0x0004, decoded.piggyback.peer);
+  TEST_ASSERT_EQUAL_HEX16(0xFF01, decoded.piggyback.stream);
+  TEST_ASSERT_EQUAL_UINT32(0xA0B0C0D0, decoded.piggyback.cumAck);
+  TEST_ASSERT_EQUAL_UINT32(0x80000001, decoded.piggyback.bitmap);
+  TEST_ASSERT_EQUAL_INT8(-37, decoded.piggyback.snrReport);
+  TEST_ASSERT_EQUAL_size_t(sizeof(payload), decodedLen);
+  TEST_ASSERT_EQUAL_MEMORY(payload, decodedPayload, sizeof(payload));
+}
+
+static void test_ack_frame_round_trip()
+{
+  LoRaFrameHeader header = baseHeader(LORA_FRAME_ACK);
+  header.ackBitmap = 0x0000F00F;
+  header.snrReport = 22;
+  header.ackStream = LORA_BROADCAST_ADDRESS;
+  header.ackSerial = 0x0009FFFE;
+  uint8_t tag[LORA_AUTH_TAG_LEN] = {9, 8, 7, 6, 5, 4, 3, 2};
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+
+  size_t frameLen = encodeLoRaFrame(header, tag, sizeof(tag), frame, sizeof(frame));
+  TEST_ASSERT_EQUAL_size_t(LORA_ACK_FRAME_LEN, frameLen);
+
+  LoRaFrameHeader decoded;
+  const uint8_t *decodedPayload;
+  size_t decodedLen;
+  TEST_ASSERT_TRUE(decodeLoRaFrame(frame, frameLen, decoded, decodedPayload, decodedLen));
+  assertCommonFields(header, decoded);
+  TEST_ASSERT_EQUAL_UINT32(0x0000F00F, decoded.ackBitmap);
+  TEST_ASSERT_EQUAL_INT8(22, decoded.snrReport);
+  TEST_ASSERT_EQUAL_HEX16(LORA_BROADCAST_ADDRESS, decoded.ackStream);
+  TEST_ASSERT_EQUAL_UINT32(0x0009FFFE, decoded.ackSerial);
+  TEST_ASSERT_EQUAL_size_t(LORA_AUTH_TAG_LEN, decodedLen);
+  TEST_ASSERT_EQUAL_MEMORY(tag, decodedPayload, sizeof(tag));
+}
+
+static void test_beacon_is_header_only()
+{
+  LoRaFrameHeader header = baseHeader(LORA_FRAME_BEACON);
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+  size_t frameLen = encodeLoRaFrame(header, nullptr, 0, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL_size_t(LORA_FRAME_HEADER_LEN, frameLen);
+
+  LoRaFrameHeader decoded;
+  const uint8_t *decodedPayload;
+  size_t decodedLen;
+  TEST_ASSERT_TRUE(decodeLoRaFrame(frame, frameLen, decoded, decodedPayload, decodedLen));
+  assertCommonFields(header, decoded);
+  TEST_ASSERT_EQUAL_size_t(0, decodedLen);
+}
+
+// A RECEIVER DROPS OTHER NODES' FRAMES ON THEIR ADDRESS BYTES ALONE
+static void test_peek_reads_addressing_only()
+{
+  LoRaFrameHeader header = baseHeader(LORA_FRAME_DATA);
+  header.nextHop = 0x0005;
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+  size_t frameLen = encodeLoRaFrame(header, nullptr, 0, frame, sizeof(frame));
+
+  uint16_t dstAddress = 0, nextHop = 0;
+  TEST_ASSERT_TRUE(peekLoRaAddressing(frame, frameLen, dstAddress, nextHop));
+  TEST_ASSERT_EQUAL_HEX16(0x0002, dstAddress);
+  TEST_ASSERT_EQUAL_HEX16(0x0005, nextHop);
+  TEST_ASSERT_FALSE(peekLoRaAddressing(frame, LORA_FRAME_HEADER_LEN - 1, dstAddress, nextHop));
+  frame[0] = (uint8_t)(((LORA_PROTOCOL_VERSION - 1) << 4) | LORA_FRAME_DATA);
+  TEST_ASSERT_FALSE(peekLoRaAddressing(frame, frameLen, dstAddress, nextHop));
+}
+
+static void test_encode_rejects_frames_that_do_not_fit()
+{
+  LoRaFrameHeader header = baseHeader(LORA_FRAME_DATA);
+  uint8_t payload[LORA_MAX_FRAME_LEN] = {};
+  uint8_t frame[LORA_MAX_FRAME_LEN + 16];
+
+  TEST_ASSERT_EQUAL_size_t(0, encodeLoRaFrame(header, payload, 10, frame, LORA_DATA_HEADER_LEN + 9));
+  TEST_ASSERT_EQUAL_size_t(0, encodeLoRaFrame(header, payload, LORA_MAX_FRAME_LEN - LORA_DATA_HEADER_LEN + 1, frame, sizeof(frame)));
+  TEST_ASSERT_EQUAL_size_t(LORA_MAX_FRAME_LEN,
+                           encodeLoRaFrame(header, payload, LORA_MAX_FRAME_LEN - LORA_DATA_HEADER_LEN, frame, sizeof(frame)));
+}
+
+static void test_decode_rejects_malformed_lengths()
+{
+  uint8_t frame[LORA_MAX_FRAME_LEN + 1] = {};
+  LoRaFrameHeader decoded;
+  const uint8_t *payload;
+  size_t payloadLen;
+
+  // SHORTER THAN THE COMMON HEADER
+  LoRaFrameHeader data = baseHeader(LORA_FRAME_DATA);
+  size_t dataLen = encodeLoRaFrame(data, nullptr, 0, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL_size_t(LORA_DATA_HEADER_LEN, dataLen);
+  TEST_ASSERT_FALSE(decodeLoRaFrame(frame, 0, decoded, payload, payloadLen));
+  TEST_ASSERT_FALSE(decodeLoRaFrame(frame, LORA_FRAME_HEADER_LEN - 1, decoded, payload, payloadLen));
+
+  // LONGER THAN ANY FRAME THE RADIO CAN CARRY
+  TEST_ASSERT_FALSE(decodeLoRaFrame(frame, LORA_MAX_FRAME_LEN + 1, decoded, payload, payloadLen));
+
+  // A DATA FRAME CUT INSIDE ITS WINDOW OFFSET, FRAGMENT OR PIGGYBACK FIELDS
+  data.flags = LORA_FLAG_FRAGMENT | LORA_FLAG_PIGGYBACK_ACK;
+  data.fragCount = 2;
+  dataLen = encodeLoRaFrame(data, nullptr, 0, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL_size_t(LORA_DATA_HEADER_LEN + LORA_FRAGMENT_HEADER_LEN + LORA_PIGGYBACK_ACK_LEN, dataLen);
+  TEST_ASSERT_TRUE(decodeLoRaFrame(frame, dataLen, decoded, payload, payloadLen));
+  for (size_t len = LORA_FRAME_HEADER_LEN; len < dataLen; len++)
+    TEST_ASSERT_FALSE(decodeLoRaFrame(frame, len, decoded, payload, payloadLen));
+
+  // AN ACK CUT INSIDE ITS BITMAP OR SERIAL
+  LoRaFrameHeader ack = baseHeader(LORA_FRAME_ACK);
+  size_t ackLen = encodeLoRaFrame(ack, nullptr, 0, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL_size_t(LORA_ACK_HEADER_LEN, ackLen);
+  for (size_t len = LORA_FRAME_HEADER_LEN; len < ackLen; len++)
+    TEST_ASSERT_FALSE(decodeLoRaFrame(frame, len, decoded, payload, payloadLen));
+}
+
+static void test_decode_rejects_bad_version_and_fragment_numbering()
+{
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+  LoRaFrameHeader decoded;
+  const uint8_t *payload;
+  size_t payloadLen;
+
+  LoRaFrameHeader header = baseHeader(LORA_FRAME_DATA);
+  header.version = LORA_PROTOCOL_VERSION - 1;
+  size_t frameLen = encodeLoRaFrame(header, nullptr, 0, frame, sizeof(frame));
+  TEST_ASSERT_FALSE(decodeLoRaFrame(frame, frameLen, decoded, payload, payloadLen));
+
+  header = baseHeader(LORA_FRAME_DATA);
+  header.flags = LORA_FLAG_FRAGMENT;
+  header.fragIndex = 3;
+  header.fragCount = 3;
+  frameLen = encodeLoRaFrame(header, nullptr, 0, frame, sizeof(frame));
+  TEST_ASSERT_FALSE(decodeLoRaFrame(frame, frameLen, decoded, payload, payloadLen));
+
+  header.fragIndex = 0;
+  header.fragCount = 0;
+  frameLen = encodeLoRaFrame(header, nullptr, 0, frame, sizeof(frame));
+  TEST_ASSERT_FALSE(decodeLoRaFrame(frame, frameLen, decoded, payload, payloadLen));
+}
+
+// THE FORMAT THIS ONE REPLACED: "SENDER:P:<DECIMAL ID>:<HEX CIPHERTEXT>"
+static void test_binary_frame_is_smaller_than_the_text_format()
+{
+  const char *text = "Meet at the north trailhead at 14:30 ok?";
+  size_t textLen = strlen(text);
+  char legacyPrefix[64];
+  int prefixLen = snprintf(legacyPrefix, sizeof(legacyPrefix), "%s:P:%u:", "BigNode", 123456789u);
+  size_t legacyLen = (size_t)prefixLen + 2 * textLen;
+
+  LoRaFrameHeader header = baseHeader(LORA_FRAME_DATA);
+  header.flags = LORA_FLAG_ENCRYPTED;
+  uint8_t frame[LORA_MAX_FRAME_LEN];
+  size_t binaryLen = encodeLoRaFrame(header, (const uint8_t *)text, textLen, frame, sizeof(frame));
+
+  char report[96];
+  snprintf(report, sizeof(report), "%u-char message: text format %u bytes, binary %u bytes",
+           (unsigned)textLen, (unsigned)legacyLen, (unsigned)binaryLen);
+  TEST_MESSAGE(report);
+  TEST_ASSERT_LESS_THAN(legacyLen, binaryLen);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_data_frame_round_trip);
+  RUN_TEST(test_fragment_with_piggyback_round_trip);
+  RUN_TEST(test_ack_frame_round_trip);
+  RUN_TEST(test_beacon_is_header_only);
+  RUN_TEST(test_peek_reads_addressing_only);
+  RUN_TEST(test_encode_rejects_frames_that_do_not_fit);
+  RUN_TEST(test_decode_rejects_malformed_lengths);
+  RUN_TEST(test_decode_rejects_bad_version_and_fragment_numbering);
+  RUN_TEST(test_binary_frame_is_smaller_than_the_text_format);
+  return UNITY_END();
+}
@@ -0,0 +1,179 @@
+#include <unity.h>
+#include "lora_airtime.h"
+#include "lora_radio.h"
+
+// LOOP LATENCY WHILE FRAMES ARE ON AIR, WITH THE RADIO TASK DRIVING A SIMULATED SX1262 (test/native/RadioLib.h)
+// THE OLD LOOP CALLED THE BLOCKING radio.transmit(), THE STACK NOW ONLY QUEUES FRAMES FOR THE RADIO TASK
+#define TEST_FRAMES 4
+#define TEST_FRAME_LEN 40
+#define TEST_SF 7
+#define TEST_POWER 14
+#define TEST_TIMEOUT_MS 5000
+
+static uint8_t testFrame[TEST_FRAME_LEN];
+static unsigned long blockingWorstUs = 0;
+
+static uint32_t testAirtimeUs()
+{
+  return loRaTimeOnAirUs(TEST_FRAME_LEN, TEST_SF, 125.0f, 5, 8);
+}
+
+void setUp() {}
+void tearDown() {}
+
+// THE ACK TIMEOUT FLOOR AND THE SIMULATED RADIO SHARE ONE TIME-ON-AIR FORMULA, CHECKED AGAINST THE SEMTECH
+// CALCULATOR FOR A 20-BYTE FRAME AT 125 kHz, 4/5 AND AN 8-SYMBOL PREAMBLE
+static void test_time_on_air_matches_the_reference()
+{
+  TEST_ASSERT_UINT32_WITHIN(100, 56600, loRaTimeOnAirUs(20, 7, 125.0f, 5, 8));
+  TEST_ASSERT_UINT32_WITHIN(100, 1318900, loRaTimeOnAirUs(20, 12, 125.0f, 5, 8));
+  TEST_ASSERT_EQUAL_UINT32(57, loRaTimeOnAirMs(20, 7, 125.0f, 5, 8));
+}
+
+// EVERY LOOP PASS THAT SENDS A FRAME STALLS FOR ITS WHOLE TIME ON AIR
+static void test_blocking_transmit_stalls_the_loop()
+{
+  Module module(0, 0, 0, 0);
+  SX1262 blockingRadio(&module);
+  blockingRadio.begin(915.0f, 125.0f, TEST_SF, 5, 0x34, TEST_POWER, 8);
+  for (int i = 0; i < TEST_FRAMES; i++)
+  {
+    unsigned long start = micros();
+    blockingRadio.transmit(testFrame, TEST_FRAME_LEN);
+    blockingWorstUs = max(blockingWorstUs, micros() - start);
+  }
+  TEST_ASSERT_EQUAL_UINT32(TEST_FRAMES, blockingRadio.framesSent());
+  TEST_ASSERT_GREATER_OR_EQUAL(testAirtimeUs(), blockingWorstUs);
+}
+
+// ONE FRAME QUEUED PER PASS, THE LOOP KEEPS TURNING UNTIL THE RADIO TASK HAS SENT THEM ALL
+static void test_queued_transmit_keeps_the_loop_running()
+{
+  setupLoRaRadio();
+  unsigned long worstUs = 0;
+  uint32_t passes = 0;
+  int queued = 0;
+  unsigned long deadline = millis() + TEST_TIMEOUT_MS;
+  while (loraRadioStats.txDone.load() < TEST_FRAMES && (long)(millis() - deadline) < 0)
+  {
+    unsigned long start = micros();
+    if (queued < TEST_FRAMES && queueLoRaRadioFrame(testFrame, TEST_FRAME_LEN, TEST_SF, TEST_POWER, LORA_TX_DATA))
+      queued++;
+    worstUs = max(worstUs, micros() - start);
+    passes++;
+    delay(1);
+  }
+
+  char report[160];
+  snprintf(report, sizeof(report), "%d x %u us on air: worst loop pass %lu us over %u passes (blocking transmit: %lu us)",
+           TEST_FRAMES, (unsigned)testAirtimeUs(), worstUs, (unsigned)passes, blockingWorstUs);
+  TEST_MESSAGE(report);
+  TEST_ASSERT_EQUAL_UINT32(TEST_FRAMES, loraRadioStats.txDone.load());
+  TEST_ASSERT_EQUAL_UINT32(TEST_FRAMES, radio.framesSent());
+  TEST_ASSERT_EQUAL_UINT32(0, loraRadioStats.txFailed.load());
+  TEST_ASSERT_LESS_THAN(testAirtimeUs() / 10, worstUs);
+}
+
+// LISTEN-BEFORE-TALK ON A CHANNEL THAT STAYS BUSY: ONE CAD PER ATTEMPT, A BACKOFF BETWEEN THEM THAT IS DRAWN
+// FROM A WINDOW DOUBLING FROM cwMinExp UP TO cwMaxExp, AND AFTER LORA_CSMA_MAX_ATTEMPTS THE FRAME GOES OUT ANYWAY
+// esp_random() IS PINNED TO UINT32_MAX, SO EVERY BACKOFF IS THE WHOLE WINDOW (2^exp - 1 SLOTS)
+#define TEST_SLACK_MS 40  // Host thread wake-up jitter, on top of the CAD itself
+
+static uint32_t testSlotMs()
+{
+  uint32_t symbolUs = (uint32_t)((float)(1UL << TEST_SF) * 1000.0f / 125.0f);
+  return (LORA_CSMA_SLOT_SYMBOLS * symbolUs + 999) / 1000;
+}
+
+static void sendOnBusyChannel(LoRaTxClass txClass, uint8_t cwMinExp, uint8_t cwMaxExp, uint32_t deferSlots)
+{
+  uint32_t scans = radio.channelScans();
+  uint32_t checks = loraRadioStats.channelChecks.load();
+  uint32_t busy = loraRadioStats.channelBusy.load();
+  uint32_t forced = loraRadioStats.csmaForced.load();
+  uint32_t backoffMs = loraRadioStats.csmaBackoffMs.load();
+  uint32_t done = loraRadioStats.txDone.load();
+  radio.setChannelBusy(true);
+  nativeRandomPin = UINT32_MAX;
+
+  unsigned long queuedUs = micros();
+  TEST_ASSERT_TRUE(queueLoRaRadioFrame(testFrame, TEST_FRAME_LEN, TEST_SF, TEST_POWER, txClass));
+  unsigned long deadline = millis() + TEST_TIMEOUT_MS;
+  while (loraRadioStats.txDone.load() == done && (long)(millis() - deadline) < 0)
+    delay(5);
+  radio.setChannelBusy(false);
+  nativeRandomPin = 0;
+
+  TEST_ASSERT_EQUAL_UINT32(done + 1, loraRadioStats.txDone.load());
+  TEST_ASSERT_EQUAL_UINT32(scans + LORA_CSMA_MAX_ATTEMPTS, radio.channelScans());
+  TEST_ASSERT_EQUAL_UINT32(checks + LORA_CSMA_MAX_ATTEMPTS, loraRadioStats.channelChecks.load());
+  TEST_ASSERT_EQUAL_UINT32(busy + LORA_CSMA_MAX_ATTEMPTS, loraRadioStats.channelBusy.load());
+  TEST_ASSERT_EQUAL_UINT32(forced + 1, loraRadioStats.csmaForced.load());
+
+  // THE FIRST CAD WAITS OUT THE CLASS'S DEFERRAL, EACH LATER ONE THE PREVIOUS WINDOW
+  uint32_t slotMs = testSlotMs();
+  unsigned long firstUs = radio.channelScanStartUs(scans);
+  TEST_ASSERT_GREATER_OR_EQUAL(deferSlots * slotMs * 1000, firstUs - queuedUs);
+  TEST_ASSERT_LESS_THAN((deferSlots * slotMs + TEST_SLACK_MS) * 1000, firstUs - queuedUs);
+  uint32_t expectedMs = 0;
+  uint8_t exp = cwMinExp;
+  for (uint32_t i = 1; i < LORA_CSMA_MAX_ATTEMPTS; i++)
+  {
+    uint32_t windowMs = ((1UL << exp) - 1) * slotMs;
+    unsigned long gapUs = radio.channelScanStartUs(scans + i) - radio.channelScanStartUs(scans + i - 1);
+    TEST_ASSERT_GREATER_OR_EQUAL(windowMs * 1000, gapUs);
+    TEST_ASSERT_LESS_THAN((windowMs + TEST_SLACK_MS) * 1000, gapUs);
+    expectedMs += windowMs;
+    if (exp < cwMaxExp)
+      exp++;
+  }
+  TEST_ASSERT_GREATER_OR_EQUAL(expectedMs, loraRadioStats.csmaBackoffMs.load() - backoffMs);
+}
+
+static void test_data_backs_off_exponentially_then_is_forced_out()
+{
+  sendOnBusyChannel(LORA_TX_DATA, LORA_CSMA_DATA_CW_MIN_EXP, LORA_CSMA_DATA_CW_MAX_EXP, LORA_CSMA_DATA_DEFER_SLOTS);
+}
+
+// ACKS SKIP THE DEFERRAL AND DRAW FROM THE SMALLER WINDOW, SO THEY GET ON AIR BEFORE DATA CONTENDING WITH THEM
+static void test_acks_contend_with_a_smaller_window()
+{
+  sendOnBusyChannel(LORA_TX_ACK, LORA_CSMA_ACK_CW_MIN_EXP, LORA_CSMA_ACK_CW_MAX_EXP, 0);
+}
+
+// UNPINNED, EACH BACKOFF IS A RANDOM NUMBER OF SLOTS WITHIN ITS WINDOW - NEVER MORE THAN THE WHOLE OF IT
+static void test_random_backoff_stays_within_its_window()
+{
+  uint32_t scans = radio.channelScans();
+  uint32_t done = loraRadioStats.txDone.load();
+  radio.setChannelBusy(true);
+  TEST_ASSERT_TRUE(queueLoRaRadioFrame(testFrame, TEST_FRAME_LEN, TEST_SF, TEST_POWER, LORA_TX_DATA));
+  unsigned long deadline = millis() + TEST_TIMEOUT_MS;
+  while (loraRadioStats.txDone.load() == done && (long)(millis() - deadline) < 0)
+    delay(5);
+  radio.setChannelBusy(false);
+
+  TEST_ASSERT_EQUAL_UINT32(done + 1, loraRadioStats.txDone.load());
+  TEST_ASSERT_EQUAL_UINT32(scans + LORA_CSMA_MAX_ATTEMPTS, radio.channelScans());
+  uint8_t exp = LORA_CSMA_DATA_CW_MIN_EXP;
+  for (uint32_t i = 1; i < LORA_CSMA_MAX_ATTEMPTS; i++)
+  {
+    uint32_t windowMs = ((1UL << exp) - 1) * testSlotMs();
+    unsigned long gapUs = radio.channelScanStartUs(scans + i) - radio.channelScanStartUs(scans + i - 1);
+    TEST_ASSERT_LESS_THAN((windowMs + TEST_SLACK_MS) * 1000, gapUs);
+    if (exp < LORA_CSMA_DATA_CW_MAX_EXP)
+      exp++;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_time_on_air_matches_the_reference);
+  RUN_TEST(test_blocking_transmit_stalls_the_loop);
+  RUN_TEST(test_queued_transmit_keeps_the_loop_running);
+  RUN_TEST(test_data_backs_off_exponentially_then_is_forced_out);
+  RUN_TEST(test_acks_contend_with_a_smaller_window);
+  RUN_TEST(test_random_backoff_stays_within_its_window);
+  return UNITY_END();
+}
@@ -0,0 +1,154 @@
+#include <unity.h>
+#include "lora_reassembly.h"
+
+// HOST TESTS FOR FRAGMENT REASSEMBLY: FRAGMENTS ARRIVE IN ANY ORDER, MESSAGES ARE KEPT APART BY SENDER,
+// DESTINATION AND FIRST SEQUENCE NUMBER, AND A MESSAGE ALREADY BEING REBUILT IS NEVER DROPPED FOR A NEW ONE
+#define SENDER_A 0x0101
+#define SENDER_B 0x0102
+#define SENDER_C 0x0103
+#define MY_ADDRESS 0x0001
+
+static unsigned long now = 1000;
+
+static LoRaFrameHeader fragmentHeader(uint16_t src, uint16_t dst, uint32_t firstSeq, uint8_t index, uint8_t count)
+{
+  LoRaFrameHeader header = {};
+  header.version = LORA_PROTOCOL_VERSION;
+  header.type = LORA_FRAME_DATA;
+  header.flags = LORA_FLAG_ENCRYPTED | LORA_FLAG_FRAGMENT;
+  header.srcAddress = src;
+  header.dstAddress = dst;
+  header.messageId = firstSeq + index;
+  header.fragIndex = index;
+  header.fragCount = count;
+  return header;
+}
+
+// FRAGMENT index OF A count-FRAGMENT MESSAGE WHOSE BYTES ALL READ fill, THE LAST ONE lastLen LONG
+static LoRaReassemblyResult addFragment(uint16_t src, uint16_t dst, uint32_t firstSeq, uint8_t index, uint8_t count,
+                                        char fill, size_t lastLen, LoRaReassembly *&entry)
+{
+  uint8_t fragment[LORA_MAX_FRAGMENT_PAYLOAD_LEN];
+  size_t len = (index == count - 1) ? lastLen : LORA_MAX_FRAGMENT_PAYLOAD_LEN;
+  memset(fragment, fill, len);
+  entry = nullptr;
+  return reassemblyAddFragment(fragmentHeader(src, dst, firstSeq, index, count), fragment, len, now, entry);
+}
+
+static void assertMessage(const LoRaReassembly *entry, char fill, size_t len)
+{
+  TEST_ASSERT_NOT_NULL(entry);
+  TEST_ASSERT_EQUAL_size_t(len, entry->totalLen);
+  for (size_t i = 0; i < len; i++)
+    TEST_ASSERT_EQUAL_HEX8(fill, entry->data[i]);
+  TEST_ASSERT_EQUAL_HEX8(0, entry->data[len]);
+}
+
+void setUp() {}
+
+// EVERY TEST LEAVES NO MESSAGE BEHIND
+void tearDown()
+{
+  now += 2 * LORA_REASSEMBLY_TIMEOUT_MS;
+  reassemblyExpire(now);
+}
+
+static void test_fragments_in_any_order_rebuild_the_message()
+{
+  LoRaReassembly *entry;
+  size_t totalLen = 3 * LORA_MAX_FRAGMENT_PAYLOAD_LEN + 17;
+  TEST_ASSERT_EQUAL(REASSEMBLY_STORED, addFragment(SENDER_A, MY_ADDRESS, 50, 2, 4, 'a', 17, entry));
+  TEST_ASSERT_EQUAL(REASSEMBLY_STORED, addFragment(SENDER_A, MY_ADDRESS, 50, 3, 4, 'a', 17, entry));
+  TEST_ASSERT_EQUAL(REASSEMBLY_STORED, addFragment(SENDER_A, MY_ADDRESS, 50, 0, 4, 'a', 17, entry));
+  TEST_ASSERT_EQUAL(REASSEMBLY_COMPLETE, addFragment(SENDER_A, MY_ADDRESS, 50, 1, 4, 'a', 17, entry));
+  assertMessage(entry, 'a', totalLen);
+  reassemblyRelease(*entry);
+}
+
+// BUFFERS ARE KEYED ON THE DESTINATION TOO, SO A SENDER'S MESSAGES TO US AND TO EVERYONE NEVER MIX
+static void test_streams_to_different_destinations_are_kept_apart()
+{
+  LoRaReassembly *unicast;
+  LoRaReassembly *broadcast;
+  TEST_ASSERT_EQUAL(REASSEMBLY_STORED, addFragment(SENDER_A, MY_ADDRESS, 7, 0, 2, 'u', 30, unicast));
+  TEST_ASSERT_EQUAL(REASSEMBLY_STORED, addFragment(SENDER_A, LORA_BROADCAST_ADDRESS, 7, 1, 2, 'b', 40, broadcast));
+  TEST_ASSERT_TRUE(unicast != broadcast);
+  TEST_ASSERT_EQUAL(REASSEMBLY_COMPLETE, addFragment(SENDER_A, MY_ADDRESS, 7, 1, 2, 'u', 30, unicast));
+  assertMessage(unicast, 'u', LORA_MAX_FRAGMENT_PAYLOAD_LEN + 30);
+  reassemblyRelease(*unicast);
+  TEST_ASSERT_EQUAL(REASSEMBLY_COMPLETE, addFragment(SENDER_A, LORA_BROADCAST_ADDRESS, 7, 0, 2, 'b', 40, broadcast));
+  assertMessage(broadcast, 'b', LORA_MAX_FRAGMENT_PAYLOAD_LEN + 40);
+  reassemblyRelease(*broadcast);
+}
+
+// WITH EVERY BUFFER BUSY A NEW MESSAGE HAS NO ROOM (ITS FRAGMENTS GO UNACKED), THE ONES ALREADY
+// ACKED STILL COMPLETE, AND THE NEW ONE FITS AS SOON AS A BUFFER FREES
+static void test_full_buffers_refuse_a_new_message_instead_of_evicting()
+{
+  static_assert(LORA_REASSEMBLY_SLOTS == 2, "Test fills exactly two buffers");
+  LoRaReassembly *entry;
+  TEST_ASSERT_EQUAL(REASSEMBLY_STORED, addFragment(SENDER_A, MY_ADDRESS, 10, 0, 2, 'a', 5, entry));
+  now += 10;
+  TEST_ASSERT_EQUAL(REASSEMBLY_STORED, addFragment(SENDER_B, MY_ADDRESS, 20, 0, 2, 'b', 5, entry));
+
+  LoRaFrameHeader newMessage = fragmentHeader(SENDER_C, MY_ADDRESS, 30, 0, 2);
+  TEST_ASSERT_FALSE(reassemblyHasRoom(newMessage, LORA_MAX_FRAGMENT_PAYLOAD_LEN));
+  TEST_ASSERT_EQUAL(REASSEMBLY_REJECTED, addFragment(SENDER_C, MY_ADDRESS, 30, 0, 2, 'c', 5, entry));
+  TEST_ASSERT_TRUE(reassemblyHasRoom(fragmentHeader(SENDER_A, MY_ADDRESS, 10, 1, 2), 5));
+
+  TEST_ASSERT_EQUAL(REASSEMBLY_COMPLETE, addFragment(SENDER_A, MY_ADDRESS, 10, 1, 2, 'a', 5, entry));
+  assertMessage(entry, 'a', LORA_MAX_FRAGMENT_PAYLOAD_LEN + 5);
+  reassemblyRelease(*entry);
+
+  TEST_ASSERT_TRUE(reassemblyHasRoom(newMessage, LORA_MAX_FRAGMENT_PAYLOAD_LEN));
+  TEST_ASSERT_EQUAL(REASSEMBLY_STORED, addFragment(SENDER_C, MY_ADDRESS, 30, 0, 2, 'c', 5, entry));
+  TEST_ASSERT_EQUAL(REASSEMBLY_COMPLETE, addFragment(SENDER_B, MY_ADDRESS, 20, 1, 2, 'b', 5, entry));
+  assertMessage(entry, 'b', LORA_MAX_FRAGMENT_PAYLOAD_LEN + 5);
+  reassemblyRelease(*entry);
+  TEST_ASSERT_EQUAL(REASSEMBLY_COMPLETE, addFragment(SENDER_C, MY_ADDRESS, 30, 1, 2, 'c', 5, entry));
+  assertMessage(entry, 'c', LORA_MAX_FRAGMENT_PAYLOAD_LEN + 5);
+  reassemblyRelease(*entry);
+}
+
+static void test_malformed_fragments_are_rejected()
+{
+  LoRaReassembly *entry;
+  uint8_t fragment[LORA_MAX_FRAGMENT_PAYLOAD_LEN] = {};
+  // A SHORT FRAGMENT THAT IS NOT THE LAST, AN EMPTY ONE, AND A MESSAGE LONGER THAN WE REASSEMBLE
+  TEST_ASSERT_FALSE(reassemblyHasRoom(fragmentHeader(SENDER_A, MY_ADDRESS, 60, 0, 2), 20));
+  TEST_ASSERT_FALSE(reassemblyHasRoom(fragmentHeader(SENDER_A, MY_ADDRESS, 60, 1, 2), 0));
+  TEST_ASSERT_FALSE(reassemblyHasRoom(fragmentHeader(SENDER_A, MY_ADDRESS, 60, 0, LORA_MAX_FRAGMENTS + 1),
+                                      LORA_MAX_FRAGMENT_PAYLOAD_LEN));
+  TEST_ASSERT_EQUAL(REASSEMBLY_REJECTED, reassemblyAddFragment(fragmentHeader(SENDER_A, MY_ADDRESS, 60, 0, 2), fragment,
+                                                               20, now, entry));
+
+  // A FRAGMENT THAT DISAGREES WITH THE MESSAGE'S FRAGMENT COUNT
+  TEST_ASSERT_EQUAL(REASSEMBLY_STORED, addFragment(SENDER_A, MY_ADDRESS, 60, 0, 3, 'a', 5, entry));
+  TEST_ASSERT_FALSE(reassemblyHasRoom(fragmentHeader(SENDER_A, MY_ADDRESS, 60, 1, 2), 5));
+  TEST_ASSERT_EQUAL(REASSEMBLY_REJECTED, addFragment(SENDER_A, MY_ADDRESS, 60, 1, 2, 'a', 5, entry));
+}
+
+// A PARTIAL MESSAGE IS DROPPED ONLY BY THE TIMEOUT, WHICH FREES ITS BUFFER
+static void test_timeout_frees_a_partial_message()
+{
+  LoRaReassembly *entry;
+  TEST_ASSERT_EQUAL(REASSEMBLY_STORED, addFragment(SENDER_A, MY_ADDRESS, 80, 0, 2, 'a', 5, entry));
+  TEST_ASSERT_EQUAL(REASSEMBLY_STORED, addFragment(SENDER_B, MY_ADDRESS, 80, 0, 2, 'b', 5, entry));
+  now += LORA_REASSEMBLY_TIMEOUT_MS / 2;
+  TEST_ASSERT_EQUAL_size_t(0, reassemblyExpire(now));
+  TEST_ASSERT_FALSE(reassemblyHasRoom(fragmentHeader(SENDER_C, MY_ADDRESS, 80, 0, 2), LORA_MAX_FRAGMENT_PAYLOAD_LEN));
+  now += LORA_REASSEMBLY_TIMEOUT_MS;
+  TEST_ASSERT_EQUAL_size_t(2, reassemblyExpire(now));
+  TEST_ASSERT_TRUE(reassemblyHasRoom(fragmentHeader(SENDER_C, MY_ADDRESS, 80, 0, 2), LORA_MAX_FRAGMENT_PAYLOAD_LEN));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_fragments_in_any_order_rebuild_the_message);
+  RUN_TEST(test_streams_to_different_destinations_are_kept_apart);
+  RUN_TEST(test_full_buffers_refuse_a_new_message_instead_of_evicting);
+  RUN_TEST(test_malformed_fragments_are_rejected);
+  RUN_TEST(test_timeout_frees_a_partial_message);
+  return UNITY_END();
+}
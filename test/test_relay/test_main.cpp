@@ -0,0 +1,192 @@
+#include <unity.h>
+#include "lora_relay.h"
+
+// HOST TESTS FOR MANAGED FLOODING: THE SEEN CACHE KNOWS A TRANSMISSION BY ITS ORIGIN AND TAG WHICHEVER RELAY
+// CARRIED IT, REBROADCASTS WAIT LONGER THE STRONGER THE FRAME WAS HEARD, AND NEIGHBOURS' COPIES CANCEL OURS
+#define AIRTIME_MS 400
+
+static unsigned long now = 1000;
+static uint32_t nextMessageId = 1;
+
+// A DATA FRAME FROM src ON ITS FIRST HOP, ITS TAG DERIVED FROM tagSeed
+struct TestFrame {
+    LoRaFrameHeader header;
+    uint8_t bytes[LORA_MAX_HEADER_LEN + LORA_AUTH_TAG_LEN];
+};
+
+static TestFrame frameFrom(uint16_t src, uint8_t tagSeed)
+{
+  TestFrame frame = {};
+  frame.header.version = LORA_PROTOCOL_VERSION;
+  frame.header.type = LORA_FRAME_DATA;
+  frame.header.srcAddress = src;
+  frame.header.dstAddress = LORA_BROADCAST_ADDRESS;
+  frame.header.messageId = nextMessageId++;
+  frame.header.attempt = 1;
+  frame.header.hopLimit = LORA_MESH_HOP_LIMIT;
+  frame.header.lastHop = src;
+  for (size_t i = 0; i < sizeof(frame.bytes); i++)
+    frame.bytes[i] = tagSeed + i;
+  return frame;
+}
+
+static LoRaRelayResult check(const TestFrame &frame)
+{
+  return relayCheckSeen(frame.header, frame.bytes, sizeof(frame.bytes));
+}
+
+static void accept(const TestFrame &frame, float snr, bool relayThis, bool directed)
+{
+  relayAccept(frame.header, frame.bytes, sizeof(frame.bytes), snr, AIRTIME_MS, relayThis, directed, now);
+}
+
+// THE PENDING REBROADCAST OF frame, OR NULLPTR, AND HOW LONG AFTER now IT IS DUE
+static LoRaRelayPending *pendingFor(const TestFrame &frame, unsigned long &delayMs)
+{
+  LoRaRelayPending *entry = relayNextDue(now + (LORA_RELAY_SNR_WINDOW_FRAMES + 2) * AIRTIME_MS);
+  if (!entry || memcmp(entry->frame, frame.bytes, sizeof(frame.bytes)) != 0)
+    return nullptr;
+  delayMs = entry->dueTime - now;
+  return entry;
+}
+
+void setUp()
+{
+  now += 10 * AIRTIME_MS;
+}
+
+// EVERY TEST LEAVES NO REBROADCAST PENDING
+void tearDown()
+{
+  LoRaRelayPending *entry;
+  while ((entry = relayNextDue(now + 100 * AIRTIME_MS)) != nullptr)
+    relayRelease(*entry);
+}
+
+// ONLY AN ACCEPTED (AUTHENTICATED) FRAME IS REMEMBERED, AND ITS COPIES FROM OTHER RELAYS MATCH IT
+static void test_seen_cache_knows_a_transmission_by_origin_and_tag()
+{
+  TestFrame frame = frameFrom(0x0401, 0x10);
+  TEST_ASSERT_EQUAL(RELAY_NEW, check(frame));
+  TEST_ASSERT_EQUAL(RELAY_NEW, check(frame)); // Not accepted yet, so not remembered
+  accept(frame, 0.0f, false, false);
+
+  uint32_t duplicatesBefore = loraRelayStats.duplicates;
+  TEST_ASSERT_EQUAL(RELAY_DUPLICATE, check(frame));
+  TestFrame relayed = frame;
+  relayed.header.lastHop = 0x0402;
+  relayed.header.hopCount = 1;
+  relayed.header.hopLimit--;
+  TEST_ASSERT_EQUAL(RELAY_DUPLICATE, check(relayed));
+  TEST_ASSERT_EQUAL_UINT32(duplicatesBefore + 2, loraRelayStats.duplicates.load());
+
+  // THE SAME HEADER WITH ANOTHER TAG IS NOT THE SAME TRANSMISSION - NOR IS THE SENDER'S RETRY
+  TestFrame forged = frame;
+  forged.bytes[sizeof(forged.bytes) - 1] ^= 0x5A;
+  TEST_ASSERT_EQUAL(RELAY_NEW, check(forged));
+  TestFrame retry = frame;
+  retry.header.attempt = 2;
+  TEST_ASSERT_EQUAL(RELAY_NEW, check(retry));
+}
+
+// ACKS REPEAT THEIR CUMULATIVE ACK, SO THEY ARE KNOWN BY THEIR SERIAL
+static void test_acks_are_known_by_their_serial()
+{
+  TestFrame ack = frameFrom(0x0410, 0x20);
+  ack.header.type = LORA_FRAME_ACK;
+  ack.header.ackSerial = 7;
+  accept(ack, 0.0f, false, false);
+  TEST_ASSERT_EQUAL(RELAY_DUPLICATE, check(ack));
+  ack.header.ackSerial = 8;
+  TEST_ASSERT_EQUAL(RELAY_NEW, check(ack));
+}
+
+// THE CACHE REMEMBERS THE LAST LORA_MESH_SEEN_LEN TRANSMISSIONS
+static void test_seen_cache_forgets_the_oldest()
+{
+  TestFrame first = frameFrom(0x0420, 0x30);
+  accept(first, 0.0f, false, false);
+  for (size_t i = 1; i < LORA_MESH_SEEN_LEN; i++)
+    accept(frameFrom(0x0421, 0x40), 0.0f, false, false);
+  TEST_ASSERT_EQUAL(RELAY_DUPLICATE, check(first));
+  accept(frameFrom(0x0421, 0x40), 0.0f, false, false);
+  TEST_ASSERT_EQUAL(RELAY_NEW, check(first));
+}
+
+// A FAINT FRAME IS RELAYED FIRST, A STRONG ONE LAST, AS THE FAINTER RELAY REACHES FURTHER
+static void test_relay_delay_follows_the_snr()
+{
+  unsigned long weakDelay, strongDelay;
+  TestFrame weak = frameFrom(0x0430, 0x50);
+  accept(weak, LORA_RELAY_SNR_WEAK, true, false);
+  LoRaRelayPending *entry = pendingFor(weak, weakDelay);
+  TEST_ASSERT_NOT_NULL(entry);
+  TEST_ASSERT_TRUE(weakDelay >= AIRTIME_MS && weakDelay <= 2 * AIRTIME_MS);
+  relayRelease(*entry);
+
+  TestFrame strong = frameFrom(0x0431, 0x60);
+  accept(strong, LORA_RELAY_SNR_STRONG, true, false);
+  entry = pendingFor(strong, strongDelay);
+  TEST_ASSERT_NOT_NULL(entry);
+  TEST_ASSERT_TRUE(strongDelay >= (1 + LORA_RELAY_SNR_WINDOW_FRAMES) * AIRTIME_MS);
+  TEST_ASSERT_TRUE(strongDelay <= (2 + LORA_RELAY_SNR_WINDOW_FRAMES) * AIRTIME_MS);
+  TEST_ASSERT_NULL(relayNextDue(now + AIRTIME_MS - 1));
+  relayRelease(*entry);
+
+  // THE DESIGNATED NEXT HOP FORWARDS WITHIN A QUARTER AIRTIME
+  unsigned long directedDelay;
+  TestFrame directed = frameFrom(0x0432, 0x70);
+  accept(directed, LORA_RELAY_SNR_STRONG, true, true);
+  entry = pendingFor(directed, directedDelay);
+  TEST_ASSERT_NOT_NULL(entry);
+  TEST_ASSERT_TRUE(directedDelay <= AIRTIME_MS / 4);
+}
+
+// ENOUGH NEIGHBOURS RELAYING FIRST MAKES OUR COPY REDUNDANT - UNLESS WE ARE THE ONE IT WAS ADDRESSED TO
+static void test_copies_from_neighbours_cancel_our_relay()
+{
+  unsigned long delayMs;
+  TestFrame flooded = frameFrom(0x0440, 0x80);
+  TestFrame directed = frameFrom(0x0441, 0x90);
+  accept(flooded, 0.0f, true, false);
+  accept(directed, 0.0f, true, true);
+  uint32_t cancelledBefore = loraRelayStats.cancelled;
+  for (int i = 0; i < LORA_RELAY_CANCEL_COPIES; i++)
+  {
+    TEST_ASSERT_EQUAL(RELAY_DUPLICATE, check(flooded));
+    TEST_ASSERT_EQUAL(RELAY_DUPLICATE, check(directed));
+  }
+  TEST_ASSERT_EQUAL_UINT32(cancelledBefore + 1, loraRelayStats.cancelled.load());
+  TEST_ASSERT_NOT_NULL(pendingFor(directed, delayMs));
+  relayRelease(*pendingFor(directed, delayMs));
+  TEST_ASSERT_NULL(relayNextDue(now + 100 * AIRTIME_MS));
+}
+
+// A FRAME OUT OF HOPS IS NOT RELAYED, AND WITH EVERY PENDING SLOT TAKEN A NEW ONE IS DROPPED
+static void test_relays_are_bounded()
+{
+  TestFrame spent = frameFrom(0x0450, 0xA0);
+  spent.header.hopLimit = 0;
+  uint32_t scheduledBefore = loraRelayStats.scheduled;
+  accept(spent, 0.0f, true, false);
+  TEST_ASSERT_EQUAL_UINT32(scheduledBefore, loraRelayStats.scheduled.load());
+
+  for (int i = 0; i < LORA_RELAY_PENDING; i++)
+    accept(frameFrom(0x0451, 0xB0 + i), 0.0f, true, false);
+  TEST_ASSERT_EQUAL_UINT32(scheduledBefore + LORA_RELAY_PENDING, loraRelayStats.scheduled.load());
+  uint32_t droppedBefore = loraRelayStats.dropped;
+  accept(frameFrom(0x0452, 0xC0), 0.0f, true, false);
+  TEST_ASSERT_EQUAL_UINT32(droppedBefore + 1, loraRelayStats.dropped.load());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_seen_cache_knows_a_transmission_by_origin_and_tag);
+  RUN_TEST(test_acks_are_known_by_their_serial);
+  RUN_TEST(test_seen_cache_forgets_the_oldest);
+  RUN_TEST(test_relay_delay_follows_the_snr);
+  RUN_TEST(test_copies_from_neighbours_cancel_our_relay);
+  RUN_TEST(test_relays_are_bounded);
+  return UNITY_END();
+}
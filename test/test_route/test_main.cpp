@@ -0,0 +1,112 @@
+#include <unity.h>
+#include "lora_route.h"
+
+// HOST TESTS FOR ROUTING: THE REVERSE PATH OF WHAT WE HEAR BECOMES A ROUTE, THE CHEAPEST CURRENT ONE IS KEPT,
+// REPEATED ACK FAILURES DROP IT SO THE NEXT FRAME FLOODS, AND BEACONS GO OUT ON THEIR SCHEDULE
+#define STRONG_DB 5.0f
+#define WEAK_DB -5.0f
+
+static unsigned long now = 1000;
+
+void setUp()
+{
+  now += ROUTE_TIMEOUT_MS + 1; // The previous test's routes are stale
+}
+
+void tearDown() {}
+
+static void test_reverse_path_becomes_a_route()
+{
+  TEST_ASSERT_EQUAL_UINT16(LORA_BROADCAST_ADDRESS, routeNextHop(0x0501, now));
+  routeLearn(0x0501, 0x0502, 2, STRONG_DB, now);
+  TEST_ASSERT_EQUAL_UINT16(0x0502, routeNextHop(0x0501, now));
+
+  // A BROADCAST SOURCE IS NEVER A DESTINATION
+  routeLearn(LORA_BROADCAST_ADDRESS, 0x0502, 1, STRONG_DB, now);
+  TEST_ASSERT_EQUAL_UINT16(LORA_BROADCAST_ADDRESS, routeNextHop(LORA_BROADCAST_ADDRESS, now));
+
+  // A ROUTE NOT REFRESHED FOR ROUTE_TIMEOUT_MS IS NOT USED
+  TEST_ASSERT_EQUAL_UINT16(0x0502, routeNextHop(0x0501, now + ROUTE_TIMEOUT_MS));
+  TEST_ASSERT_EQUAL_UINT16(LORA_BROADCAST_ADDRESS, routeNextHop(0x0501, now + ROUTE_TIMEOUT_MS + 1));
+}
+
+// A CHEAPER PATH WINS, A DEARER ONE ONLY REPLACES A STALE ROUTE, AND THE CURRENT NEXT HOP ALWAYS UPDATES IT
+static void test_cheapest_current_route_is_kept()
+{
+  routeLearn(0x0510, 0x0511, 3, STRONG_DB, now);
+  routeLearn(0x0510, 0x0512, 2, STRONG_DB, now);
+  TEST_ASSERT_EQUAL_UINT16(0x0512, routeNextHop(0x0510, now));
+  routeLearn(0x0510, 0x0511, 3, STRONG_DB, now);
+  TEST_ASSERT_EQUAL_UINT16(0x0512, routeNextHop(0x0510, now));
+
+  // THE SAME HOP COUNT OVER A WEAK FIRST LINK COSTS MORE
+  routeLearn(0x0510, 0x0513, 2, WEAK_DB, now);
+  TEST_ASSERT_EQUAL_UINT16(0x0512, routeNextHop(0x0510, now));
+
+  // NEWS FROM THE NEXT HOP ITSELF IS TAKEN EVEN WHEN IT IS WORSE - THE OLD COST NO LONGER HOLDS
+  routeLearn(0x0510, 0x0512, 3, WEAK_DB, now);
+  TEST_ASSERT_EQUAL_UINT16(0x0512, routeNextHop(0x0510, now));
+  routeLearn(0x0510, 0x0511, 3, STRONG_DB, now);
+  TEST_ASSERT_EQUAL_UINT16(0x0511, routeNextHop(0x0510, now));
+
+  now += ROUTE_TIMEOUT_MS + 1;
+  routeLearn(0x0510, 0x0514, 3, WEAK_DB, now);
+  TEST_ASSERT_EQUAL_UINT16(0x0514, routeNextHop(0x0510, now));
+}
+
+// ROUTE_REPAIR_FAILURES ACK TIMEOUTS IN A ROW DROP THE ROUTE, A DELIVERY IN BETWEEN STARTS THE COUNT AGAIN
+static void test_repeated_failures_drop_the_route()
+{
+  static_assert(ROUTE_REPAIR_FAILURES == 2, "Test fails the route twice");
+  routeLearn(0x0520, 0x0521, 2, STRONG_DB, now);
+  routeFailed(0x0520);
+  routeDelivered(0x0520);
+  routeFailed(0x0520);
+  TEST_ASSERT_EQUAL_UINT16(0x0521, routeNextHop(0x0520, now));
+
+  uint32_t repairedBefore = loraRouteStats.routesRepaired;
+  routeFailed(0x0520);
+  TEST_ASSERT_EQUAL_UINT32(repairedBefore + 1, loraRouteStats.routesRepaired.load());
+  TEST_ASSERT_EQUAL_UINT16(LORA_BROADCAST_ADDRESS, routeNextHop(0x0520, now));
+
+  // THE ACK THAT COMES BACK OVER THE FLOOD TEACHES THE NEW PATH, WITH A CLEAN FAILURE COUNT
+  routeLearn(0x0520, 0x0522, 3, STRONG_DB, now);
+  TEST_ASSERT_EQUAL_UINT16(0x0522, routeNextHop(0x0520, now));
+  routeFailed(0x0520);
+  TEST_ASSERT_EQUAL_UINT16(0x0522, routeNextHop(0x0520, now));
+}
+
+// A FULL TABLE MAKES ROOM BY FORGETTING THE ROUTE REFRESHED LONGEST AGO
+static void test_full_table_forgets_the_oldest_route()
+{
+  for (uint16_t i = 0; i < ROUTE_MAX_ENTRIES; i++)
+    routeLearn(0x0530 + i, 0x0550, 1, STRONG_DB, now + i);
+  routeLearn(0x0530, 0x0550, 1, STRONG_DB, now + ROUTE_MAX_ENTRIES); // The first one is refreshed
+  routeLearn(0x0560, 0x0550, 1, STRONG_DB, now + ROUTE_MAX_ENTRIES);
+  now += ROUTE_MAX_ENTRIES;
+  TEST_ASSERT_EQUAL_UINT16(0x0550, routeNextHop(0x0560, now));
+  TEST_ASSERT_EQUAL_UINT16(0x0550, routeNextHop(0x0530, now));
+  TEST_ASSERT_EQUAL_UINT16(LORA_BROADCAST_ADDRESS, routeNextHop(0x0531, now));
+  TEST_ASSERT_EQUAL_UINT16(0x0550, routeNextHop(0x0532, now));
+}
+
+// THE FIRST BEACON GOES OUT WITHIN THE JITTER OF BOOT, LATER ONES A FULL INTERVAL APART
+static void test_beacons_follow_their_schedule()
+{
+  TEST_ASSERT_FALSE(routeBeaconDue(now));
+  TEST_ASSERT_TRUE(routeBeaconDue(now + ROUTE_BEACON_JITTER_MS));
+  now += ROUTE_BEACON_JITTER_MS;
+  TEST_ASSERT_FALSE(routeBeaconDue(now + ROUTE_BEACON_INTERVAL_MS - 1));
+  TEST_ASSERT_TRUE(routeBeaconDue(now + ROUTE_BEACON_INTERVAL_MS + ROUTE_BEACON_JITTER_MS));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_reverse_path_becomes_a_route);
+  RUN_TEST(test_cheapest_current_route_is_kept);
+  RUN_TEST(test_repeated_failures_drop_the_route);
+  RUN_TEST(test_full_table_forgets_the_oldest_route);
+  RUN_TEST(test_beacons_follow_their_schedule);
+  return UNITY_END();
+}
@@ -0,0 +1,161 @@
+#include <unity.h>
+#include <thread>
+#include "spsc_ring.h"
+
+// HOST TESTS FOR THE RADIO TASK <-> STACK FRAME RING
+
+#define TEST_RING_LEN 4
+#define TEST_THREADED_ITEMS 200000
+
+typedef SpscRing<uint32_t, TEST_RING_LEN> TestRing;
+
+static bool push(TestRing &ring, uint32_t value)
+{
+  uint32_t *slot = ring.acquire();
+  if (!slot)
+    return false;
+  *slot = value;
+  ring.commit();
+  return true;
+}
+
+static bool pop(TestRing &ring, uint32_t &value)
+{
+  uint32_t *slot = ring.peek();
+  if (!slot)
+    return false;
+  value = *slot;
+  ring.release();
+  return true;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_new_ring_is_empty()
+{
+  TestRing ring;
+  TEST_ASSERT_NULL(ring.peek());
+  TEST_ASSERT_EQUAL_size_t(0, ring.size());
+  TEST_ASSERT_EQUAL_size_t(0, ring.committed());
+  TEST_ASSERT_EQUAL_size_t(0, ring.released());
+}
+
+static void test_fills_to_capacity_then_refuses()
+{
+  TestRing ring;
+  for (uint32_t i = 0; i < TEST_RING_LEN; i++)
+    TEST_ASSERT_TRUE(push(ring, i));
+  TEST_ASSERT_EQUAL_size_t(TEST_RING_LEN, ring.size());
+  TEST_ASSERT_NULL(ring.acquire());
+
+  // ONE RELEASE MAKES ROOM FOR EXACTLY ONE MORE
+  uint32_t value;
+  TEST_ASSERT_TRUE(pop(ring, value));
+  TEST_ASSERT_EQUAL_UINT32(0, value);
+  TEST_ASSERT_TRUE(push(ring, TEST_RING_LEN));
+  TEST_ASSERT_NULL(ring.acquire());
+}
+
+static void test_acquired_slot_is_invisible_until_committed()
+{
+  TestRing ring;
+  uint32_t *slot = ring.acquire();
+  TEST_ASSERT_NOT_NULL(slot);
+  *slot = 7;
+  TEST_ASSERT_NULL(ring.peek());
+  TEST_ASSERT_EQUAL_PTR(slot, ring.acquire()); // Same slot until committed
+  ring.commit();
+  TEST_ASSERT_EQUAL_PTR(slot, ring.peek());
+}
+
+static void test_peek_returns_the_same_slot_until_released()
+{
+  TestRing ring;
+  push(ring, 1);
+  push(ring, 2);
+  uint32_t *first = ring.peek();
+  TEST_ASSERT_EQUAL_PTR(first, ring.peek());
+  TEST_ASSERT_EQUAL_UINT32(1, *first);
+  ring.release();
+  TEST_ASSERT_EQUAL_UINT32(2, *ring.peek());
+  ring.release();
+  TEST_ASSERT_NULL(ring.peek());
+}
+
+static void test_wraps_around_in_order()
+{
+  TestRing ring;
+  uint32_t next = 0, expected = 0, value;
+  for (int round = 0; round < 10 * TEST_RING_LEN; round++)
+  {
+    // VARYING FILL LEVELS, SO HEAD AND TAIL CROSS THE END OF THE ARRAY AT EVERY OFFSET
+    int burst = 1 + round % TEST_RING_LEN;
+    for (int i = 0; i < burst; i++)
+      TEST_ASSERT_TRUE(push(ring, next++));
+    for (int i = 0; i < burst; i++)
+    {
+      TEST_ASSERT_TRUE(pop(ring, value));
+      TEST_ASSERT_EQUAL_UINT32(expected++, value);
+    }
+    TEST_ASSERT_EQUAL_size_t(0, ring.size());
+  }
+  TEST_ASSERT_EQUAL_size_t(next, ring.committed());
+  TEST_ASSERT_EQUAL_size_t(next, ring.released());
+}
+
+static void test_committed_and_released_track_a_slot()
+{
+  TestRing ring;
+  push(ring, 1);
+  size_t position = ring.committed(); // What queueLoRaRadioFrame() keeps in a ticket
+  push(ring, 2);
+  uint32_t value;
+  pop(ring, value);
+  TEST_ASSERT_FALSE(ring.released() > position);
+  pop(ring, value);
+  TEST_ASSERT_TRUE(ring.released() > position);
+}
+
+// ONE PRODUCER AND ONE CONSUMER THREAD, EVERY VALUE ARRIVES ONCE AND IN ORDER
+static void test_threads_pass_every_item_in_order()
+{
+  static TestRing ring;
+  std::thread producer([]() {
+    for (uint32_t i = 0; i < TEST_THREADED_ITEMS;)
+    {
+      if (push(ring, i))
+        i++;
+      else
+        std::this_thread::yield();
+    }
+  });
+  uint32_t expected = 0, value;
+  bool inOrder = true;
+  while (expected < TEST_THREADED_ITEMS)
+  {
+    if (!pop(ring, value))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    inOrder = inOrder && value == expected;
+    expected++;
+  }
+  producer.join();
+  TEST_ASSERT_TRUE(inOrder);
+  TEST_ASSERT_EQUAL_size_t(0, ring.size());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_new_ring_is_empty);
+  RUN_TEST(test_fills_to_capacity_then_refuses);
+  RUN_TEST(test_acquired_slot_is_invisible_until_committed);
+  RUN_TEST(test_peek_returns_the_same_slot_until_released);
+  RUN_TEST(test_wraps_around_in_order);
+  RUN_TEST(test_committed_and_released_track_a_slot);
+  RUN_TEST(test_threads_pass_every_item_in_order);
+  return UNITY_END();
+}
@@ -0,0 +1,335 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include "timer_wheel.h"
+
+// HOST TESTS FOR THE ACK DEADLINE TIMER WHEEL, AND A BENCHMARK AGAINST THE VECTOR IT REPLACED
+
+#define TEST_TIMERS 16
+#define TEST_BUCKETS 8
+#define TEST_TICK_MS 10
+#define BENCH_SLOTS 1024
+#define BENCH_PASSES 20000
+#define BENCH_TIMEOUT_MS 5000
+
+typedef TimerWheel<TEST_TIMERS, TEST_BUCKETS, TEST_TICK_MS> TestWheel;
+
+static TestWheel *wheel;
+static uint32_t firedMask;
+static int firedCount;
+
+static void recordExpiry(uint16_t id)
+{
+  firedMask |= 1UL << id;
+  firedCount++;
+}
+
+void setUp()
+{
+  static TestWheel storage;
+  storage = TestWheel();
+  wheel = &storage;
+  firedMask = 0;
+  firedCount = 0;
+}
+
+void tearDown() {}
+
+static void test_fires_at_its_deadline_and_not_before()
+{
+  wheel->schedule(4, 1000);
+  wheel->advance(995, recordExpiry);
+  wheel->advance(999, recordExpiry);
+  TEST_ASSERT_EQUAL_INT(0, firedCount);
+  TEST_ASSERT_TRUE(wheel->isScheduled(4));
+  TEST_ASSERT_EQUAL_UINT32(1000, wheel->deadline(4));
+  wheel->advance(1000, recordExpiry);
+  TEST_ASSERT_EQUAL_UINT32(1UL << 4, firedMask);
+  TEST_ASSERT_FALSE(wheel->isScheduled(4));
+  wheel->advance(2000, recordExpiry);
+  TEST_ASSERT_EQUAL_INT(1, firedCount);
+}
+
+static void test_cancelled_timer_does_not_fire()
+{
+  wheel->schedule(1, 1000);
+  wheel->schedule(2, 1000);
+  wheel->cancel(1);
+  wheel->cancel(1); // Cancelling an idle timer is harmless
+  TEST_ASSERT_FALSE(wheel->isScheduled(1));
+  wheel->advance(1000, recordExpiry);
+  TEST_ASSERT_EQUAL_UINT32(1UL << 2, firedMask);
+}
+
+static void test_rescheduling_replaces_the_deadline()
+{
+  wheel->schedule(1, 1000);
+  wheel->schedule(1, 1300);
+  wheel->advance(1000, recordExpiry);
+  TEST_ASSERT_EQUAL_INT(0, firedCount);
+  wheel->schedule(1, 1100); // Earlier again
+  wheel->advance(1100, recordExpiry);
+  TEST_ASSERT_EQUAL_INT(1, firedCount);
+  wheel->advance(1300, recordExpiry);
+  TEST_ASSERT_EQUAL_INT(1, firedCount);
+}
+
+// A DEADLINE SEVERAL REVOLUTIONS OUT SHARES A BUCKET WITH NEARER ONES BUT WAITS ITS TURN
+static void test_deadline_beyond_one_revolution()
+{
+  const unsigned long revolution = TEST_BUCKETS * TEST_TICK_MS;
+  wheel->schedule(1, 1000);
+  wheel->schedule(2, 1000 + 3 * revolution);
+  for (unsigned long now = 1000; now < 1000 + 3 * revolution; now += TEST_TICK_MS)
+    wheel->advance(now, recordExpiry);
+  TEST_ASSERT_EQUAL_UINT32(1UL << 1, firedMask);
+  wheel->advance(1000 + 3 * revolution, recordExpiry);
+  TEST_ASSERT_EQUAL_UINT32((1UL << 1) | (1UL << 2), firedMask);
+}
+
+// ONE CALL LONG AFTER EVERYTHING FELL DUE FIRES IT ALL, WHICHEVER BUCKETS IT IS IN
+static void test_long_stall_fires_everything_due()
+{
+  for (uint16_t id = 0; id < TEST_TIMERS; id++)
+    wheel->schedule(id, 1000 + id * 37);
+  wheel->advance(1000 + 100000, recordExpiry);
+  TEST_ASSERT_EQUAL_INT(TEST_TIMERS, firedCount);
+}
+
+static void test_deadline_already_passed_fires_on_next_advance()
+{
+  wheel->advance(5000, recordExpiry);
+  wheel->schedule(1, 5000);
+  wheel->schedule(2, 100); // The wheel is past this tick, so it goes in the current bucket
+  wheel->advance(5000, recordExpiry);
+  TEST_ASSERT_EQUAL_UINT32((1UL << 1) | (1UL << 2), firedMask);
+}
+
+// millis() WRAPS EVERY 49.7 DAYS ON THE BOARD
+static void test_survives_millis_wrap_around()
+{
+  const unsigned long start = (unsigned long)-50;
+  wheel->schedule(1, start + 20);
+  wheel->schedule(2, start + 100); // Past the wrap
+  wheel->advance(start + 20, recordExpiry);
+  TEST_ASSERT_EQUAL_UINT32(1UL << 1, firedMask);
+  wheel->advance(start + 99, recordExpiry);
+  TEST_ASSERT_EQUAL_INT(1, firedCount);
+  wheel->advance(start + 100, recordExpiry);
+  TEST_ASSERT_EQUAL_UINT32((1UL << 1) | (1UL << 2), firedMask);
+}
+
+// TIMERS 1..3 SHARE A BUCKET AND ALL FALL DUE TOGETHER - THE FIRST ONE FIRED CANCELS ANOTHER
+// (AS FAILING ONE FRAGMENT OF A MESSAGE RELEASES ITS SIBLINGS' SLOTS)
+static void test_callback_cancelling_a_sibling()
+{
+  for (uint16_t id = 1; id <= 3; id++)
+    wheel->schedule(id, 1000);
+  static uint16_t firstFired;
+  firstFired = TestWheel::NONE;
+  wheel->advance(1000, [](uint16_t id) {
+    recordExpiry(id);
+    if (firstFired != TestWheel::NONE)
+      return;
+    firstFired = id;
+    wheel->cancel(id == 2 ? 3 : 2);
+  });
+  TEST_ASSERT_EQUAL_INT(2, firedCount);
+  TEST_ASSERT_FALSE(wheel->isScheduled(1));
+  TEST_ASSERT_FALSE(wheel->isScheduled(2));
+  TEST_ASSERT_FALSE(wheel->isScheduled(3));
+
+  // THE WHEEL IS STILL CONSISTENT: THE SAME IDS CAN BE ARMED AND FIRED AGAIN
+  firedMask = 0;
+  firedCount = 0;
+  for (uint16_t id = 1; id <= 3; id++)
+    wheel->schedule(id, 2000);
+  wheel->advance(2000, recordExpiry);
+  TEST_ASSERT_EQUAL_INT(3, firedCount);
+  TEST_ASSERT_EQUAL_UINT32(0x0E, firedMask);
+}
+
+// THE CALLBACK MOVES A SIBLING TO A LATER DEADLINE - IT FIRES THEN, NOT NOW
+static void test_callback_rearming_a_sibling()
+{
+  for (uint16_t id = 1; id <= 3; id++)
+    wheel->schedule(id, 1000);
+  static bool moved;
+  moved = false;
+  wheel->advance(1000, [](uint16_t id) {
+    recordExpiry(id);
+    if (moved)
+      return;
+    moved = true;
+    for (uint16_t other = 1; other <= 3; other++)
+    {
+      if (other != id && wheel->isScheduled(other))
+      {
+        wheel->schedule(other, 1500);
+        return;
+      }
+    }
+  });
+  TEST_ASSERT_EQUAL_INT(2, firedCount);
+  firedCount = 0;
+  wheel->advance(1490, recordExpiry);
+  TEST_ASSERT_EQUAL_INT(0, firedCount);
+  wheel->advance(1500, recordExpiry);
+  TEST_ASSERT_EQUAL_INT(1, firedCount);
+}
+
+// THE CALLBACK ARMS ANOTHER TIMER INTO THE BUCKET BEING WALKED, DUE LATER IN THE SAME TICK
+static void test_callback_scheduling_into_the_same_bucket()
+{
+  wheel->schedule(1, 1000);
+  wheel->advance(1000, [](uint16_t id) {
+    recordExpiry(id);
+    if (id == 1)
+      wheel->schedule(2, 1005);
+  });
+  TEST_ASSERT_EQUAL_UINT32(0x02, firedMask);
+  TEST_ASSERT_TRUE(wheel->isScheduled(2));
+  wheel->advance(1005, recordExpiry);
+  TEST_ASSERT_EQUAL_UINT32(0x06, firedMask);
+}
+
+// THE STRUCTURE THE WHEEL REPLACED: HEAP STRINGS IN A VECTOR, SCANNED FOR TIMEOUTS EVERY PASS,
+// SCANNED AGAIN TO MATCH AN ACK AND ERASED FROM THE MIDDLE
+struct LegacyOutgoing {
+  std::string text;
+  std::string localWebId;
+  uint32_t messageId;
+  unsigned long sendTime;
+  int retries;
+};
+
+// THE SAME WORKLOAD FOR BOTH: ONE LOOP PASS PER SIMULATED MILLISECOND CHECKS DEADLINES (A TIMED-OUT MESSAGE
+// IS SENT AGAIN), THEN A RANDOM IN-FLIGHT MESSAGE IS ACKED AND A NEW ONE TAKES ITS PLACE
+struct BenchWorkload {
+  uint32_t inFlightIds[BENCH_SLOTS];
+  size_t inFlight;
+  uint32_t nextId;
+  uint32_t rng;
+
+  void start(size_t count)
+  {
+    inFlight = count;
+    nextId = 0;
+    rng = 1;
+    for (size_t i = 0; i < count; i++)
+      inFlightIds[i] = nextId++;
+  }
+
+  // THE MESSAGE ACKED THIS PASS AND ITS PLACE IN THE IN-FLIGHT SET, WHERE nextId - 1 NOW TAKES OVER
+  uint32_t ackOne(size_t &place)
+  {
+    rng = rng * 1664525u + 1013904223u;
+    place = (rng >> 8) % inFlight;
+    uint32_t acked = inFlightIds[place];
+    inFlightIds[place] = nextId++;
+    return acked;
+  }
+};
+static BenchWorkload workload;
+
+static unsigned long benchLegacy(size_t inFlight, uint32_t &resends)
+{
+  std::vector<LegacyOutgoing> queue;
+  workload.start(inFlight);
+  unsigned long now = 0;
+  for (size_t i = 0; i < inFlight; i++)
+    queue.push_back({"Meet at the north trailhead", "local-" + std::to_string(i), (uint32_t)i, now, 0});
+  resends = 0;
+  unsigned long start = micros();
+  for (int pass = 0; pass < BENCH_PASSES; pass++, now++)
+  {
+    for (LegacyOutgoing &msg : queue)
+    {
+      if (now - msg.sendTime >= BENCH_TIMEOUT_MS)
+      {
+        msg.sendTime = now;
+        msg.retries++;
+        resends++;
+      }
+    }
+    size_t place;
+    uint32_t acked = workload.ackOne(place);
+    for (auto it = queue.begin(); it != queue.end(); ++it)
+    {
+      if (it->messageId == acked)
+      {
+        queue.erase(it);
+        break;
+      }
+    }
+    uint32_t id = workload.nextId - 1;
+    queue.push_back({"Meet at the north trailhead", "local-" + std::to_string(id), id, now, 0});
+  }
+  return (micros() - start) * 1000 / BENCH_PASSES;
+}
+
+// A MESSAGE'S PLACE IN THE IN-FLIGHT SET IS ITS SLOT, FOUND DIRECTLY AS THE ARQ WINDOW FINDS A SLOT BY SEQUENCE
+static unsigned long benchWheel(size_t inFlight, uint32_t &resends)
+{
+  typedef TimerWheel<BENCH_SLOTS, 64, 50> BenchWheel;
+  static BenchWheel benchWheel;
+  static unsigned long now;
+  static uint32_t timeouts;
+  benchWheel = BenchWheel();
+  workload.start(inFlight);
+  now = 0;
+  timeouts = 0;
+  for (size_t i = 0; i < inFlight; i++)
+    benchWheel.schedule((uint16_t)i, now + BENCH_TIMEOUT_MS);
+  unsigned long start = micros();
+  for (int pass = 0; pass < BENCH_PASSES; pass++, now++)
+  {
+    benchWheel.advance(now, [](uint16_t slot) {
+      timeouts++;
+      benchWheel.schedule(slot, now + BENCH_TIMEOUT_MS);
+    });
+    size_t slot;
+    workload.ackOne(slot);
+    benchWheel.cancel((uint16_t)slot);
+    benchWheel.schedule((uint16_t)slot, now + BENCH_TIMEOUT_MS);
+  }
+  resends = timeouts;
+  return (micros() - start) * 1000 / BENCH_PASSES;
+}
+
+static void test_benchmark_against_the_vector()
+{
+  static const size_t sizes[] = {10, 100, 1000};
+  unsigned long legacyNs = 0, wheelNs = 0;
+  for (size_t inFlight : sizes)
+  {
+    uint32_t legacyResends, wheelResends;
+    legacyNs = benchLegacy(inFlight, legacyResends);
+    wheelNs = benchWheel(inFlight, wheelResends);
+    char report[128];
+    snprintf(report, sizeof(report), "%4u in flight: vector %6lu ns/pass, slots + wheel %6lu ns/pass (%u resends each)",
+             (unsigned)inFlight, legacyNs, wheelNs, (unsigned)wheelResends);
+    TEST_MESSAGE(report);
+    TEST_ASSERT_EQUAL_UINT32(legacyResends, wheelResends); // Both did the same work
+  }
+  // AT 1000 IN FLIGHT THE LINEAR SCANS ARE FAR BEHIND, WELL CLEAR OF TIMING NOISE
+  TEST_ASSERT_LESS_THAN(legacyNs, wheelNs);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_fires_at_its_deadline_and_not_before);
+  RUN_TEST(test_cancelled_timer_does_not_fire);
+  RUN_TEST(test_rescheduling_replaces_the_deadline);
+  RUN_TEST(test_deadline_beyond_one_revolution);
+  RUN_TEST(test_long_stall_fires_everything_due);
+  RUN_TEST(test_deadline_already_passed_fires_on_next_advance);
+  RUN_TEST(test_survives_millis_wrap_around);
+  RUN_TEST(test_callback_cancelling_a_sibling);
+  RUN_TEST(test_callback_rearming_a_sibling);
+  RUN_TEST(test_callback_scheduling_into_the_same_bucket);
+  RUN_TEST(test_benchmark_against_the_vector);
+  return UNITY_END();
+}
@@ -0,0 +1,155 @@
+#include <unity.h>
+#include <zlib.h>
+#include "mbedtls/sha256.h"
+#include "web_assets.h"
+
+// HOST TESTS FOR THE WEB UI AS scripts/embed_web_assets.py EMBEDS IT (web_assets.h IS REGENERATED BEFORE
+// EVERY BUILD, THIS ONE INCLUDED): VALID GZIP OF THE RIGHT SIZE, CONTENT-HASH ETAGS, CACHE HEADERS AND 304S
+
+#define WEB_ASSET_COUNT (sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0]))
+#define MAX_RAW_LEN 65536
+
+static char inflated[MAX_RAW_LEN + 1];
+
+// GUNZIP INTO inflated AND NUL-TERMINATE, RETURNS THE SIZE OR -1 IF THE STREAM IS NOT VALID GZIP
+static long gunzip(const WebAsset &asset)
+{
+  z_stream stream = {};
+  if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+    return -1;
+  stream.next_in = (Bytef *)asset.data;
+  stream.avail_in = (uInt)asset.len;
+  stream.next_out = (Bytef *)inflated;
+  stream.avail_out = MAX_RAW_LEN;
+  int result = inflate(&stream, Z_FINISH);
+  long len = (long)stream.total_out;
+  inflateEnd(&stream);
+  if (result != Z_STREAM_END || stream.avail_in != 0)
+    return -1;
+  inflated[len] = 0;
+  return len;
+}
+
+static const WebAsset *assetAt(const char *path)
+{
+  for (const WebAsset &asset : WEB_ASSETS)
+  {
+    if (strcmp(asset.path, path) == 0)
+      return &asset;
+  }
+  return nullptr;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_every_asset_inflates_to_its_raw_size()
+{
+  TEST_ASSERT_GREATER_OR_EQUAL(3, WEB_ASSET_COUNT);
+  for (const WebAsset &asset : WEB_ASSETS)
+  {
+    TEST_ASSERT_EQUAL_INT((long)asset.rawLen, gunzip(asset));
+    TEST_ASSERT_LESS_THAN(asset.rawLen, asset.len);
+  }
+}
+
+// mtime=0 IN THE GZIP HEADER, SO THE SAME web/ ALWAYS GIVES THE SAME BYTES AND ETAGS
+static void test_gzip_output_is_reproducible()
+{
+  for (const WebAsset &asset : WEB_ASSETS)
+  {
+    TEST_ASSERT_EQUAL_HEX8(0x1f, asset.data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x8b, asset.data[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x08, asset.data[2]); // Deflate
+    for (int i = 4; i < 8; i++)
+      TEST_ASSERT_EQUAL_HEX8(0, asset.data[i]);
+  }
+}
+
+// "<FIRST 16 HEX DIGITS OF THE SHA-256 OF THE GZIPPED BYTES>", DIFFERENT FOR EVERY ASSET
+static void test_etag_is_quoted_hash_of_gzipped_bytes()
+{
+  for (size_t i = 0; i < WEB_ASSET_COUNT; i++)
+  {
+    const WebAsset &asset = WEB_ASSETS[i];
+    uint8_t digest[32];
+    TEST_ASSERT_EQUAL_INT(0, mbedtls_sha256(asset.data, asset.len, digest, 0));
+    char expected[19];
+    expected[0] = '"';
+    for (int b = 0; b < 8; b++)
+      snprintf(expected + 1 + 2 * b, 3, "%02x", digest[b]);
+    expected[17] = '"';
+    expected[18] = 0;
+    TEST_ASSERT_EQUAL_STRING(expected, asset.etag);
+    for (size_t j = 0; j < i; j++)
+      TEST_ASSERT_TRUE(strcmp(asset.etag, WEB_ASSETS[j].etag) != 0);
+  }
+}
+
+// THE PAGE IS REVALIDATED ON EVERY LOAD AND NAMES THE OTHER ASSETS BY HASH, SO THOSE ARE CACHED FOR GOOD
+static void test_page_revalidates_and_names_immutable_assets_by_hash()
+{
+  const WebAsset *page = assetAt("/");
+  TEST_ASSERT_NOT_NULL(page);
+  TEST_ASSERT_EQUAL_STRING("no-cache", page->cacheControl);
+  TEST_ASSERT_NOT_NULL(strstr(page->contentType, "text/html"));
+  TEST_ASSERT_TRUE(gunzip(*page) > 0);
+  TEST_ASSERT_NULL(strstr(inflated, "{{")); // Every placeholder replaced
+
+  for (const WebAsset &asset : WEB_ASSETS)
+  {
+    if (&asset == page)
+      continue;
+    TEST_ASSERT_NOT_NULL(strstr(asset.cacheControl, "immutable"));
+    char reference[64];
+    snprintf(reference, sizeof(reference), "%s?v=%.8s", asset.path + 1, asset.etag + 1);
+    TEST_ASSERT_NOT_NULL(strstr(inflated, reference));
+  }
+}
+
+// WHAT serveWebAsset() ANSWERS WITH A 304 INSTEAD OF THE BODY
+static void test_not_modified_only_for_a_current_etag()
+{
+  const WebAsset &asset = WEB_ASSETS[0];
+  const WebAsset &other = WEB_ASSETS[1];
+  char header[96];
+  TEST_ASSERT_FALSE(webAssetNotModified(asset, nullptr));
+  TEST_ASSERT_FALSE(webAssetNotModified(asset, ""));
+  TEST_ASSERT_TRUE(webAssetNotModified(asset, asset.etag));
+  TEST_ASSERT_TRUE(webAssetNotModified(asset, "*"));
+  snprintf(header, sizeof(header), "W/%s", asset.etag);
+  TEST_ASSERT_TRUE(webAssetNotModified(asset, header));
+  snprintf(header, sizeof(header), "%s, %s", other.etag, asset.etag);
+  TEST_ASSERT_TRUE(webAssetNotModified(asset, header));
+  TEST_ASSERT_FALSE(webAssetNotModified(asset, other.etag));
+  TEST_ASSERT_FALSE(webAssetNotModified(asset, "\"0000000000000000\"")); // A previous build's copy
+}
+
+// BYTES A FIRST VISIT DOWNLOADS, GZIPPED AGAINST PLAIN
+static void test_page_load_bytes()
+{
+  size_t rawBytes = 0, sentBytes = 0;
+  for (const WebAsset &asset : WEB_ASSETS)
+  {
+    rawBytes += asset.rawLen;
+    sentBytes += asset.len;
+  }
+  char report[128];
+  snprintf(report, sizeof(report), "%u assets: %u bytes plain, %u gzipped (%u%% less), repeat visit: 1 revalidation (304)",
+           (unsigned)WEB_ASSET_COUNT, (unsigned)rawBytes, (unsigned)sentBytes,
+           (unsigned)(100 - 100 * sentBytes / rawBytes));
+  TEST_MESSAGE(report);
+  TEST_ASSERT_LESS_THAN(rawBytes * 40 / 100, sentBytes);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_every_asset_inflates_to_its_raw_size);
+  RUN_TEST(test_gzip_output_is_reproducible);
+  RUN_TEST(test_etag_is_quoted_hash_of_gzipped_bytes);
+  RUN_TEST(test_page_revalidates_and_names_immutable_assets_by_hash);
+  RUN_TEST(test_not_modified_only_for_a_current_etag);
+  RUN_TEST(test_page_load_bytes);
+  return UNITY_END();
+}
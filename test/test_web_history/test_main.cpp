@@ -0,0 +1,187 @@
+#include <unity.h>
+#include "web_history.h"
+
+// HOST TESTS FOR THE NODE-SIDE EVENT HISTORY: THE RING WRAPS AND EVICTS WHOLE RECORDS, AND A CLIENT'S
+// CURSOR KEEPS FINDING THE NEXT EVENT IT NEEDS WHILE APPENDS OVERTAKE IT (NO PSRAM ON THE HOST, SO
+// THE RING IS WEB_HISTORY_RAM_BYTES)
+
+#define EVENT_LEN_MAX 1200
+
+// AN EVENT AS web_manager.cpp STORES IT - JSON THAT CARRIES ITS OWN SEQUENCE NUMBER - PADDED TO len
+static uint32_t appendEvent(size_t len)
+{
+  char event[EVENT_LEN_MAX];
+  uint32_t seq = historyNextSeq();
+  int prefix = snprintf(event, sizeof(event), "{\"seq\":%u,\"pad\":\"", (unsigned)seq);
+  TEST_ASSERT_LESS_OR_EQUAL(EVENT_LEN_MAX, len);
+  TEST_ASSERT_GREATER_THAN((size_t)prefix + 2, len);
+  memset(event + prefix, 'x', len - prefix - 2);
+  memcpy(event + len - 2, "\"}", 2);
+  TEST_ASSERT_EQUAL_UINT32(seq, historyAppend(event, len));
+  return seq;
+}
+
+// THE SEQUENCE NUMBER A PEEKED EVENT CARRIES, OR 0 IF IT IS NOT ONE appendEvent() WROTE
+static uint32_t eventSeq(const char *event, uint16_t len)
+{
+  unsigned seq = 0;
+  char text[EVENT_LEN_MAX + 1];
+  if (len > EVENT_LEN_MAX || len < 4 || memcmp(event + len - 2, "\"}", 2) != 0)
+    return 0;
+  memcpy(text, event, len);
+  text[len] = 0;
+  return sscanf(text, "{\"seq\":%u,", &seq) == 1 ? seq : 0;
+}
+
+// AN EVENT TOO BIG FOR THE RING EMPTIES IT, SO EACH TEST STARTS FROM NOTHING STORED
+static void emptyRing()
+{
+  static char tooBig[WEB_HISTORY_RAM_BYTES];
+  historyAppend(tooBig, sizeof(tooBig));
+  TEST_ASSERT_EQUAL_UINT32(historyNextSeq(), historyOldestSeq());
+  TEST_ASSERT_EQUAL_size_t(0, historyBytes());
+}
+
+// WALK EVERYTHING A CLIENT THAT LAST SAW lastSeen WOULD BE SENT, CHECKING THE EVENTS ARE WHOLE AND
+// CONSECUTIVE FROM THE OLDEST STILL HELD, RETURNS HOW MANY THERE WERE
+static uint32_t replayFrom(uint32_t lastSeen)
+{
+  WebHistoryCursor cursor = historySeek(lastSeen);
+  uint32_t expected = (int32_t)(lastSeen + 1 - historyOldestSeq()) < 0 ? historyOldestSeq() : lastSeen + 1;
+  uint32_t count = 0;
+  const char *event;
+  uint16_t len;
+  while ((event = historyPeek(cursor, &len)))
+  {
+    TEST_ASSERT_EQUAL_UINT32(expected, cursor.seq);
+    TEST_ASSERT_EQUAL_UINT32(expected, eventSeq(event, len));
+    historyAdvance(cursor);
+    expected++;
+    count++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(historyNextSeq(), cursor.seq);
+  return count;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_events_come_back_in_order()
+{
+  emptyRing();
+  uint32_t first = historyNextSeq();
+  for (int i = 0; i < 10; i++)
+    appendEvent(40 + i);
+  TEST_ASSERT_EQUAL_UINT32(first, historyOldestSeq());
+  TEST_ASSERT_EQUAL_UINT32(first + 9, historyHeadSeq());
+  TEST_ASSERT_EQUAL_UINT32(10, replayFrom(first - 1));
+  TEST_ASSERT_EQUAL_UINT32(3, replayFrom(first + 6));
+  TEST_ASSERT_EQUAL_UINT32(0, replayFrom(historyHeadSeq()));
+  TEST_ASSERT_EQUAL_UINT32(0, replayFrom(historyHeadSeq() + 5)); // A client ahead of us, caught up
+}
+
+// RECORDS OF UNEVEN SIZE WRAP THE RING MANY TIMES - EVERY EVENT STILL HELD READS BACK WHOLE AND
+// THE OLDEST ONES GO FIRST
+static void test_wrapping_evicts_whole_records_oldest_first()
+{
+  emptyRing();
+  uint32_t first = historyNextSeq();
+  uint32_t oldest = historyOldestSeq();
+  for (int i = 0; i < 400; i++)
+  {
+    appendEvent(30 + (i * 97) % 900);
+    TEST_ASSERT_LESS_OR_EQUAL(WEB_HISTORY_RAM_BYTES, historyBytes());
+    TEST_ASSERT_FALSE((int32_t)(historyOldestSeq() - oldest) < 0);
+    oldest = historyOldestSeq();
+    TEST_ASSERT_EQUAL_UINT32(historyHeadSeq() - oldest + 1, replayFrom(0));
+  }
+  TEST_ASSERT_TRUE((int32_t)(historyOldestSeq() - first) > 300);
+  TEST_ASSERT_GREATER_THAN(WEB_HISTORY_RAM_BYTES / 2, historyBytes());
+}
+
+// A CLIENT TOO SLOW FOR THE RING SKIPS TO THE OLDEST EVENT STILL HELD AND CARRIES ON FROM THERE
+static void test_overtaken_cursor_skips_to_oldest()
+{
+  emptyRing();
+  appendEvent(200);
+  WebHistoryCursor cursor = historySeek(historyOldestSeq() - 1);
+  uint16_t len;
+  TEST_ASSERT_NOT_NULL(historyPeek(cursor, &len));
+  historyAdvance(cursor);
+  for (int i = 0; i < 100; i++)
+    appendEvent(500);
+  uint32_t oldest = historyOldestSeq();
+  TEST_ASSERT_TRUE((int32_t)(cursor.seq - oldest) < 0);
+
+  const char *event = historyPeek(cursor, &len);
+  TEST_ASSERT_NOT_NULL(event);
+  TEST_ASSERT_EQUAL_UINT32(oldest, cursor.seq);
+  TEST_ASSERT_EQUAL_UINT32(oldest, eventSeq(event, len));
+  uint32_t count = 0;
+  while (historyPeek(cursor, &len))
+  {
+    historyAdvance(cursor);
+    count++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(historyHeadSeq() - oldest + 1, count);
+}
+
+// A CAUGHT-UP CLIENT WAITS AT THE HEAD - THE NEXT EVENT MAY BE STORED BACK AT THE START OF THE RING
+static void test_cursor_parked_at_head_survives_a_wrap()
+{
+  emptyRing();
+  WebHistoryCursor cursor = historySeek(historyHeadSeq());
+  uint16_t len;
+  TEST_ASSERT_NULL(historyPeek(cursor, &len));
+  for (int i = 0; i < 2000; i++)
+  {
+    cursor = historySeek(historyHeadSeq());
+    uint32_t seq = appendEvent(EVENT_LEN_MAX - (i * 131) % 700);
+    const char *event = historyPeek(cursor, &len);
+    TEST_ASSERT_NOT_NULL(event);
+    TEST_ASSERT_EQUAL_UINT32(seq, eventSeq(event, len));
+    historyAdvance(cursor);
+    TEST_ASSERT_NULL(historyPeek(cursor, &len));
+  }
+
+  // PARKED ACROSS SEVERAL APPENDS THAT WRAP, AND ACROSS ENOUGH TO BE OVERTAKEN
+  for (int appends = 1; appends < 40; appends += 3)
+  {
+    cursor = historySeek(historyHeadSeq());
+    uint32_t first = historyNextSeq();
+    for (int i = 0; i < appends; i++)
+      appendEvent(EVENT_LEN_MAX);
+    const char *event = historyPeek(cursor, &len);
+    TEST_ASSERT_NOT_NULL(event);
+    uint32_t expected = (int32_t)(first - historyOldestSeq()) < 0 ? historyOldestSeq() : first;
+    TEST_ASSERT_EQUAL_UINT32(expected, eventSeq(event, len));
+  }
+}
+
+// THE RING ONLY HOLDS CONSECUTIVE EVENTS, SO ONE IT CANNOT HOLD EMPTIES IT AND WAITING CLIENTS SKIP IT
+static void test_event_too_big_for_the_ring_empties_it()
+{
+  emptyRing();
+  appendEvent(100);
+  WebHistoryCursor cursor = historySeek(historyHeadSeq());
+  emptyRing();
+  uint16_t len;
+  TEST_ASSERT_NULL(historyPeek(cursor, &len));
+  uint32_t seq = appendEvent(100);
+  const char *event = historyPeek(cursor, &len);
+  TEST_ASSERT_NOT_NULL(event);
+  TEST_ASSERT_EQUAL_UINT32(seq, eventSeq(event, len));
+  TEST_ASSERT_EQUAL_UINT32(seq, cursor.seq);
+}
+
+int main(int argc, char **argv)
+{
+  historySetup();
+  UNITY_BEGIN();
+  RUN_TEST(test_events_come_back_in_order);
+  RUN_TEST(test_wrapping_evicts_whole_records_oldest_first);
+  RUN_TEST(test_overtaken_cursor_skips_to_oldest);
+  RUN_TEST(test_cursor_parked_at_head_survives_a_wrap);
+  RUN_TEST(test_event_too_big_for_the_ring_empties_it);
+  return UNITY_END();
+}
@@ -0,0 +1,202 @@
+#include <unity.h>
+#include "web_history.h"
+#include "web_manager.h"
+
+// HOST TESTS FOR THE WEBSOCKET SIDE OF THE UI: A LOOP TICK'S EVENTS REACH EACH PHONE AS ONE FRAME, IN THE ENCODING
+// ITS HELLO ASKED FOR, AND A PHONE THAT STOPS DRAINING ITS QUEUE IS CAUGHT UP FROM THE HISTORY RING INSTEAD OF
+// BUFFERING WITHOUT BOUND, WITH SUPERSEDED ACK UPDATES LEFT OUT. THE PHONES ARE THE SHIM'S WEBSOCKET CLIENTS
+#define CLIENT_BYTE_BUDGET 8192 // WEB_CLIENT_BYTE_BUDGET in web_manager.cpp
+#define MAX_PHONES 4
+#define BIG_TEXT_LEN 400
+
+static AsyncWebSocketClient *phones[MAX_PHONES];
+static size_t phoneCount = 0;
+
+// A PHONE THAT HAS LOADED THE PAGE AND SAID HELLO, LAST HAVING SEEN lastSeq - AFTER ONE LOOP TICK ITS FRAMES
+// ARE THE IDENTITY MESSAGE AND ITS FIRST HISTORY BATCH
+static AsyncWebSocketClient *hello(const char *encoding, uint32_t lastSeq)
+{
+  TEST_ASSERT_LESS_THAN(MAX_PHONES, phoneCount);
+  AsyncWebSocketClient *phone = ws.nativeConnect();
+  phones[phoneCount++] = phone;
+  char message[160];
+  snprintf(message, sizeof(message), "{\"type\":\"hello\",\"history_id\":%u,\"last_seq\":%u,\"encoding\":\"%s\"}",
+           (unsigned)historyId(), (unsigned)lastSeq, encoding);
+  ws.nativeReceive(phone, message);
+  loopWebManager();
+  TEST_ASSERT_EQUAL_size_t(2, phone->nativeFrames.size());
+  TEST_ASSERT_EQUAL_STRING_LEN("{\"type\":\"history\"", phone->nativeFrames[1].data.c_str(), 17);
+  return phone;
+}
+
+// A PHONE THAT IS UP TO DATE AND RECEIVING LIVE EVENTS, NOTHING IN ITS QUEUE
+static AsyncWebSocketClient *joinLive(const char *encoding)
+{
+  AsyncWebSocketClient *phone = hello(encoding, historyHeadSeq());
+  phone->nativeFrames.clear();
+  phone->nativeDrain();
+  return phone;
+}
+
+// WHAT A PHONE THAT NEVER DRAINED STILL HAS QUEUED
+static size_t queuedBytes(const AsyncWebSocketClient *phone)
+{
+  size_t bytes = 0;
+  for (const NativeWsFrame &frame : phone->nativeFrames)
+    bytes += frame.data.size();
+  return bytes;
+}
+
+static size_t occurrences(const std::string &text, const char *needle)
+{
+  size_t count = 0;
+  for (size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1))
+    count++;
+  return count;
+}
+
+static void put32(std::string &out, uint32_t value)
+{
+  for (int i = 0; i < 4; i++)
+    out += (char)(value >> (8 * i));
+}
+
+void setUp() {}
+
+// EVERY TEST'S PHONES GO AWAY, FREEING THEIR SLOTS
+void tearDown()
+{
+  for (size_t i = 0; i < phoneCount; i++)
+    ws.nativeDisconnect(phones[i]);
+  phoneCount = 0;
+  loopWebManager();
+}
+
+// THE TICK'S EVENTS ARE HELD TO ITS END, THEN EACH PHONE GETS ONE FRAME: JSON ESCAPED, BINARY AS RECEIVED
+static void test_tick_events_share_one_frame_per_encoding()
+{
+  AsyncWebSocketClient *jsonPhone = joinLive("json");
+  AsyncWebSocketClient *binaryPhone = joinLive("binary");
+  uint32_t first = historyNextSeq();
+  sendLoRaTextToWebSocket("Node-0002", "Say \"hi\"\n", 9);
+  sendLoraAckStatusToWebSocket("web-7", 0x00050001, true, false);
+  TEST_ASSERT_EQUAL_size_t(0, jsonPhone->nativeFrames.size());
+  TEST_ASSERT_EQUAL_size_t(0, binaryPhone->nativeFrames.size());
+  loopWebManager();
+
+  char json[256];
+  snprintf(json, sizeof(json),
+           "{\"type\":\"events\",\"events\":[{\"seq\":%u,\"sender\":\"Node-0002\",\"text\":\"Say \\\"hi\\\"\\n\"},"
+           "{\"seq\":%u,\"type\":\"ack_status\",\"local_id\":\"web-7\",\"lora_msg_id\":327681,\"status\":\"acked\"}]}",
+           (unsigned)first, (unsigned)(first + 1));
+  TEST_ASSERT_EQUAL_size_t(1, jsonPhone->nativeFrames.size());
+  TEST_ASSERT_FALSE(jsonPhone->nativeFrames[0].binary);
+  TEST_ASSERT_EQUAL_STRING(json, jsonPhone->nativeFrames[0].data.c_str());
+
+  // VERSION, EVENT COUNT, THEN RX (SENDER, 16-BIT TEXT LENGTH) AND ACK STATUS (LOCAL ID, LORA MESSAGE ID, STATUS)
+  std::string binary = {1, 2, 1};
+  put32(binary, first);
+  binary += std::string("\x09Node-0002\x09\x00Say \"hi\"\n", 21);
+  binary += (char)2;
+  put32(binary, first + 1);
+  binary += "\x05web-7";
+  put32(binary, 0x00050001);
+  binary += (char)1;
+  TEST_ASSERT_EQUAL_size_t(1, binaryPhone->nativeFrames.size());
+  TEST_ASSERT_TRUE(binaryPhone->nativeFrames[0].binary);
+  TEST_ASSERT_EQUAL_size_t(binary.size(), binaryPhone->nativeFrames[0].data.size());
+  TEST_ASSERT_EQUAL_MEMORY(binary.data(), binaryPhone->nativeFrames[0].data.data(), binary.size());
+
+  // A QUIET TICK SENDS NOTHING
+  loopWebManager();
+  TEST_ASSERT_EQUAL_size_t(1, jsonPhone->nativeFrames.size());
+  TEST_ASSERT_EQUAL_size_t(1, binaryPhone->nativeFrames.size());
+}
+
+// A PHONE THAT STOPS DRAINING GETS LIVE FRAMES ONLY WHILE THEY FIT ITS BUDGET, THE OTHERS CARRY ON UNAFFECTED,
+// AND ONCE IT HAS DRAINED IT IS SENT EVERYTHING IT MISSED FROM THE RING BEFORE GOING LIVE AGAIN
+static void test_a_slow_phone_is_caught_up_from_the_ring()
+{
+  AsyncWebSocketClient *slow = joinLive("json");
+  AsyncWebSocketClient *fast = joinLive("binary");
+  char text[BIG_TEXT_LEN + 1];
+  memset(text, 'm', BIG_TEXT_LEN);
+  text[BIG_TEXT_LEN] = 0;
+
+  bool missedAny = false;
+  uint32_t firstMissed = 0;
+  uint32_t lastSent = 0;
+  for (int tick = 0; tick < 30; tick++)
+  {
+    size_t framesBefore = slow->nativeFrames.size();
+    lastSent = historyNextSeq();
+    sendLoRaTextToWebSocket("Node-0002", text, BIG_TEXT_LEN);
+    loopWebManager();
+    fast->nativeDrain();
+    TEST_ASSERT_LESS_OR_EQUAL(CLIENT_BYTE_BUDGET, queuedBytes(slow));
+    if (slow->nativeFrames.size() == framesBefore && !missedAny)
+    {
+      missedAny = true;
+      firstMissed = lastSent;
+    }
+  }
+  TEST_ASSERT_TRUE(missedAny);
+  TEST_ASSERT_EQUAL_size_t(30, fast->nativeFrames.size());
+
+  // DRAINED: THE CATCH-UP STARTS AT THE FIRST EVENT IT MISSED AND REACHES THE HEAD
+  size_t live = slow->nativeFrames.size();
+  std::string caughtUp;
+  for (int tick = 0; tick < 10; tick++)
+  {
+    slow->nativeDrain();
+    loopWebManager();
+  }
+  TEST_ASSERT_TRUE(slow->nativeFrames.size() > live);
+  for (size_t i = live; i < slow->nativeFrames.size(); i++)
+  {
+    TEST_ASSERT_EQUAL_STRING_LEN("{\"type\":\"history\"", slow->nativeFrames[i].data.c_str(), 17);
+    caughtUp += slow->nativeFrames[i].data;
+  }
+  char seq[32];
+  snprintf(seq, sizeof(seq), "{\"seq\":%u,", (unsigned)(firstMissed - 1));
+  TEST_ASSERT_EQUAL_size_t(0, occurrences(caughtUp, seq));
+  for (uint32_t missed = firstMissed; missed != lastSent + 1; missed++)
+  {
+    snprintf(seq, sizeof(seq), "{\"seq\":%u,", (unsigned)missed);
+    TEST_ASSERT_EQUAL_size_t(1, occurrences(caughtUp, seq));
+  }
+
+  // AND IS LIVE AGAIN
+  size_t caughtUpFrames = slow->nativeFrames.size();
+  sendLoRaTextToWebSocket("Node-0002", "Back", 4);
+  loopWebManager();
+  TEST_ASSERT_EQUAL_size_t(caughtUpFrames + 1, slow->nativeFrames.size());
+  TEST_ASSERT_EQUAL_STRING_LEN("{\"type\":\"events\"", slow->nativeFrames.back().data.c_str(), 16);
+}
+
+// A PHONE CATCHING UP ONLY NEEDS THE LATEST STATUS OF EACH MESSAGE, NOT EVERY RETRY'S pending_ack ON THE WAY
+static void test_catch_up_keeps_only_the_latest_ack_status()
+{
+  uint32_t lastSeen = historyHeadSeq();
+  sendLoraAckStatusToWebSocket("web-9", 0x00050010, false, false);
+  sendLoraAckStatusToWebSocket("web-8", 0x00050011, false, false);
+  sendLoraAckStatusToWebSocket("web-9", 0x00050010, false, false);
+  sendLoraAckStatusToWebSocket("web-9", 0x00050010, true, false);
+  loopWebManager();
+
+  AsyncWebSocketClient *away = hello("json", lastSeen);
+  const std::string &batch = away->nativeFrames[1].data;
+  TEST_ASSERT_EQUAL_size_t(1, occurrences(batch, "\"local_id\":\"web-9\""));
+  TEST_ASSERT_EQUAL_size_t(1, occurrences(batch, "\"local_id\":\"web-9\",\"lora_msg_id\":327696,\"status\":\"acked\""));
+  TEST_ASSERT_EQUAL_size_t(1, occurrences(batch, "\"local_id\":\"web-8\",\"lora_msg_id\":327697,\"status\":\"pending_ack\""));
+}
+
+int main(int argc, char **argv)
+{
+  setupWebServer(String("BigNode"), String("LoRaChat"), String("password"));
+  UNITY_BEGIN();
+  RUN_TEST(test_tick_events_share_one_frame_per_encoding);
+  RUN_TEST(test_a_slow_phone_is_caught_up_from_the_ring);
+  RUN_TEST(test_catch_up_keeps_only_the_latest_ack_status);
+  return UNITY_END();
+}
@@ -0,0 +1,417 @@
+const chatbox = document.getElementById('chatbox');
+const chatSpacer = document.getElementById('chatSpacer');
+const chatRows = document.getElementById('chatRows');
+const messageInput = document.getElementById('messageInput');
+const sendButton = document.getElementById('sendButton');
+const recipientSelect = document.getElementById('recipientSelect');
+const connectionStatusElement = document.getElementById('connectionStatus');
+const pageTitleElement = document.getElementById('pageTitle');
+let websocket;
+let myDeviceId = 'UnknownDevice';
+let boardName = 'Node';
+// NODE HISTORY POSITION - EVERY EVENT FROM THE NODE CARRIES A SEQUENCE NUMBER FROM ITS CURRENT BOOT
+let historyId = Number(localStorage.getItem('loraHistoryId')) || 0;
+let lastSeq = Number(localStorage.getItem('loraLastSeq')) || 0;
+let resyncing = false;
+// A HELLO THE NODE HAD NO ROOM FOR GOES UNANSWERED, SO IT IS SENT AGAIN UNTIL THE FIRST HISTORY BATCH ARRIVES
+const HELLO_RETRY_MS = 3000;
+let helloRetryTimer = null;
+// LIVE EVENTS ARRIVE AS BINARY FRAMES UNLESS THE PAGE IS OPENED WITH ?json (READABLE IN THE BROWSER'S DEVTOOLS)
+const useBinary = !new URLSearchParams(window.location.search).has('json');
+
+function generateLocalId() { return 'local_msg_' + Date.now() + '_' + Math.random().toString(36).substr(2, 5); }
+function getCurrentTime() { return new Date().toLocaleTimeString([], { hour: '2-digit', minute: '2-digit' }); }
+
+function updateConnectionStatus(status) {
+    connectionStatusElement.className = ''; 
+    let statusTitle = 'Connection Status';
+    if (status === 'connected') { connectionStatusElement.classList.add('status-connected'); statusTitle = 'Connected to ' + boardName; }
+    else if (status === 'disconnected') { connectionStatusElement.classList.add('status-disconnected'); statusTitle = 'Disconnected from ' + boardName; }
+    else { connectionStatusElement.classList.add('status-connecting'); statusTitle = 'Connecting to ' + boardName + '...'; }
+    connectionStatusElement.title = statusTitle;
+}
+
+function updateRecipients(recipients) {
+    const selected = recipientSelect.value;
+    recipientSelect.innerHTML = '';
+    recipients.forEach(r => {
+        const option = document.createElement('option');
+        option.value = r.address;
+        option.textContent = r.name;
+        recipientSelect.appendChild(option);
+    });
+    if (recipientSelect.querySelector(`option[value="${selected}"]`)) { recipientSelect.value = selected; }
+}
+
+// CHAT RECORDS - ONE PLAIN OBJECT PER MESSAGE, IN DISPLAY ORDER, MIRRORED TO INDEXEDDB
+// THE LIST IS VIRTUALIZED: ONLY ROWS NEAR THE VISIBLE PART OF THE CHATBOX ARE IN THE DOM
+// ONLY THE LATEST RECORDS ARE LOADED AT START, OLDER ONES A PAGE AT A TIME AS THE USER SCROLLS UP TO THEM
+const ROW_ESTIMATE_PX = 64, OVERSCAN_PX = 400;
+const RECORD_PAGE_LEN = 200;
+let records = [];
+const recordsByLocalId = new Map();
+let rowHeights = [];            // Measured height of each row, an estimate until it is first shown
+let rowOffsets = [0];           // Top of each row, valid up to offsetsValidTo
+let offsetsValidTo = 0;
+let nextRecordKey = 1;
+let olderRecordsStored = false; // IndexedDB holds records before records[0]
+let loadingOlder = false;
+let stickToBottom = true;
+let renderQueued = false;
+const renderedRows = new Map(); // Record index -> row element in the DOM
+
+function rowTop(index) {
+    for (; offsetsValidTo < index; offsetsValidTo++) { rowOffsets[offsetsValidTo + 1] = rowOffsets[offsetsValidTo] + rowHeights[offsetsValidTo]; }
+    return rowOffsets[index];
+}
+function setRowHeight(index, height) {
+    if (rowHeights[index] === height) { return false; }
+    rowHeights[index] = height;
+    offsetsValidTo = Math.min(offsetsValidTo, index);
+    return true;
+}
+
+function buildRow(rec) {
+    const row = document.createElement('div');
+    row.className = 'chat-row';
+    const msgDiv = document.createElement('div');
+    if (rec.kind === 'system-message') { msgDiv.className = 'system-message'; }
+    else {
+        msgDiv.className = 'message ' + rec.kind + (rec.status ? ' status-' + rec.status.replace('_', '-') : '');
+        const senderInfoSpan = document.createElement('span');
+        senderInfoSpan.className = 'sender-info';
+        senderInfoSpan.textContent = rec.label || ((rec.kind === 'sent') ? `Me (${rec.sender})` : rec.sender);
+        if (rec.recipient) { senderInfoSpan.textContent += ` \u2192 ${rec.recipient}`; }
+        msgDiv.appendChild(senderInfoSpan);
+    }
+    const contentSpan = document.createElement('span');
+    contentSpan.textContent = rec.text;
+    msgDiv.appendChild(contentSpan);
+    const timestampSpan = document.createElement('span');
+    timestampSpan.className = 'timestamp';
+    timestampSpan.textContent = rec.time;
+    msgDiv.appendChild(timestampSpan);
+    row.appendChild(msgDiv);
+    return row;
+}
+
+function scheduleRender() {
+    if (!renderQueued) { renderQueued = true; requestAnimationFrame(renderRows); }
+}
+
+// REBUILD THE ROWS AROUND THE SCROLL POSITION, THEN MEASURE THEM - ROWS OUTSIDE KEEP THEIR LAST HEIGHT
+function renderRows() {
+    renderQueued = false;
+    if (stickToBottom) { chatSpacer.style.height = rowTop(records.length) + 'px'; chatbox.scrollTop = chatbox.scrollHeight; }
+    const top = chatbox.scrollTop - OVERSCAN_PX, bottom = chatbox.scrollTop + chatbox.clientHeight + OVERSCAN_PX;
+    rowTop(records.length);
+    let first = 0, last = records.length;
+    while (first < last) { const mid = (first + last) >> 1; if (rowTop(mid + 1) <= top) { first = mid + 1; } else { last = mid; } }
+    let end = first;
+    while (end < records.length && rowTop(end) < bottom) { end++; }
+
+    const fragment = document.createDocumentFragment();
+    renderedRows.clear();
+    for (let i = first; i < end; i++) { const row = buildRow(records[i]); renderedRows.set(i, row); fragment.appendChild(row); }
+    chatRows.replaceChildren(fragment);
+    renderedRows.forEach((row, i) => setRowHeight(i, row.offsetHeight));
+    chatRows.style.transform = `translateY(${rowTop(first)}px)`;
+    chatSpacer.style.height = rowTop(records.length) + 'px';
+    if (stickToBottom) { chatbox.scrollTop = chatbox.scrollHeight; }
+}
+
+function addRecord(rec) {
+    records.push(rec);
+    rowHeights.push(ROW_ESTIMATE_PX);
+    if (rec.localId) { recordsByLocalId.set(rec.localId, rec); }
+    scheduleRender();
+}
+
+// PUT A PAGE OF OLDER RECORDS IN FRONT, KEEPING THE ROWS ON SCREEN WHERE THEY ARE
+function prependRecords(older) {
+    if (older.length === 0) { return; }
+    records = older.concat(records);
+    rowHeights = older.map(() => ROW_ESTIMATE_PX).concat(rowHeights);
+    offsetsValidTo = 0;
+    older.forEach(rec => { if (rec.localId) { recordsByLocalId.set(rec.localId, rec); } });
+    chatSpacer.style.height = rowTop(records.length) + 'px';
+    chatbox.scrollTop += older.length * ROW_ESTIMATE_PX;
+    scheduleRender();
+}
+
+function appendMessage(text, sender, typeOverride = null, localId = null, recipient = null) {
+    const kind = typeOverride || ((sender === myDeviceId) ? 'sent' : 'received');
+    const rec = { key: nextRecordKey++, kind: kind, sender: sender, recipient: recipient, text: String(text), time: getCurrentTime(), localId: localId, status: null };
+    addRecord(rec);
+    saveRecord(rec);
+}
+
+function updateMessageStatus(localId, status) {
+    const rec = recordsByLocalId.get(localId);
+    if (!rec) { updateStoredStatus(localId, status); return; }
+    if (rec.status === status) { return; }
+    rec.status = status;
+    saveRecord(rec);
+    renderedRows.forEach((row, i) => { if (records[i] === rec) { scheduleRender(); } });
+}
+
+function noteSeq(seq) { lastSeq = seq; localStorage.setItem('loraLastSeq', lastSeq); }
+
+// ASK THE NODE FOR EVERYTHING AFTER THE LAST EVENT WE SAW, IT ANSWERS WITH 'history' BATCHES
+function requestResync() {
+    if (!websocket || websocket.readyState !== WebSocket.OPEN) { return; }
+    resyncing = true;
+    websocket.send(JSON.stringify({ type: 'hello', history_id: historyId, last_seq: lastSeq, encoding: useBinary ? 'binary' : 'json' }));
+    clearTimeout(helloRetryTimer);
+    helloRetryTimer = setTimeout(() => { helloRetryTimer = null; if (resyncing) { requestResync(); } }, HELLO_RETRY_MS);
+}
+
+// DECODE A BINARY EVENT FRAME INTO THE SAME EVENTS THE JSON FRAMES CARRY (LAYOUT IN web_manager.cpp)
+const EVENT_STATUSES = ['pending_ack', 'acked', 'failed_ack'];
+const utf8Decoder = new TextDecoder();
+function decodeEventFrame(buffer) {
+    const view = new DataView(buffer);
+    const bytes = new Uint8Array(buffer);
+    const events = [];
+    if (view.getUint8(0) !== 1) { console.error('Unknown event frame version', view.getUint8(0)); return events; }
+    let pos = 2;
+    const string = len => { const s = utf8Decoder.decode(bytes.subarray(pos, pos + len)); pos += len; return s; };
+    const string8 = () => string(view.getUint8(pos++));
+    const string16 = () => { const len = view.getUint16(pos, true); pos += 2; return string(len); };
+    for (let count = view.getUint8(1); count > 0; count--) {
+        const type = view.getUint8(pos);
+        const ev = { seq: view.getUint32(pos + 1, true) };
+        pos += 5;
+        if (type === 1) { ev.sender = string8(); ev.text = string16(); }
+        else if (type === 2) {
+            ev.type = 'ack_status';
+            ev.local_id = string8();
+            ev.lora_msg_id = view.getUint32(pos, true);
+            ev.status = EVENT_STATUSES[view.getUint8(pos + 4)];
+            pos += 5;
+        } else if (type === 3) { ev.type = 'sent'; ev.local_id = string8(); ev.to = string8(); ev.text = string16(); }
+        else { console.error('Unknown event type', type); break; }
+        events.push(ev);
+    }
+    return events;
+}
+
+// APPLY A SEQUENCED EVENT ONCE AND IN ORDER - A LIVE EVENT AFTER A GAP MEANS WE MISSED SOME, SO CATCH UP
+function applyEvent(ev, fromHistory) {
+    if (ev.seq <= lastSeq) { return; }
+    if (ev.seq !== lastSeq + 1 && !fromHistory) { if (!resyncing) { requestResync(); } return; }
+    noteSeq(ev.seq);
+    if (ev.type === 'ack_status') { updateMessageStatus(ev.local_id, ev.status); }
+    else if (ev.type === 'sent') {
+        if (!recordsByLocalId.has(ev.local_id)) { appendMessage(ev.text, myDeviceId, 'sent', ev.local_id, ev.to); }
+    }
+    else if (ev.sender && ev.text) { appendMessage(ev.text, ev.sender); }
+}
+
+function applyHistory(batch) {
+    if (batch.history_id !== historyId) { return; }
+    clearTimeout(helloRetryTimer); // The node has this client now, the rest of the catch-up follows
+    helloRetryTimer = null;
+    // SEQUENCE NUMBERS MAY SKIP INSIDE A BATCH (STATUS UPDATES A LATER ONE REPLACED), ONLY from_seq SAYS WHAT IS LOST
+    if (lastSeq > 0 && batch.from_seq > lastSeq + 1) {
+        appendMessage(`${batch.from_seq - lastSeq - 1} older event(s) no longer held by ${boardName}.`, 'System', 'system-message');
+    }
+    batch.events.forEach(ev => applyEvent(ev, true));
+    // THE BATCH THAT REACHES head_seq (OR HAS NOTHING LEFT TO SEND) ENDS THE CATCH-UP
+    if (batch.events.length === 0 || lastSeq >= batch.head_seq) { noteSeq(Math.max(lastSeq, batch.head_seq)); resyncing = false; }
+}
+
+function initWebSocket() {
+    console.log('Attempting to connect WebSocket...');
+    updateConnectionStatus('connecting');
+    // appendMessage('Connecting to ESP32...', 'System', 'system-message'); // Initial system message is less critical now
+
+    websocket = new WebSocket(`ws://${window.location.hostname}/ws`);
+    websocket.binaryType = 'arraybuffer';
+
+    websocket.onopen = () => { console.log('WebSocket connection established'); updateConnectionStatus('connected'); };
+    websocket.onclose = () => {
+        console.log('WebSocket connection closed. Retrying...');
+        resyncing = false;
+        clearTimeout(helloRetryTimer);
+        helloRetryTimer = null;
+        updateConnectionStatus('disconnected');
+        appendMessage(`Disconnected from ${boardName}. Retrying in 3s...`, 'System', 'system-message');
+        setTimeout(initWebSocket, 3000);
+    };
+    websocket.onmessage = event => {
+        if (event.data instanceof ArrayBuffer) {
+            decodeEventFrame(event.data).forEach(ev => applyEvent(ev, false));
+            return;
+        }
+        console.log('Message from server:', event.data);
+        try {
+            const parsed = JSON.parse(event.data);
+            if (parsed.type === 'system' && parsed.event === 'identity') {
+                myDeviceId = parsed.deviceId;
+                boardName = parsed.boardName || 'Node'; // Use board name from server
+                pageTitleElement.textContent = `${boardName} LoRa Messenger`;
+                document.title = `${boardName} LoRa Messenger`;
+                if (parsed.recipients) { updateRecipients(parsed.recipients); }
+                updateConnectionStatus('connected'); // Update status with board name
+                appendMessage(`Connected to ${boardName}. Your ID: ${myDeviceId} `, 'System', 'system-message');
+                // A NEW HISTORY ID MEANS THE NODE REBOOTED - ITS SEQUENCE NUMBERS START OVER
+                if (parsed.history_id !== historyId) {
+                    historyId = parsed.history_id;
+                    localStorage.setItem('loraHistoryId', historyId);
+                    noteSeq(0);
+                }
+                requestResync();
+            } else if (parsed.type === 'history') { applyHistory(parsed); }
+            else if (parsed.type === 'events') { parsed.events.forEach(ev => applyEvent(ev, false)); }
+            else if (parsed.type === 'error') {
+                if (parsed.local_id) { updateMessageStatus(parsed.local_id, 'failed_ack'); }
+                appendMessage(`Not sent: ${parsed.message}`, 'System', 'system-message');
+            }
+            else { appendMessage(event.data, 'Peer?');  }
+        } catch (e) { console.error("Error processing message from server:", e); appendMessage(event.data, 'RawData'); }
+    };
+    websocket.onerror = error => { console.error('WebSocket Error:', error); appendMessage('WebSocket error. Check console.', 'System', 'system-message'); };
+}
+
+sendButton.onclick = () => {
+    const messageText = messageInput.value;
+    if (messageText.trim() === "" || !websocket || websocket.readyState !== WebSocket.OPEN) { return; }
+    const localMsgId = generateLocalId();
+    const to = parseInt(recipientSelect.value, 10);
+    const payload = JSON.stringify({ text: messageText, local_id: localMsgId, to: to });
+    websocket.send(payload);
+    const recipientName = recipientSelect.options[recipientSelect.selectedIndex].textContent;
+    appendMessage(messageText, myDeviceId, 'sent', localMsgId, recipientName); // Explicitly 'sent'
+    updateMessageStatus(localMsgId, 'pending_ack'); // Set initial status for UI
+    messageInput.value = "";
+    messageInput.focus();
+};
+messageInput.addEventListener('keypress', e => { if (e.key === 'Enter') { sendButton.onclick(); } });
+
+// INDEXEDDB MIRROR - WRITES ARE BATCHED INTO ONE TRANSACTION, A STATUS UPDATE REWRITES ONLY ITS OWN RECORD
+// RECORDS ARE KEYED BY THEIR ORDER AND INDEXED BY localId, SO A STATUS UPDATE FOR A MESSAGE NOT LOADED IN
+// THE PAGE IS ONE INDEX LOOKUP. WITHOUT INDEXEDDB THE CHAT STILL WORKS, IT JUST DOES NOT SURVIVE A RELOAD
+let chatDb = null;
+const dirtyRecords = new Set();
+let flushTimer = null;
+
+function openChatStore() {
+    return new Promise(resolve => {
+        if (!window.indexedDB) { resolve(null); return; }
+        const request = indexedDB.open('loraChat', 2);
+        request.onupgradeneeded = event => {
+            const store = event.oldVersion < 1 ? request.result.createObjectStore('messages', { keyPath: 'key' })
+                                               : request.transaction.objectStore('messages');
+            store.createIndex('localId', 'localId');
+        };
+        request.onsuccess = () => resolve(request.result);
+        request.onerror = () => { console.warn('IndexedDB unavailable, chat history will not persist.'); resolve(null); };
+    });
+}
+
+// UP TO RECORD_PAGE_LEN RECORDS BEFORE beforeKey (THE NEWEST ONES WITHOUT IT), OLDEST FIRST, AND
+// WHETHER THERE ARE MORE BEFORE THOSE
+function loadChatRecords(beforeKey) {
+    return new Promise(resolve => {
+        if (!chatDb) { resolve({ page: [], more: false }); return; }
+        const range = beforeKey === undefined ? null : IDBKeyRange.upperBound(beforeKey, true);
+        const request = chatDb.transaction('messages').objectStore('messages').openCursor(range, 'prev');
+        const page = [];
+        request.onsuccess = () => {
+            const cursor = request.result;
+            if (cursor && page.length < RECORD_PAGE_LEN) { page.push(cursor.value); cursor.continue(); return; }
+            resolve({ page: page.reverse(), more: !!cursor });
+        };
+        request.onerror = () => resolve({ page: [], more: false });
+    });
+}
+
+function loadOlderRecords() {
+    if (!olderRecordsStored || loadingOlder || records.length === 0) { return; }
+    loadingOlder = true;
+    const firstKey = records[0].key;
+    loadChatRecords(firstKey).then(older => {
+        loadingOlder = false;
+        if (records.length === 0 || records[0].key !== firstKey) { return; } // The chat was cleared meanwhile
+        olderRecordsStored = older.more;
+        prependRecords(older.page);
+    });
+}
+
+// STATUS OF A MESSAGE THAT IS ONLY IN INDEXEDDB, FOUND THROUGH THE localId INDEX
+function updateStoredStatus(localId, status) {
+    if (!chatDb) { console.warn(`Could not find message with local_id ${localId} to update status.`); return; }
+    const store = chatDb.transaction('messages', 'readwrite').objectStore('messages');
+    const request = store.index('localId').get(localId);
+    request.onsuccess = () => {
+        const rec = request.result;
+        if (!rec) { console.warn(`Could not find message with local_id ${localId} to update status.`); return; }
+        if (rec.status !== status) { rec.status = status; store.put(rec); }
+    };
+}
+
+function saveRecord(rec) {
+    if (!chatDb) { return; }
+    dirtyRecords.add(rec);
+    if (!flushTimer) { flushTimer = setTimeout(flushRecords, 250); }
+}
+
+function flushRecords() {
+    flushTimer = null;
+    if (!chatDb || dirtyRecords.size === 0) { return; }
+    const store = chatDb.transaction('messages', 'readwrite').objectStore('messages');
+    dirtyRecords.forEach(rec => store.put(rec));
+    dirtyRecords.clear();
+}
+
+// ONE-TIME IMPORT OF THE OLD localStorage HISTORY, WHICH HELD EACH MESSAGE'S innerHTML
+function importLegacyHistory() {
+    Object.keys(localStorage).filter(k => k.startsWith('loraChatHistory-')).forEach(k => {
+        let stored = [];
+        try { stored = JSON.parse(localStorage.getItem(k) || '[]'); } catch (e) { }
+        stored.forEach(m => {
+            const body = new DOMParser().parseFromString(m.htmlContent || '', 'text/html').body; // Inert, nothing runs
+            const kind = ['sent', 'received', 'system-message'].find(c => (m.classes || []).includes(c)) || 'received';
+            const status = ['acked', 'failed_ack', 'pending_ack'].find(s => (m.classes || []).includes('status-' + s.replace('_', '-'))) || null;
+            const rec = { key: nextRecordKey++, kind: kind, label: body.querySelector('.sender-info')?.textContent || null,
+                          text: body.querySelector('span:not([class])')?.textContent || '', time: body.querySelector('.timestamp')?.textContent || '',
+                          localId: m.localId || null, status: status };
+            addRecord(rec);
+            saveRecord(rec);
+        });
+        localStorage.removeItem(k);
+    });
+}
+
+chatbox.addEventListener('scroll', () => {
+    stickToBottom = chatbox.scrollTop + chatbox.clientHeight >= chatbox.scrollHeight - 8;
+    if (chatbox.scrollTop < OVERSCAN_PX) { loadOlderRecords(); }
+    scheduleRender();
+}, { passive: true });
+window.addEventListener('resize', scheduleRender);
+window.addEventListener('pagehide', () => { clearTimeout(flushTimer); flushRecords(); });
+
+document.getElementById('clearChatButton').onclick = () => {
+    if (confirm('Are you sure you want to clear the chat history?')) {
+        records = [];
+        recordsByLocalId.clear();
+        olderRecordsStored = false;
+        rowHeights = [];
+        offsetsValidTo = 0;
+        dirtyRecords.clear();
+        if (chatDb) { chatDb.transaction('messages', 'readwrite').objectStore('messages').clear(); }
+        appendMessage('Chat history cleared.', 'System', 'system-message');
+    }
+};
+
+window.onload = () => {
+    openChatStore().then(db => { chatDb = db; return loadChatRecords(); }).then(latest => {
+        const stored = latest.page;
+        olderRecordsStored = latest.more;
+        stored.forEach(addRecord);
+        if (stored.length > 0) { nextRecordKey = stored[stored.length - 1].key + 1; }
+        if (chatDb) { importLegacyHistory(); }
+        initWebSocket();
+    });
+};